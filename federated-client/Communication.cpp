@@ -1,17 +1,36 @@
 #include "Communication.h"
 
+static_assert(BLEConfig::TRANSFER_FRAME_BYTES >= sizeof(float) * BLEConfig::CHUNK_SIZE_SEND &&
+              BLEConfig::TRANSFER_FRAME_BYTES >= sizeof(float) * BLEConfig::CHUNK_SIZE_RECEIVE,
+              "Weight characteristics must hold a legacy chunk");
+
+Communication* Communication::instance = nullptr;
+
 Communication::Communication() : 
     lockService(BLEConfig::SERVICE_UUID),
-    // Characteristic for sending weights FROM Arduino TO Python
-    weightsReadCharacteristic(BLEConfig::WEIGHTS_READ_CHAR_UUID, BLERead | BLENotify, sizeof(float) * BLEConfig::CHUNK_SIZE_SEND),
-    // Characteristic for receiving weights FROM Python TO Arduino
-    weightsWriteCharacteristic(BLEConfig::WEIGHTS_WRITE_CHAR_UUID, BLEWrite, sizeof(float) * BLEConfig::CHUNK_SIZE_RECEIVE),
+    // Characteristic for sending weights FROM Arduino TO Python (chunks or pipelined frames)
+    weightsReadCharacteristic(BLEConfig::WEIGHTS_READ_CHAR_UUID, BLERead | BLENotify, BLEConfig::TRANSFER_FRAME_BYTES),
+    // Characteristic for receiving weights FROM Python TO Arduino; pipelined frames are unacknowledged writes
+    weightsWriteCharacteristic(BLEConfig::WEIGHTS_WRITE_CHAR_UUID, BLEWrite | BLEWriteWithoutResponse, BLEConfig::TRANSFER_FRAME_BYTES),
     controlCharacteristic(BLEConfig::CONTROL_CHAR_UUID, BLERead | BLEWrite, sizeof(uint8_t)),
     labelCharacteristic(BLEConfig::LABEL_CHAR_UUID, BLERead | BLEWrite, sizeof(int8_t)),
     predictionCharacteristic(BLEConfig::PREDICTION_CHAR_UUID, BLERead | BLENotify, sizeof(float) * 3),
     currentBufferPos(0),
-    currentSendPos(0)
+    codecRngState(0x9E3779B9u),
+    modelDecoder(encodedBuffer, sizeof(encodedBuffer)),
+    modelHeaderChecked(false),
+    transferMode(TransferMode::NONE),
+    transferReceiver(encodedBuffer, sizeof(encodedBuffer), BLEConfig::TRANSFER_FRAME_BYTES),
+    transferId(0),
+    readyFrameBytes(0),
+    readyWindow(0),
+    transferBegun(false),
+    ackPending(false),
+    lastFrameMs(0)
 {
+    memset(uploadResidual, 0, sizeof(uploadResidual));
+    memset(referenceWeights, 0, sizeof(referenceWeights));
+    memset(deltaResidual, 0, sizeof(deltaResidual));
 }
 
 bool Communication::begin() {
@@ -33,6 +52,8 @@ bool Communication::begin() {
 
     BLE.setEventHandler(BLEConnected, Communication::onBLEConnected);
     BLE.setEventHandler(BLEDisconnected, Communication::onBLEDisconnected);
+    instance = this;
+    weightsWriteCharacteristic.setEventHandler(BLEWritten, Communication::onWeightsWritten);
 
     BLE.advertise();
     Serial.println("BLE service started");
@@ -43,11 +64,22 @@ bool Communication::begin() {
 
 void Communication::update() {
     BLE.poll();
+
+    // A finished download keeps answering repeated frames until the next command, in
+    // case the central missed the final ACK
+    if (ackPending) {
+        uint8_t ack[TransferProtocol::ACK_BYTES];
+        size_t ackLength = transferReceiver.ack(ack, sizeof(ack));
+        if (ackLength == 0 || weightsReadCharacteristic.writeValue(ack, ackLength)) {
+            ackPending = false;
+        }
+    }
     
     if (controlCharacteristic.written()) {
         uint8_t command;
         controlCharacteristic.readValue(command);
         currentCommand = static_cast<Command>(command);
+        transferMode = TransferMode::NONE;
         
         switch(currentCommand) {
             case Command::GET_WEIGHTS:
@@ -63,6 +95,39 @@ void Communication::update() {
             case Command::START_CLASSIFICATION:
                 Serial.println("Received START_CLASSIFICATION command");
                 break;
+            // The commands below reuse encodedBuffer, so a partial pipelined download is dropped
+            case Command::GET_WEIGHTS_ENCODED:
+                Serial.println("Received GET_WEIGHTS_ENCODED command");
+                transferReceiver.reset();
+                break;
+            case Command::SET_WEIGHTS_ENCODED:
+                Serial.println("Received SET_WEIGHTS_ENCODED command");
+                currentBufferPos = 0;
+                transferReceiver.reset();
+                break;
+            case Command::GET_WEIGHT_DELTA:
+                Serial.println("Received GET_WEIGHT_DELTA command");
+                transferReceiver.reset();
+                break;
+            case Command::SET_MODEL:
+                Serial.println("Received SET_MODEL command");
+                modelDecoder.reset();
+                modelHeaderChecked = false;
+                transferReceiver.reset();
+                break;
+            case Command::GET_WEIGHTS_PIPELINED:
+                Serial.println("Received GET_WEIGHTS_PIPELINED command");
+                transferMode = TransferMode::SENDING;
+                readyFrameBytes = 0;
+                lastFrameMs = millis();
+                break;
+            case Command::SET_WEIGHTS_PIPELINED:
+                Serial.println("Received SET_WEIGHTS_PIPELINED command");
+                transferMode = TransferMode::RECEIVING;
+                transferBegun = false;
+                ackPending = false;
+                lastFrameMs = millis();
+                break;
             default:
                 Serial.println("Unknown command received");
                 break;
@@ -80,6 +145,30 @@ void Communication::onBLEDisconnected(BLEDevice central) {
     Serial.println(central.address());
 }
 
+void Communication::onWeightsWritten(BLEDevice /*central*/, BLECharacteristic characteristic) {
+    if (instance != nullptr) {
+        instance->onTransferFrame(characteristic.value(), characteristic.valueLength());
+    }
+}
+
+void Communication::onTransferFrame(const uint8_t* frame, size_t length) {
+    if (transferMode == TransferMode::NONE || length == 0) {
+        return;  // Legacy chunks are read through written()
+    }
+    lastFrameMs = millis();
+
+    if (transferMode == TransferMode::RECEIVING) {
+        if (frame[0] == TransferProtocol::TYPE_BEGIN) {
+            transferBegun = true;
+        }
+        if (transferReceiver.onFrame(frame, length)) {
+            ackPending = true;
+        }
+    } else if (!TransferProtocol::parseReady(frame, length, readyFrameBytes, readyWindow)) {
+        transferSender.onFrame(frame, length, lastFrameMs);
+    }
+}
+
 bool Communication::isConnected() {
     return BLE.connected();
 }
@@ -125,43 +214,406 @@ bool Communication::sendWeights(const float* weights, size_t length) {
             return false;
         }
     }
+
+    // Nothing left to send
+    currentSendPos = 0;
+    currentCommand = Command::NONE;
+    return true;
 }
 
 bool Communication::receiveWeights(float* buffer, size_t length) {
     if (!isConnected() || length > NNConfig::MAX_WEIGHTS) {
         Serial.println("Not connected or buffer too large");
+        resetState();
         return false;
     }
     
-    if (weightsWriteCharacteristic.written()) {
-        const size_t max_chunk_size = BLEConfig::CHUNK_SIZE_RECEIVE * sizeof(float);
-        uint8_t chunk[max_chunk_size];
-        int bytesRead = weightsWriteCharacteristic.readValue(chunk, sizeof(chunk));
-        
-        int numFloats = bytesRead / sizeof(float);
-        
-        if (currentBufferPos + numFloats > length) {
-            Serial.println("Error: Buffer overflow");
-            currentBufferPos = 0;
+    if (!weightsWriteCharacteristic.written()) {
+        return false;  // Transfer still in progress
+    }
+
+    const size_t max_chunk_size = BLEConfig::CHUNK_SIZE_RECEIVE * sizeof(float);
+    uint8_t chunk[max_chunk_size];
+    int bytesRead = weightsWriteCharacteristic.readValue(chunk, sizeof(chunk));
+    
+    int numFloats = bytesRead / sizeof(float);
+    
+    if (currentBufferPos + numFloats > length) {
+        Serial.println("Error: Buffer overflow");
+        resetState();
+        return false;
+    }
+    
+    memcpy(&buffer[currentBufferPos], chunk, bytesRead);
+    currentBufferPos += numFloats;
+    
+    if (currentBufferPos % 32 == 0) {
+        Serial.print("Received weights: ");
+        Serial.print(currentBufferPos);
+        Serial.print("/");
+        Serial.println(length);
+    }
+    
+    if (currentBufferPos < length) {
+        return false;
+    }
+
+    currentBufferPos = 0;
+    currentCommand = Command::NONE;
+    Serial.println("Weight transfer complete");
+    return true;
+}
+
+bool Communication::sendEncodedWeights(float* weights, size_t length, WeightCodec::Format format) {
+    if (length > NNConfig::MAX_WEIGHTS) {
+        Serial.println("Too many weights to encode");
+        currentCommand = Command::NONE;
+        return false;
+    }
+
+    // Quantize the change, so the error carried into the next upload is relative to the
+    // same kind of value rather than to a global model the server has replaced since
+    for (size_t i = 0; i < length; i++) {
+        weights[i] -= referenceWeights[i];
+    }
+    size_t encodedLength = WeightCodec::encode(weights, length, format, WeightCodec::Rounding::STOCHASTIC,
+                                               encodedBuffer, sizeof(encodedBuffer),
+                                               uploadResidual, &codecRngState);
+    if (encodedLength == 0) {
+        Serial.println("Failed to encode weights");
+        currentCommand = Command::NONE;
+        return false;
+    }
+
+    Serial.print("Encoded ");
+    Serial.print(length);
+    Serial.print(" weight changes as ");
+    Serial.print(WeightCodec::formatName(format));
+    Serial.print(" in ");
+    Serial.print(encodedLength);
+    Serial.println(" bytes");
+    return sendBytes(encodedBuffer, encodedLength);
+}
+
+void Communication::setReferenceWeights(const float* weights, size_t length) {
+    if (length > NNConfig::MAX_WEIGHTS) {
+        length = NNConfig::MAX_WEIGHTS;
+    }
+    memcpy(referenceWeights, weights, length * sizeof(float));
+}
+
+bool Communication::sendWeightDelta(float* weights, size_t length) {
+    if (length > NNConfig::MAX_WEIGHTS) {
+        Serial.println("Too many weights for delta");
+        currentCommand = Command::NONE;
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        weights[i] -= referenceWeights[i];
+    }
+
+    size_t entries = length * BLEConfig::DELTA_DENSITY_PERCENT / 100;
+    size_t encodedLength = SparseDelta::encodeTopK(weights, length, entries > 0 ? entries : 1,
+                                                   encodedBuffer, sizeof(encodedBuffer), deltaResidual);
+    if (encodedLength == 0) {
+        Serial.println("Failed to encode weight delta");
+        currentCommand = Command::NONE;
+        return false;
+    }
+
+    Serial.print("Sparse delta of ");
+    Serial.print(length);
+    Serial.print(" weights in ");
+    Serial.print(encodedLength);
+    Serial.println(" bytes");
+    return sendBytes(encodedBuffer, encodedLength);
+}
+
+bool Communication::receiveModel(float* buffer, size_t length) {
+    if (!isConnected() || length > NNConfig::MAX_WEIGHTS) {
+        Serial.println("Not connected or buffer too large");
+        resetState();
+        return false;
+    }
+
+    if (!weightsWriteCharacteristic.written()) {
+        return false;  // Transfer still in progress
+    }
+
+    const size_t max_chunk_size = BLEConfig::CHUNK_SIZE_RECEIVE * sizeof(float);
+    uint8_t chunk[max_chunk_size];
+    int bytesRead = weightsWriteCharacteristic.readValue(chunk, sizeof(chunk));
+    if (bytesRead <= 0) {
+        return false;
+    }
+
+    ModelDecoder::Status status = modelDecoder.feed(chunk, bytesRead);
+    if (status == ModelDecoder::Status::FAILED) {
+        Serial.print("Model transfer failed: ");
+        Serial.print(ModelDecoder::errorName(modelDecoder.error()));
+        Serial.print(" at byte ");
+        Serial.println(modelDecoder.received());
+        resetState();
+        return false;
+    }
+
+    // Reject a model for another network before its payload is sent
+    if (modelDecoder.headerReady() && !modelHeaderChecked) {
+        const ModelFormat::Header& header = modelDecoder.header();
+        bool matches = header.layerCount == NNConfig::NUM_LAYERS;
+        for (unsigned int i = 0; matches && i < NNConfig::NUM_LAYERS; i++) {
+            matches = header.layers[i] == NNConfig::LAYERS[i];
+        }
+        if (!matches) {
+            Serial.println("Model topology does not match NNConfig::LAYERS");
+            resetState();
             return false;
         }
-        
-        memcpy(&buffer[currentBufferPos], chunk, bytesRead);
-        currentBufferPos += numFloats;
-        
-        if (currentBufferPos % 32 == 0) {
-            Serial.print("Received weights: ");
-            Serial.print(currentBufferPos);
-            Serial.print("/");
-            Serial.println(length);
+        modelHeaderChecked = true;
+    }
+
+    if (status != ModelDecoder::Status::COMPLETE) {
+        return false;
+    }
+
+    const ModelFormat::Header& header = modelDecoder.header();
+    if (ModelFormat::decodeWeights(header, modelDecoder.payload(), buffer, length) != length) {
+        Serial.println("Failed to decode model weights");
+        resetState();
+        return false;
+    }
+
+    Serial.print("Received ");
+    Serial.print(WeightCodec::formatName(header.format));
+    Serial.print(" model, ");
+    Serial.print(modelDecoder.received());
+    Serial.println(" bytes");
+    if (header.hasBiases()) {
+        Serial.println("Per-neuron biases in the model are not used by this network");
+    }
+    if (header.hasMask()) {
+        Serial.print("Pruned model: ");
+        Serial.print(header.keptWeights);
+        Serial.print(" of ");
+        Serial.print(header.weightCount());
+        Serial.println(" weights kept");
+    }
+
+    currentCommand = Command::NONE;
+    return true;
+}
+
+bool Communication::sendBytes(const uint8_t* data, size_t length) {
+    if (!isConnected()) {
+        Serial.println("Not connected");
+        return false;
+    }
+
+    const size_t chunk_bytes = BLEConfig::CHUNK_SIZE_SEND * sizeof(float);
+    unsigned long startTime = millis();
+    const unsigned long TIMEOUT_MS = 30000; // 30 seconds timeout
+    size_t sent = 0;
+
+    while (sent < length) {
+        if (millis() - startTime > TIMEOUT_MS) {
+            Serial.println("Timeout occurred while sending encoded weights");
+            currentCommand = Command::NONE;
+            return false;
         }
-        
-        if (currentBufferPos >= length) {
-            currentBufferPos = 0;
-            Serial.println("Weight transfer complete");
-            return true;
+
+        size_t bytesToSend = min(chunk_bytes, length - sent);
+        if (!weightsReadCharacteristic.writeValue(&data[sent], bytesToSend)) {
+            Serial.println("Failed to send encoded chunk");
+            currentCommand = Command::NONE;
+            return false;
         }
+        sent += bytesToSend;
+        delay(15);
+    }
+
+    currentCommand = Command::NONE;
+    Serial.println("Completed sending encoded weights");
+    return true;
+}
+
+bool Communication::receiveEncodedWeights(float* buffer, size_t length) {
+    if (!isConnected() || length > NNConfig::MAX_WEIGHTS) {
+        Serial.println("Not connected or buffer too large");
+        resetState();
+        return false;
+    }
+
+    if (!weightsWriteCharacteristic.written()) {
+        return false;  // Transfer still in progress
     }
+
+    const size_t max_chunk_size = BLEConfig::CHUNK_SIZE_RECEIVE * sizeof(float);
+    uint8_t chunk[max_chunk_size];
+    int bytesRead = weightsWriteCharacteristic.readValue(chunk, sizeof(chunk));
+
+    if (bytesRead <= 0 || currentBufferPos + bytesRead > sizeof(encodedBuffer)) {
+        Serial.println("Error: Encoded buffer overflow");
+        resetState();
+        return false;
+    }
+    memcpy(&encodedBuffer[currentBufferPos], chunk, bytesRead);
+    currentBufferPos += bytesRead;
+
+    // The header tells how long the payload is, so a wrong weight count is rejected early
+    WeightCodec::Format format;
+    size_t count;
+    if (!WeightCodec::peekHeader(encodedBuffer, currentBufferPos, format, count)) {
+        return false;
+    }
+    if (count != length) {
+        Serial.print("Weight count mismatch. Expected: ");
+        Serial.print(length);
+        Serial.print(" Got: ");
+        Serial.println(count);
+        resetState();
+        return false;
+    }
+
+    size_t expectedBytes = WeightCodec::encodedSize(format, count);
+    if (currentBufferPos < expectedBytes) {
+        return false;
+    }
+
+    bool decoded = WeightCodec::decode(encodedBuffer, currentBufferPos, buffer, length) == length;
+    Serial.print("Encoded weight transfer complete (");
+    Serial.print(WeightCodec::formatName(format));
+    Serial.println(decoded ? ")" : ", decoding failed)");
+    resetState();
+    return decoded;
+}
+
+bool Communication::sendWeightsPipelined(const float* weights, size_t length) {
+    const unsigned long startTime = millis();
+
+    // The central answers the command with READY, choosing a frame size that fits its MTU
+    while (readyFrameBytes == 0) {
+        BLE.poll();
+        if (!isConnected() || millis() - lastFrameMs > BLEConfig::TRANSFER_IDLE_MS) {
+            Serial.println("No READY from central");
+            transferMode = TransferMode::NONE;
+            currentCommand = Command::NONE;
+            return false;
+        }
+    }
+
+    const uint16_t frameBytes = min(readyFrameBytes, static_cast<uint16_t>(BLEConfig::TRANSFER_FRAME_BYTES));
+    const uint8_t window = min(readyWindow, static_cast<uint8_t>(BLEConfig::TRANSFER_WINDOW));
+    if (!transferSender.begin(reinterpret_cast<const uint8_t*>(weights), length * sizeof(float), ++transferId,
+                              frameBytes, window, BLEConfig::TRANSFER_TIMEOUT_MS)) {
+        Serial.println("Invalid pipelined transfer parameters");
+        transferMode = TransferMode::NONE;
+        currentCommand = Command::NONE;
+        return false;
+    }
+
+    uint8_t frame[BLEConfig::TRANSFER_FRAME_BYTES];
+    unsigned long lastWriteMs = millis();
+    lastFrameMs = lastWriteMs;
+    while (!transferSender.finished()) {
+        BLE.poll();  // ACKs arrive through onWeightsWritten()
+        if (!isConnected()) {
+            break;
+        }
+        // Neither a write the central took nor an ACK, e.g. notifications not subscribed
+        const unsigned long now = millis();
+        if (now - lastWriteMs > BLEConfig::TRANSFER_IDLE_MS && now - lastFrameMs > BLEConfig::TRANSFER_IDLE_MS) {
+            Serial.println("Central stopped taking frames");
+            break;
+        }
+        size_t frameLength = transferSender.nextFrame(frame, sizeof(frame), now);
+        // A full notification queue is retried on the next pass
+        if (frameLength > 0 && weightsReadCharacteristic.writeValue(frame, frameLength)) {
+            lastWriteMs = millis();
+            transferSender.frameSent(lastWriteMs);
+        }
+    }
+
+    transferMode = TransferMode::NONE;
+    currentCommand = Command::NONE;
+    if (transferSender.state() != TransferSender::State::COMPLETE) {
+        Serial.println("Pipelined upload failed");
+        return false;
+    }
+
+    Serial.print("Pipelined upload of ");
+    Serial.print(transferSender.frames());
+    Serial.print(" frames");
+    if (transferSender.resumedAt() > 0) {
+        Serial.print(", resumed at ");
+        Serial.print(transferSender.resumedAt());
+    }
+    Serial.print(", ");
+    Serial.print(transferSender.retransmissions());
+    Serial.print(" resent, ");
+    Serial.print(millis() - startTime);
+    Serial.println(" ms");
+    return true;
+}
+
+bool Communication::receiveWeightsPipelined(float* buffer, size_t length) {
+    if (!isConnected() || length > NNConfig::MAX_WEIGHTS) {
+        Serial.println("Not connected or buffer too large");
+        transferMode = TransferMode::NONE;
+        resetState();
+        return false;
+    }
+
+    const unsigned long startTime = millis();
+    TransferReceiver::State state = TransferReceiver::State::IDLE;
+    while (true) {
+        BLE.poll();  // Frames arrive through onWeightsWritten()
+        if (ackPending) {
+            uint8_t ack[TransferProtocol::ACK_BYTES];
+            size_t ackLength = transferReceiver.ack(ack, sizeof(ack));
+            if (ackLength == 0 || weightsReadCharacteristic.writeValue(ack, ackLength)) {
+                ackPending = false;
+            }
+        }
+        state = transferReceiver.state();
+        if (transferBegun && !ackPending &&
+            (state == TransferReceiver::State::COMPLETE || state == TransferReceiver::State::FAILED)) {
+            break;
+        }
+        // The partial payload stays in encodedBuffer for a resumed transfer
+        if (!isConnected() || millis() - lastFrameMs > BLEConfig::TRANSFER_IDLE_MS) {
+            Serial.print("Pipelined download interrupted at byte ");
+            Serial.println(transferReceiver.received());
+            transferMode = TransferMode::NONE;
+            currentCommand = Command::NONE;
+            return false;
+        }
+    }
+
+    // transferMode stays RECEIVING: update() answers frames the central repeats
+    currentCommand = Command::NONE;
+    if (state == TransferReceiver::State::FAILED) {
+        Serial.println("Pipelined download failed: rejected or CRC mismatch");
+        return false;
+    }
+    if (transferReceiver.length() != length * sizeof(float)) {
+        Serial.print("Weight count mismatch. Expected: ");
+        Serial.print(length);
+        Serial.print(" Got: ");
+        Serial.println(transferReceiver.length() / sizeof(float));
+        return false;
+    }
+
+    memcpy(buffer, transferReceiver.data(), transferReceiver.length());
+    Serial.print("Pipelined download complete");
+    if (transferReceiver.resumedAt() > 0) {
+        Serial.print(", resumed at frame ");
+        Serial.print(transferReceiver.resumedAt());
+    }
+    Serial.print(", ");
+    Serial.print(millis() - startTime);
+    Serial.println(" ms");
+    return true;
 }
 
 bool Communication::sendPrediction(const float* probabilities, size_t length) {
@@ -189,7 +641,10 @@ int8_t Communication::getTrainingLabel() {
 
 void Communication::resetState() {
     currentBufferPos = 0;
+    modelDecoder.reset();
+    modelHeaderChecked = false;
     currentSendPos = 0;
+    transferMode = TransferMode::NONE;
     currentCommand = Command::NONE;
     Serial.println("Communication state reset");
 }
\ No newline at end of file
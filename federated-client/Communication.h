@@ -3,6 +3,10 @@
 
 #include <ArduinoBLE.h>
 #include "Config.h"
+#include "WeightCodec.h"
+#include "SparseDelta.h"
+#include "ModelFormat.h"
+#include "TransferProtocol.h"
 
 enum class Command {
     NONE = 0,
@@ -11,7 +15,13 @@ enum class Command {
     START_TRAINING = 3,
     START_CLASSIFICATION = 4,
     START_INFERENCE_BENCHMARK = 5,
-    START_TRAINING_BENCHMARK = 6
+    START_TRAINING_BENCHMARK = 6,
+    GET_WEIGHTS_ENCODED = 7,
+    SET_WEIGHTS_ENCODED = 8,
+    GET_WEIGHT_DELTA = 9,
+    SET_MODEL = 10,
+    GET_WEIGHTS_PIPELINED = 11,
+    SET_WEIGHTS_PIPELINED = 12
 };
 
 class Communication {
@@ -23,6 +33,24 @@ public:
     Command getCurrentCommand() { return currentCommand; } 
     bool sendWeights(const float* weights, size_t length);
     bool receiveWeights(float* buffer, size_t length);
+    // Quantized exchange: payloads are WeightCodec-encoded and self-describing. Uploads carry
+    // the change since the last received global model, as the simulator's clients do;
+    // weights is overwritten with the change.
+    bool sendEncodedWeights(float* weights, size_t length, WeightCodec::Format format);
+    bool receiveEncodedWeights(float* buffer, size_t length);
+    // Sparse upload: the largest changes since the last received global model.
+    // weights is overwritten with the change; unsent changes are kept for later uploads.
+    bool sendWeightDelta(float* weights, size_t length);
+    void setReferenceWeights(const float* weights, size_t length);
+    // Model file transfer: every block is CRC-checked as it arrives and the topology is
+    // checked against NNConfig::LAYERS as soon as the header is complete
+    bool receiveModel(float* buffer, size_t length);
+    const ModelFormat::Header& getModelHeader() const { return modelDecoder.header(); }
+    // Pipelined fp32 exchange (TransferProtocol.h): windowed frames over write-without-response
+    // and notifications, polled without loop delays. An upload starts when the central writes
+    // READY; an interrupted download is resumed by the next SET_WEIGHTS_PIPELINED.
+    bool sendWeightsPipelined(const float* weights, size_t length);
+    bool receiveWeightsPipelined(float* buffer, size_t length);
     void resetState();
     bool sendPrediction(const float* probabilities, size_t length);
     int8_t getTrainingLabel();
@@ -42,8 +70,53 @@ private:
     float tempBuffer[NNConfig::MAX_WEIGHTS];
     size_t currentBufferPos;
 
+    // Encoded transfers
+    // Large enough for an fp32 weight payload or a model file payload with biases and a
+    // pruning mask: a lightly pruned fp32 model is larger than the dense one
+    static constexpr size_t MAX_ENCODED_BYTES =
+        ModelFormat::maskBytes(NNConfig::MAX_WEIGHTS) +
+        WeightCodec::encodedSize(WeightCodec::Format::FLOAT32, NNConfig::MAX_WEIGHTS) +
+        WeightCodec::encodedSize(WeightCodec::Format::FLOAT32, NNConfig::MAX_BIASES);
+    uint8_t encodedBuffer[MAX_ENCODED_BYTES];
+    float uploadResidual[NNConfig::MAX_WEIGHTS];  // Quantization error of uploaded changes
+    uint32_t codecRngState;
+
+    // Sparse delta uploads
+    static constexpr size_t DELTA_ENTRIES = NNConfig::MAX_WEIGHTS * BLEConfig::DELTA_DENSITY_PERCENT / 100;
+    static_assert(SparseDelta::maxEncodedSize(DELTA_ENTRIES) <= MAX_ENCODED_BYTES,
+                  "Sparse delta does not fit the encoded buffer");
+    float referenceWeights[NNConfig::MAX_WEIGHTS];  // Last global model received
+    float deltaResidual[NNConfig::MAX_WEIGHTS];     // Changes not sent yet
+
+    ModelDecoder modelDecoder;  // Writes the verified payload into encodedBuffer
+    // The largest model payload the decoder accepts for this topology: fp32 with biases and a
+    // mask that keeps every weight
+    static_assert(ModelFormat::payloadSize(WeightCodec::Format::FLOAT32, NNConfig::MAX_WEIGHTS,
+                                           NNConfig::MAX_WEIGHTS, NNConfig::MAX_BIASES, true) <=
+                      MAX_ENCODED_BYTES,
+                  "The largest model payload does not fit the encoded buffer");
+    bool modelHeaderChecked;
+
+    // Pipelined transfers. Frames from the central arrive through onWeightsWritten(), so
+    // none is lost when several are written between two polls.
+    enum class TransferMode : uint8_t { NONE, SENDING, RECEIVING };
+    TransferMode transferMode;
+    TransferSender transferSender;
+    TransferReceiver transferReceiver;  // Assembles downloads in encodedBuffer
+    uint8_t transferId;
+    uint16_t readyFrameBytes;           // From the central's READY frame, 0 until it arrives
+    uint8_t readyWindow;
+    bool transferBegun;                 // BEGIN seen since the command was received
+    bool ackPending;
+    unsigned long lastFrameMs;
+    void onTransferFrame(const uint8_t* frame, size_t length);
+    static Communication* instance;
+
+    bool sendBytes(const uint8_t* data, size_t length);
+
     static void onBLEConnected(BLEDevice central);
     static void onBLEDisconnected(BLEDevice central);
+    static void onWeightsWritten(BLEDevice central, BLECharacteristic characteristic);
 };
 
 #endif
\ No newline at end of file
@@ -8,6 +8,13 @@ namespace NNConfig {
     
     constexpr float ERROR_THRESHOLD = 0.01f;
     constexpr unsigned int MAX_EPOCHS = 1000;
+
+    // Run the network on FixedPointMLP (int8 weights, Q15 activations, per-neuron biases), the
+    // engine the simulator uses with --backend fixed, instead of the float NeuralNetwork library.
+    // The exchanged weights keep their layout; the biases stay on the device.
+    constexpr bool FIXED_POINT_BACKEND = false;
+    // Learning rate of the fixed-point backend (the library's default for weights)
+    constexpr float FIXED_POINT_LEARNING_RATE = 0.33f;
     
     constexpr size_t calculateTotalWeights() {
         size_t total = 0;
@@ -19,6 +26,23 @@ namespace NNConfig {
     
     constexpr size_t MAX_WEIGHTS = calculateTotalWeights();
 
+    constexpr size_t calculateTotalBiases() {
+        size_t total = 0;
+        for (unsigned int i = 1; i < NUM_LAYERS; i++) {
+            total += LAYERS[i];
+        }
+        return total;
+    }
+
+    // Per-neuron biases carried by model files from the host simulation
+    constexpr size_t MAX_BIASES = calculateTotalBiases();
+
+    // Recent training windows kept for local epochs (11 floats + label each)
+    constexpr size_t REPLAY_CAPACITY = 64;
+    // Passes over the replay buffer per round: the live pass plus LOCAL_EPOCHS - 1 replays
+    // before the weights are uploaded (1 = live training only)
+    constexpr unsigned int LOCAL_EPOCHS = 1;
+
     // Classification labels
     enum class TheftClass {
         NO_THEFT = 0,
@@ -34,6 +58,12 @@ namespace SignalConfig {
     constexpr unsigned int SAMPLING_PERIOD_MS = 1000/SAMPLING_FREQ;
     constexpr unsigned int FEATURE_BINS = 8;
     constexpr unsigned int TOTAL_FEATURES = 11;  // 8 frequency bins + 3 statistical features
+
+    // Samples shared by consecutive windows: with continued requests (classification), a
+    // window completes every SAMPLES - WINDOW_OVERLAP samples
+    constexpr unsigned int WINDOW_OVERLAP = SAMPLES / 2;
+    // Sampling continues this long after the last window request
+    constexpr unsigned long ACQUISITION_LINGER_MS = 5000;
     
     // Frequency bands (Hz)
     constexpr float FREQ_BANDS[] = {0, 6, 12, 19, 25, 31, 37, 44, 50};
@@ -50,6 +80,18 @@ namespace BLEConfig {
     constexpr char PREDICTION_CHAR_UUID[] = "19B10004-E8F2-537E-4F6C-D104768A1214";
     constexpr unsigned int CHUNK_SIZE_RECEIVE = 52;
     constexpr unsigned int CHUNK_SIZE_SEND = 32;
+
+    // Encoding used for GET_WEIGHTS_ENCODED uploads (0 = fp32, 1 = fp16, 2 = int8)
+    constexpr unsigned char UPLOAD_WEIGHT_FORMAT = 2;
+
+    // Percentage of weights sent by GET_WEIGHT_DELTA (largest changes first)
+    constexpr unsigned int DELTA_DENSITY_PERCENT = 5;
+
+    // Pipelined transfers (GET/SET_WEIGHTS_PIPELINED, see TransferProtocol.h)
+    constexpr unsigned int TRANSFER_FRAME_BYTES = 244;   // ATT MTU 247 minus the ATT header
+    constexpr unsigned char TRANSFER_WINDOW = 8;         // Frames in flight
+    constexpr unsigned long TRANSFER_TIMEOUT_MS = 250;   // Go back to the first unacknowledged frame
+    constexpr unsigned long TRANSFER_IDLE_MS = 3000;     // Give up when the central goes quiet
 }
 
 #endif
\ No newline at end of file
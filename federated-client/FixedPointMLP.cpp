@@ -0,0 +1,352 @@
+#include "FixedPointMLP.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+    // round(32767 * sigmoid(x)) for x = -8 + k / 16, k = 0..256
+    const int16_t SIGMOID_TABLE[257] = {
+       11,    12,    12,    13,    14,    15,    16,    17,    18,    19,    21,    22,
+       23,    25,    26,    28,    30,    32,    34,    36,    38,    41,    43,    46,
+       49,    52,    56,    59,    63,    67,    72,    76,    81,    86,    92,    98,
+      104,   111,   118,   125,   133,   142,   151,   161,   171,   182,   194,   206,
+      219,   233,   248,   264,   281,   299,   318,   338,   360,   383,   407,   433,
+      461,   490,   521,   554,   589,   627,   666,   708,   753,   800,   851,   904,
+      960,  1020,  1084,  1152,  1223,  1299,  1379,  1464,  1554,  1649,  1750,  1856,
+     1969,  2088,  2213,  2346,  2486,  2633,  2788,  2952,  3124,  3305,  3496,  3696,
+     3906,  4126,  4357,  4598,  4851,  5115,  5391,  5678,  5978,  6289,  6613,  6949,
+     7297,  7658,  8031,  8416,  8812,  9221,  9641, 10071, 10512, 10963, 11424, 11893,
+    12371, 12856, 13347, 13844, 14346, 14852, 15361, 15872, 16384, 16895, 17406, 17915,
+    18421, 18923, 19420, 19911, 20396, 20874, 21343, 21804, 22255, 22696, 23126, 23546,
+    23955, 24351, 24736, 25109, 25470, 25818, 26154, 26478, 26789, 27089, 27376, 27652,
+    27916, 28169, 28410, 28641, 28861, 29071, 29271, 29462, 29643, 29815, 29979, 30134,
+    30281, 30421, 30554, 30679, 30798, 30911, 31017, 31118, 31213, 31303, 31388, 31468,
+    31544, 31615, 31683, 31747, 31807, 31863, 31916, 31967, 32014, 32059, 32101, 32140,
+    32178, 32213, 32246, 32277, 32306, 32334, 32360, 32384, 32407, 32429, 32449, 32468,
+    32486, 32503, 32519, 32534, 32548, 32561, 32573, 32585, 32596, 32606, 32616, 32625,
+    32634, 32642, 32649, 32656, 32663, 32669, 32675, 32681, 32686, 32691, 32695, 32700,
+    32704, 32708, 32711, 32715, 32718, 32721, 32724, 32726, 32729, 32731, 32733, 32735,
+    32737, 32739, 32741, 32742, 32744, 32745, 32746, 32748, 32749, 32750, 32751, 32752,
+    32753, 32754, 32755, 32755, 32756
+    };
+
+    constexpr int MAX_SHIFT = 14;
+    constexpr int MASTER_BITS = 8;   // Extra fraction bits of the master weights
+
+    int16_t clampInt16(int64_t value) {
+        return static_cast<int16_t>(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+    }
+
+    int32_t clampInt32(int64_t value) {
+        return static_cast<int32_t>(value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : value);
+    }
+
+    // 256 products of at most 2^22 add up to 2^30; the rest of the int32 range is left to the
+    // bias and the rounding of the sigmoid argument (at most 2^16)
+    constexpr int32_t MAX_BIAS = (1L << 30) - (1L << 17);
+    static_assert(static_cast<int64_t>(FixedPointMLP::MAX_INPUTS) * 128 * 32768 + MAX_BIAS + (1L << 16) <= INT32_MAX,
+                  "Forward pass accumulators can overflow int32");
+
+    int32_t clampBias(int64_t value) {
+        return static_cast<int32_t>(value > MAX_BIAS ? MAX_BIAS : value < -MAX_BIAS ? -MAX_BIAS : value);
+    }
+
+    int8_t roundMaster(int16_t master) {
+        int32_t rounded = (static_cast<int32_t>(master) + (1 << (MASTER_BITS - 1))) >> MASTER_BITS;
+        return static_cast<int8_t>(rounded > 127 ? 127 : rounded < -128 ? -128 : rounded);
+    }
+
+    // Largest shift in [0, MAX_SHIFT] with maxAbs * 2^shift <= limit
+    int chooseShift(float maxAbs, float limit) {
+        int shift = MAX_SHIFT;
+        while (shift > 0 && maxAbs * static_cast<float>(1L << shift) > limit) {
+            shift--;
+        }
+        return shift;
+    }
+}
+
+FixedPointMLP::FixedPointMLP()
+    : layerCount(0), input(nullptr), errors(nullptr), widest(0), rngState(1) {
+    memset(layers, 0, sizeof(layers));
+}
+
+FixedPointMLP::~FixedPointMLP() {
+    release();
+}
+
+void FixedPointMLP::release() {
+    for (unsigned int l = 0; l < layerCount; l++) {
+        delete[] layers[l].master;
+        delete[] layers[l].weights;
+        delete[] layers[l].biases;
+        delete[] layers[l].activations;
+    }
+    memset(layers, 0, sizeof(layers));
+    delete[] input;
+    delete[] errors;
+    input = nullptr;
+    errors = nullptr;
+    layerCount = 0;
+    widest = 0;
+}
+
+bool FixedPointMLP::init(const unsigned int* topology, unsigned int numLayers, uint32_t seed) {
+    if (!topology || numLayers < 2 || numLayers > MAX_LAYERS || seed == 0) {
+        return false;
+    }
+    for (unsigned int l = 0; l < numLayers; l++) {
+        if (topology[l] == 0 || topology[l] > MAX_INPUTS) {
+            return false;
+        }
+    }
+
+    release();
+    rngState = seed;
+    layerCount = numLayers - 1;
+    input = new int16_t[topology[0]];
+    widest = topology[0];
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        layer.inputs = topology[l];
+        layer.outputs = topology[l + 1];
+        layer.master = new int16_t[layer.inputs * layer.outputs];
+        layer.weights = new int8_t[layer.inputs * layer.outputs];
+        layer.biases = new int32_t[layer.outputs];
+        layer.activations = new int16_t[layer.outputs];
+        if (layer.outputs > widest) widest = layer.outputs;
+
+        // Xavier/Glorot uniform weights and zero biases until parameters are set
+        float range = sqrtf(6.0f / (layer.inputs + layer.outputs));
+        layer.shift = chooseShift(range, 127.0f);
+        int32_t masterRange = static_cast<int32_t>(range * static_cast<float>(1L << (layer.shift + MASTER_BITS)));
+        for (unsigned int i = 0; i < layer.inputs * layer.outputs; i++) {
+            int32_t value = static_cast<int32_t>(nextRandom() % (2 * static_cast<uint32_t>(masterRange) + 1)) - masterRange;
+            layer.master[i] = clampInt16(value);
+            layer.weights[i] = roundMaster(layer.master[i]);
+        }
+        memset(layer.biases, 0, layer.outputs * sizeof(int32_t));
+        memset(layer.activations, 0, layer.outputs * sizeof(int16_t));
+    }
+    errors = new int32_t[2 * widest];
+    return true;
+}
+
+size_t FixedPointMLP::parameterCount() const {
+    size_t count = 0;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        count += (layers[l].inputs + 1) * layers[l].outputs;
+    }
+    return count;
+}
+
+size_t FixedPointMLP::memoryBytes() const {
+    if (!layerCount) return 0;
+    size_t bytes = layers[0].inputs * sizeof(int16_t) + 2 * widest * sizeof(int32_t);
+    for (unsigned int l = 0; l < layerCount; l++) {
+        size_t weights = layers[l].inputs * layers[l].outputs;
+        bytes += weights * (sizeof(int16_t) + sizeof(int8_t)) +
+                 layers[l].outputs * (sizeof(int32_t) + sizeof(int16_t));
+    }
+    return bytes;
+}
+
+bool FixedPointMLP::setParameters(const float* params, size_t count) {
+    if (!layerCount || !params || count != parameterCount()) {
+        return false;
+    }
+
+    const float* p = params;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        const size_t weightCount = layer.inputs * layer.outputs;
+        const float* weights = p;
+        const float* biases = p + weightCount;
+        p += weightCount + layer.outputs;
+
+        float maxWeight = 0.0f;
+        float maxBias = 0.0f;
+        for (size_t i = 0; i < weightCount; i++) {
+            if (fabsf(weights[i]) > maxWeight) maxWeight = fabsf(weights[i]);
+        }
+        for (unsigned int i = 0; i < layer.outputs; i++) {
+            if (fabsf(biases[i]) > maxBias) maxBias = fabsf(biases[i]);
+        }
+        // Weights fill half the int8 range, leaving room to grow during local training;
+        // biases keep the accumulator below 2^30
+        int weightShift = chooseShift(maxWeight, 63.0f);
+        int biasShift = chooseShift(maxBias, 32767.0f);
+        layer.shift = weightShift < biasShift ? weightShift : biasShift;
+
+        const float masterScale = static_cast<float>(1L << (layer.shift + MASTER_BITS));
+        const float biasScale = static_cast<float>(1L << (layer.shift + 15));
+        for (size_t i = 0; i < weightCount; i++) {
+            layer.master[i] = clampInt16(lroundf(weights[i] * masterScale));
+            layer.weights[i] = roundMaster(layer.master[i]);
+        }
+        for (unsigned int i = 0; i < layer.outputs; i++) {
+            layer.biases[i] = clampBias(llroundf(biases[i] * biasScale));
+        }
+    }
+    return true;
+}
+
+bool FixedPointMLP::getParameters(float* params, size_t count) const {
+    if (!layerCount || !params || count != parameterCount()) {
+        return false;
+    }
+
+    float* p = params;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        const Layer& layer = layers[l];
+        const float masterStep = 1.0f / static_cast<float>(1L << (layer.shift + MASTER_BITS));
+        const float biasStep = 1.0f / static_cast<float>(1L << (layer.shift + 15));
+        for (size_t i = 0; i < layer.inputs * layer.outputs; i++) {
+            *p++ = layer.master[i] * masterStep;
+        }
+        for (unsigned int i = 0; i < layer.outputs; i++) {
+            *p++ = layer.biases[i] * biasStep;
+        }
+    }
+    return true;
+}
+
+int16_t FixedPointMLP::toQ15(float value) {
+    if (value >= 32767.0f / 32768.0f) return 32767;
+    if (value <= -1.0f) return -32768;
+    return static_cast<int16_t>(lroundf(value * 32768.0f));
+}
+
+int16_t FixedPointMLP::sigmoidQ15(int32_t xQ12) {
+    if (xQ12 < -8 * 4096) xQ12 = -8 * 4096;
+    if (xQ12 > 8 * 4096 - 1) xQ12 = 8 * 4096 - 1;
+    uint32_t position = static_cast<uint32_t>(xQ12 + 8 * 4096);   // Table step is 256 in Q12
+    uint32_t index = position >> 8;
+    int32_t fraction = static_cast<int32_t>(position & 0xFF);
+    int32_t low = SIGMOID_TABLE[index];
+    int32_t high = SIGMOID_TABLE[index + 1];
+    return static_cast<int16_t>(low + (((high - low) * fraction + 128) >> 8));
+}
+
+const int16_t* FixedPointMLP::forward(const int16_t* in) {
+    if (!layerCount || !in) return nullptr;
+
+    memcpy(input, in, layers[0].inputs * sizeof(int16_t));
+    const int16_t* previous = input;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        const Layer& layer = layers[l];
+        const int toQ12 = layer.shift + 3;
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            const int8_t* row = layer.weights + o * layer.inputs;
+            int32_t accumulator = layer.biases[o];
+            for (unsigned int i = 0; i < layer.inputs; i++) {
+                accumulator += static_cast<int32_t>(row[i]) * previous[i];
+            }
+            layer.activations[o] = sigmoidQ15((accumulator + (1 << (toQ12 - 1))) >> toQ12);
+        }
+        previous = layer.activations;
+    }
+    return previous;
+}
+
+bool FixedPointMLP::predict(const float* features, float* outputs) {
+    if (!layerCount || !features || !outputs) return false;
+
+    int16_t quantized[MAX_INPUTS];
+    for (unsigned int i = 0; i < layers[0].inputs; i++) {
+        quantized[i] = toQ15(features[i]);
+    }
+    const int16_t* result = forward(quantized);
+    for (unsigned int o = 0; o < outputSize(); o++) {
+        outputs[o] = result[o] * (1.0f / 32768.0f);
+    }
+    return true;
+}
+
+uint32_t FixedPointMLP::nextRandom() {
+    // xorshift32, as in WeightCodec
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rngState = x;
+    return x;
+}
+
+int32_t FixedPointMLP::stochasticShift(int64_t value, int bits) {
+    if (bits <= 0) {
+        return clampInt32(value * (1LL << -bits));
+    }
+    // Adding uniform noise in [0, 2^bits) before the floor rounds up with the probability
+    // of the discarded fraction
+    int64_t noise = bits <= 32
+        ? static_cast<int64_t>((static_cast<uint64_t>(nextRandom()) << bits) >> 32)
+        : static_cast<int64_t>(nextRandom()) << (bits - 32);
+    return clampInt32((value + noise) >> bits);
+}
+
+bool FixedPointMLP::train(const float* features, const float* target, float learningRate) {
+    if (!layerCount || !features || !target) return false;
+
+    int16_t quantized[MAX_INPUTS];
+    for (unsigned int i = 0; i < layers[0].inputs; i++) {
+        quantized[i] = toQ15(features[i]);
+    }
+    const int16_t* outputs = forward(quantized);
+
+    // Output error in Q15
+    int32_t* error = errors;
+    int32_t* below = errors + widest;
+    for (unsigned int o = 0; o < outputSize(); o++) {
+        error[o] = static_cast<int32_t>(outputs[o]) - toQ15(target[o]);
+    }
+
+    const int64_t rateQ16 = llroundf(learningRate * 65536.0f);
+    for (int l = static_cast<int>(layerCount) - 1; l >= 0; l--) {
+        Layer& layer = layers[l];
+        const int16_t* previous = l > 0 ? layers[l - 1].activations : input;
+        if (l > 0) {
+            memset(below, 0, layer.inputs * sizeof(int32_t));
+        }
+
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            // delta = error * sigmoid'(z), with sigmoid' = a (1 - a)
+            int32_t a = layer.activations[o];
+            int32_t derivative = (a * (32768 - a)) >> 15;
+            int32_t delta = (error[o] * derivative + (1 << 14)) >> 15;
+            if (delta == 0) continue;
+
+            int16_t* master = layer.master + o * layer.inputs;
+            int8_t* weights = layer.weights + o * layer.inputs;
+            if (l > 0) {
+                // Error of the layer below, through the weights used in the forward pass
+                for (unsigned int i = 0; i < layer.inputs; i++) {
+                    below[i] += static_cast<int32_t>(weights[i]) * delta;
+                }
+            }
+
+            // rate * delta in Q31; masters are in units of 2^-(shift + 8), biases 2^-(shift + 15)
+            const int64_t rateDelta = rateQ16 * delta;
+            layer.biases[o] = clampBias(static_cast<int64_t>(layer.biases[o]) -
+                                        stochasticShift(rateDelta, 16 - layer.shift));
+            const int weightBits = 46 - (layer.shift + MASTER_BITS);
+            for (unsigned int i = 0; i < layer.inputs; i++) {
+                int32_t step = stochasticShift(rateDelta * previous[i], weightBits);
+                if (step == 0) continue;
+                master[i] = clampInt16(static_cast<int32_t>(master[i]) - step);
+                weights[i] = roundMaster(master[i]);
+            }
+        }
+
+        if (l > 0) {
+            // Weights are in units of 2^-shift
+            const int32_t half = layer.shift > 0 ? 1 << (layer.shift - 1) : 0;
+            for (unsigned int i = 0; i < layer.inputs; i++) {
+                below[i] = (below[i] + half) >> layer.shift;
+            }
+            int32_t* swap = error;
+            error = below;
+            below = swap;
+        }
+    }
+    return true;
+}
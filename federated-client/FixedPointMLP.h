@@ -0,0 +1,81 @@
+#ifndef FIXED_POINT_MLP_H
+#define FIXED_POINT_MLP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Integer-arithmetic sigmoid MLP, shared by the firmware and the host simulation.
+//
+//   weights      int8 with a power-of-two scale per layer: w = q * 2^-shift
+//   activations  Q15 (a = q / 32768); inputs are clamped to [-1, 1)
+//   accumulators int32; biases are stored at accumulator scale 2^-(shift + 15) and held
+//                below 2^30, so with at most 256 inputs of |q| <= 128 * 32768 the sum fits
+//   sigmoid      257-entry Q15 table over [-8, 8] with linear interpolation
+//
+// Training is quantization-aware: every weight also has an int16 master copy with 8 more
+// fraction bits. Forward passes use the int8 rounding of the master and gradients update
+// the master (straight-through estimator). Updates smaller than one master step are
+// applied with stochastic rounding, so small learning rates still move the weights.
+//
+// Parameters are exchanged as floats in the simulator layout: per layer the weights
+// [output][input], then the biases. The scale of each layer is chosen again whenever
+// parameters are set, i.e. after every global model update.
+class FixedPointMLP {
+public:
+    static constexpr unsigned int MAX_LAYERS = 8;     // Layer sizes, including the input
+    static constexpr unsigned int MAX_INPUTS = 256;   // Per layer, keeps accumulators in int32
+
+    FixedPointMLP();
+    ~FixedPointMLP();
+    FixedPointMLP(const FixedPointMLP&) = delete;
+    FixedPointMLP& operator=(const FixedPointMLP&) = delete;
+
+    // seed drives stochastic rounding and must be non-zero
+    bool init(const unsigned int* topology, unsigned int numLayers, uint32_t seed = 1);
+    bool isInitialized() const { return layerCount > 0; }
+
+    size_t parameterCount() const;
+    bool setParameters(const float* params, size_t count);
+    bool getParameters(float* params, size_t count) const;
+
+    // Sigmoid outputs of the last layer
+    bool predict(const float* features, float* outputs);
+    // One SGD step on the squared error, the same gradient as the float network
+    bool train(const float* features, const float* target, float learningRate);
+
+    // Integer forward pass on Q15 inputs; returns the Q15 outputs of the last layer
+    const int16_t* forward(const int16_t* input);
+
+    unsigned int inputSize() const { return layerCount ? layers[0].inputs : 0; }
+    unsigned int outputSize() const { return layerCount ? layers[layerCount - 1].outputs : 0; }
+    // Heap used for parameters and activation buffers
+    size_t memoryBytes() const;
+
+    static int16_t toQ15(float value);
+    // Sigmoid of a Q12 argument, in Q15
+    static int16_t sigmoidQ15(int32_t xQ12);
+
+private:
+    struct Layer {
+        unsigned int inputs;
+        unsigned int outputs;
+        int shift;
+        int16_t* master;       // [output][input], w = master * 2^-(shift + 8)
+        int8_t* weights;       // Rounded master used by forward passes
+        int32_t* biases;
+        int16_t* activations;  // Q15 outputs of the last forward pass
+    };
+
+    void release();
+    int32_t stochasticShift(int64_t value, int bits);
+    uint32_t nextRandom();
+
+    Layer layers[MAX_LAYERS - 1];
+    unsigned int layerCount;
+    int16_t* input;            // Q15 input of the last forward pass
+    int32_t* errors;           // Backpropagated error, two buffers of the widest layer
+    unsigned int widest;
+    uint32_t rngState;
+};
+
+#endif
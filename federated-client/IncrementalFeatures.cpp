@@ -0,0 +1,211 @@
+#include "IncrementalFeatures.h"
+#include <math.h>
+#include <stdlib.h>
+
+IncrementalFeatures::IncrementalFeatures()
+    : windowSamples(0), hop(0), bins(0), bandCount(0), sinceStart(0),
+      hamming(nullptr), cosines(nullptr), sines(nullptr), windowReal(nullptr), windowImag(nullptr),
+      state(nullptr), bandStart(nullptr), output(nullptr), windows(), completed(0) {
+}
+
+IncrementalFeatures::~IncrementalFeatures() {
+    release();
+}
+
+void IncrementalFeatures::release() {
+    free(hamming);
+    free(state);
+    free(bandStart);
+    free(output);
+    hamming = cosines = sines = windowReal = windowImag = state = output = nullptr;
+    bandStart = nullptr;
+    bins = 0;
+}
+
+bool IncrementalFeatures::init(uint16_t windowSamples, uint16_t overlapSamples, float samplingFreq,
+                               const float* bandEdgesHz, uint8_t bandCount) {
+    release();
+    if (windowSamples < 4 || windowSamples % 2 != 0 || overlapSamples > windowSamples / 2 ||
+        samplingFreq <= 0 || bandCount == 0) {
+        return false;
+    }
+
+    const uint16_t half = windowSamples / 2;
+    // One block for the window and bin tables, one for the filter states
+    hamming = static_cast<float*>(malloc(5 * half * sizeof(float)));
+    state = static_cast<float*>(malloc(2 * MAX_WINDOWS * half * sizeof(float)));
+    bandStart = static_cast<uint16_t*>(malloc((bandCount + 1) * sizeof(uint16_t)));
+    output = static_cast<float*>(malloc((bandCount + STATISTICS) * sizeof(float)));
+    if (!hamming || !state || !bandStart || !output) {
+        release();
+        return false;
+    }
+    cosines = hamming + half;
+    sines = cosines + half;
+    windowReal = sines + half;
+    windowImag = windowReal + half;
+
+    // Bin ranges as computed by the FFT path
+    for (uint8_t band = 0; band <= bandCount; band++) {
+        bandStart[band] = static_cast<uint16_t>((bandEdgesHz[band] * windowSamples) / samplingFreq);
+        if (bandStart[band] > half || (band > 0 && bandStart[band] <= bandStart[band - 1])) {
+            release();
+            return false;
+        }
+    }
+
+    this->windowSamples = windowSamples;
+    this->hop = windowSamples - overlapSamples;
+    this->bandCount = bandCount;
+    bins = half;
+
+    // Symmetric Hamming window over windowSamples - 1 intervals, as arduinoFFT applies it
+    for (uint16_t i = 0; i < half; i++) {
+        hamming[i] = 0.54f - 0.46f * cosf(2.0f * static_cast<float>(M_PI) * i / (windowSamples - 1));
+    }
+    for (uint16_t k = 0; k < bins; k++) {
+        const float omega = 2.0f * static_cast<float>(M_PI) * k / windowSamples;
+        cosines[k] = cosf(omega);
+        sines[k] = sinf(omega);
+    }
+
+    // Spectrum of the window itself, through the same filters as the samples
+    for (uint16_t k = 0; k < bins; k++) {
+        const float factor = 2.0f * cosines[k];
+        float s1 = 0.0f;
+        float s2 = 0.0f;
+        for (uint16_t i = 0; i < windowSamples; i++) {
+            if (k == 0) {
+                s1 += coefficient(i);
+            } else {
+                const float s0 = coefficient(i) + factor * s1 - s2;
+                s2 = s1;
+                s1 = s0;
+            }
+        }
+        windowReal[k] = k == 0 ? s1 : s1 - cosines[k] * s2;
+        windowImag[k] = k == 0 ? 0.0f : sines[k] * s2;
+    }
+
+    for (uint8_t w = 0; w < MAX_WINDOWS; w++) {
+        windows[w].s1 = state + 2 * w * half;
+        windows[w].s2 = windows[w].s1 + half;
+    }
+    for (size_t i = 0; i < featureCount(); i++) {
+        output[i] = 0.0f;
+    }
+    completed = 0;
+    restart();
+    return true;
+}
+
+size_t IncrementalFeatures::memoryBytes() const {
+    if (!isInitialized()) {
+        return 0;
+    }
+    return (5 + 2 * MAX_WINDOWS) * bins * sizeof(float) + (bandCount + 1) * sizeof(uint16_t) +
+           featureCount() * sizeof(float);
+}
+
+float IncrementalFeatures::coefficient(uint16_t position) const {
+    return hamming[position < bins ? position : windowSamples - 1 - position];
+}
+
+void IncrementalFeatures::restart() {
+    for (uint8_t w = 0; w < MAX_WINDOWS; w++) {
+        windows[w].active = false;
+    }
+    sinceStart = 0;
+}
+
+bool IncrementalFeatures::push(float value) {
+    if (!isInitialized()) {
+        return false;
+    }
+
+    if (sinceStart == 0) {
+        // A window starts every hop samples; the one started two hops ago has finished
+        for (uint8_t w = 0; w < MAX_WINDOWS; w++) {
+            Window& window = windows[w];
+            if (!window.active) {
+                window.active = true;
+                window.position = 0;
+                window.offset = value;
+                window.sum = 0.0f;
+                for (uint16_t k = 0; k < bins; k++) {
+                    window.s1[k] = 0.0f;
+                    window.s2[k] = 0.0f;
+                }
+                break;
+            }
+        }
+    }
+    if (++sinceStart == hop) {
+        sinceStart = 0;
+    }
+
+    bool finished = false;
+    for (uint8_t w = 0; w < MAX_WINDOWS; w++) {
+        Window& window = windows[w];
+        if (!window.active) {
+            continue;
+        }
+        const float x = value - window.offset;
+        const float weighted = x * coefficient(window.position);
+        window.sum += x;
+
+        float* s1 = window.s1;
+        float* s2 = window.s2;
+        s1[0] += weighted;
+        for (uint16_t k = 1; k < bins; k++) {
+            const float s0 = weighted + 2.0f * cosines[k] * s1[k] - s2[k];
+            s2[k] = s1[k];
+            s1[k] = s0;
+        }
+
+        if (++window.position == windowSamples) {
+            finish(window);
+            window.active = false;
+            finished = true;
+        }
+    }
+    return finished;
+}
+
+void IncrementalFeatures::finish(Window& window) {
+    // Magnitudes of the DC-free windowed spectrum, written over the filter state
+    const float mean = window.sum / windowSamples;
+    float* magnitudes = window.s1;
+    for (uint16_t k = 0; k < bins; k++) {
+        const float re = (k == 0 ? window.s1[0] : window.s1[k] - cosines[k] * window.s2[k]) - mean * windowReal[k];
+        const float im = (k == 0 ? 0.0f : sines[k] * window.s2[k]) - mean * windowImag[k];
+        magnitudes[k] = sqrtf(re * re + im * im);
+    }
+
+    for (uint8_t band = 0; band < bandCount; band++) {
+        float energy = 0.0f;
+        for (uint16_t k = bandStart[band]; k < bandStart[band + 1]; k++) {
+            energy += magnitudes[k];
+        }
+        output[band] = energy / (bandStart[band + 1] - bandStart[band]);
+    }
+
+    float meanMagnitude = 0.0f;
+    float maxMagnitude = 0.0f;
+    for (uint16_t k = 0; k < bins; k++) {
+        meanMagnitude += magnitudes[k];
+        if (magnitudes[k] > maxMagnitude) maxMagnitude = magnitudes[k];
+    }
+    meanMagnitude /= bins;
+    float variance = 0.0f;
+    for (uint16_t k = 0; k < bins; k++) {
+        const float diff = magnitudes[k] - meanMagnitude;
+        variance += diff * diff;
+    }
+    variance /= bins;
+
+    output[bandCount] = meanMagnitude;
+    output[bandCount + 1] = maxMagnitude;
+    output[bandCount + 2] = sqrtf(variance);
+    completed++;
+}
@@ -0,0 +1,81 @@
+#ifndef INCREMENTAL_FEATURES_H
+#define INCREMENTAL_FEATURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Spectral features of overlapping sample windows, computed sample by sample with a
+// Goertzel filter per DFT bin instead of one FFT per window. Produces the features of
+// SignalProcessing's FFT path: band means of the Hamming-windowed magnitude spectrum after
+// DC removal, then mean, max and standard deviation of the magnitudes below Nyquist.
+//
+// Each sample is multiplied by the window coefficient of its position and fed to the
+// filter bank of every window it belongs to, so the work is spread evenly over the
+// samples. DC removal needs the window mean, which is only known at the end: the
+// spectrum of (x - mean) * w is that of x * w minus mean times the spectrum of w, taken
+// from a table. Completing a window costs one magnitude per bin.
+//
+// Windows start every windowSamples - overlapSamples samples after restart(), like those
+// of WindowAcquisition. Memory: about (5 + 2 * MAX_WINDOWS) * windowSamples / 2 floats,
+// allocated once by init(); 4.6 KB for 256-sample windows.
+class IncrementalFeatures {
+public:
+    // Windows in flight, so the overlap may be up to half a window
+    static constexpr uint8_t MAX_WINDOWS = 2;
+    static constexpr uint8_t STATISTICS = 3;
+
+    IncrementalFeatures();
+    ~IncrementalFeatures();
+    IncrementalFeatures(const IncrementalFeatures&) = delete;
+    IncrementalFeatures& operator=(const IncrementalFeatures&) = delete;
+
+    // bandEdgesHz holds bandCount + 1 ascending edges up to samplingFreq / 2
+    bool init(uint16_t windowSamples, uint16_t overlapSamples, float samplingFreq,
+              const float* bandEdgesHz, uint8_t bandCount);
+    bool isInitialized() const { return bins > 0; }
+
+    // Drop the windows in flight; the next window starts with the next sample
+    void restart();
+
+    // Returns true when the sample completed a window; its features are in features()
+    bool push(float value);
+
+    // bandCount band energies followed by mean, max and standard deviation
+    const float* features() const { return output; }
+    size_t featureCount() const { return bandCount + STATISTICS; }
+    uint32_t windowCount() const { return completed; }
+    size_t memoryBytes() const;
+
+private:
+    struct Window {
+        bool active;
+        uint16_t position;
+        float offset;     // First sample, subtracted from all samples to keep the sums small
+        float sum;        // Of the offset samples, for the mean
+        float* s1;        // Goertzel state per bin (bin 0 is a plain sum in s1)
+        float* s2;
+    };
+
+    void finish(Window& window);
+    float coefficient(uint16_t position) const;
+    void release();
+
+    uint16_t windowSamples;
+    uint16_t hop;
+    uint16_t bins;           // windowSamples / 2
+    uint8_t bandCount;
+    uint16_t sinceStart;     // Samples since the last window started
+
+    float* hamming;          // First half of the symmetric window
+    float* cosines;          // cos(2 pi k / N) per bin
+    float* sines;
+    float* windowReal;       // Goertzel output of the window itself, for DC removal
+    float* windowImag;
+    float* state;
+    uint16_t* bandStart;     // bandCount + 1 bin indices
+    float* output;
+    Window windows[MAX_WINDOWS];
+    uint32_t completed;
+};
+
+#endif
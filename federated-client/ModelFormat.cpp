@@ -0,0 +1,423 @@
+#include "ModelFormat.h"
+#include <string.h>
+
+constexpr uint8_t ModelFormat::MAGIC[4];
+
+namespace {
+    void writeU16(uint8_t* out, uint16_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void writeU32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint16_t readU16(const uint8_t* in) {
+        return static_cast<uint16_t>(in[0] | (in[1] << 8));
+    }
+
+    uint32_t readU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t floatBits(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsToFloat(uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Nibble table keeps the CRC small enough for flash
+    const uint32_t CRC_TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+}
+
+size_t ModelFormat::Header::weightCount() const {
+    size_t total = 0;
+    for (size_t i = 0; i + 1 < layerCount; i++) {
+        total += static_cast<size_t>(layers[i]) * layers[i + 1];
+    }
+    return total;
+}
+
+size_t ModelFormat::Header::biasCount() const {
+    size_t total = 0;
+    for (size_t i = 1; i < layerCount; i++) {
+        total += layers[i];
+    }
+    return total;
+}
+
+size_t ModelFormat::countKept(const uint8_t* mask, size_t count) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        kept += (mask[i / 8] >> (i % 8)) & 1;
+    }
+    return kept;
+}
+
+uint32_t ModelFormat::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = CRC_TABLE[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = CRC_TABLE[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+bool ModelFormat::layoutBlocks(Header& header) {
+    if (header.layerCount < 2 || header.layerCount > MAX_LAYERS) {
+        return false;
+    }
+    for (size_t i = 0; i < header.layerCount; i++) {
+        if (header.layers[i] == 0) {
+            return false;
+        }
+    }
+
+    if (header.hasMask() && header.keptWeights > header.weightCount()) {
+        return false;
+    }
+
+    const size_t payload = payloadSize(header.format, header.weightCount(), header.storedWeightCount(),
+                                       header.hasBiases() ? header.biasCount() : 0, header.hasMask());
+    size_t blockBytes = DEFAULT_BLOCK_BYTES;
+    if (payload > blockBytes * MAX_BLOCKS) {
+        blockBytes = (payload + MAX_BLOCKS - 1) / MAX_BLOCKS;
+    }
+    if (blockBytes > 0xFFFF) {
+        return false;
+    }
+
+    header.payloadBytes = static_cast<uint32_t>(payload);
+    header.blockBytes = static_cast<uint16_t>(blockBytes);
+    header.blockCount = static_cast<uint16_t>((payload + blockBytes - 1) / blockBytes);
+    header.headerBytes = static_cast<uint16_t>(headerSize(header.layerCount, header.blockCount, header.hasMask()));
+    return true;
+}
+
+size_t ModelFormat::encodedSize(const Header& header) {
+    Header layout = header;
+    return layoutBlocks(layout) ? layout.fileBytes() : 0;
+}
+
+size_t ModelFormat::encode(Header& header, const float* weights, const float* biases,
+                           uint8_t* out, size_t capacity, const uint8_t* mask) {
+    if (!weights || !out || (header.hasBiases() && !biases) || (header.hasMask() && !mask) ||
+        !layoutBlocks(header) || capacity < header.fileBytes()) {
+        return 0;
+    }
+    if (header.hasMask() && countKept(mask, header.weightCount()) != header.keptWeights) {
+        return 0;
+    }
+    header.version = header.hasMask() ? MASK_VERSION : VERSION;
+
+    uint8_t* payload = out + header.headerBytes;
+    size_t offset = header.maskSectionBytes();
+    if (header.hasMask()) {
+        memcpy(payload, mask, offset);
+        // Bits past the last weight are zero, so the section has one encoding per mask
+        if (header.weightCount() % 8 != 0) {
+            payload[offset - 1] &= static_cast<uint8_t>((1u << (header.weightCount() % 8)) - 1);
+        }
+    }
+    size_t written = WeightCodec::encode(weights, header.storedWeightCount(), header.format,
+                                         WeightCodec::Rounding::NEAREST, payload + offset,
+                                         header.weightSectionBytes());
+    if (written != header.weightSectionBytes()) {
+        return 0;
+    }
+    offset += written;
+    if (header.hasBiases()) {
+        written = WeightCodec::encode(biases, header.biasCount(), header.format,
+                                      WeightCodec::Rounding::NEAREST, payload + offset, header.biasSectionBytes());
+        if (written != header.biasSectionBytes()) {
+            return 0;
+        }
+    }
+
+    for (size_t block = 0; block < header.blockCount; block++) {
+        size_t start = block * header.blockBytes;
+        size_t length = header.payloadBytes - start < header.blockBytes
+            ? header.payloadBytes - start : header.blockBytes;
+        header.blockCrcs[block] = crc32(payload + start, length);
+    }
+
+    memset(out, 0, header.headerBytes);
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    writeU16(out + 4, header.version);
+    writeU16(out + 6, header.headerBytes);
+    out[8] = static_cast<uint8_t>(header.format);
+    out[9] = header.flags;
+    out[10] = header.layerCount;
+    writeU32(out + 12, floatBits(header.featureMin));
+    writeU32(out + 16, floatBits(header.featureMax));
+    writeU32(out + 20, header.payloadBytes);
+    writeU16(out + 24, header.blockBytes);
+    writeU16(out + 26, header.blockCount);
+
+    size_t position = FIXED_HEADER_BYTES;
+    for (size_t i = 0; i < header.layerCount; i++, position += 2) {
+        writeU16(out + position, header.layers[i]);
+    }
+    if (header.hasMask()) {
+        writeU32(out + position, header.keptWeights);
+        position += 4;
+    }
+    for (size_t block = 0; block < header.blockCount; block++, position += 4) {
+        writeU32(out + position, header.blockCrcs[block]);
+    }
+    writeU32(out + header.headerBytes - 4, crc32(out, header.headerBytes - 4));
+
+    return header.fileBytes();
+}
+
+bool ModelFormat::parseHeader(const uint8_t* in, size_t length, Header& header) {
+    if (!in || length < FIXED_HEADER_BYTES || memcmp(in, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+    const uint16_t version = readU16(in + 4);
+    if (version != VERSION && version != MASK_VERSION) {
+        return false;
+    }
+
+    const size_t headerBytes = readU16(in + 6);
+    if (headerBytes < FIXED_HEADER_BYTES + 4 || headerBytes > MAX_HEADER_BYTES || length < headerBytes ||
+        readU32(in + headerBytes - 4) != crc32(in, headerBytes - 4)) {
+        return false;
+    }
+
+    Header parsed;
+    parsed.version = version;
+    parsed.headerBytes = static_cast<uint16_t>(headerBytes);
+    parsed.format = static_cast<WeightCodec::Format>(in[8]);
+    parsed.flags = in[9];
+    parsed.layerCount = in[10];
+    parsed.featureMin = bitsToFloat(readU32(in + 12));
+    parsed.featureMax = bitsToFloat(readU32(in + 16));
+    parsed.payloadBytes = readU32(in + 20);
+    parsed.blockBytes = readU16(in + 24);
+    parsed.blockCount = readU16(in + 26);
+
+    if (parsed.format > WeightCodec::Format::INT8 || parsed.layerCount < 2 ||
+        parsed.layerCount > MAX_LAYERS || parsed.blockCount > MAX_BLOCKS || parsed.blockBytes == 0 ||
+        parsed.hasMask() != (version == MASK_VERSION) ||
+        headerBytes != headerSize(parsed.layerCount, parsed.blockCount, parsed.hasMask())) {
+        return false;
+    }
+
+    size_t offset = FIXED_HEADER_BYTES;
+    for (size_t i = 0; i < parsed.layerCount; i++, offset += 2) {
+        parsed.layers[i] = readU16(in + offset);
+    }
+    if (parsed.hasMask()) {
+        parsed.keptWeights = readU32(in + offset);
+        offset += 4;
+    }
+    for (size_t block = 0; block < parsed.blockCount; block++, offset += 4) {
+        parsed.blockCrcs[block] = readU32(in + offset);
+    }
+
+    // The payload size and blocks must agree with the topology
+    Header layout = parsed;
+    if (!layoutBlocks(layout) || layout.payloadBytes != parsed.payloadBytes ||
+        layout.blockBytes != parsed.blockBytes || layout.blockCount != parsed.blockCount) {
+        return false;
+    }
+
+    header = parsed;
+    return true;
+}
+
+bool ModelFormat::verifyPayload(const Header& header, const uint8_t* payload) {
+    for (size_t block = 0; block < header.blockCount; block++) {
+        size_t start = block * header.blockBytes;
+        size_t length = header.payloadBytes - start < header.blockBytes
+            ? header.payloadBytes - start : header.blockBytes;
+        if (crc32(payload + start, length) != header.blockCrcs[block]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ModelFormat::decodeWeights(const Header& header, const uint8_t* payload, float* out, size_t capacity) {
+    const size_t total = header.weightCount();
+    if (capacity < total) {
+        return 0;
+    }
+    size_t count = WeightCodec::decode(payload + header.maskSectionBytes(), header.weightSectionBytes(),
+                                       out, capacity);
+    if (count != header.storedWeightCount()) {
+        return 0;
+    }
+    if (!header.hasMask()) {
+        return count;
+    }
+
+    // Spread the kept weights out in place, from the back so none is overwritten unread
+    if (countKept(payload, total) != count) {
+        return 0;
+    }
+    size_t kept = count;
+    for (size_t i = total; i-- > 0;) {
+        out[i] = (payload[i / 8] >> (i % 8)) & 1 ? out[--kept] : 0.0f;
+    }
+    return total;
+}
+
+size_t ModelFormat::decodeBiases(const Header& header, const uint8_t* payload, float* out, size_t capacity) {
+    if (!header.hasBiases()) {
+        return 0;
+    }
+    size_t count = WeightCodec::decode(payload + header.maskSectionBytes() + header.weightSectionBytes(),
+                                       header.biasSectionBytes(), out, capacity);
+    return count == header.biasCount() ? count : 0;
+}
+
+ModelDecoder::ModelDecoder(uint8_t* payloadBuffer, size_t payloadCapacity)
+    : payloadBuffer(payloadBuffer),
+      payloadCapacity(payloadCapacity) {
+    reset();
+}
+
+void ModelDecoder::reset() {
+    parsedHeader = ModelFormat::Header();
+    expectedHeaderBytes = ModelFormat::FIXED_HEADER_BYTES;
+    receivedBytes = 0;
+    payloadPos = 0;
+    verifiedBytes = 0;
+    nextBlock = 0;
+    headerParsed = false;
+    state = Status::NEED_MORE;
+    lastError = Error::NONE;
+}
+
+ModelDecoder::Status ModelDecoder::fail(Error error) {
+    lastError = error;
+    state = Status::FAILED;
+    return state;
+}
+
+ModelDecoder::Status ModelDecoder::feedHeader(const uint8_t*& data, size_t& length) {
+    while (length > 0 && receivedBytes < expectedHeaderBytes) {
+        size_t take = expectedHeaderBytes - receivedBytes;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(headerBuffer + receivedBytes, data, take);
+        receivedBytes += take;
+        data += take;
+        length -= take;
+
+        if (receivedBytes < expectedHeaderBytes) {
+            return Status::NEED_MORE;
+        }
+
+        if (expectedHeaderBytes == ModelFormat::FIXED_HEADER_BYTES) {
+            // The fixed part tells how long the whole header is
+            if (memcmp(headerBuffer, ModelFormat::MAGIC, sizeof(ModelFormat::MAGIC)) != 0) {
+                return fail(Error::BAD_MAGIC);
+            }
+            const uint16_t version = readU16(headerBuffer + 4);
+            if (version != ModelFormat::VERSION && version != ModelFormat::MASK_VERSION) {
+                return fail(Error::UNSUPPORTED_VERSION);
+            }
+            size_t headerBytes = readU16(headerBuffer + 6);
+            if (headerBytes <= ModelFormat::FIXED_HEADER_BYTES || headerBytes > ModelFormat::MAX_HEADER_BYTES) {
+                return fail(Error::BAD_HEADER);
+            }
+            expectedHeaderBytes = headerBytes;
+            continue;
+        }
+
+        size_t headerBytes = expectedHeaderBytes;
+        if (readU32(headerBuffer + headerBytes - 4) != ModelFormat::crc32(headerBuffer, headerBytes - 4)) {
+            return fail(Error::HEADER_CRC);
+        }
+        if (!ModelFormat::parseHeader(headerBuffer, headerBytes, parsedHeader)) {
+            return fail(Error::BAD_HEADER);
+        }
+        if (parsedHeader.payloadBytes > payloadCapacity) {
+            return fail(Error::PAYLOAD_TOO_LARGE);
+        }
+        headerParsed = true;
+    }
+    return Status::NEED_MORE;
+}
+
+ModelDecoder::Status ModelDecoder::feed(const uint8_t* data, size_t length) {
+    if (state != Status::NEED_MORE) {
+        return length > 0 && state == Status::COMPLETE ? fail(Error::TRAILING_DATA) : state;
+    }
+
+    if (!headerParsed && (feedHeader(data, length) == Status::FAILED || !headerParsed)) {
+        return state;
+    }
+
+    while (length > 0) {
+        if (payloadPos >= parsedHeader.payloadBytes) {
+            return fail(Error::TRAILING_DATA);
+        }
+
+        // Copy up to the end of the current block, then check it
+        size_t blockEnd = static_cast<size_t>(nextBlock + 1) * parsedHeader.blockBytes;
+        if (blockEnd > parsedHeader.payloadBytes) {
+            blockEnd = parsedHeader.payloadBytes;
+        }
+        size_t take = blockEnd - payloadPos;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(payloadBuffer + payloadPos, data, take);
+        payloadPos += take;
+        receivedBytes += take;
+        data += take;
+        length -= take;
+
+        if (payloadPos == blockEnd) {
+            size_t blockStart = static_cast<size_t>(nextBlock) * parsedHeader.blockBytes;
+            if (ModelFormat::crc32(payloadBuffer + blockStart, blockEnd - blockStart) !=
+                parsedHeader.blockCrcs[nextBlock]) {
+                return fail(Error::BLOCK_CRC);
+            }
+            verifiedBytes = blockEnd;
+            nextBlock++;
+        }
+    }
+
+    if (payloadPos == parsedHeader.payloadBytes) {
+        state = Status::COMPLETE;
+    }
+    return state;
+}
+
+const char* ModelDecoder::errorName(Error error) {
+    switch (error) {
+        case Error::NONE: return "none";
+        case Error::BAD_MAGIC: return "bad magic";
+        case Error::UNSUPPORTED_VERSION: return "unsupported version";
+        case Error::BAD_HEADER: return "bad header";
+        case Error::HEADER_CRC: return "header CRC mismatch";
+        case Error::PAYLOAD_TOO_LARGE: return "payload too large";
+        case Error::BLOCK_CRC: return "block CRC mismatch";
+        case Error::TRAILING_DATA: return "trailing data";
+    }
+    return "unknown";
+}
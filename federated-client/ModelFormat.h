@@ -0,0 +1,186 @@
+#ifndef MODEL_FORMAT_H
+#define MODEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WeightCodec.h"
+
+// Versioned binary model file shared by the firmware and the host simulation.
+//
+// Layout (little-endian):
+//   Header, padded to a multiple of 16 bytes:
+//     [0..3]   magic "SBLM"
+//     [4..5]   version
+//     [6..7]   header size including padding and CRC
+//     [8]      weight format (WeightCodec::Format)
+//     [9]      flags (bit 0: per-neuron biases follow the weights, bit 1: pruning mask)
+//     [10]     layer count
+//     [11]     reserved
+//     [12..15] feature min (DataPreprocessor scale params)
+//     [16..19] feature max
+//     [20..23] payload size
+//     [24..25] block size
+//     [26..27] block count
+//     layer sizes (u16 each), kept weight count (u32, masked files only), CRC32 of every
+//     payload block (u32 each), zero padding, CRC32 of all preceding header bytes in the
+//     last 4 bytes
+//   Payload, contiguous:
+//     pruning mask (if flagged): one bit per weight, LSB first, set for kept weights
+//     weights as a WeightCodec payload, every layer's [output][input] matrix in layer order
+//     (the order of NeuralNetworkBikeLock::updateNetworkWeights); only the kept weights
+//     if the file has a mask
+//     biases as a second WeightCodec payload, per neuron in layer order (if flagged)
+//
+// Files with a mask are version 2, so decoders that predate it reject them; all others are
+// still written as version 1.
+class ModelFormat {
+public:
+    static constexpr uint8_t MAGIC[4] = {'S', 'B', 'L', 'M'};
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint16_t MASK_VERSION = 2;
+    static constexpr uint8_t FLAG_HAS_BIASES = 0x01;
+    static constexpr uint8_t FLAG_HAS_MASK = 0x02;
+
+    static constexpr size_t MAX_LAYERS = 8;
+    static constexpr size_t MAX_BLOCKS = 64;
+    static constexpr uint16_t DEFAULT_BLOCK_BYTES = 256;
+    static constexpr size_t FIXED_HEADER_BYTES = 28;
+    static constexpr size_t HEADER_ALIGNMENT = 16;
+
+    static constexpr size_t headerSize(size_t layerCount, size_t blockCount, bool masked = false) {
+        return (FIXED_HEADER_BYTES + 2 * layerCount + (masked ? 4 : 0) + 4 * blockCount + 4 +
+                HEADER_ALIGNMENT - 1) / HEADER_ALIGNMENT * HEADER_ALIGNMENT;
+    }
+    static constexpr size_t MAX_HEADER_BYTES =
+        (FIXED_HEADER_BYTES + 2 * MAX_LAYERS + 4 + 4 * MAX_BLOCKS + 4 + HEADER_ALIGNMENT - 1)
+        / HEADER_ALIGNMENT * HEADER_ALIGNMENT;
+    // Mask section of a model with weightCount weights
+    static constexpr size_t maskBytes(size_t weightCount) { return (weightCount + 7) / 8; }
+    // Payload of a model storing storedWeights of its weightCount weights and biasCount biases
+    // (0 without the bias flag); a mask is only present with the mask flag
+    static constexpr size_t payloadSize(WeightCodec::Format format, size_t weightCount, size_t storedWeights,
+                                        size_t biasCount, bool masked) {
+        return (masked ? maskBytes(weightCount) : 0) + WeightCodec::encodedSize(format, storedWeights) +
+               (biasCount > 0 ? WeightCodec::encodedSize(format, biasCount) : 0);
+    }
+
+    struct Header {
+        uint16_t version = VERSION;
+        uint16_t headerBytes = 0;
+        WeightCodec::Format format = WeightCodec::Format::FLOAT32;
+        uint8_t flags = 0;
+        uint8_t layerCount = 0;
+        uint16_t layers[MAX_LAYERS] = {};
+        float featureMin = 0.0f;
+        float featureMax = 1.0f;
+        uint32_t payloadBytes = 0;
+        uint16_t blockBytes = 0;
+        uint16_t blockCount = 0;
+        uint32_t blockCrcs[MAX_BLOCKS] = {};
+        uint32_t keptWeights = 0;   // Weights the mask keeps (masked files only)
+
+        bool hasBiases() const { return (flags & FLAG_HAS_BIASES) != 0; }
+        bool hasMask() const { return (flags & FLAG_HAS_MASK) != 0; }
+        size_t weightCount() const;
+        size_t biasCount() const;
+        // Weights in the weight section: all of them, or those the mask keeps
+        size_t storedWeightCount() const { return hasMask() ? keptWeights : weightCount(); }
+        size_t maskSectionBytes() const { return hasMask() ? maskBytes(weightCount()) : 0; }
+        size_t weightSectionBytes() const { return WeightCodec::encodedSize(format, storedWeightCount()); }
+        size_t biasSectionBytes() const { return hasBiases() ? WeightCodec::encodedSize(format, biasCount()) : 0; }
+        size_t fileBytes() const { return headerBytes + payloadBytes; }
+    };
+
+    // Incremental CRC32 (IEEE 802.3); pass the previous result to continue a running CRC
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+
+    // Size of a complete file for the header's topology, format and flags
+    static size_t encodedSize(const Header& header);
+
+    // Write a complete model. The header's topology, format, flags, kept weight count and scale
+    // params are used; its version, size, payload and block fields are filled in. biases may be
+    // null without the bias flag. With the mask flag, mask holds one bit per weight and weights
+    // only the keptWeights kept ones, in order. Returns bytes written, 0 on error.
+    static size_t encode(Header& header, const float* weights, const float* biases,
+                         uint8_t* out, size_t capacity, const uint8_t* mask = nullptr);
+
+    // Parse and verify a complete header. Returns false on a bad magic, version, size or CRC.
+    static bool parseHeader(const uint8_t* in, size_t length, Header& header);
+
+    // Verify every payload block of a complete file
+    static bool verifyPayload(const Header& header, const uint8_t* payload);
+
+    // Decode the payload sections. Return the number of values, 0 on error. Weights are
+    // always decoded in full, pruned ones as zero.
+    static size_t decodeWeights(const Header& header, const uint8_t* payload, float* out, size_t capacity);
+    static size_t decodeBiases(const Header& header, const uint8_t* payload, float* out, size_t capacity);
+    // The mask section of a verified payload, nullptr if the file has none
+    static const uint8_t* mask(const Header& header, const uint8_t* payload) {
+        return header.hasMask() ? payload : nullptr;
+    }
+
+    // Set bits among the first count bits of a mask
+    static size_t countKept(const uint8_t* mask, size_t count);
+
+private:
+    static bool layoutBlocks(Header& header);
+};
+
+// Streaming decoder for a model arriving in chunks (e.g. over BLE). The header is checked as
+// soon as it is complete and every payload block is checked as soon as its last byte arrives,
+// so a corrupted or mis-sized transfer fails at the first bad block.
+class ModelDecoder {
+public:
+    enum class Status : uint8_t {
+        NEED_MORE = 0,
+        COMPLETE = 1,
+        FAILED = 2
+    };
+
+    enum class Error : uint8_t {
+        NONE = 0,
+        BAD_MAGIC,
+        UNSUPPORTED_VERSION,
+        BAD_HEADER,
+        HEADER_CRC,
+        PAYLOAD_TOO_LARGE,
+        BLOCK_CRC,
+        TRAILING_DATA
+    };
+
+    // The verified payload is written to the caller's buffer
+    ModelDecoder(uint8_t* payloadBuffer, size_t payloadCapacity);
+
+    void reset();
+    Status feed(const uint8_t* data, size_t length);
+
+    bool headerReady() const { return headerParsed; }
+    const ModelFormat::Header& header() const { return parsedHeader; }
+    const uint8_t* payload() const { return payloadBuffer; }
+    Status status() const { return state; }
+    Error error() const { return lastError; }
+    size_t received() const { return receivedBytes; }
+    size_t verifiedPayloadBytes() const { return verifiedBytes; }
+
+    static const char* errorName(Error error);
+
+private:
+    Status fail(Error error);
+    Status feedHeader(const uint8_t*& data, size_t& length);
+
+    uint8_t headerBuffer[ModelFormat::MAX_HEADER_BYTES];
+    uint8_t* payloadBuffer;
+    size_t payloadCapacity;
+
+    ModelFormat::Header parsedHeader;
+    size_t expectedHeaderBytes;
+    size_t receivedBytes;
+    size_t payloadPos;
+    size_t verifiedBytes;
+    uint16_t nextBlock;
+    bool headerParsed;
+    Status state;
+    Error lastError;
+};
+
+#endif
@@ -3,7 +3,9 @@
 #include "NeuralNetworkBikeLock.h"
 #include <NeuralNetwork.h>
 
-NeuralNetworkBikeLock::NeuralNetworkBikeLock() : nn(nullptr), isInitialized(false) {
+NeuralNetworkBikeLock::NeuralNetworkBikeLock()
+    : nn(nullptr), isInitialized(false), fixedParameters(nullptr), replayPending(false),
+      replayRng(0x9E3779B9u) {
 }
 
 
@@ -23,13 +25,31 @@ void NeuralNetworkBikeLock::init(const unsigned int* layer_, float* weights, con
         Serial.println(totalWeights);
         
         // If no weights provided, create random weights
-        if (weights == nullptr) {
+        if (NNConfig::FIXED_POINT_BACKEND) {
+            if (!fixedNet.init(layer_, NumberOflayers)) {
+                Serial.println("Fixed-point network initialization failed");
+                return;
+            }
+            fixedParameters = new float[fixedNet.parameterCount()];
+        } else if (weights == nullptr) {
             nn= new NeuralNetwork(layer_, NumberOflayers);
         } else {
             nn = new NeuralNetwork(layer_, weights, NumberOflayers);
         }
         
+        if (NNConfig::LOCAL_EPOCHS > 1 && !replay.init(NNConfig::REPLAY_CAPACITY, layer_[0])) {
+            Serial.println("Replay buffer allocation failed");
+        }
+
         isInitialized = true;
+        if (NNConfig::FIXED_POINT_BACKEND) {
+            if (weights != nullptr) {
+                updateNetworkWeights(weights, getTotalWeights());
+            }
+            Serial.print("Fixed-point network uses ");
+            Serial.print(fixedNet.memoryBytes());
+            Serial.println(" bytes");
+        }
         Serial.println("Neural Network initialized successfully");
     } else {
         Serial.println("Neural Network already initialized");
@@ -50,17 +70,55 @@ void NeuralNetworkBikeLock::performLiveTraining(const float* features, int label
     }
     Serial.println("]");
     Serial.println("Performing backpropagation...");
-    nn->FeedForward(features);
-    nn->BackProp(expectedOutput); 
+    trainStep(features, expectedOutput);
     Serial.println("Backpropagation completed");
 
+    if (replay.add(features, static_cast<uint8_t>(label))) {
+        replayPending = true;
+    }
+
     Serial.println("Training process completed");
 }
 
+void NeuralNetworkBikeLock::finishLocalEpochs() {
+    if (!isInitialized || !replayPending || !replay.isInitialized()) return;
+    replayPending = false;
+
+    Serial.print("Replaying ");
+    Serial.print(replay.size());
+    Serial.println(" windows...");
+    for (unsigned int epoch = 1; epoch < NNConfig::LOCAL_EPOCHS; epoch++) {
+        ReplayBuffer::shuffle(replayOrder, replay.size(), replayRng);
+        for (size_t i = 0; i < replay.size(); i++) {
+            float expectedOutput[3] = {0.0f, 0.0f, 0.0f};
+            expectedOutput[replay.label(replayOrder[i])] = 1.0f;
+            trainStep(replay.features(replayOrder[i]), expectedOutput);
+        }
+    }
+    Serial.println("Local epochs completed");
+}
+
+void NeuralNetworkBikeLock::trainStep(const float* features, const float* expectedOutput) {
+    if (NNConfig::FIXED_POINT_BACKEND) {
+        fixedNet.train(features, expectedOutput, NNConfig::FIXED_POINT_LEARNING_RATE);
+        return;
+    }
+    nn->FeedForward(features);
+    nn->BackProp(expectedOutput);
+}
+
+const float* NeuralNetworkBikeLock::feedForward(const float* features) {
+    if (NNConfig::FIXED_POINT_BACKEND) {
+        fixedNet.predict(features, fixedOutputs);
+        return fixedOutputs;
+    }
+    return nn->FeedForward(features);
+}
+
 NNConfig::TheftClass NeuralNetworkBikeLock::performInference(const float* features) {
     if (!isInitialized) return NNConfig::TheftClass::NO_THEFT;
     
-    float* output = nn->FeedForward(features);
+    const float* output = feedForward(features);
     
     // Find the highest probability class
     float maxProb = output[0];
@@ -80,7 +138,7 @@ NNConfig::TheftClass NeuralNetworkBikeLock::performInference(const float* featur
 void NeuralNetworkBikeLock::getPredictionProbabilities(const float* features, float* probabilities) {
     if (!isInitialized) return;
     
-    float* output = nn->FeedForward(features);
+    const float* output = feedForward(features);
     
     // Copy probabilities
     for(int i = 0; i < 3; i++) {
@@ -92,6 +150,22 @@ bool NeuralNetworkBikeLock::getWeights(float* buffer, size_t length) {
     if (!isInitialized || !buffer) return false;
     
     size_t weightIndex = 0;
+
+    if (NNConfig::FIXED_POINT_BACKEND) {
+        if (getTotalWeights() > length) {
+            Serial.println("Error: Buffer too small for weights");
+            return false;
+        }
+        fixedNet.getParameters(fixedParameters, fixedNet.parameterCount());
+        const float* params = fixedParameters;
+        for (unsigned int i = 0; i + 1 < numLayers; i++) {
+            size_t layerWeights = layers[i] * layers[i + 1];
+            memcpy(&buffer[weightIndex], params, layerWeights * sizeof(float));
+            weightIndex += layerWeights;
+            params += layerWeights + layers[i + 1];  // The layer's biases stay on the device
+        }
+        return true;
+    }
     
     for (unsigned int i = 0; i < nn->numberOflayers; i++) {
         unsigned int numInputs = nn->layers[i]._numberOfInputs;
@@ -138,6 +212,22 @@ bool NeuralNetworkBikeLock::updateNetworkWeights(const float* newWeights, size_t
         return false;
     }
     
+    if (NNConfig::FIXED_POINT_BACKEND) {
+        // Keep the biases and requantize with the new weights
+        fixedNet.getParameters(fixedParameters, fixedNet.parameterCount());
+        float* params = fixedParameters;
+        size_t weightIndex = 0;
+        for (unsigned int i = 0; i + 1 < numLayers; i++) {
+            size_t layerWeights = layers[i] * layers[i + 1];
+            memcpy(params, &newWeights[weightIndex], layerWeights * sizeof(float));
+            weightIndex += layerWeights;
+            params += layerWeights + layers[i + 1];
+        }
+        fixedNet.setParameters(fixedParameters, fixedNet.parameterCount());
+        Serial.println("Network weights updated successfully");
+        return true;
+    }
+
     // Update weights in the network
     #if defined(REDUCE_RAM_WEIGHTS_LVL2)
         memcpy(nn->weights, newWeights, length * sizeof(float));
@@ -163,6 +253,12 @@ size_t NeuralNetworkBikeLock::getTotalWeights() {
     }
     
     size_t total = 0;
+    if (NNConfig::FIXED_POINT_BACKEND) {
+        for (unsigned int i = 0; i + 1 < numLayers; i++) {
+            total += layers[i] * layers[i + 1];
+        }
+        return total;
+    }
     for (unsigned int i = 0; i < nn->numberOflayers; i++) {
         unsigned int layerWeights = nn->layers[i]._numberOfInputs * nn->layers[i]._numberOfOutputs;
         total += layerWeights;
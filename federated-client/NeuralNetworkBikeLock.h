@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include "Config.h"
+#include "FixedPointMLP.h"
+#include "ReplayBuffer.h"
 
 class NeuralNetwork;
 
@@ -13,6 +15,8 @@ public:
     
     // Modified training method to accept label
     void performLiveTraining(const float* features, int label);
+    // Run the remaining local epochs over the replay buffer once per round, before an upload
+    void finishLocalEpochs();
     float getMeanSquaredError(size_t numSamples);
     
     // Inference methods
@@ -25,10 +29,26 @@ public:
     bool updateNetworkWeights(const float* newWeights, size_t length);
     
 private:
+    // One training step with the configured engine
+    void trainStep(const float* features, const float* expectedOutput);
+    // Output probabilities of the configured engine
+    const float* feedForward(const float* features);
+
     NeuralNetwork* nn;
     unsigned int* layers;
     unsigned int numLayers;
     bool isInitialized;
+
+    // NNConfig::FIXED_POINT_BACKEND: parameters in FixedPointMLP order (per layer the weights,
+    // then the biases), used to exchange the weights alone
+    FixedPointMLP fixedNet;
+    float* fixedParameters;
+    float fixedOutputs[NNConfig::LAYERS[NNConfig::NUM_LAYERS - 1]];
+
+    ReplayBuffer replay;
+    bool replayPending;                            // Windows were trained since the last replay
+    uint32_t replayRng;
+    uint16_t replayOrder[NNConfig::REPLAY_CAPACITY];
 };
 
 #endif
\ No newline at end of file
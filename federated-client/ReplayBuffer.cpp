@@ -0,0 +1,56 @@
+#include "ReplayBuffer.h"
+#include <string.h>
+
+ReplayBuffer::ReplayBuffer()
+    : data(nullptr), labels(nullptr), slots(0), width(0), count(0), next(0) {
+}
+
+ReplayBuffer::~ReplayBuffer() {
+    release();
+}
+
+void ReplayBuffer::release() {
+    delete[] data;
+    delete[] labels;
+    data = nullptr;
+    labels = nullptr;
+    slots = 0;
+    width = 0;
+    clear();
+}
+
+bool ReplayBuffer::init(size_t capacity, size_t featureCount) {
+    release();
+    if (capacity == 0 || featureCount == 0 || capacity > 0xFFFF) return false;
+
+    data = new float[capacity * featureCount];
+    labels = new uint8_t[capacity];
+    slots = capacity;
+    width = featureCount;
+    return true;
+}
+
+bool ReplayBuffer::add(const float* features, uint8_t label) {
+    if (slots == 0 || features == nullptr) return false;
+
+    memcpy(data + next * width, features, width * sizeof(float));
+    labels[next] = label;
+    next = (next + 1) % slots;
+    if (count < slots) count++;
+    return true;
+}
+
+void ReplayBuffer::shuffle(uint16_t* order, size_t count, uint32_t& state) {
+    for (size_t i = 0; i < count; i++) {
+        order[i] = static_cast<uint16_t>(i);
+    }
+    for (size_t i = count; i > 1; i--) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        size_t j = static_cast<size_t>((static_cast<uint64_t>(state) * i) >> 32);
+        uint16_t swap = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = swap;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded ring of recent training windows (feature vector and class label), shared by the
+// firmware and the host simulation. Local epochs revisit the buffer instead of waiting for
+// new windows. When full, each new window replaces the oldest one.
+//
+// Memory: capacity * (featureCount * 4 + 1) bytes, allocated once by init(). With the 11
+// features of SignalConfig, 64 windows take 2880 bytes.
+class ReplayBuffer {
+public:
+    ReplayBuffer();
+    ~ReplayBuffer();
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    bool init(size_t capacity, size_t featureCount);
+    bool isInitialized() const { return slots > 0; }
+
+    // Store a window, replacing the oldest one when full
+    bool add(const float* features, uint8_t label);
+    void clear() { count = 0; next = 0; }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots; }
+    size_t featureCount() const { return width; }
+    size_t memoryBytes() const { return slots * (width * sizeof(float) + 1); }
+
+    // Window i, oldest first (i < size())
+    const float* features(size_t i) const { return data + slot(i) * width; }
+    uint8_t label(size_t i) const { return labels[slot(i)]; }
+
+    // Random permutation of 0..count-1 (Fisher-Yates on a xorshift32 state, which must be
+    // non-zero), the visiting order of one local epoch
+    static void shuffle(uint16_t* order, size_t count, uint32_t& state);
+
+private:
+    size_t slot(size_t i) const { return (next + slots - count + i) % slots; }
+    void release();
+
+    float* data;
+    uint8_t* labels;
+    size_t slots;
+    size_t width;
+    size_t count;
+    size_t next;      // Slot written by the next add()
+};
+
+#endif
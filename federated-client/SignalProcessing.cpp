@@ -1,12 +1,19 @@
 #include "SignalProcessing.h"
 
+static_assert(SignalConfig::ACQUISITION_LINGER_MS > SignalConfig::SAMPLES * SignalConfig::SAMPLING_PERIOD_MS,
+              "A fresh window must complete before the acquisition stops");
+
 const float SignalProcessing::freqBands[SignalConfig::FEATURE_BINS + 1] PROGMEM = {0, 6, 12, 19, 25, 31, 37, 44, 50};
 
 SignalProcessing::SignalProcessing() 
-    : FFT(vReal, vImag, SignalConfig::SAMPLES, SignalConfig::SAMPLING_FREQ), millisOld(0) {
+    : FFT(windows[0], vImag, SignalConfig::SAMPLES, SignalConfig::SAMPLING_FREQ),
+      acquisition(windows[0], windows[1], SignalConfig::SAMPLES),
+      windowFeaturesValid(false), featureCheck(false), checkedWindows(0), maxFeatureDeviation(0),
+      requested(false), requestedFresh(false), acceptFrom(0), lastRequestMs(0), lastSample(0) {
     // Initialize arrays
     for(int i = 0; i < SignalConfig::SAMPLES; i++) {
-        vReal[i] = 0;
+        windows[0][i] = 0;
+        windows[1][i] = 0;
         vImag[i] = 0;
     }
     for(int i = 0; i < SignalConfig::TOTAL_FEATURES; i++) {
@@ -14,41 +21,134 @@ SignalProcessing::SignalProcessing()
     }
 }
 
-bool SignalProcessing::collectData() {
-    float x, y, z;
-    millisOld = millis();
-    
-    // Data Collection
-    for(int i = 0; i < SignalConfig::SAMPLES; i++) {
-        while((millis() - millisOld) < SignalConfig::SAMPLING_PERIOD_MS);
-        millisOld = millis();
-        
+bool SignalProcessing::requestWindow(bool fresh) {
+    lastRequestMs = millis();
+    if (requested && requestedFresh == fresh) {
+        return false;
+    }
+    if (!acquisition.running()) {
+        lastSample = 0;
+        acquisition.start(micros(), SignalConfig::SAMPLING_PERIOD_MS * 1000UL, SignalConfig::WINDOW_OVERLAP);
+        restartWindows();
+    }
+
+    const uint32_t next = acquisition.sampleCount();
+    if (fresh) {
+        // Start the window now rather than at the next hop of a running acquisition
+        acquisition.restart();
+        restartWindows();
+        acceptFrom = next;
+    } else {
+        // The window being filled (or any later one) ends after the request
+        acceptFrom = next + 1 > SignalConfig::SAMPLES ? next + 1 - SignalConfig::SAMPLES : 0;
+    }
+    requested = true;
+    requestedFresh = fresh;
+    return true;
+}
+
+bool SignalProcessing::poll() {
+    if (!acquisition.running()) {
+        return false;
+    }
+    if (millis() - lastRequestMs >= SignalConfig::ACQUISITION_LINGER_MS) {
+        acquisition.stop();
+        requested = false;
+        return false;
+    }
+
+    const uint32_t gaps = acquisition.gaps();
+    uint16_t owed = acquisition.due(micros());
+    if (acquisition.gaps() != gaps) {
+        restartWindows();
+    }
+    if (owed > 0) {
+        float x, y, z;
         if (IMU.accelerationAvailable()) {
             IMU.readAcceleration(x, y, z);
-            vReal[i] = x * 9.81; // Convert to m/s^2
-        } else {
-            vReal[i] = (i > 0) ? vReal[i-1] : 0;
+            lastSample = x * 9.81; // Convert to m/s^2
         }
-        vImag[i] = 0;
+        // Late samples repeat the current reading, as the previous loop did without new data
+        for (uint16_t i = 0; i < owed; i++) {
+            const bool published = acquisition.push(lastSample);
+            const bool computed = incremental.push(lastSample);
+            if (published) {
+                windowFeaturesValid = computed;
+                if (computed) {
+                    memcpy(windowFeatures, incremental.features(), sizeof(windowFeatures));
+                }
+            }
+        }
+    }
+    return requested && acquisition.ready(acceptFrom);
+}
+
+bool SignalProcessing::collectData() {
+    requestWindow(true);
+    while (!poll()) {
+        delay(1);
     }
     return true;
 }
 
-void SignalProcessing::processData() {
+bool SignalProcessing::processData() {
+    if (!requested || !acquisition.ready(acceptFrom)) {
+        return false;
+    }
+    float* window = acquisition.acquire();
+    if (!windowFeaturesValid) {
+        computeFftFeatures(window, features);
+    } else {
+        memcpy(features, windowFeatures, sizeof(features));
+        if (featureCheck) {
+            float reference[SignalConfig::TOTAL_FEATURES];
+            computeFftFeatures(window, reference);
+            float scale = 0;
+            for(int i = 0; i < SignalConfig::TOTAL_FEATURES; i++) {
+                if (fabsf(reference[i]) > scale) scale = fabsf(reference[i]);
+            }
+            for(int i = 0; i < SignalConfig::TOTAL_FEATURES; i++) {
+                float deviation = scale > 0 ? fabsf(features[i] - reference[i]) / scale : 0;
+                if (deviation > maxFeatureDeviation) maxFeatureDeviation = deviation;
+            }
+            checkedWindows++;
+        }
+    }
+    acquisition.release();
+    requested = false;
+    lastRequestMs = millis();
+    return true;
+}
+
+void SignalProcessing::restartWindows() {
+    incremental.restart();
+    windowFeaturesValid = false;
+}
+
+void SignalProcessing::computeFftFeatures(float* window, float* out) {
+    // The FFT works in place on the acquired buffer; sampling continues in the other one
+    for(int i = 0; i < SignalConfig::SAMPLES; i++) {
+        vImag[i] = 0;
+    }
+
     // FFT Processing
+    FFT.setArrays(window, vImag);
     FFT.dcRemoval();
     FFT.windowing(FFTWindow::Hamming, FFTDirection::Forward);
     FFT.compute(FFTDirection::Forward);
     FFT.complexToMagnitude();
     
-    extractFeatures();
+    extractFeatures(window, out);
 }
 
 bool SignalProcessing::begin() {
+    // Without memory for the filter bank, features fall back to the FFT path
+    incremental.init(SignalConfig::SAMPLES, SignalConfig::WINDOW_OVERLAP, SignalConfig::SAMPLING_FREQ,
+                     SignalConfig::FREQ_BANDS, SignalConfig::FEATURE_BINS);
     return IMU.begin();
 }
 
-void SignalProcessing::extractFeatures() {
+void SignalProcessing::extractFeatures(const float* magnitudes, float* out) {
     // Calculate frequency bin energies
     for(int bin = 0; bin < SignalConfig::FEATURE_BINS; bin++) {
         float binEnergy = 0;
@@ -56,28 +156,28 @@ void SignalProcessing::extractFeatures() {
         int endIndex = (pgm_read_float(&freqBands[bin + 1]) * SignalConfig::SAMPLES) / SignalConfig::SAMPLING_FREQ;
         
         for(int i = startIndex; i < endIndex; i++) {
-            binEnergy += vReal[i];
+            binEnergy += magnitudes[i];
         }
-        features[bin] = binEnergy / (endIndex - startIndex);
+        out[bin] = binEnergy / (endIndex - startIndex);
     }
     
     // Calculate statistical features
     float mean = 0, maxVal = 0;
     for(int i = 0; i < SignalConfig::SAMPLES/2; i++) {
-        mean += vReal[i];
-        if(vReal[i] > maxVal) maxVal = vReal[i];
+        mean += magnitudes[i];
+        if(magnitudes[i] > maxVal) maxVal = magnitudes[i];
     }
     mean /= (SignalConfig::SAMPLES/2);
     
     float variance = 0;
     for(int i = 0; i < SignalConfig::SAMPLES/2; i++) {
-        float diff = vReal[i] - mean;
+        float diff = magnitudes[i] - mean;
         variance += diff * diff;
     }
     variance /= (SignalConfig::SAMPLES/2);
     
     // Store statistical features
-    features[SignalConfig::FEATURE_BINS] = mean;
-    features[SignalConfig::FEATURE_BINS + 1] = maxVal;
-    features[SignalConfig::FEATURE_BINS + 2] = sqrt(variance);
+    out[SignalConfig::FEATURE_BINS] = mean;
+    out[SignalConfig::FEATURE_BINS + 1] = maxVal;
+    out[SignalConfig::FEATURE_BINS + 2] = sqrt(variance);
 }
\ No newline at end of file
@@ -4,25 +4,65 @@
 #include "arduinoFFT.h"
 #include <Arduino_LSM9DS1.h>
 #include "Config.h"
+#include "WindowAcquisition.h"
+#include "IncrementalFeatures.h"
 
+// Accelerometer windows are sampled in the background: poll() takes the samples the
+// schedule owes and returns at once, so the caller keeps serving BLE while a window
+// fills. Features are computed sample by sample (IncrementalFeatures.h) and are ready
+// when the window completes; the FFT path remains as the fallback and as a reference.
+// It runs in place on a complete window while the next one fills the other buffer (see
+// WindowAcquisition.h).
 class SignalProcessing {
 public:
     SignalProcessing();
     
     bool begin();
+
+    // Ask for a window, starting the acquisition if it is stopped. A fresh window only
+    // holds samples taken after the request (training, where the label must match); any
+    // other window just has to end after it. Returns false while the same kind of
+    // request is already pending.
+    bool requestWindow(bool fresh);
+    // Take due samples; true once the requested window is complete. The acquisition stops
+    // when no window was requested for ACQUISITION_LINGER_MS.
+    bool poll();
+    // Features of the requested window, if it is complete
+    bool processData();
+
+    // Blocks until a fresh window is complete (TimingBenchmark)
     bool collectData();
-    void processData();
     const float* getFeatures() const { return features; }
+    const WindowAcquisition& getAcquisition() const { return acquisition; }
+
+    // Also run the FFT path on every window and track the largest deviation of the
+    // incremental features, relative to the largest FFT feature of the window
+    void setFeatureCheck(bool enabled) { featureCheck = enabled; }
+    uint32_t getCheckedWindows() const { return checkedWindows; }
+    float getMaxFeatureDeviation() const { return maxFeatureDeviation; }
     
 private:
     ArduinoFFT<float> FFT;
-    float vReal[SignalConfig::SAMPLES];
+    float windows[2][SignalConfig::SAMPLES];
     float vImag[SignalConfig::SAMPLES];
     float features[SignalConfig::TOTAL_FEATURES];
-    unsigned long millisOld;
+    WindowAcquisition acquisition;
+    IncrementalFeatures incremental;
+    float windowFeatures[SignalConfig::TOTAL_FEATURES];   // Of the window waiting in acquisition
+    bool windowFeaturesValid;
+    bool featureCheck;
+    uint32_t checkedWindows;
+    float maxFeatureDeviation;
+    bool requested;
+    bool requestedFresh;
+    uint32_t acceptFrom;
+    unsigned long lastRequestMs;
+    float lastSample;
     
     static const float freqBands[SignalConfig::FEATURE_BINS + 1] PROGMEM;
-    void extractFeatures();
+    void restartWindows();
+    void computeFftFeatures(float* window, float* out);
+    void extractFeatures(const float* magnitudes, float* out);
 };
 
-#endif
\ No newline at end of file
+#endif
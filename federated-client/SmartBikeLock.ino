@@ -57,12 +57,15 @@ void loop() {
     bleComm.update();
 
     switch (bleComm.getCurrentCommand()) {
+        // The window is sampled in the background while loop() keeps serving BLE; the
+        // command finishes in the iteration that finds it complete
         case Command::START_CLASSIFICATION: {
-            #ifdef DEBUG
-            Serial.println("Starting classification...");
-            #endif
-            if (signalProc.collectData()) {
-                signalProc.processData();
+            if (signalProc.requestWindow(false)) {
+                #ifdef DEBUG
+                Serial.println("Starting classification...");
+                #endif
+            }
+            if (signalProc.processData()) {
                 const float* features = signalProc.getFeatures();
                 
                 // Perform classification
@@ -74,18 +77,19 @@ void loop() {
                 #ifdef DEBUG
                 Serial.println("Classification complete");
                 #endif
+                bleComm.resetState();
             }
-            
-            bleComm.resetState();
             break;
           }
         
         case Command::START_TRAINING: {
-            #ifdef DEBUG
-            Serial.println("Starting training...");
-            #endif
-            if (signalProc.collectData()) {
-                signalProc.processData();
+            // Only samples taken after the command belong to its label
+            if (signalProc.requestWindow(true)) {
+                #ifdef DEBUG
+                Serial.println("Starting training...");
+                #endif
+            }
+            if (signalProc.processData()) {
                 const float* features = signalProc.getFeatures();
                 // Get label from BLE characteristic
                 int8_t label = bleComm. getTrainingLabel();
@@ -100,13 +104,13 @@ void loop() {
                     Serial.println("Invalid label received");
                     #endif
                 }
+                bleComm.resetState();
             }
-            
-            bleComm.resetState();
             break;
           }
         
         case Command::GET_WEIGHTS: {
+            NN.finishLocalEpochs();
             size_t numWeights = NN.getTotalWeights();
             
             // Use Communication's tempBuffer directly
@@ -119,13 +123,77 @@ void loop() {
           }
                 
         case Command::SET_WEIGHTS: {
-            if (bleComm.receiveWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS)) {                     
+            // Returns true once the last chunk has arrived; errors reset the state
+            if (bleComm.receiveWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS)) {
+                NN.updateNetworkWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+                bleComm.setReferenceWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+            }
+            break;
+          }
+        case Command::GET_WEIGHTS_ENCODED: {
+            NN.finishLocalEpochs();
+            size_t numWeights = NN.getTotalWeights();
+
+            if (NN.getWeights(bleComm.getTempBuffer(), numWeights)) {
+                bleComm.sendEncodedWeights(bleComm.getTempBuffer(), numWeights,
+                    static_cast<WeightCodec::Format>(BLEConfig::UPLOAD_WEIGHT_FORMAT));
+            } else {
+              bleComm.resetState();
+            }
+            break;
+          }
+
+        case Command::SET_WEIGHTS_ENCODED: {
+            // Returns true once the whole payload has arrived and decoded
+            if (bleComm.receiveEncodedWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS)) {
+                NN.updateNetworkWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+                bleComm.setReferenceWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+            }
+            break;
+          }
+
+        case Command::SET_MODEL: {
+            // Returns true once the whole model has arrived with every block verified
+            if (bleComm.receiveModel(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS)) {
+                NN.updateNetworkWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+                bleComm.setReferenceWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+            }
+            break;
+          }
+
+        case Command::GET_WEIGHTS_PIPELINED: {
+            NN.finishLocalEpochs();
+            size_t numWeights = NN.getTotalWeights();
+
+            if (NN.getWeights(bleComm.getTempBuffer(), numWeights)) {
+                bleComm.sendWeightsPipelined(bleComm.getTempBuffer(), numWeights);
+            } else {
+              bleComm.resetState();
+            }
+            break;
+          }
+
+        case Command::SET_WEIGHTS_PIPELINED: {
+            // Blocks until the transfer completes, fails or is interrupted
+            if (bleComm.receiveWeightsPipelined(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS)) {
                 NN.updateNetworkWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+                bleComm.setReferenceWeights(bleComm.getTempBuffer(), NNConfig::MAX_WEIGHTS);
+            }
+            break;
+          }
+
+        case Command::GET_WEIGHT_DELTA: {
+            NN.finishLocalEpochs();
+            size_t numWeights = NN.getTotalWeights();
+
+            if (NN.getWeights(bleComm.getTempBuffer(), numWeights)) {
+                bleComm.sendWeightDelta(bleComm.getTempBuffer(), numWeights);
             } else {
               bleComm.resetState();
             }
             break;
           }
+
        /* case Command::START_INFERENCE_BENCHMARK: {
               Serial.println("Starting inference benchmark...");
               benchmark.measureInferenceLatency();
@@ -144,5 +212,10 @@ void loop() {
           }*/
     }
     
-    delay(50);
+    // Wait out the loop period while sampling stays on schedule
+    const unsigned long waitStart = millis();
+    do {
+        signalProc.poll();
+        delay(1);
+    } while (millis() - waitStart < 50);
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "SparseDelta.h"
+#include <string.h>
+
+namespace {
+    void writeU32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint32_t readU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t floatBits(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsToFloat(uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+size_t SparseDelta::entriesForDensity(size_t count, float density) {
+    if (density >= 1.0f) {
+        return count;
+    }
+    size_t k = static_cast<size_t>(count * density + 0.5f);
+    return k > 0 ? k : 1;
+}
+
+uint32_t SparseDelta::magnitudeBits(float value) {
+    // For non-negative floats the bit pattern orders like the value; NaN sorts last
+    uint32_t bits = floatBits(value) & 0x7FFFFFFF;
+    return bits > 0x7F800000 ? 0 : bits;
+}
+
+size_t SparseDelta::writeVarint(uint32_t value, uint8_t* out) {
+    size_t written = 0;
+    while (value >= 0x80) {
+        out[written++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[written++] = static_cast<uint8_t>(value);
+    return written;
+}
+
+size_t SparseDelta::readVarint(const uint8_t* in, size_t length, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < length && i < MAX_VARINT_BYTES; i++) {
+        value |= static_cast<uint32_t>(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t SparseDelta::encodeTopK(const float* delta, size_t count, size_t k,
+                               uint8_t* out, size_t capacity, float* residual) {
+    if (!delta || !out || !residual || k == 0) {
+        return 0;
+    }
+    if (k > count) {
+        k = count;
+    }
+    if (capacity < maxEncodedSize(k)) {
+        return 0;
+    }
+
+    // Accumulate the new delta onto what previous uploads left behind
+    for (size_t i = 0; i < count; i++) {
+        residual[i] += delta[i];
+    }
+
+    // Largest threshold t with at least k magnitudes >= t, i.e. the k-th largest magnitude
+    uint32_t low = 0;
+    uint32_t high = 0x7F800000;
+    while (low < high) {
+        uint32_t mid = low + (high - low + 1) / 2;
+        size_t atLeast = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (magnitudeBits(residual[i]) >= mid) {
+                atLeast++;
+            }
+        }
+        if (atLeast >= k) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    const uint32_t threshold = low;
+
+    size_t above = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (magnitudeBits(residual[i]) > threshold) {
+            above++;
+        }
+    }
+    // Ties at the threshold fill the remaining slots in index order
+    size_t tiesAllowed = k - above;
+
+    out[0] = VERSION;
+    out[1] = 0;
+    out[2] = 0;
+    out[3] = 0;
+    writeU32(out + 4, static_cast<uint32_t>(count));
+    writeU32(out + 8, static_cast<uint32_t>(k));
+
+    size_t written = HEADER_BYTES;
+    size_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t bits = magnitudeBits(residual[i]);
+        bool selected = bits > threshold;
+        if (!selected && bits == threshold && tiesAllowed > 0) {
+            selected = true;
+            tiesAllowed--;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        written += writeVarint(static_cast<uint32_t>(i - previous), out + written);
+        writeU32(out + written, floatBits(residual[i]));
+        written += sizeof(float);
+        previous = i;
+        residual[i] = 0.0f;
+    }
+
+    return written;
+}
+
+bool SparseDelta::peekHeader(const uint8_t* in, size_t length, size_t& count, size_t& entries) {
+    if (!in || length < HEADER_BYTES || in[0] != VERSION) {
+        return false;
+    }
+    count = readU32(in + 4);
+    entries = readU32(in + 8);
+    return true;
+}
+
+bool SparseDelta::apply(const uint8_t* in, size_t length, float* target, size_t count, float scale) {
+    size_t denseCount;
+    size_t entries;
+    if (!peekHeader(in, length, denseCount, entries) || denseCount != count || !target) {
+        return false;
+    }
+
+    size_t offset = HEADER_BYTES;
+    size_t index = 0;
+    for (size_t e = 0; e < entries; e++) {
+        uint32_t gap;
+        size_t used = readVarint(in + offset, length - offset, gap);
+        if (used == 0 || offset + used + sizeof(float) > length) {
+            return false;
+        }
+        offset += used;
+        index += gap;
+        if (index >= count) {
+            return false;
+        }
+
+        float value = bitsToFloat(readU32(in + offset));
+        offset += sizeof(float);
+        target[index] += scale * value;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SPARSE_DELTA_H
+#define SPARSE_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Top-k sparse weight deltas, shared by the firmware and the host simulation.
+//
+// Payload layout (little-endian):
+//   [0]     version
+//   [1..3]  reserved
+//   [4..7]  dense value count
+//   [8..11] number of entries k
+//   k entries of (varint index gap, float32 value), indices ascending
+class SparseDelta {
+public:
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 12;
+    static constexpr size_t MAX_VARINT_BYTES = 5;
+
+    // Worst-case payload size for k entries
+    static constexpr size_t maxEncodedSize(size_t k) {
+        return HEADER_BYTES + k * (MAX_VARINT_BYTES + sizeof(float));
+    }
+
+    // Number of entries sent for a density in (0, 1]
+    static size_t entriesForDensity(size_t count, float density);
+
+    // Send the k largest-magnitude entries of delta + residual. Entries that are not sent
+    // accumulate in residual for later uploads. Needs no scratch memory: the k-th largest
+    // magnitude is found by bisection on its float bits. Returns bytes written, 0 on error.
+    static size_t encodeTopK(const float* delta, size_t count, size_t k,
+                             uint8_t* out, size_t capacity, float* residual);
+
+    // Add scale * value to target for every entry of the payload
+    static bool apply(const uint8_t* in, size_t length, float* target, size_t count, float scale = 1.0f);
+
+    static bool peekHeader(const uint8_t* in, size_t length, size_t& count, size_t& entries);
+
+    static size_t writeVarint(uint32_t value, uint8_t* out);
+    static size_t readVarint(const uint8_t* in, size_t length, uint32_t& value);
+
+private:
+    static uint32_t magnitudeBits(float value);
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "SparseMLP.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+    bool maskBit(const uint8_t* mask, size_t index) {
+        return mask == nullptr || ((mask[index / 8] >> (index % 8)) & 1) != 0;
+    }
+
+    float sigmoid(float x) {
+        return 1.0f / (1.0f + expf(-x));
+    }
+}
+
+SparseMLP::SparseMLP()
+    : layerCount(0), errors(nullptr), widest(0) {
+    memset(layers, 0, sizeof(layers));
+}
+
+SparseMLP::~SparseMLP() {
+    release();
+}
+
+void SparseMLP::release() {
+    for (unsigned int l = 0; l < layerCount; l++) {
+        delete[] layers[l].rowStart;
+        delete[] layers[l].columns;
+        delete[] layers[l].values;
+        delete[] layers[l].biases;
+        delete[] layers[l].activations;
+    }
+    memset(layers, 0, sizeof(layers));
+    delete[] errors;
+    errors = nullptr;
+    layerCount = 0;
+    widest = 0;
+}
+
+bool SparseMLP::init(const unsigned int* topology, unsigned int numLayers) {
+    if (!topology || numLayers < 2 || numLayers > MAX_LAYERS) {
+        return false;
+    }
+    for (unsigned int l = 0; l < numLayers; l++) {
+        if (topology[l] == 0 || (l + 1 < numLayers && topology[l] > MAX_INPUTS)) {
+            return false;
+        }
+        // Row offsets are 16-bit
+        if (l + 1 < numLayers && topology[l] * topology[l + 1] > 0xFFFF) {
+            return false;
+        }
+    }
+
+    release();
+    layerCount = numLayers - 1;
+    widest = topology[0];
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        layer.inputs = topology[l];
+        layer.outputs = topology[l + 1];
+        layer.rowStart = new uint16_t[layer.outputs + 1];
+        layer.biases = new float[layer.outputs];
+        layer.activations = new float[layer.outputs];
+        memset(layer.biases, 0, layer.outputs * sizeof(float));
+        memset(layer.activations, 0, layer.outputs * sizeof(float));
+        if (layer.outputs > widest) widest = layer.outputs;
+    }
+    errors = new float[2 * widest];
+    return setMask(nullptr, weightCount());
+}
+
+bool SparseMLP::setMask(const uint8_t* mask, size_t count) {
+    if (!layerCount || count != weightCount()) {
+        return false;
+    }
+
+    size_t bit = 0;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        size_t kept = 0;
+        for (size_t i = 0; i < static_cast<size_t>(layer.inputs) * layer.outputs; i++) {
+            kept += maskBit(mask, bit + i);
+        }
+
+        // Build the new rows, carrying over the values of weights that stay
+        uint16_t* rowStart = new uint16_t[layer.outputs + 1];
+        uint8_t* columns = new uint8_t[kept > 0 ? kept : 1];
+        float* values = new float[kept > 0 ? kept : 1];
+        size_t next = 0;
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            rowStart[o] = static_cast<uint16_t>(next);
+            // No rows yet right after init()
+            uint16_t old = layer.columns ? layer.rowStart[o] : 0;
+            const uint16_t oldEnd = layer.columns ? layer.rowStart[o + 1] : 0;
+            for (unsigned int i = 0; i < layer.inputs; i++, bit++) {
+                while (old < oldEnd && layer.columns[old] < i) old++;
+                if (!maskBit(mask, bit)) {
+                    continue;
+                }
+                columns[next] = static_cast<uint8_t>(i);
+                values[next] = old < oldEnd && layer.columns[old] == i ? layer.values[old] : 0.0f;
+                next++;
+            }
+        }
+        rowStart[layer.outputs] = static_cast<uint16_t>(next);
+
+        delete[] layer.rowStart;
+        delete[] layer.columns;
+        delete[] layer.values;
+        layer.rowStart = rowStart;
+        layer.columns = columns;
+        layer.values = values;
+    }
+    return true;
+}
+
+size_t SparseMLP::parameterCount() const {
+    size_t count = 0;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        count += (layers[l].inputs + 1) * layers[l].outputs;
+    }
+    return count;
+}
+
+size_t SparseMLP::weightCount() const {
+    size_t count = 0;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        count += layers[l].inputs * layers[l].outputs;
+    }
+    return count;
+}
+
+size_t SparseMLP::keptWeights() const {
+    size_t count = 0;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        count += layers[l].rowStart[layers[l].outputs];
+    }
+    return count;
+}
+
+size_t SparseMLP::memoryBytes() const {
+    if (!layerCount) return 0;
+    size_t bytes = 2 * widest * sizeof(float);
+    for (unsigned int l = 0; l < layerCount; l++) {
+        const size_t kept = layers[l].rowStart[layers[l].outputs];
+        bytes += kept * (sizeof(uint8_t) + sizeof(float)) + (layers[l].outputs + 1) * sizeof(uint16_t) +
+                 2 * layers[l].outputs * sizeof(float);
+    }
+    return bytes;
+}
+
+bool SparseMLP::setParameters(const float* params, size_t count) {
+    if (!layerCount || !params || count != parameterCount()) {
+        return false;
+    }
+
+    const float* p = params;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            const float* row = p + o * layer.inputs;
+            for (uint16_t k = layer.rowStart[o]; k < layer.rowStart[o + 1]; k++) {
+                layer.values[k] = row[layer.columns[k]];
+            }
+        }
+        p += layer.inputs * layer.outputs;
+        memcpy(layer.biases, p, layer.outputs * sizeof(float));
+        p += layer.outputs;
+    }
+    return true;
+}
+
+bool SparseMLP::getParameters(float* params, size_t count) const {
+    if (!layerCount || !params || count != parameterCount()) {
+        return false;
+    }
+
+    float* p = params;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        const Layer& layer = layers[l];
+        memset(p, 0, layer.inputs * layer.outputs * sizeof(float));
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            float* row = p + o * layer.inputs;
+            for (uint16_t k = layer.rowStart[o]; k < layer.rowStart[o + 1]; k++) {
+                row[layer.columns[k]] = layer.values[k];
+            }
+        }
+        p += layer.inputs * layer.outputs;
+        memcpy(p, layer.biases, layer.outputs * sizeof(float));
+        p += layer.outputs;
+    }
+    return true;
+}
+
+const float* SparseMLP::forward(const float* features) {
+    const float* input = features;
+    for (unsigned int l = 0; l < layerCount; l++) {
+        Layer& layer = layers[l];
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            float sum = layer.biases[o];
+            for (uint16_t k = layer.rowStart[o]; k < layer.rowStart[o + 1]; k++) {
+                sum += layer.values[k] * input[layer.columns[k]];
+            }
+            layer.activations[o] = sigmoid(sum);
+        }
+        input = layer.activations;
+    }
+    return input;
+}
+
+bool SparseMLP::predict(const float* features, float* outputs) {
+    if (!layerCount || !features || !outputs) {
+        return false;
+    }
+    const float* result = forward(features);
+    memcpy(outputs, result, outputSize() * sizeof(float));
+    return true;
+}
+
+bool SparseMLP::train(const float* features, const float* target, float learningRate) {
+    if (!layerCount || !features || !target) {
+        return false;
+    }
+    const float* output = forward(features);
+
+    float* error = errors;
+    float* nextError = errors + widest;
+    for (unsigned int o = 0; o < outputSize(); o++) {
+        error[o] = output[o] - target[o];
+    }
+
+    for (unsigned int l = layerCount; l-- > 0;) {
+        Layer& layer = layers[l];
+        const float* input = l == 0 ? features : layers[l - 1].activations;
+        memset(nextError, 0, layer.inputs * sizeof(float));
+
+        for (unsigned int o = 0; o < layer.outputs; o++) {
+            const float y = layer.activations[o];
+            const float delta = error[o] * y * (1.0f - y);
+            layer.biases[o] -= learningRate * delta;
+            for (uint16_t k = layer.rowStart[o]; k < layer.rowStart[o + 1]; k++) {
+                const uint8_t column = layer.columns[k];
+                nextError[column] += layer.values[k] * delta;
+                layer.values[k] -= learningRate * delta * input[column];
+            }
+        }
+
+        float* swap = error;
+        error = nextError;
+        nextError = swap;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef SPARSE_MLP_H
+#define SPARSE_MLP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Float sigmoid MLP over compressed sparse rows, shared by the firmware and the host
+// simulation. A pruning mask (the ModelFormat mask: one bit per weight, LSB first, in the
+// order of every layer's [output][input] matrix) selects the weights that are stored;
+// forward and backward passes visit only those.
+//
+// Per layer, each output neuron has a run of kept weights with their input index:
+//   rowStart  outputs + 1 offsets into columns/values
+//   columns   uint8 input index per kept weight (so layers have at most 256 inputs)
+//   values    float per kept weight
+// A kept weight costs 5 bytes instead of the 4 of a dense matrix, so the engine needs less
+// memory than the dense network once more than a fifth of the weights are pruned.
+//
+// Parameters are exchanged as floats in the simulator layout (per layer the weights
+// [output][input], then the biases) like FixedPointMLP; pruned weights read as zero and
+// are ignored when set. Training is plain SGD on the squared error, the gradient of the
+// float network, so pruned weights stay pruned.
+class SparseMLP {
+public:
+    static constexpr unsigned int MAX_LAYERS = 8;     // Layer sizes, including the input
+    static constexpr unsigned int MAX_INPUTS = 256;   // Per layer, so columns fit in uint8
+
+    SparseMLP();
+    ~SparseMLP();
+    SparseMLP(const SparseMLP&) = delete;
+    SparseMLP& operator=(const SparseMLP&) = delete;
+
+    // Every weight kept, all parameters zero until they are set
+    bool init(const unsigned int* topology, unsigned int numLayers);
+    bool isInitialized() const { return layerCount > 0; }
+
+    // Keep only the weights whose mask bit is set; nullptr keeps all of them. Kept weights
+    // keep their values, newly kept ones start at zero.
+    bool setMask(const uint8_t* mask, size_t weightCount);
+
+    size_t parameterCount() const;
+    size_t weightCount() const;
+    size_t keptWeights() const;
+    bool setParameters(const float* params, size_t count);
+    bool getParameters(float* params, size_t count) const;
+
+    // Sigmoid outputs of the last layer
+    bool predict(const float* features, float* outputs);
+    // One SGD step on the squared error
+    bool train(const float* features, const float* target, float learningRate);
+
+    unsigned int inputSize() const { return layerCount ? layers[0].inputs : 0; }
+    unsigned int outputSize() const { return layerCount ? layers[layerCount - 1].outputs : 0; }
+    // Heap used for parameters, indices and activation buffers
+    size_t memoryBytes() const;
+
+private:
+    struct Layer {
+        unsigned int inputs;
+        unsigned int outputs;
+        uint16_t* rowStart;
+        uint8_t* columns;
+        float* values;
+        float* biases;
+        float* activations;    // Outputs of the last forward pass
+    };
+
+    const float* forward(const float* features);
+    void release();
+
+    Layer layers[MAX_LAYERS - 1];
+    unsigned int layerCount;
+    float* errors;             // Backpropagated error, two buffers of the widest layer
+    unsigned int widest;
+};
+
+#endif
@@ -0,0 +1,377 @@
+#include "TransferProtocol.h"
+#include "ModelFormat.h"
+#include <string.h>
+
+namespace {
+    constexpr uint16_t BEGIN_PENDING = 0xFFFF;
+    constexpr uint16_t MAX_FRAMES = 0xFFFE;
+
+    void writeU16(uint8_t* out, uint16_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void writeU32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint16_t readU16(const uint8_t* in) {
+        return static_cast<uint16_t>(in[0] | (in[1] << 8));
+    }
+
+    uint32_t readU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    bool validFrame(uint32_t totalBytes, uint16_t frameBytes, uint8_t window) {
+        return totalBytes > 0 && frameBytes >= TransferProtocol::MIN_FRAME_BYTES &&
+               window > 0 && window <= TransferProtocol::MAX_WINDOW &&
+               TransferProtocol::frameCount(totalBytes, frameBytes) <= MAX_FRAMES;
+    }
+}
+
+size_t TransferProtocol::encodeReady(uint16_t frameBytes, uint8_t window, uint8_t* out, size_t capacity) {
+    if (capacity < READY_BYTES) {
+        return 0;
+    }
+    out[0] = TYPE_READY;
+    out[1] = 0;
+    writeU16(out + 2, frameBytes);
+    out[4] = window;
+    return READY_BYTES;
+}
+
+bool TransferProtocol::parseReady(const uint8_t* frame, size_t length, uint16_t& frameBytes, uint8_t& window) {
+    if (length < READY_BYTES || frame[0] != TYPE_READY) {
+        return false;
+    }
+    frameBytes = readU16(frame + 2);
+    window = frame[4];
+    return frameBytes >= MIN_FRAME_BYTES && window > 0;
+}
+
+bool TransferSender::begin(const uint8_t* data, uint32_t length, uint8_t transferId, uint16_t frameBytes,
+                           uint8_t window, uint32_t timeoutMs) {
+    if (!validFrame(length, frameBytes, window) || timeoutMs == 0) {
+        currentState = State::FAILED;
+        return false;
+    }
+
+    payload = data;
+    totalBytes = length;
+    totalCrc = ModelFormat::crc32(data, length);
+    frameSize = frameBytes;
+    frameTotal = static_cast<uint16_t>(TransferProtocol::frameCount(length, frameBytes));
+    id = transferId;
+    windowFrames = window;
+    timeout = timeoutMs;
+    currentState = State::STARTING;
+
+    base = 0;
+    nextSeq = 0;
+    highestSent = 0;
+    rewoundAt = BEGIN_PENDING;
+    resumeSeq = 0;
+    beginSent = false;
+    pendingSeq = BEGIN_PENDING;
+    lastSendMs = 0;
+    progressMs = 0;
+    activityMs = 0;
+    activityStarted = false;
+    retries = 0;
+    sentCount = 0;
+    resentCount = 0;
+    return true;
+}
+
+size_t TransferSender::writeBegin(uint8_t* out, size_t capacity) const {
+    if (capacity < TransferProtocol::BEGIN_BYTES) {
+        return 0;
+    }
+    out[0] = TransferProtocol::TYPE_BEGIN;
+    out[1] = id;
+    writeU32(out + 2, totalBytes);
+    writeU32(out + 6, totalCrc);
+    writeU16(out + 10, frameSize);
+    out[12] = windowFrames;
+    return TransferProtocol::BEGIN_BYTES;
+}
+
+size_t TransferSender::writeData(uint16_t seq, uint8_t* out, size_t capacity) const {
+    const size_t perFrame = frameSize - TransferProtocol::DATA_OVERHEAD;
+    const size_t offset = static_cast<size_t>(seq) * perFrame;
+    const size_t count = totalBytes - offset < perFrame ? totalBytes - offset : perFrame;
+    const size_t length = count + TransferProtocol::DATA_OVERHEAD;
+    if (capacity < length) {
+        return 0;
+    }
+
+    out[0] = TransferProtocol::TYPE_DATA;
+    out[1] = id;
+    writeU16(out + 2, seq);
+    memcpy(out + TransferProtocol::DATA_HEADER_BYTES, payload + offset, count);
+    writeU32(out + length - 4, ModelFormat::crc32(out, length - 4));
+    return length;
+}
+
+size_t TransferSender::nextFrame(uint8_t* out, size_t capacity, uint32_t nowMs) {
+    if (currentState != State::STARTING && currentState != State::SENDING) {
+        return 0;
+    }
+    // A link that accepts no frame and a receiver that stays silent never make the
+    // retry counts below advance
+    if (!activityStarted) {
+        activityMs = nowMs;
+        activityStarted = true;
+    } else if (nowMs - activityMs >= timeout * (MAX_RETRIES + 1u)) {
+        currentState = State::FAILED;
+        return 0;
+    }
+
+    if (currentState == State::STARTING) {
+        // BEGIN is repeated until the receiver answers
+        if (beginSent && nowMs - lastSendMs < timeout) {
+            return 0;
+        }
+        pendingSeq = BEGIN_PENDING;
+        return writeBegin(out, capacity);
+    }
+    if (currentState != State::SENDING) {
+        return 0;
+    }
+
+    // Nothing acknowledged for a timeout: go back to the first unacknowledged frame
+    if (nextSeq > base && nowMs - progressMs >= timeout) {
+        if (++retries > MAX_RETRIES) {
+            currentState = State::FAILED;
+            return 0;
+        }
+        nextSeq = base;
+        progressMs = nowMs;
+    }
+
+    if (nextSeq >= frameTotal || nextSeq - base >= windowFrames) {
+        return 0;
+    }
+    pendingSeq = nextSeq;
+    return writeData(nextSeq, out, capacity);
+}
+
+void TransferSender::frameSent(uint32_t nowMs) {
+    sentCount++;
+    lastSendMs = nowMs;
+    activityMs = nowMs;
+
+    if (pendingSeq == BEGIN_PENDING) {
+        if (currentState != State::STARTING) {
+            return;
+        }
+        if (beginSent) {
+            resentCount++;
+            if (++retries > MAX_RETRIES) {
+                currentState = State::FAILED;
+            }
+        }
+        beginSent = true;
+        return;
+    }
+
+    if (pendingSeq < highestSent) {
+        resentCount++;
+    } else {
+        highestSent = pendingSeq + 1;
+    }
+    // The timeout runs from the oldest frame in flight
+    if (nextSeq == base) {
+        progressMs = nowMs;
+    }
+    nextSeq = pendingSeq + 1;
+}
+
+void TransferSender::onFrame(const uint8_t* frame, size_t length, uint32_t nowMs) {
+    if (length < TransferProtocol::ACK_BYTES || frame[0] != TransferProtocol::TYPE_ACK || frame[1] != id) {
+        return;
+    }
+    if (currentState != State::STARTING && currentState != State::SENDING) {
+        return;
+    }
+
+    activityMs = nowMs;
+    const uint16_t next = readU16(frame + 2);
+    const TransferProtocol::AckStatus status = static_cast<TransferProtocol::AckStatus>(frame[4]);
+    if (status == TransferProtocol::AckStatus::FAILED) {
+        currentState = State::FAILED;
+        return;
+    }
+    if (next > frameTotal) {
+        return;
+    }
+
+    if (currentState == State::STARTING) {
+        // The first ACK tells where to start: 0, or the first frame a partial transfer misses
+        currentState = State::SENDING;
+        base = next;
+        nextSeq = next;
+        highestSent = next;
+        resumeSeq = next;
+        progressMs = nowMs;
+        retries = 0;
+    } else if (next > base) {
+        base = next;
+        if (nextSeq < base) {
+            nextSeq = base;
+        }
+        progressMs = nowMs;
+        retries = 0;
+    } else if (next == base && nextSeq > base && rewoundAt != base) {
+        // The receiver saw a gap: resend from its first missing frame, once per gap
+        nextSeq = base;
+        rewoundAt = base;
+    }
+
+    if (base == frameTotal && status == TransferProtocol::AckStatus::COMPLETE) {
+        currentState = State::COMPLETE;
+    }
+}
+
+TransferReceiver::TransferReceiver(uint8_t* buffer, size_t capacity, uint16_t maxFrameBytes)
+    : buffer(buffer), capacity(capacity), maxFrameBytes(maxFrameBytes) {
+}
+
+void TransferReceiver::reset() {
+    currentState = State::IDLE;
+    totalBytes = 0;
+    totalCrc = 0;
+    frameSize = 0;
+    frameTotal = 0;
+    expected = 0;
+    lastAcked = 0;
+    gapAcked = false;
+    lastUnexpected = 0;
+    resumeSeq = 0;
+}
+
+uint32_t TransferReceiver::received() const {
+    if (currentState == State::COMPLETE) {
+        return totalBytes;
+    }
+    if (frameSize == 0) {
+        return 0;
+    }
+    uint32_t bytes = static_cast<uint32_t>(expected) * (frameSize - TransferProtocol::DATA_OVERHEAD);
+    return bytes < totalBytes ? bytes : totalBytes;
+}
+
+bool TransferReceiver::onFrame(const uint8_t* frame, size_t length) {
+    if (length == 0) {
+        return false;
+    }
+    if (frame[0] == TransferProtocol::TYPE_BEGIN && length >= TransferProtocol::BEGIN_BYTES) {
+        onBegin(frame);
+        return true;
+    }
+    if (frame[0] == TransferProtocol::TYPE_DATA) {
+        return onData(frame, length);
+    }
+    return false;
+}
+
+void TransferReceiver::onBegin(const uint8_t* frame) {
+    const uint32_t total = readU32(frame + 2);
+    const uint32_t crc = readU32(frame + 6);
+    const uint16_t frameBytes = readU16(frame + 10);
+    const uint8_t window = frame[12];
+    id = frame[1];
+
+    if (!validFrame(total, frameBytes, window) || frameBytes > maxFrameBytes || total > capacity) {
+        reset();
+        currentState = State::FAILED;
+        return;
+    }
+
+    // Same payload as the partial (or finished) transfer in the buffer: keep what arrived
+    const bool resume = (currentState == State::RECEIVING || currentState == State::COMPLETE) &&
+                        total == totalBytes && crc == totalCrc && frameBytes == frameSize;
+    if (resume) {
+        resumeSeq = expected;
+    } else {
+        currentState = State::RECEIVING;
+        totalBytes = total;
+        totalCrc = crc;
+        frameSize = frameBytes;
+        frameTotal = static_cast<uint16_t>(TransferProtocol::frameCount(total, frameBytes));
+        expected = 0;
+        resumeSeq = 0;
+    }
+    // Half a window between ACKs keeps the sender's window open
+    ackEvery = window / 2 > 0 ? window / 2 : 1;
+    lastAcked = expected;
+    gapAcked = false;
+}
+
+bool TransferReceiver::onData(const uint8_t* frame, size_t length) {
+    if (length <= TransferProtocol::DATA_OVERHEAD || frame[1] != id || currentState == State::IDLE) {
+        return false;
+    }
+    if (ModelFormat::crc32(frame, length - 4) != readU32(frame + length - 4)) {
+        corruptCount++;
+        return false;
+    }
+    // Repeated frames after the end: the sender missed the final ACK
+    if (currentState != State::RECEIVING) {
+        return true;
+    }
+
+    const uint16_t seq = readU16(frame + 2);
+    if (seq != expected) {
+        // A gap or a duplicate: tell the sender where to continue, once per pass of the
+        // sender (a lower sequence number than the last unexpected one means it went back)
+        const bool repeat = gapAcked && seq > lastUnexpected;
+        gapAcked = true;
+        lastUnexpected = seq;
+        return !repeat;
+    }
+
+    const size_t perFrame = frameSize - TransferProtocol::DATA_OVERHEAD;
+    const size_t offset = static_cast<size_t>(seq) * perFrame;
+    const size_t count = length - TransferProtocol::DATA_OVERHEAD;
+    const size_t remaining = totalBytes - offset;
+    if (count != (remaining < perFrame ? remaining : perFrame)) {
+        corruptCount++;
+        return false;
+    }
+    memcpy(buffer + offset, frame + TransferProtocol::DATA_HEADER_BYTES, count);
+    expected++;
+    gapAcked = false;
+
+    if (expected == frameTotal) {
+        currentState = ModelFormat::crc32(buffer, totalBytes) == totalCrc ? State::COMPLETE : State::FAILED;
+        return true;
+    }
+    return expected - lastAcked >= ackEvery;
+}
+
+size_t TransferReceiver::ack(uint8_t* out, size_t capacity) {
+    if (capacity < TransferProtocol::ACK_BYTES || currentState == State::IDLE) {
+        return 0;
+    }
+    TransferProtocol::AckStatus status = TransferProtocol::AckStatus::RECEIVING;
+    if (currentState == State::COMPLETE) {
+        status = TransferProtocol::AckStatus::COMPLETE;
+    } else if (currentState == State::FAILED) {
+        status = TransferProtocol::AckStatus::FAILED;
+    }
+
+    out[0] = TransferProtocol::TYPE_ACK;
+    out[1] = id;
+    writeU16(out + 2, expected);
+    out[4] = static_cast<uint8_t>(status);
+    lastAcked = expected;
+    return TransferProtocol::ACK_BYTES;
+}
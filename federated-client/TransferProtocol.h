@@ -0,0 +1,173 @@
+#ifndef TRANSFER_PROTOCOL_H
+#define TRANSFER_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pipelined, resumable transfer of a byte payload over unacknowledged BLE writes and
+// notifications, shared by the firmware and the host simulation. Neither side waits for
+// the other between frames: the sender keeps up to a window of MTU-sized frames in
+// flight and the receiver acknowledges cumulatively, so throughput is bounded by the
+// link rather than by fixed per-chunk delays.
+//
+// Frames (little-endian):
+//   BEGIN  sender -> receiver
+//     [0] TYPE_BEGIN  [1] transfer id  [2..5] total bytes  [6..9] CRC32 of the payload
+//     [10..11] frame size  [12] window
+//   DATA   sender -> receiver
+//     [0] TYPE_DATA  [1] transfer id  [2..3] sequence number  payload
+//     CRC32 of all preceding frame bytes in the last 4 bytes
+//   ACK    receiver -> sender
+//     [0] TYPE_ACK  [1] transfer id  [2..3] next expected sequence number  [4] AckStatus
+//   READY  receiver -> sender, when the receiver starts the exchange (uploads)
+//     [0] TYPE_READY  [1] reserved  [2..3] largest frame size  [4] window
+//
+// Each DATA frame carries frameBytes - DATA_OVERHEAD payload bytes, the last one the rest.
+// Frames are accepted in order only (go-back-N): a gap or a duplicate is answered with an
+// immediate ACK, and the sender goes back to the first unacknowledged frame on a repeated
+// ACK or when nothing was acknowledged for a timeout. The receiver keeps a partial
+// payload; a BEGIN for the same total size, CRC and frame size resumes it from the first
+// missing frame, e.g. after a reconnect.
+namespace TransferProtocol {
+    constexpr uint8_t TYPE_BEGIN = 1;
+    constexpr uint8_t TYPE_DATA = 2;
+    constexpr uint8_t TYPE_ACK = 3;
+    constexpr uint8_t TYPE_READY = 4;
+
+    constexpr size_t BEGIN_BYTES = 13;
+    constexpr size_t ACK_BYTES = 5;
+    constexpr size_t READY_BYTES = 5;
+    constexpr size_t DATA_HEADER_BYTES = 4;
+    constexpr size_t DATA_OVERHEAD = DATA_HEADER_BYTES + 4;
+    constexpr size_t MIN_FRAME_BYTES = 20;   // Payload of the default 23-byte ATT MTU
+    constexpr uint8_t MAX_WINDOW = 32;
+
+    enum class AckStatus : uint8_t {
+        RECEIVING = 0,
+        COMPLETE = 1,   // Every frame arrived and the payload CRC matches
+        FAILED = 2      // Payload CRC mismatch, or a transfer the receiver cannot hold
+    };
+
+    constexpr size_t frameCount(uint32_t totalBytes, uint16_t frameBytes) {
+        return totalBytes == 0 ? 0 : (totalBytes + frameBytes - DATA_OVERHEAD - 1) / (frameBytes - DATA_OVERHEAD);
+    }
+
+    size_t encodeReady(uint16_t frameBytes, uint8_t window, uint8_t* out, size_t capacity);
+    bool parseReady(const uint8_t* frame, size_t length, uint16_t& frameBytes, uint8_t& window);
+}
+
+class TransferSender {
+public:
+    enum class State : uint8_t {
+        IDLE = 0,
+        STARTING,    // BEGIN sent, waiting for the receiver's first ACK
+        SENDING,
+        COMPLETE,
+        FAILED
+    };
+
+    // Consecutive timeouts without progress before the transfer fails. The same number of
+    // timeouts (plus one) without a frame the link accepted or an ACK also fails it, e.g.
+    // when every write is rejected.
+    static constexpr uint8_t MAX_RETRIES = 10;
+
+    // data must stay valid until the transfer has finished
+    bool begin(const uint8_t* data, uint32_t length, uint8_t transferId, uint16_t frameBytes,
+               uint8_t window, uint32_t timeoutMs);
+
+    // Writes the frame due at nowMs and returns its length, or 0 while the window is full.
+    // The frame counts as sent only after frameSent(), so it can be offered again when
+    // the link has no buffer for it.
+    size_t nextFrame(uint8_t* out, size_t capacity, uint32_t nowMs);
+    void frameSent(uint32_t nowMs);
+
+    // ACK from the receiver
+    void onFrame(const uint8_t* frame, size_t length, uint32_t nowMs);
+
+    State state() const { return currentState; }
+    bool finished() const { return currentState == State::COMPLETE || currentState == State::FAILED; }
+    uint16_t frames() const { return frameTotal; }
+    uint16_t resumedAt() const { return resumeSeq; }
+    uint32_t framesSent() const { return sentCount; }
+    uint32_t retransmissions() const { return resentCount; }
+
+private:
+    size_t writeBegin(uint8_t* out, size_t capacity) const;
+    size_t writeData(uint16_t seq, uint8_t* out, size_t capacity) const;
+
+    const uint8_t* payload = nullptr;
+    uint32_t totalBytes = 0;
+    uint32_t totalCrc = 0;
+    uint16_t frameSize = 0;
+    uint16_t frameTotal = 0;
+    uint8_t id = 0;
+    uint8_t windowFrames = 1;
+    uint32_t timeout = 0;
+    State currentState = State::IDLE;
+
+    uint16_t base = 0;          // First unacknowledged frame
+    uint16_t nextSeq = 0;       // Next frame to send
+    uint16_t highestSent = 0;   // One past the highest frame ever sent
+    uint16_t rewoundAt = 0xFFFF;
+    uint16_t resumeSeq = 0;
+    bool beginSent = false;
+    uint16_t pendingSeq = 0;    // Frame written by nextFrame(), 0xFFFF for BEGIN
+    uint32_t lastSendMs = 0;
+    uint32_t progressMs = 0;
+    uint32_t activityMs = 0;    // Last frame the link accepted or ACK, from the first nextFrame()
+    bool activityStarted = false;
+    uint8_t retries = 0;
+    uint32_t sentCount = 0;
+    uint32_t resentCount = 0;
+};
+
+class TransferReceiver {
+public:
+    enum class State : uint8_t {
+        IDLE = 0,
+        RECEIVING,
+        COMPLETE,
+        FAILED
+    };
+
+    // The payload is assembled in the caller's buffer
+    TransferReceiver(uint8_t* buffer, size_t capacity, uint16_t maxFrameBytes);
+
+    // Forget the current and any partial transfer
+    void reset();
+
+    // Returns true when an ACK is due; write it with ack()
+    bool onFrame(const uint8_t* frame, size_t length);
+    size_t ack(uint8_t* out, size_t capacity);
+
+    State state() const { return currentState; }
+    const uint8_t* data() const { return buffer; }
+    uint32_t length() const { return totalBytes; }
+    uint32_t received() const;
+    uint16_t resumedAt() const { return resumeSeq; }
+    uint32_t corruptFrames() const { return corruptCount; }
+
+private:
+    void onBegin(const uint8_t* frame);
+    bool onData(const uint8_t* frame, size_t length);
+
+    uint8_t* buffer;
+    size_t capacity;
+    uint16_t maxFrameBytes;
+
+    State currentState = State::IDLE;
+    uint8_t id = 0;
+    uint32_t totalBytes = 0;
+    uint32_t totalCrc = 0;
+    uint16_t frameSize = 0;
+    uint16_t frameTotal = 0;
+    uint16_t ackEvery = 1;
+    uint16_t expected = 0;       // Next frame accepted
+    uint16_t lastAcked = 0;
+    bool gapAcked = false;       // An out-of-order frame was answered for this expected frame
+    uint16_t lastUnexpected = 0;
+    uint16_t resumeSeq = 0;
+    uint32_t corruptCount = 0;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "WeightCodec.h"
+#include <string.h>
+#include <math.h>
+
+namespace {
+    void writeU32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint32_t readU32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t floatBits(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsToFloat(uint32_t bits) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+uint32_t WeightCodec::nextRandom(uint32_t* state) {
+    // xorshift32: cheap enough for the microcontroller
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+uint16_t WeightCodec::floatToHalf(float value) {
+    return floatToHalfRounded(value, Rounding::NEAREST, 0);
+}
+
+uint16_t WeightCodec::floatToHalfRounded(float value, Rounding rounding, uint32_t randomBits) {
+    uint32_t bits = floatBits(value);
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // NaN and infinity
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31) {
+        return sign | 0x7C00;
+    }
+    if (exponent < -10) {
+        return sign;
+    }
+
+    uint32_t shift;
+    uint16_t half;
+    if (exponent <= 0) {
+        // Subnormal half: make the implicit leading one explicit
+        mantissa |= 0x800000;
+        shift = static_cast<uint32_t>(14 - exponent);
+        half = sign | static_cast<uint16_t>(mantissa >> shift);
+    } else {
+        shift = 13;
+        half = sign | static_cast<uint16_t>(exponent << 10) | static_cast<uint16_t>(mantissa >> shift);
+    }
+
+    // Round on the discarded bits; a carry into the exponent is the correct result
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    if (rounding == Rounding::STOCHASTIC) {
+        if ((randomBits & ((1u << shift) - 1)) < remainder) {
+            half++;
+        }
+    } else {
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+    }
+    return half;
+}
+
+float WeightCodec::halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            return bitsToFloat(sign);
+        }
+        // Subnormal: value = mantissa * 2^-24
+        float value = ldexpf(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    if (exponent == 31) {
+        return bitsToFloat(sign | 0x7F800000 | (mantissa << 13));
+    }
+    return bitsToFloat(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+}
+
+size_t WeightCodec::encode(const float* values, size_t count, Format format, Rounding rounding,
+                           uint8_t* out, size_t capacity,
+                           float* residual, uint32_t* rngState) {
+    size_t size = encodedSize(format, count);
+    if (!values || !out || capacity < size) {
+        return 0;
+    }
+    if (rounding == Rounding::STOCHASTIC && (!rngState || *rngState == 0)) {
+        return 0;
+    }
+
+    out[0] = static_cast<uint8_t>(format);
+    out[1] = rounding == Rounding::STOCHASTIC ? 1 : 0;
+    out[2] = 0;
+    out[3] = 0;
+    writeU32(out + 4, static_cast<uint32_t>(count));
+    uint8_t* payload = out + HEADER_BYTES;
+
+    switch (format) {
+        case Format::FLOAT32: {
+            // Lossless: nothing to feed back
+            for (size_t i = 0; i < count; i++) {
+                writeU32(payload + 4 * i, floatBits(values[i]));
+            }
+            if (residual) {
+                memset(residual, 0, count * sizeof(float));
+            }
+            break;
+        }
+        case Format::FLOAT16: {
+            for (size_t i = 0; i < count; i++) {
+                float value = values[i] + (residual ? residual[i] : 0.0f);
+                uint32_t random = rounding == Rounding::STOCHASTIC ? nextRandom(rngState) : 0;
+                uint16_t half = floatToHalfRounded(value, rounding, random);
+                payload[2 * i] = static_cast<uint8_t>(half);
+                payload[2 * i + 1] = static_cast<uint8_t>(half >> 8);
+                if (residual) {
+                    residual[i] = value - halfToFloat(half);
+                }
+            }
+            break;
+        }
+        case Format::INT8: {
+            // Per-tensor affine quantization; the range always contains zero so that
+            // zero is represented exactly
+            float minValue = 0.0f;
+            float maxValue = 0.0f;
+            for (size_t i = 0; i < count; i++) {
+                float value = values[i] + (residual ? residual[i] : 0.0f);
+                if (value < minValue) minValue = value;
+                if (value > maxValue) maxValue = value;
+            }
+
+            float scale = (maxValue - minValue) / 255.0f;
+            if (scale <= 0.0f) {
+                scale = 1.0f;
+            }
+            int32_t zeroPoint = -128 - static_cast<int32_t>(lroundf(minValue / scale));
+            if (zeroPoint < -128) zeroPoint = -128;
+            if (zeroPoint > 127) zeroPoint = 127;
+
+            uint8_t* params = out + HEADER_BYTES;
+            writeU32(params, floatBits(scale));
+            params[4] = static_cast<uint8_t>(static_cast<int8_t>(zeroPoint));
+            params[5] = 0;
+            params[6] = 0;
+            params[7] = 0;
+            payload = params + INT8_PARAM_BYTES;
+
+            for (size_t i = 0; i < count; i++) {
+                float value = values[i] + (residual ? residual[i] : 0.0f);
+                float scaled = value / scale;
+                int32_t q;
+                if (rounding == Rounding::STOCHASTIC) {
+                    float u = (nextRandom(rngState) >> 8) * (1.0f / 16777216.0f);
+                    q = static_cast<int32_t>(floorf(scaled + u));
+                } else {
+                    q = static_cast<int32_t>(lroundf(scaled));
+                }
+                q += zeroPoint;
+                if (q < -128) q = -128;
+                if (q > 127) q = 127;
+
+                payload[i] = static_cast<uint8_t>(static_cast<int8_t>(q));
+                if (residual) {
+                    residual[i] = value - scale * static_cast<float>(q - zeroPoint);
+                }
+            }
+            break;
+        }
+        default:
+            return 0;
+    }
+
+    return size;
+}
+
+bool WeightCodec::peekHeader(const uint8_t* in, size_t length, Format& format, size_t& count) {
+    if (!in || length < HEADER_BYTES || in[0] > static_cast<uint8_t>(Format::INT8)) {
+        return false;
+    }
+    format = static_cast<Format>(in[0]);
+    count = readU32(in + 4);
+    return true;
+}
+
+size_t WeightCodec::decode(const uint8_t* in, size_t length, float* out, size_t capacity) {
+    Format format;
+    size_t count;
+    if (!peekHeader(in, length, format, count) || !out || count > capacity ||
+        length < encodedSize(format, count)) {
+        return 0;
+    }
+
+    const uint8_t* payload = in + HEADER_BYTES;
+    switch (format) {
+        case Format::FLOAT32:
+            for (size_t i = 0; i < count; i++) {
+                out[i] = bitsToFloat(readU32(payload + 4 * i));
+            }
+            break;
+        case Format::FLOAT16:
+            for (size_t i = 0; i < count; i++) {
+                uint16_t half = static_cast<uint16_t>(payload[2 * i] | (payload[2 * i + 1] << 8));
+                out[i] = halfToFloat(half);
+            }
+            break;
+        case Format::INT8: {
+            float scale = bitsToFloat(readU32(payload));
+            int32_t zeroPoint = static_cast<int8_t>(payload[4]);
+            payload += INT8_PARAM_BYTES;
+            for (size_t i = 0; i < count; i++) {
+                out[i] = scale * static_cast<float>(static_cast<int8_t>(payload[i]) - zeroPoint);
+            }
+            break;
+        }
+    }
+    return count;
+}
+
+const char* WeightCodec::formatName(Format format) {
+    switch (format) {
+        case Format::FLOAT32: return "fp32";
+        case Format::FLOAT16: return "fp16";
+        case Format::INT8: return "int8";
+    }
+    return "unknown";
+}
+
+bool WeightCodec::parseFormat(const char* name, Format& format) {
+    if (strcmp(name, "fp32") == 0) format = Format::FLOAT32;
+    else if (strcmp(name, "fp16") == 0) format = Format::FLOAT16;
+    else if (strcmp(name, "int8") == 0) format = Format::INT8;
+    else return false;
+    return true;
+}
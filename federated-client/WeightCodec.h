@@ -0,0 +1,62 @@
+#ifndef WEIGHT_CODEC_H
+#define WEIGHT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Portable weight payload codec shared by the firmware and the host simulation.
+//
+// Payload layout (little-endian):
+//   [0]     format
+//   [1]     flags (bit 0: stochastic rounding was used)
+//   [2..3]  reserved
+//   [4..7]  value count
+//   INT8 only: [8..11] scale, [12] zero point, [13..15] reserved
+//   values: float32, float16 or int8
+class WeightCodec {
+public:
+    enum class Format : uint8_t {
+        FLOAT32 = 0,
+        FLOAT16 = 1,
+        INT8 = 2
+    };
+
+    enum class Rounding : uint8_t {
+        NEAREST = 0,
+        STOCHASTIC = 1
+    };
+
+    static constexpr size_t HEADER_BYTES = 8;
+    static constexpr size_t INT8_PARAM_BYTES = 8;
+
+    static constexpr size_t encodedSize(Format format, size_t count) {
+        return HEADER_BYTES + (format == Format::INT8 ? INT8_PARAM_BYTES + count
+                             : format == Format::FLOAT16 ? 2 * count
+                             : 4 * count);
+    }
+
+    // Encode count values into out. If residual is given, it is added to the values before
+    // quantization and replaced by the new quantization error (error feedback).
+    // rngState drives stochastic rounding and must be non-zero. Returns bytes written, 0 on error.
+    static size_t encode(const float* values, size_t count, Format format, Rounding rounding,
+                         uint8_t* out, size_t capacity,
+                         float* residual = nullptr, uint32_t* rngState = nullptr);
+
+    // Decode a payload into out. Returns the number of values, 0 on error.
+    static size_t decode(const uint8_t* in, size_t length, float* out, size_t capacity);
+
+    // Read format and value count once the header has arrived
+    static bool peekHeader(const uint8_t* in, size_t length, Format& format, size_t& count);
+
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t half);
+
+    static const char* formatName(Format format);
+    static bool parseFormat(const char* name, Format& format);
+
+private:
+    static uint16_t floatToHalfRounded(float value, Rounding rounding, uint32_t randomBits);
+    static uint32_t nextRandom(uint32_t* state);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "WindowAcquisition.h"
+#include <string.h>
+
+WindowAcquisition::WindowAcquisition(float* first, float* second, uint16_t windowSamples)
+    : buffers{first, second}, windowSamples(windowSamples) {
+}
+
+bool WindowAcquisition::start(uint32_t nowMicros, uint32_t periodMicros, uint16_t overlapSamples) {
+    if (periodMicros == 0 || windowSamples == 0 || overlapSamples >= windowSamples) {
+        active = false;
+        return false;
+    }
+    period = periodMicros;
+    overlap = overlapSamples;
+    active = true;
+
+    // The first sample is due right away
+    nextDue = nowMicros;
+    fill = held == 0 ? 1 : 0;
+    waiting = -1;
+    position = 0;
+    windowStart[fill] = 0;
+    samples = 0;
+    completed = 0;
+    dropped = 0;
+    late = 0;
+    gapCount = 0;
+    return true;
+}
+
+void WindowAcquisition::stop() {
+    active = false;
+    waiting = -1;
+}
+
+void WindowAcquisition::restart() {
+    position = 0;
+    windowStart[fill] = samples;
+}
+
+uint16_t WindowAcquisition::due(uint32_t nowMicros) {
+    // Signed difference, so the schedule survives the wrap of micros()
+    if (!active || static_cast<int32_t>(nowMicros - nextDue) < 0) {
+        return 0;
+    }
+    const uint32_t owed = (nowMicros - nextDue) / period + 1;
+    nextDue += owed * period;
+
+    if (owed - 1 > MAX_LATE_SAMPLES) {
+        // Too long without a sample: the window restarts after the gap
+        gapCount++;
+        samples += owed - 1;
+        position = 0;
+        windowStart[fill] = samples;
+        return 1;
+    }
+    late += owed - 1;
+    return static_cast<uint16_t>(owed);
+}
+
+bool WindowAcquisition::push(float value) {
+    if (!active) {
+        return false;
+    }
+    buffers[fill][position++] = value;
+    samples++;
+    if (position < windowSamples) {
+        return false;
+    }
+
+    completed++;
+    const uint16_t hop = windowSamples - overlap;
+    const uint8_t other = fill ^ 1;
+    if (held == other) {
+        // The consumer still works on the other buffer: drop the oldest hop and keep filling
+        dropped++;
+        memmove(buffers[fill], buffers[fill] + hop, overlap * sizeof(float));
+        windowStart[fill] += hop;
+        position = overlap;
+        return false;
+    }
+
+    if (waiting == other) {
+        dropped++;
+    }
+    waiting = fill;
+    // The next window starts with the last overlap samples of this one
+    memcpy(buffers[other], buffers[fill] + hop, overlap * sizeof(float));
+    windowStart[other] = windowStart[fill] + hop;
+    fill = other;
+    position = overlap;
+    return true;
+}
+
+bool WindowAcquisition::ready(uint32_t firstSample) const {
+    return waiting >= 0 && windowStart[waiting] >= firstSample;
+}
+
+float* WindowAcquisition::acquire() {
+    if (waiting < 0) {
+        return nullptr;
+    }
+    held = waiting;
+    waiting = -1;
+    return buffers[held];
+}
+
+void WindowAcquisition::release() {
+    held = -1;
+}
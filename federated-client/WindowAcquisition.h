@@ -0,0 +1,75 @@
+#ifndef WINDOW_ACQUISITION_H
+#define WINDOW_ACQUISITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample windows assembled on a fixed schedule into two buffers, so a complete window
+// can be processed in place (e.g. by the FFT) while the next one fills the other buffer.
+// Consecutive windows share overlapSamples samples: once the first window is full, one
+// completes every windowSamples - overlapSamples samples.
+//
+// The caller passes the time, so the same schedule runs on micros() on the device and
+// on a synthetic clock on the host. Each poll asks due() how many samples the schedule
+// owes and pushes that many. A late poll is filled with the current reading for up to
+// MAX_LATE_SAMPLES periods; a longer gap restarts the window, as a spectrum over a hole
+// in the signal is meaningless.
+//
+// Only the newest window is kept: a completed window replaces one nobody acquired yet.
+// While the consumer still holds the other buffer, a completed window is dropped and the
+// buffer being filled slides on by one hop, so sampling never stalls.
+class WindowAcquisition {
+public:
+    static constexpr uint16_t MAX_LATE_SAMPLES = 2;
+
+    // Both buffers hold windowSamples values
+    WindowAcquisition(float* first, float* second, uint16_t windowSamples);
+
+    bool start(uint32_t nowMicros, uint32_t periodMicros, uint16_t overlapSamples);
+    void stop();
+    bool running() const { return active; }
+    // Drop the partial window, so the next one starts with the next sample (e.g. a window
+    // that may only hold samples taken after an event)
+    void restart();
+
+    // Samples owed by the schedule at nowMicros; push() each of them
+    uint16_t due(uint32_t nowMicros);
+    // Returns true when the sample completed a window
+    bool push(float value);
+
+    // A complete window starting at or after sample firstSample is waiting
+    bool ready(uint32_t firstSample) const;
+    // Takes the waiting window until release(); nullptr when there is none
+    float* acquire();
+    void release();
+
+    // Schedule slots since start(), including those skipped by gaps
+    uint32_t sampleCount() const { return samples; }
+    uint32_t acquiredFirstSample() const { return held >= 0 ? windowStart[held] : 0; }
+    uint32_t windowCount() const { return completed; }
+    uint32_t droppedWindows() const { return dropped; }
+    uint32_t lateSamples() const { return late; }
+    uint32_t gaps() const { return gapCount; }
+
+private:
+    float* buffers[2];
+    uint16_t windowSamples;
+    uint16_t overlap = 0;
+    uint32_t period = 0;
+    bool active = false;
+
+    uint32_t nextDue = 0;
+    uint8_t fill = 0;           // Buffer being filled
+    int8_t waiting = -1;        // Complete buffer not acquired yet
+    int8_t held = -1;           // Buffer acquired by the consumer
+    uint16_t position = 0;
+    uint32_t windowStart[2] = {0, 0};
+
+    uint32_t samples = 0;
+    uint32_t completed = 0;
+    uint32_t dropped = 0;
+    uint32_t late = 0;
+    uint32_t gapCount = 0;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino core used by the firmware.
+// Time is virtual: it runs --speedup times faster than the host clock (see HostRuntime.h).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_float(address) (*(const float*)(address))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Deterministic per seed, like the Arduino core without randomSeed()
+void randomSeed(unsigned long seed);
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+class String {
+public:
+    String(const char* text = "") : text(text) {}
+    String(const std::string& text) : text(text) {}
+    const char* c_str() const { return text.c_str(); }
+    size_t length() const { return text.size(); }
+
+private:
+    std::string text;
+};
+
+// Serial output goes to stderr with the device name as prefix, or nowhere (--serial)
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+
+    size_t print(const char* text);
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(char value);
+    size_t print(int value) { return print(static_cast<long>(value)); }
+    size_t print(unsigned int value) { return print(static_cast<unsigned long>(value)); }
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(long long value) { return print(static_cast<long>(value)); }
+    size_t print(unsigned long long value) { return print(static_cast<unsigned long>(value)); }
+    // Two decimals, as on the Arduino core
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    size_t println(double value, int digits) { return print(value, digits) + println(); }
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef HOST_ARDUINO_BLE_H
+#define HOST_ARDUINO_BLE_H
+
+// Host stand-in for ArduinoBLE. The GATT server is reached over a TCP or Unix socket
+// (HostLink below) instead of the radio; one connected socket client is the central.
+// Characteristic semantics follow ArduinoBLE: a write replaces the single value and
+// sets the written flag, which written() clears, and events are only processed in
+// BLE.poll(), so a write request is acknowledged when the device next polls.
+
+#include "Arduino.h"
+#include <vector>
+
+enum BLEProperty {
+    BLEBroadcast = 0x01,
+    BLERead = 0x02,
+    BLEWriteWithoutResponse = 0x04,
+    BLEWrite = 0x08,
+    BLENotify = 0x10,
+    BLEIndicate = 0x20
+};
+
+enum BLEDeviceEvent {
+    BLEConnected = 0,
+    BLEDisconnected = 1
+};
+
+// Only BLEWritten is raised by the stand-in
+enum BLECharacteristicEvent {
+    BLESubscribed = 0,
+    BLEUnsubscribed = 1,
+    BLEWritten = 3
+};
+
+class BLEDevice {
+public:
+    explicit BLEDevice(const String& address = String()) : peer(address) {}
+    String address() const { return peer; }
+
+private:
+    String peer;
+};
+
+class BLECharacteristic;
+typedef void (*BLECharacteristicEventHandler)(BLEDevice central, BLECharacteristic characteristic);
+
+class BLECharacteristic {
+public:
+    BLECharacteristic(const char* uuid, uint8_t properties, int valueSize);
+
+    // The handler gets a copy of the characteristic holding the value just written, so
+    // every write is seen even when several arrive between two polls
+    void setEventHandler(BLECharacteristicEvent event, BLECharacteristicEventHandler handler);
+
+    const char* uuid() const { return characteristicUuid; }
+    uint8_t properties() const { return characteristicProperties; }
+
+    // True once after each write from the central
+    bool written();
+    bool subscribed() const { return isSubscribed; }
+
+    const uint8_t* value() const { return data.data(); }
+    int valueLength() const { return static_cast<int>(data.size()); }
+    int readValue(uint8_t* value, int length);
+    int readValue(void* value, int length) { return readValue(static_cast<uint8_t*>(value), length); }
+    template <typename T>
+    int readValue(T& value) { return readValue(&value, static_cast<int>(sizeof(T))); }
+
+    // Sets the value and notifies the central if it subscribed
+    bool writeValue(const uint8_t* value, int length);
+    bool writeValue(const void* value, int length) { return writeValue(static_cast<const uint8_t*>(value), length); }
+
+private:
+    friend class BLELocalDevice;
+
+    const char* characteristicUuid;
+    uint8_t characteristicProperties;
+    size_t maxSize;
+    int handle;                 // Position in the GATT table, assigned by BLE.addService()
+    std::vector<uint8_t> data;
+    bool writtenFlag;
+    bool isSubscribed;
+    BLECharacteristicEventHandler writtenHandler;
+};
+
+class BLEService {
+public:
+    explicit BLEService(const char* uuid) : serviceUuid(uuid) {}
+    const char* uuid() const { return serviceUuid; }
+    void addCharacteristic(BLECharacteristic& characteristic) { characteristics.push_back(&characteristic); }
+
+private:
+    friend class BLELocalDevice;
+
+    const char* serviceUuid;
+    std::vector<BLECharacteristic*> characteristics;
+};
+
+typedef void (*BLEDeviceEventHandler)(BLEDevice device);
+
+class BLELocalDevice {
+public:
+    int begin();
+    void end();
+    void poll(unsigned long timeout = 0);
+    bool connected() const;
+    bool disconnect();
+
+    bool setLocalName(const char* name);
+    void setAdvertisedService(const BLEService& service);
+    void addService(BLEService& service);
+    int advertise();
+    void stopAdvertise();
+    String address() const;
+    void setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler);
+
+private:
+    void closeCentral();
+    void handleFrame(uint8_t type, uint8_t handle, const uint8_t* payload, size_t length);
+};
+
+extern BLELocalDevice BLE;
+
+// Socket transport behind the stand-in. Every frame is
+//   type (u8) | handle (u8) | payload length (u16, little endian) | payload
+// with these types:
+//   HELLO           device -> central on connect; text payload "name\naddress\n"
+//                   followed by one "handle uuid properties maxsize\n" line per characteristic
+//   WRITE_REQUEST   central -> device, answered by WRITE_RESPONSE or ERROR at the next poll
+//   WRITE_COMMAND   central -> device, not answered
+//   NOTIFY          device -> central, a new value of a subscribed characteristic
+//   SUBSCRIBE       central -> device, payload 1 (subscribe) or 0 (unsubscribe)
+//   READ_REQUEST    central -> device, answered by READ_RESPONSE with the value
+namespace HostLink {
+    enum FrameType : uint8_t {
+        HELLO = 0,
+        WRITE_REQUEST = 1,
+        WRITE_RESPONSE = 2,
+        WRITE_COMMAND = 3,
+        NOTIFY = 4,
+        SUBSCRIBE = 5,
+        READ_REQUEST = 6,
+        READ_RESPONSE = 7,
+        ERROR = 8
+    };
+
+    // Call before BLE.begin(); exactly one of tcpPort (on 127.0.0.1) or unixPath is used
+    void listenOn(uint16_t tcpPort, const char* unixPath);
+    void setAddress(const char* address);
+
+    // Payload bytes written by the central and sent to it
+    uint64_t bytesReceived();
+    uint64_t bytesSent();
+    // Called for every write from the central, after the value was replaced
+    void setWriteObserver(void (*observer)(const BLECharacteristic& characteristic));
+    // Called when the central disconnects
+    void setDisconnectObserver(void (*observer)());
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef HOST_ARDUINO_LSM9DS1_H
+#define HOST_ARDUINO_LSM9DS1_H
+
+// Host stand-in for the LSM9DS1 IMU. Acceleration (in g) is synthesized from the virtual
+// clock for the selected motion profile:
+//   still   gravity on z plus sensor noise
+//   carry   a bike being walked away: 1.8 Hz gait sway and slow tilt on x
+//   breach  an attack on the lock: 22 Hz vibration and random impacts on x
+//   cycle   switches between the three every 10 seconds
+
+#include "Arduino.h"
+
+enum class HostMotion : uint8_t {
+    STILL,
+    CARRY,
+    BREACH,
+    CYCLE
+};
+
+class LSM9DS1Class {
+public:
+    int begin() { return 1; }
+    void end() {}
+
+    // New samples arrive at 119 Hz, as configured by the Arduino library
+    int accelerationAvailable();
+    int readAcceleration(float& x, float& y, float& z);
+    float accelerationSampleRate() { return 119.0f; }
+
+    // Host only
+    void setMotion(HostMotion motion, uint32_t seed);
+    static bool parseMotion(const char* name, HostMotion& motion);
+
+private:
+    HostMotion motion = HostMotion::STILL;
+    uint32_t rngState = 0x2545F491u;
+    unsigned long lastSampleMicros = 0;
+
+    float noise();
+};
+
+extern LSM9DS1Class IMU;
+
+#endif
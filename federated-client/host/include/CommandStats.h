@@ -0,0 +1,58 @@
+#ifndef COMMAND_STATS_H
+#define COMMAND_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Latency and transfer volume of each command a virtual device executes, in virtual time.
+//
+// A command starts when the central writes the control characteristic. It ends when the
+// firmware returns to Command::NONE or, if it never does (a transfer the central gave up
+// on), at the last loop iteration that moved data before the next command or disconnect.
+// The firmware is observed at each delay(), i.e. between transfer chunks and at the end
+// of loop(), so the end is known to within one chunk.
+class CommandStats {
+public:
+    struct Record {
+        uint8_t command;
+        uint64_t startMicros;
+        uint64_t endMicros;
+        uint64_t bytesIn;    // Payload written by the central, without the command byte
+        uint64_t bytesOut;   // Payload notified to the central
+    };
+
+    explicit CommandStats(const char* device) : device(device) {}
+    ~CommandStats();
+
+    // One CSV row per command: device,command,start_ms,latency_ms,bytes_in,bytes_out
+    bool openReport(const char* path);
+    // Print a line per command to stdout as it ends
+    void setEcho(bool echo) { this->echo = echo; }
+
+    void begin(uint8_t command, uint64_t nowMicros, uint64_t bytesIn, uint64_t bytesOut);
+    // idle: the firmware is back at Command::NONE
+    void probe(bool idle, uint64_t nowMicros, uint64_t bytesIn, uint64_t bytesOut);
+    // Ends the current command at its last activity (disconnect, shutdown)
+    void finish();
+
+    void printSummary(FILE* out) const;
+
+    static const char* commandName(uint8_t command);
+
+private:
+    void closeRecord(uint64_t endMicros);
+
+    std::string device;
+    std::vector<Record> records;
+    bool active = false;
+    Record current{};
+    uint64_t lastActivityMicros = 0;
+    uint64_t seenIn = 0;
+    uint64_t seenOut = 0;
+    bool echo = true;
+    FILE* report = nullptr;
+};
+
+#endif
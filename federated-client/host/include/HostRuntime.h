@@ -0,0 +1,31 @@
+#ifndef HOST_RUNTIME_H
+#define HOST_RUNTIME_H
+
+#include <stdint.h>
+
+// Process-wide state of one virtual device: its clock and Serial sink.
+//
+// The virtual clock is the host's monotonic clock scaled by the speedup, so delay(ms)
+// sleeps ms / speedup and busy waits on millis() end that much sooner. Host work (the
+// network, the socket) is scaled too, so latencies are only device-accurate at speedup 1.
+namespace HostRuntime {
+    void configure(double speedup, bool serialOutput, const char* deviceName);
+
+    // Virtual time since start
+    uint64_t nowMicros();
+    double speedup();
+
+    bool serialOutput();
+    const char* deviceName();
+
+    // Called on every delay() before sleeping; the firmware calls delay() at the end of
+    // each loop() and between transfer chunks
+    void setDelayHook(void (*hook)());
+    void runDelayHook();
+
+    // Set by SIGINT/SIGTERM; sleeps are cut short once it is set
+    bool stopRequested();
+    void requestStop();
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef HOST_NEURAL_NETWORK_H
+#define HOST_NEURAL_NETWORK_H
+
+// Host stand-in for the NeuralNetworks library (GiorgosXou) with the members the firmware
+// uses: a sigmoid MLP with one bias per layer, trained by BackProp() on the squared error
+// with the library's default learning rates. Like the library, _2_OPTIMIZE 0B01000000
+// selects REDUCE_RAM_WEIGHTS_LVL2, which keeps all weights in one array,
+// [layer][output][input].
+
+#include "Arduino.h"
+
+#if defined(_2_OPTIMIZE) && ((_2_OPTIMIZE & 0B01000000) == 0B01000000)
+    #define REDUCE_RAM_WEIGHTS_LVL2
+#endif
+
+class NeuralNetwork {
+public:
+    class Layer {
+    public:
+        unsigned int _numberOfInputs;
+        unsigned int _numberOfOutputs;
+        float* bias;
+        float* outputs;
+        float* gamma;
+        #if !defined(REDUCE_RAM_WEIGHTS_LVL2)
+        float** weights;
+        #endif
+    };
+
+    Layer* layers;
+    unsigned int numberOflayers;
+    #if defined(REDUCE_RAM_WEIGHTS_LVL2)
+    float* weights;
+    #endif
+    float LearningRateOfWeights = 0.33f;
+    float LearningRateOfBiases = 0.066f;
+
+    // Random weights and biases in [-0.9, 0.9), from random()
+    NeuralNetwork(const unsigned int* layer_, const unsigned int& NumberOflayers)
+        : NeuralNetwork(layer_, nullptr, NumberOflayers) {}
+
+    NeuralNetwork(const unsigned int* layer_, float* default_Weights, const unsigned int& NumberOflayers)
+        : numberOflayers(NumberOflayers - 1), inputs(nullptr) {
+        layers = new Layer[numberOflayers];
+        size_t total = 0;
+        for (unsigned int i = 0; i < numberOflayers; i++) {
+            total += layer_[i] * layer_[i + 1];
+        }
+        float* flat = new float[total];
+        size_t offset = 0;
+        for (unsigned int i = 0; i < numberOflayers; i++) {
+            Layer& layer = layers[i];
+            layer._numberOfInputs = layer_[i];
+            layer._numberOfOutputs = layer_[i + 1];
+            layer.bias = new float[1];
+            layer.bias[0] = random(-90000, 90000) / 100000.0f;
+            layer.outputs = new float[layer._numberOfOutputs]();
+            layer.gamma = new float[layer._numberOfOutputs]();
+            #if !defined(REDUCE_RAM_WEIGHTS_LVL2)
+            layer.weights = new float*[layer._numberOfOutputs];
+            #endif
+            for (unsigned int out = 0; out < layer._numberOfOutputs; out++) {
+                #if !defined(REDUCE_RAM_WEIGHTS_LVL2)
+                layer.weights[out] = flat + offset;
+                #endif
+                for (unsigned int in = 0; in < layer._numberOfInputs; in++, offset++) {
+                    flat[offset] = default_Weights ? default_Weights[offset] : random(-90000, 90000) / 100000.0f;
+                }
+            }
+        }
+        #if defined(REDUCE_RAM_WEIGHTS_LVL2)
+        weights = flat;
+        #else
+        flatWeights = flat;
+        #endif
+    }
+
+    ~NeuralNetwork() {
+        for (unsigned int i = 0; i < numberOflayers; i++) {
+            delete[] layers[i].bias;
+            delete[] layers[i].outputs;
+            delete[] layers[i].gamma;
+            #if !defined(REDUCE_RAM_WEIGHTS_LVL2)
+            delete[] layers[i].weights;
+            #endif
+        }
+        delete[] layers;
+        delete[] weightData();
+    }
+
+    NeuralNetwork(const NeuralNetwork&) = delete;
+    NeuralNetwork& operator=(const NeuralNetwork&) = delete;
+
+    // Keeps the inputs pointer for BackProp(), as the library does
+    float* FeedForward(const float* inputs_) {
+        inputs = inputs_;
+        const float* in = inputs_;
+        const float* w = weightData();
+        for (unsigned int i = 0; i < numberOflayers; i++) {
+            Layer& layer = layers[i];
+            for (unsigned int out = 0; out < layer._numberOfOutputs; out++) {
+                float sum = layer.bias[0];
+                for (unsigned int k = 0; k < layer._numberOfInputs; k++) sum += w[k] * in[k];
+                w += layer._numberOfInputs;
+                layer.outputs[out] = 1.0f / (1.0f + expf(-sum));
+            }
+            in = layer.outputs;
+        }
+        return layers[numberOflayers - 1].outputs;
+    }
+
+    void BackProp(const float* expected) {
+        // Errors of every layer first, from the weights of the forward pass
+        Layer& last = layers[numberOflayers - 1];
+        for (unsigned int out = 0; out < last._numberOfOutputs; out++) {
+            float y = last.outputs[out];
+            last.gamma[out] = (y - expected[out]) * y * (1.0f - y);
+        }
+        for (int i = static_cast<int>(numberOflayers) - 2; i >= 0; i--) {
+            Layer& layer = layers[i];
+            const Layer& next = layers[i + 1];
+            const float* w = weightData() + layerOffset(i + 1);
+            for (unsigned int k = 0; k < layer._numberOfOutputs; k++) {
+                float sum = 0.0f;
+                for (unsigned int out = 0; out < next._numberOfOutputs; out++) {
+                    sum += next.gamma[out] * w[out * next._numberOfInputs + k];
+                }
+                float y = layer.outputs[k];
+                layer.gamma[k] = sum * y * (1.0f - y);
+            }
+        }
+
+        float* w = weightData();
+        for (unsigned int i = 0; i < numberOflayers; i++) {
+            Layer& layer = layers[i];
+            const float* in = i == 0 ? inputs : layers[i - 1].outputs;
+            for (unsigned int out = 0; out < layer._numberOfOutputs; out++) {
+                for (unsigned int k = 0; k < layer._numberOfInputs; k++) {
+                    w[k] -= LearningRateOfWeights * layer.gamma[out] * in[k];
+                }
+                w += layer._numberOfInputs;
+                layer.bias[0] -= LearningRateOfBiases * layer.gamma[out];
+            }
+        }
+    }
+
+private:
+    const float* inputs;
+    #if !defined(REDUCE_RAM_WEIGHTS_LVL2)
+    float* flatWeights;
+    #endif
+
+    float* weightData() const {
+        #if defined(REDUCE_RAM_WEIGHTS_LVL2)
+        return weights;
+        #else
+        return flatWeights;
+        #endif
+    }
+
+    size_t layerOffset(unsigned int layer) const {
+        size_t offset = 0;
+        for (unsigned int i = 0; i < layer; i++) offset += layers[i]._numberOfInputs * layers[i]._numberOfOutputs;
+        return offset;
+    }
+};
+
+#endif
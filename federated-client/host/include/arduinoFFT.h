@@ -0,0 +1,102 @@
+#ifndef HOST_ARDUINO_FFT_H
+#define HOST_ARDUINO_FFT_H
+
+// Host stand-in for the subset of arduinoFFT 2.x used by SignalProcessing: in-place
+// radix-2 FFT with the library's DC removal, Hamming/Hann windows and magnitudes.
+
+#include "Arduino.h"
+
+enum class FFTDirection { Forward, Reverse };
+
+enum class FFTWindow { Rectangle, Hamming, Hann };
+
+template <typename T>
+class ArduinoFFT {
+public:
+    ArduinoFFT(T* vReal, T* vImag, uint_fast16_t samples, T samplingFrequency)
+        : vReal(vReal), vImag(vImag), samples(samples), samplingFrequency(samplingFrequency) {}
+
+    void setArrays(T* vReal, T* vImag, uint_fast16_t samples = 0) {
+        this->vReal = vReal;
+        this->vImag = vImag;
+        if (samples) this->samples = samples;
+    }
+
+    void dcRemoval() {
+        T mean = 0;
+        for (uint_fast16_t i = 0; i < samples; i++) mean += vReal[i];
+        mean /= samples;
+        for (uint_fast16_t i = 0; i < samples; i++) vReal[i] -= mean;
+    }
+
+    void windowing(FFTWindow window, FFTDirection direction) {
+        // Symmetric window over samples - 1 intervals, as in the library
+        const T last = static_cast<T>(samples - 1);
+        for (uint_fast16_t i = 0; i < samples / 2; i++) {
+            T ratio = static_cast<T>(i) / last;
+            T factor = 1;
+            if (window == FFTWindow::Hamming) factor = 0.54 - 0.46 * cos(2 * M_PI * ratio);
+            if (window == FFTWindow::Hann) factor = 0.5 * (1 - cos(2 * M_PI * ratio));
+            if (direction == FFTDirection::Forward) {
+                vReal[i] *= factor;
+                vReal[samples - 1 - i] *= factor;
+            } else {
+                vReal[i] /= factor;
+                vReal[samples - 1 - i] /= factor;
+            }
+        }
+    }
+
+    void compute(FFTDirection direction) {
+        // Bit-reversal permutation
+        for (uint_fast16_t i = 1, j = 0; i < samples; i++) {
+            uint_fast16_t bit = samples >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) {
+                std::swap(vReal[i], vReal[j]);
+                std::swap(vImag[i], vImag[j]);
+            }
+        }
+        const T sign = direction == FFTDirection::Forward ? -1 : 1;
+        for (uint_fast16_t length = 2; length <= samples; length <<= 1) {
+            T angle = sign * 2 * M_PI / length;
+            T stepReal = cos(angle), stepImag = sin(angle);
+            for (uint_fast16_t start = 0; start < samples; start += length) {
+                T wReal = 1, wImag = 0;
+                for (uint_fast16_t k = 0; k < length / 2; k++) {
+                    uint_fast16_t a = start + k, b = a + length / 2;
+                    T real = vReal[b] * wReal - vImag[b] * wImag;
+                    T imag = vReal[b] * wImag + vImag[b] * wReal;
+                    vReal[b] = vReal[a] - real;
+                    vImag[b] = vImag[a] - imag;
+                    vReal[a] += real;
+                    vImag[a] += imag;
+                    T next = wReal * stepReal - wImag * stepImag;
+                    wImag = wReal * stepImag + wImag * stepReal;
+                    wReal = next;
+                }
+            }
+        }
+        if (direction == FFTDirection::Reverse) {
+            for (uint_fast16_t i = 0; i < samples; i++) {
+                vReal[i] /= samples;
+                vImag[i] /= samples;
+            }
+        }
+    }
+
+    void complexToMagnitude() {
+        for (uint_fast16_t i = 0; i < samples; i++) {
+            vReal[i] = sqrt(vReal[i] * vReal[i] + vImag[i] * vImag[i]);
+        }
+    }
+
+private:
+    T* vReal;
+    T* vImag;
+    uint_fast16_t samples;
+    T samplingFrequency;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "CommandStats.h"
+#include <algorithm>
+#include <map>
+
+CommandStats::~CommandStats() {
+    if (report) fclose(report);
+}
+
+bool CommandStats::openReport(const char* path) {
+    report = fopen(path, "w");
+    if (!report) return false;
+    fprintf(report, "device,command,start_ms,latency_ms,bytes_in,bytes_out\n");
+    fflush(report);
+    return true;
+}
+
+void CommandStats::begin(uint8_t command, uint64_t nowMicros, uint64_t bytesIn, uint64_t bytesOut) {
+    // A new command ends one that never returned to Command::NONE
+    if (active) finish();
+    current = Record{command, nowMicros, nowMicros, bytesIn, bytesOut};
+    seenIn = bytesIn;
+    seenOut = bytesOut;
+    lastActivityMicros = nowMicros;
+    active = true;
+}
+
+void CommandStats::probe(bool idle, uint64_t nowMicros, uint64_t bytesIn, uint64_t bytesOut) {
+    if (!active) return;
+    if (bytesIn != seenIn || bytesOut != seenOut) {
+        seenIn = bytesIn;
+        seenOut = bytesOut;
+        lastActivityMicros = nowMicros;
+    }
+    if (idle) closeRecord(nowMicros);
+}
+
+void CommandStats::finish() {
+    if (active) closeRecord(lastActivityMicros);
+}
+
+void CommandStats::closeRecord(uint64_t endMicros) {
+    Record record = current;
+    record.endMicros = endMicros;
+    record.bytesIn = seenIn - current.bytesIn;
+    record.bytesOut = seenOut - current.bytesOut;
+    records.push_back(record);
+    active = false;
+
+    double latencyMs = (record.endMicros - record.startMicros) / 1000.0;
+    if (echo) {
+        printf("[%s] %-22s %9.1f ms  in %6llu B  out %6llu B", device.c_str(), commandName(record.command),
+               latencyMs, static_cast<unsigned long long>(record.bytesIn),
+               static_cast<unsigned long long>(record.bytesOut));
+        if (latencyMs > 0.0 && record.bytesIn + record.bytesOut > 0) {
+            printf("  %7.2f kbit/s", (record.bytesIn + record.bytesOut) * 8.0 / latencyMs);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    if (report) {
+        fprintf(report, "%s,%s,%.3f,%.3f,%llu,%llu\n", device.c_str(), commandName(record.command),
+                record.startMicros / 1000.0, latencyMs, static_cast<unsigned long long>(record.bytesIn),
+                static_cast<unsigned long long>(record.bytesOut));
+        fflush(report);
+    }
+}
+
+void CommandStats::printSummary(FILE* out) const {
+    std::map<uint8_t, std::vector<const Record*>> byCommand;
+    for (const Record& record : records) byCommand[record.command].push_back(&record);
+
+    fprintf(out, "\n%s: %zu commands\n", device.c_str(), records.size());
+    if (records.empty()) return;
+    fprintf(out, "  %-22s %6s %10s %10s %10s %10s %12s\n", "Command", "Count", "Mean ms", "p50 ms", "p95 ms",
+            "Max ms", "kbit/s");
+    for (const auto& entry : byCommand) {
+        std::vector<double> latencies;
+        double bytes = 0.0;
+        for (const Record* record : entry.second) {
+            latencies.push_back((record->endMicros - record->startMicros) / 1000.0);
+            bytes += record->bytesIn + record->bytesOut;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0.0;
+        for (double latency : latencies) total += latency;
+        size_t n = latencies.size();
+        fprintf(out, "  %-22s %6zu %10.1f %10.1f %10.1f %10.1f", commandName(entry.first), n, total / n,
+                latencies[(n - 1) / 2], latencies[std::min(n - 1, n * 95 / 100)], latencies.back());
+        if (bytes > 0.0 && total > 0.0) {
+            fprintf(out, " %12.2f", bytes * 8.0 / total);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+const char* CommandStats::commandName(uint8_t command) {
+    // Values of the Command enum in Communication.h
+    static const char* const names[] = {
+        "NONE", "GET_WEIGHTS", "SET_WEIGHTS", "START_TRAINING", "START_CLASSIFICATION",
+        "START_INFERENCE_BENCHMARK", "START_TRAINING_BENCHMARK", "GET_WEIGHTS_ENCODED",
+        "SET_WEIGHTS_ENCODED", "GET_WEIGHT_DELTA", "SET_MODEL",
+        "GET_WEIGHTS_PIPELINED", "SET_WEIGHTS_PIPELINED"
+    };
+    return command < sizeof(names) / sizeof(names[0]) ? names[command] : "UNKNOWN";
+}
@@ -0,0 +1,289 @@
+#include "ArduinoBLE.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+BLELocalDevice BLE;
+
+namespace {
+
+constexpr size_t FRAME_HEADER = 4;
+
+uint16_t listenPort = 0;
+std::string listenPath;
+std::string deviceAddress = "02:00:00:00:00:01";
+std::string localName;
+int listenFd = -1;
+int centralFd = -1;
+bool advertising = false;
+std::vector<uint8_t> received;                    // Bytes of incomplete frames
+std::vector<BLECharacteristic*> characteristics;  // Index is the handle
+BLEDeviceEventHandler connectedHandler = nullptr;
+BLEDeviceEventHandler disconnectedHandler = nullptr;
+void (*writeObserver)(const BLECharacteristic&) = nullptr;
+void (*disconnectObserver)() = nullptr;
+uint64_t payloadReceived = 0;
+uint64_t payloadSent = 0;
+
+bool sendAll(const uint8_t* data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = send(centralFd, data + done, length - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // The central is not reading; a radio would stall the same way
+            usleep(100);
+            continue;
+        }
+        if (n <= 0) return false;  // The disconnect is handled by the next poll
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendFrame(uint8_t type, uint8_t handle, const uint8_t* payload, size_t length) {
+    if (centralFd < 0 || length > 0xFFFF) return false;
+    uint8_t header[FRAME_HEADER] = {type, handle, static_cast<uint8_t>(length & 0xFF), static_cast<uint8_t>(length >> 8)};
+    return sendAll(header, FRAME_HEADER) && (length == 0 || sendAll(payload, length));
+}
+
+String centralAddress() {
+    return String(listenPath.empty() ? "127.0.0.1:" + std::to_string(listenPort) : listenPath);
+}
+
+} // namespace
+
+BLECharacteristic::BLECharacteristic(const char* uuid, uint8_t properties, int valueSize)
+    : characteristicUuid(uuid), characteristicProperties(properties),
+      maxSize(valueSize > 0 ? static_cast<size_t>(valueSize) : 0), handle(-1),
+      writtenFlag(false), isSubscribed(false), writtenHandler(nullptr) {
+}
+
+void BLECharacteristic::setEventHandler(BLECharacteristicEvent event, BLECharacteristicEventHandler handler) {
+    if (event == BLEWritten) writtenHandler = handler;
+}
+
+bool BLECharacteristic::written() {
+    bool wasWritten = writtenFlag;
+    writtenFlag = false;
+    return wasWritten;
+}
+
+int BLECharacteristic::readValue(uint8_t* value, int length) {
+    int count = min(length, valueLength());
+    if (count > 0) memcpy(value, data.data(), count);
+    return count;
+}
+
+bool BLECharacteristic::writeValue(const uint8_t* value, int length) {
+    if (length < 0 || static_cast<size_t>(length) > maxSize) return false;
+    data.assign(value, value + length);
+    if (!isSubscribed || centralFd < 0) return true;
+    if (!sendFrame(HostLink::NOTIFY, static_cast<uint8_t>(handle), value, length)) return false;
+    payloadSent += length;
+    return true;
+}
+
+int BLELocalDevice::begin() {
+    if (listenFd >= 0) return 1;
+    if (listenPath.empty()) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(listenPort);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::perror("bind");
+            return 0;
+        }
+    } else {
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (listenPath.size() >= sizeof(address.sun_path)) return 0;
+        memcpy(address.sun_path, listenPath.c_str(), listenPath.size() + 1);
+        unlink(listenPath.c_str());
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::perror("bind");
+            return 0;
+        }
+    }
+    if (listen(listenFd, 1) != 0) {
+        std::perror("listen");
+        return 0;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    return 1;
+}
+
+void BLELocalDevice::closeCentral() {
+    close(centralFd);
+    centralFd = -1;
+    received.clear();
+    for (BLECharacteristic* characteristic : characteristics) {
+        // Subscriptions do not outlive the connection
+        characteristic->isSubscribed = false;
+    }
+    if (disconnectObserver) disconnectObserver();
+    if (disconnectedHandler) disconnectedHandler(BLEDevice(centralAddress()));
+}
+
+void BLELocalDevice::end() {
+    if (centralFd >= 0) closeCentral();
+    if (listenFd >= 0) close(listenFd);
+    listenFd = -1;
+    if (!listenPath.empty()) unlink(listenPath.c_str());
+}
+
+void BLELocalDevice::poll(unsigned long) {
+    if (centralFd < 0) {
+        if (!advertising || listenFd < 0) return;
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if (listenPath.empty()) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        centralFd = fd;
+
+        std::string hello = localName + "\n" + deviceAddress + "\n";
+        for (size_t handle = 0; handle < characteristics.size(); handle++) {
+            char line[96];
+            std::snprintf(line, sizeof(line), "%zu %s %u %zu\n", handle, characteristics[handle]->uuid(),
+                          characteristics[handle]->properties(), characteristics[handle]->maxSize);
+            hello += line;
+        }
+        sendFrame(HostLink::HELLO, 0, reinterpret_cast<const uint8_t*>(hello.data()), hello.size());
+        if (connectedHandler) connectedHandler(BLEDevice(centralAddress()));
+    }
+
+    uint8_t buffer[4096];
+    for (;;) {
+        ssize_t n = recv(centralFd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            received.insert(received.end(), buffer, buffer + n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeCentral();
+        return;
+    }
+
+    size_t offset = 0;
+    while (received.size() - offset >= FRAME_HEADER) {
+        size_t length = received[offset + 2] | (received[offset + 3] << 8);
+        if (received.size() - offset < FRAME_HEADER + length) break;
+        handleFrame(received[offset], received[offset + 1], &received[offset + FRAME_HEADER], length);
+        offset += FRAME_HEADER + length;
+        if (centralFd < 0) return;
+    }
+    received.erase(received.begin(), received.begin() + offset);
+}
+
+void BLELocalDevice::handleFrame(uint8_t type, uint8_t handle, const uint8_t* payload, size_t length) {
+    BLECharacteristic* characteristic = handle < characteristics.size() ? characteristics[handle] : nullptr;
+    if (characteristic == nullptr) {
+        sendFrame(HostLink::ERROR, handle, nullptr, 0);
+        return;
+    }
+
+    switch (type) {
+        case HostLink::WRITE_REQUEST:
+        case HostLink::WRITE_COMMAND: {
+            bool writable = characteristic->properties() & (BLEWrite | BLEWriteWithoutResponse);
+            if (!writable || length > characteristic->maxSize) {
+                // Rejected like an ATT write with an invalid attribute length
+                if (type == HostLink::WRITE_REQUEST) sendFrame(HostLink::ERROR, handle, nullptr, 0);
+                return;
+            }
+            characteristic->data.assign(payload, payload + length);
+            characteristic->writtenFlag = true;
+            payloadReceived += length;
+            if (writeObserver) writeObserver(*characteristic);
+            if (characteristic->writtenHandler) {
+                characteristic->writtenHandler(BLEDevice(centralAddress()), *characteristic);
+            }
+            if (type == HostLink::WRITE_REQUEST) sendFrame(HostLink::WRITE_RESPONSE, handle, nullptr, 0);
+            break;
+        }
+        case HostLink::SUBSCRIBE:
+            characteristic->isSubscribed = length > 0 && payload[0] != 0;
+            break;
+        case HostLink::READ_REQUEST:
+            sendFrame(HostLink::READ_RESPONSE, handle, characteristic->data.data(), characteristic->data.size());
+            break;
+        default:
+            sendFrame(HostLink::ERROR, handle, nullptr, 0);
+            break;
+    }
+}
+
+bool BLELocalDevice::connected() const {
+    return centralFd >= 0;
+}
+
+bool BLELocalDevice::disconnect() {
+    if (centralFd < 0) return false;
+    closeCentral();
+    return true;
+}
+
+bool BLELocalDevice::setLocalName(const char* name) {
+    localName = name;
+    return true;
+}
+
+void BLELocalDevice::setAdvertisedService(const BLEService&) {
+}
+
+void BLELocalDevice::addService(BLEService& service) {
+    for (BLECharacteristic* characteristic : service.characteristics) {
+        characteristic->handle = static_cast<int>(characteristics.size());
+        characteristics.push_back(characteristic);
+    }
+}
+
+int BLELocalDevice::advertise() {
+    advertising = true;
+    return 1;
+}
+
+void BLELocalDevice::stopAdvertise() {
+    advertising = false;
+}
+
+String BLELocalDevice::address() const {
+    return String(deviceAddress);
+}
+
+void BLELocalDevice::setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler) {
+    if (event == BLEConnected) connectedHandler = handler;
+    if (event == BLEDisconnected) disconnectedHandler = handler;
+}
+
+namespace HostLink {
+
+void listenOn(uint16_t tcpPort, const char* unixPath) {
+    listenPort = tcpPort;
+    listenPath = unixPath ? unixPath : "";
+}
+
+void setAddress(const char* address) { deviceAddress = address; }
+
+uint64_t bytesReceived() { return payloadReceived; }
+uint64_t bytesSent() { return payloadSent; }
+
+void setWriteObserver(void (*observer)(const BLECharacteristic&)) { writeObserver = observer; }
+void setDisconnectObserver(void (*observer)()) { disconnectObserver = observer; }
+
+} // namespace HostLink
@@ -0,0 +1,72 @@
+#include "Arduino_LSM9DS1.h"
+
+LSM9DS1Class IMU;
+
+namespace {
+
+constexpr float TWO_PI_F = 6.2831853f;
+constexpr unsigned long SAMPLE_PERIOD_US = 1000000UL / 119;
+constexpr unsigned long CYCLE_PERIOD_US = 10000000UL;
+
+} // namespace
+
+int LSM9DS1Class::accelerationAvailable() {
+    return micros() - lastSampleMicros >= SAMPLE_PERIOD_US ? 1 : 0;
+}
+
+int LSM9DS1Class::readAcceleration(float& x, float& y, float& z) {
+    unsigned long now = micros();
+    lastSampleMicros = now;
+    float t = now / 1e6f;
+
+    HostMotion current = motion;
+    if (current == HostMotion::CYCLE) {
+        current = static_cast<HostMotion>((now / CYCLE_PERIOD_US) % 3);
+    }
+
+    x = 0.01f * noise();
+    y = 0.01f * noise();
+    z = 1.0f + 0.01f * noise();
+    switch (current) {
+        case HostMotion::CARRY:
+            x += 0.25f * sinf(TWO_PI_F * 1.8f * t) + 0.1f * sinf(TWO_PI_F * 0.2f * t);
+            y += 0.1f * sinf(TWO_PI_F * 3.6f * t);
+            break;
+        case HostMotion::BREACH:
+            x += 0.15f * sinf(TWO_PI_F * 22.0f * t);
+            // About two impacts per second
+            if ((rngState >> 8) % 60 == 0) x += 1.5f * noise();
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+void LSM9DS1Class::setMotion(HostMotion motion, uint32_t seed) {
+    this->motion = motion;
+    rngState = seed ? seed : 0x2545F491u;
+}
+
+bool LSM9DS1Class::parseMotion(const char* name, HostMotion& motion) {
+    static const char* const names[] = {"still", "carry", "breach", "cycle"};
+    for (uint8_t i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            motion = static_cast<HostMotion>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+float LSM9DS1Class::noise() {
+    // Sum of two xorshift32 uniforms, roughly triangular on [-1, 1]
+    float sum = 0.0f;
+    for (int i = 0; i < 2; i++) {
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        sum += (rngState >> 8) * (1.0f / 16777216.0f);
+    }
+    return sum - 1.0f;
+}
@@ -0,0 +1,134 @@
+#include "HostRuntime.h"
+#include "Arduino.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+HostSerial Serial;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point startTime = Clock::now();
+double clockSpeedup = 1.0;
+bool serialEnabled = false;
+std::string name = "SmartBikeLock";
+bool atLineStart = true;
+void (*delayHook)() = nullptr;
+uint32_t randomState = 0x9E3779B9u;
+volatile std::sig_atomic_t stopFlag = 0;
+
+size_t writeSerial(const char* text) {
+    if (!serialEnabled) return strlen(text);
+    size_t length = 0;
+    for (const char* c = text; *c; c++, length++) {
+        if (atLineStart) {
+            std::fprintf(stderr, "[%s %8.3f] ", name.c_str(), HostRuntime::nowMicros() / 1e6);
+            atLineStart = false;
+        }
+        std::fputc(*c, stderr);
+        if (*c == '\n') atLineStart = true;
+    }
+    return length;
+}
+
+} // namespace
+
+namespace HostRuntime {
+
+void configure(double speedup, bool serialOutput, const char* deviceName) {
+    clockSpeedup = speedup > 0.0 ? speedup : 1.0;
+    serialEnabled = serialOutput;
+    name = deviceName;
+}
+
+uint64_t nowMicros() {
+    auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+    return static_cast<uint64_t>(elapsed * clockSpeedup);
+}
+
+double speedup() { return clockSpeedup; }
+bool serialOutput() { return serialEnabled; }
+const char* deviceName() { return name.c_str(); }
+
+void setDelayHook(void (*hook)()) { delayHook = hook; }
+
+void runDelayHook() {
+    if (delayHook) delayHook();
+}
+
+bool stopRequested() { return stopFlag != 0; }
+void requestStop() { stopFlag = 1; }
+
+} // namespace HostRuntime
+
+unsigned long millis() {
+    // The firmware busy-waits on millis() while sampling; sleeping when the value has not
+    // changed keeps dozens of virtual devices from saturating the host
+    static unsigned long last = 0;
+    unsigned long now = static_cast<unsigned long>(HostRuntime::nowMicros() / 1000);
+    if (now == last) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    last = now;
+    return now;
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(HostRuntime::nowMicros());
+}
+
+void delay(unsigned long ms) {
+    HostRuntime::runDelayHook();
+    // Sleep until the virtual deadline rather than for a fixed time, so time spent in
+    // the hook is not added to the delay
+    uint64_t deadline = HostRuntime::nowMicros() + static_cast<uint64_t>(ms) * 1000;
+    while (!HostRuntime::stopRequested()) {
+        uint64_t now = HostRuntime::nowMicros();
+        if (now >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::duration<double, std::micro>((deadline - now) / clockSpeedup));
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    uint64_t deadline = HostRuntime::nowMicros() + us;
+    while (HostRuntime::nowMicros() < deadline) {
+    }
+}
+
+void randomSeed(unsigned long seed) {
+    randomState = seed ? static_cast<uint32_t>(seed) : 0x9E3779B9u;
+}
+
+long random(long howBig) {
+    if (howBig <= 0) return 0;
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return static_cast<long>(randomState % static_cast<uint32_t>(howBig));
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) return howSmall;
+    return howSmall + random(howBig - howSmall);
+}
+
+size_t HostSerial::print(const char* text) { return writeSerial(text); }
+
+size_t HostSerial::print(char value) {
+    char text[2] = {value, '\0'};
+    return writeSerial(text);
+}
+
+size_t HostSerial::print(long value) { return writeSerial(std::to_string(value).c_str()); }
+
+size_t HostSerial::print(unsigned long value) { return writeSerial(std::to_string(value).c_str()); }
+
+size_t HostSerial::print(double value, int digits) {
+    char text[64];
+    std::snprintf(text, sizeof(text), "%.*f", digits, value);
+    return writeSerial(text);
+}
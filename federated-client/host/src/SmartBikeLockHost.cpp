@@ -0,0 +1,164 @@
+// Host build of the SmartBikeLock firmware: the sketch runs unchanged against the
+// stand-ins in host/include, with BLE served over a local socket.
+
+#include "SmartBikeLock.ino"
+#include "CommandStats.h"
+#include "HostRuntime.h"
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+CommandStats* stats = nullptr;
+bool disconnected = false;
+
+void onWrite(const BLECharacteristic& characteristic) {
+    if (strcmp(characteristic.uuid(), BLEConfig::CONTROL_CHAR_UUID) != 0 || characteristic.valueLength() == 0) {
+        return;
+    }
+    stats->begin(characteristic.value()[0], HostRuntime::nowMicros(), HostLink::bytesReceived(), HostLink::bytesSent());
+}
+
+void onDisconnect() {
+    stats->finish();
+    disconnected = true;
+}
+
+void onDelay() {
+    stats->probe(bleComm.getCurrentCommand() == Command::NONE, HostRuntime::nowMicros(),
+                 HostLink::bytesReceived(), HostLink::bytesSent());
+}
+
+void onSignal(int) {
+    HostRuntime::requestStop();
+}
+
+bool getCmdOption(const std::vector<std::string>& args, const std::string& option, std::string& value) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == option && i + 1 < args.size()) {
+            value = args[i + 1];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool cmdOptionExists(const std::vector<std::string>& args, const std::string& option) {
+    for (const std::string& arg : args) {
+        if (arg == option) return true;
+    }
+    return false;
+}
+
+void printUsage() {
+    printf("Usage: SmartBikeLockHost [options]\n");
+    printf("Options:\n");
+    printf("  --port <N>            Serve the GATT table on TCP 127.0.0.1:N (default: 9000)\n");
+    printf("  --socket <path>       Serve it on a Unix socket instead\n");
+    printf("  --name <name>         Device name used in logs and reports (default: sbl-<port>)\n");
+    printf("  --address <mac>       Address reported by BLE.address() (default: from the port)\n");
+    printf("  --speedup <x>         Run the virtual clock x times faster than real time (default: 1)\n");
+    printf("  --motion <profile>    IMU signal: still, carry, breach, cycle (default: still)\n");
+    printf("  --seed <N>            Seed of the initial weights and the IMU noise (default: 1)\n");
+    printf("  --report <file>       Write one CSV row per command\n");
+    printf("  --check-features      Check the incremental features of every window against the FFT\n");
+    printf("  --serial              Print the firmware's Serial output to stderr\n");
+    printf("  --quiet               Do not print a line per command\n");
+    printf("  --once                Exit when the first central disconnects\n");
+    printf("  --help, -h            Show this help message\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (cmdOptionExists(args, "--help") || cmdOptionExists(args, "-h")) {
+        printUsage();
+        return 0;
+    }
+
+    unsigned long port = 9000;
+    std::string socketPath;
+    std::string name;
+    std::string address;
+    double speedup = 1.0;
+    HostMotion motion = HostMotion::STILL;
+    unsigned long seed = 1;
+    std::string reportPath;
+
+    std::string value;
+    try {
+        if (getCmdOption(args, "--port", value)) port = std::stoul(value);
+        if (getCmdOption(args, "--socket", value)) socketPath = value;
+        if (getCmdOption(args, "--name", value)) name = value;
+        if (getCmdOption(args, "--address", value)) address = value;
+        if (getCmdOption(args, "--speedup", value)) speedup = std::stod(value);
+        if (getCmdOption(args, "--seed", value)) seed = std::stoul(value);
+        if (getCmdOption(args, "--report", value)) reportPath = value;
+    } catch (const std::exception&) {
+        fprintf(stderr, "Invalid value '%s'\n", value.c_str());
+        return 1;
+    }
+    if (getCmdOption(args, "--motion", value) && !LSM9DS1Class::parseMotion(value.c_str(), motion)) {
+        fprintf(stderr, "Unknown motion profile '%s'\n", value.c_str());
+        return 1;
+    }
+    if (port == 0 || port > 65535 || speedup <= 0.0) {
+        fprintf(stderr, "Invalid port or speedup\n");
+        return 1;
+    }
+    if (name.empty()) {
+        name = socketPath.empty() ? "sbl-" + std::to_string(port) : socketPath;
+    }
+    if (address.empty()) {
+        // Locally administered, unique per port
+        char mac[18];
+        snprintf(mac, sizeof(mac), "02:00:00:00:%02lx:%02lx", (port >> 8) & 0xFF, port & 0xFF);
+        address = mac;
+    }
+
+    HostRuntime::configure(speedup, cmdOptionExists(args, "--serial"), name.c_str());
+    HostLink::listenOn(static_cast<uint16_t>(port), socketPath.empty() ? nullptr : socketPath.c_str());
+    HostLink::setAddress(address.c_str());
+    randomSeed(seed);
+    IMU.setMotion(motion, static_cast<uint32_t>(seed));
+    signalProc.setFeatureCheck(cmdOptionExists(args, "--check-features"));
+
+    CommandStats commandStats(name.c_str());
+    commandStats.setEcho(!cmdOptionExists(args, "--quiet"));
+    if (!reportPath.empty() && !commandStats.openReport(reportPath.c_str())) {
+        fprintf(stderr, "Cannot write %s\n", reportPath.c_str());
+        return 1;
+    }
+    stats = &commandStats;
+    HostLink::setWriteObserver(onWrite);
+    HostLink::setDisconnectObserver(onDisconnect);
+    HostRuntime::setDelayHook(onDelay);
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // setup() retries forever when BLE fails to start, so check the socket first
+    if (!BLE.begin()) {
+        return 1;
+    }
+    setup();
+    printf("%s listening on %s (speedup %g)\n", name.c_str(),
+           socketPath.empty() ? ("127.0.0.1:" + std::to_string(port)).c_str() : socketPath.c_str(), speedup);
+    fflush(stdout);
+
+    const bool once = cmdOptionExists(args, "--once");
+    while (!HostRuntime::stopRequested() && !(once && disconnected)) {
+        loop();
+    }
+
+    commandStats.finish();
+    BLE.end();
+    commandStats.printSummary(stdout);
+    if (signalProc.getCheckedWindows() > 0) {
+        printf("Feature check: %lu windows, largest deviation from the FFT %.2e of the largest feature\n",
+               static_cast<unsigned long>(signalProc.getCheckedWindows()), signalProc.getMaxFeatureDeviation());
+    }
+    return 0;
+}
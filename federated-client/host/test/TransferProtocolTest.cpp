@@ -0,0 +1,100 @@
+// Host checks of the pipelined transfer state machines in TransferProtocol.h
+#include "TransferProtocol.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAIL: %s\n", what);
+            failures++;
+        }
+    }
+
+    std::vector<uint8_t> payload(size_t length) {
+        std::vector<uint8_t> data(length);
+        for (size_t i = 0; i < length; i++) data[i] = static_cast<uint8_t>(i * 31 + 7);
+        return data;
+    }
+
+    // Offer frames every millisecond to a link that rejects every write. Returns the time
+    // at which the sender gave up, or 0 if it was still running after limitMs.
+    uint32_t runRejectingLink(TransferSender& sender, uint32_t startMs, uint32_t limitMs) {
+        uint8_t frame[244];
+        for (uint32_t now = startMs; now < startMs + limitMs; now++) {
+            sender.nextFrame(frame, sizeof(frame), now);  // Never followed by frameSent()
+            if (sender.finished()) return now;
+        }
+        return 0;
+    }
+
+    void testLosslessTransfer() {
+        auto data = payload(3000);
+        std::vector<uint8_t> received(data.size());
+        TransferSender sender;
+        TransferReceiver receiver(received.data(), received.size(), 244);
+        check(sender.begin(data.data(), data.size(), 1, 244, 8, 250), "begin");
+
+        uint8_t frame[244];
+        uint8_t ack[TransferProtocol::ACK_BYTES];
+        for (uint32_t now = 0; now < 10000 && !sender.finished(); now++) {
+            size_t length = sender.nextFrame(frame, sizeof(frame), now);
+            if (length == 0) continue;
+            sender.frameSent(now);
+            if (receiver.onFrame(frame, length)) {
+                size_t ackLength = receiver.ack(ack, sizeof(ack));
+                sender.onFrame(ack, ackLength, now);
+            }
+        }
+        check(sender.state() == TransferSender::State::COMPLETE, "lossless transfer completes");
+        check(receiver.state() == TransferReceiver::State::COMPLETE, "receiver completes");
+        check(received == data, "payload arrives intact");
+        check(sender.retransmissions() == 0, "no retransmissions without loss");
+    }
+
+    void testRejectedBegin() {
+        auto data = payload(1000);
+        TransferSender sender;
+        check(sender.begin(data.data(), data.size(), 2, 244, 8, 250), "begin");
+        uint32_t failedAt = runRejectingLink(sender, 1000, 60000);
+        check(sender.state() == TransferSender::State::FAILED, "rejected BEGIN fails the transfer");
+        check(failedAt > 0 && failedAt - 1000 <= 250u * (TransferSender::MAX_RETRIES + 1),
+              "rejected BEGIN fails within the retry budget");
+    }
+
+    void testRejectedData() {
+        auto data = payload(1000);
+        std::vector<uint8_t> received(data.size());
+        TransferSender sender;
+        TransferReceiver receiver(received.data(), received.size(), 244);
+        check(sender.begin(data.data(), data.size(), 3, 244, 8, 250), "begin");
+
+        // BEGIN gets through and is acknowledged, then the link rejects everything
+        uint8_t frame[244];
+        uint8_t ack[TransferProtocol::ACK_BYTES];
+        size_t length = sender.nextFrame(frame, sizeof(frame), 0);
+        sender.frameSent(0);
+        check(receiver.onFrame(frame, length), "BEGIN is acknowledged");
+        sender.onFrame(ack, receiver.ack(ack, sizeof(ack)), 1);
+        check(sender.state() == TransferSender::State::SENDING, "sending after the first ACK");
+
+        uint32_t failedAt = runRejectingLink(sender, 2, 60000);
+        check(sender.state() == TransferSender::State::FAILED, "rejected DATA fails the transfer");
+        check(failedAt > 0 && failedAt - 1 <= 250u * (TransferSender::MAX_RETRIES + 1),
+              "rejected DATA fails within the retry budget");
+    }
+}
+
+int main() {
+    testLosslessTransfer();
+    testRejectedBegin();
+    testRejectedData();
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All transfer protocol checks passed\n");
+    return 0;
+}
@@ -25,6 +25,11 @@ class BLEClient:
             print(f"Connection error: {str(e)}")
             return False
     
+    @property
+    def mtu(self):
+        """Negotiated ATT MTU (23 until the exchange has happened)."""
+        return self.client.mtu_size if self.client and self.connected else 23
+
     async def disconnect(self):
         """Disconnect from the BLE device."""
         if self.client and self.client.is_connected:
@@ -0,0 +1,143 @@
+"""
+Weight payload codec matching federated-client/WeightCodec.cpp.
+
+Payload layout (little-endian):
+    format (u8), flags (u8), reserved (u16), count (u32)
+    INT8 only: scale (f32), zero point (i8), 3 reserved bytes
+    values: float32, float16 or int8
+
+Device uploads (GET_WEIGHTS_ENCODED) carry the change since the last weights the device
+received; decode them with those weights as the reference.
+"""
+
+import struct
+import numpy as np
+
+
+class WeightCodec:
+    FLOAT32 = 0
+    FLOAT16 = 1
+    INT8 = 2
+
+    HEADER_BYTES = 8
+    INT8_PARAM_BYTES = 8
+
+    FORMAT_NAMES = {FLOAT32: 'fp32', FLOAT16: 'fp16', INT8: 'int8'}
+
+    @classmethod
+    def encoded_size(cls, fmt, count):
+        """Return the payload size in bytes for count values."""
+        if fmt == cls.INT8:
+            return cls.HEADER_BYTES + cls.INT8_PARAM_BYTES + count
+        if fmt == cls.FLOAT16:
+            return cls.HEADER_BYTES + 2 * count
+        return cls.HEADER_BYTES + 4 * count
+
+    @classmethod
+    def peek_header(cls, data):
+        """Return (format, count) once the header has arrived, otherwise None."""
+        if len(data) < cls.HEADER_BYTES or data[0] > cls.INT8:
+            return None
+        fmt, _flags, _reserved, count = struct.unpack_from('<BBHI', data, 0)
+        return fmt, count
+
+    @classmethod
+    def encode(cls, weights, fmt):
+        """Encode weights with round-to-nearest."""
+        values = np.asarray(weights, dtype=np.float32)
+        header = struct.pack('<BBHI', fmt, 0, 0, len(values))
+
+        if fmt == cls.FLOAT32:
+            return header + values.astype('<f4').tobytes()
+        if fmt == cls.FLOAT16:
+            return header + values.astype('<f2').tobytes()
+
+        # Per-tensor affine int8; the range always contains zero
+        min_value = min(float(values.min(initial=0.0)), 0.0)
+        max_value = max(float(values.max(initial=0.0)), 0.0)
+        scale = (max_value - min_value) / 255.0 or 1.0
+        zero_point = int(np.clip(-128 - round(min_value / scale), -128, 127))
+        quantized = np.clip(np.round(values / scale) + zero_point, -128, 127).astype(np.int8)
+        params = struct.pack('<fbxxx', scale, zero_point)
+        return header + params + quantized.tobytes()
+
+    @classmethod
+    def decode(cls, data, reference=None):
+        """Decode a complete payload into a float32 array, added to reference if given."""
+        values = cls._decode_values(data)
+        if reference is None:
+            return values
+        return (np.asarray(reference, dtype=np.float32) + values).astype(np.float32)
+
+    @classmethod
+    def _decode_values(cls, data):
+        header = cls.peek_header(data)
+        if header is None:
+            raise ValueError("Invalid weight payload header")
+        fmt, count = header
+        if len(data) < cls.encoded_size(fmt, count):
+            raise ValueError("Truncated weight payload")
+
+        payload = bytes(data[cls.HEADER_BYTES:])
+        if fmt == cls.FLOAT32:
+            return np.frombuffer(payload, dtype='<f4', count=count).astype(np.float32)
+        if fmt == cls.FLOAT16:
+            return np.frombuffer(payload, dtype='<f2', count=count).astype(np.float32)
+
+        scale, zero_point = struct.unpack_from('<fb', payload, 0)
+        quantized = np.frombuffer(payload, dtype=np.int8, count=count,
+                                  offset=cls.INT8_PARAM_BYTES)
+        return (scale * (quantized.astype(np.float32) - zero_point)).astype(np.float32)
+
+
+class SparseDelta:
+    """
+    Top-k sparse delta payload matching federated-client/SparseDelta.cpp.
+
+    Payload layout (little-endian):
+        version (u8), 3 reserved bytes, dense count (u32), entries (u32)
+        entries x (varint index gap, float32 value), indices ascending
+    """
+
+    VERSION = 1
+    HEADER_BYTES = 12
+
+    @classmethod
+    def peek_header(cls, data):
+        """Return (count, entries) once the header has arrived, otherwise None."""
+        if len(data) < cls.HEADER_BYTES or data[0] != cls.VERSION:
+            return None
+        count, entries = struct.unpack_from('<II', data, 4)
+        return count, entries
+
+    @classmethod
+    def decode(cls, data):
+        """Decode a payload into a dense float32 delta, or None while it is incomplete."""
+        header = cls.peek_header(data)
+        if header is None:
+            return None
+        count, entries = header
+
+        delta = np.zeros(count, dtype=np.float32)
+        offset = cls.HEADER_BYTES
+        index = 0
+        for _ in range(entries):
+            gap = 0
+            shift = 0
+            while True:
+                if offset >= len(data):
+                    return None
+                byte = data[offset]
+                offset += 1
+                gap |= (byte & 0x7F) << shift
+                shift += 7
+                if not byte & 0x80:
+                    break
+            if offset + 4 > len(data):
+                return None
+            index += gap
+            if index >= count:
+                raise ValueError("Sparse delta index out of range")
+            delta[index] = struct.unpack_from('<f', data, offset)[0]
+            offset += 4
+        return delta
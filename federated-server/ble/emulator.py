@@ -0,0 +1,160 @@
+"""
+Socket client for the host emulator of the federated client (federated-client/host).
+
+EmulatorClient has the interface of BLEClient, so CommandHandler and the timing
+handler drive a virtual device exactly like a real one.
+"""
+
+import asyncio
+import struct
+
+
+class EmulatorClient:
+    # Frame types of the emulator link (see federated-client/host/include/ArduinoBLE.h)
+    HELLO = 0
+    WRITE_REQUEST = 1
+    WRITE_RESPONSE = 2
+    WRITE_COMMAND = 3
+    NOTIFY = 4
+    SUBSCRIBE = 5
+    READ_REQUEST = 6
+    READ_RESPONSE = 7
+    ERROR = 8
+
+    def __init__(self, device_address, timeout=10.0):
+        """device_address is "host:port", "port" or the path of a Unix socket."""
+        self.device_address = device_address
+        self.timeout = timeout
+        self.connected = False
+        self.name = None
+        self.address = None
+        self.callbacks = {}
+        self._reader = None
+        self._writer = None
+        self._handles = {}       # UUID -> handle
+        self._uuids = {}         # handle -> UUID
+        self._pending = None     # Future of the outstanding request
+        self._request_lock = None
+        self._receiver = None
+        self._hello = None
+        # The socket has no MTU; report the one the firmware is configured for
+        self.mtu = 247
+
+    async def connect(self):
+        """Connect to the virtual device and read its GATT table."""
+        try:
+            if "/" in self.device_address:
+                self._reader, self._writer = await asyncio.open_unix_connection(self.device_address)
+            else:
+                host, _, port = self.device_address.rpartition(":")
+                self._reader, self._writer = await asyncio.open_connection(host or "127.0.0.1", int(port))
+            self._hello = asyncio.get_event_loop().create_future()
+            self._request_lock = asyncio.Lock()
+            self._receiver = asyncio.ensure_future(self._receive())
+            # The device accepts the connection at its next BLE.poll()
+            await asyncio.wait_for(self._hello, self.timeout)
+            self.connected = True
+            print(f"Connected: {self.connected} ({self.name}, {self.address})")
+            return True
+        except Exception as e:
+            print(f"Connection error: {str(e)}")
+            await self.disconnect()
+            return False
+
+    async def disconnect(self):
+        """Close the socket; the device sees a BLE disconnect."""
+        if self._receiver:
+            self._receiver.cancel()
+            self._receiver = None
+        if self._writer:
+            self._writer.close()
+            self._writer = None
+        if self.connected:
+            self.connected = False
+            print("Disconnected")
+
+    async def start_notify(self, char_uuid, callback):
+        """Subscribe to a characteristic; callback(sender, data) gets each notification."""
+        if not self.connected:
+            print("Not connected to device")
+            return False
+        handle = self._handles.get(char_uuid.upper())
+        if handle is None:
+            print(f"Notification error: no characteristic {char_uuid}")
+            return False
+        self.callbacks[handle] = callback
+        self._send(self.SUBSCRIBE, handle, b"\x01")
+        return True
+
+    async def write_char(self, char_uuid, data, response=True):
+        """Write a characteristic; with response, wait until the device has polled it."""
+        if not self.connected:
+            print("Not connected to device")
+            return False
+        handle = self._handles.get(char_uuid.upper())
+        if handle is None:
+            print(f"Write error: no characteristic {char_uuid}")
+            return False
+        try:
+            if not response:
+                self._send(self.WRITE_COMMAND, handle, bytes(data))
+                await self._writer.drain()
+                return True
+            frame_type, _ = await self._request(self.WRITE_REQUEST, handle, bytes(data))
+            if frame_type != self.WRITE_RESPONSE:
+                print("Write error: rejected by device")
+                return False
+            return True
+        except Exception as e:
+            print(f"Write error: {str(e)}")
+            return False
+
+    async def read_char(self, char_uuid):
+        """Read the current value of a characteristic."""
+        handle = self._handles.get(char_uuid.upper())
+        if not self.connected or handle is None:
+            return None
+        frame_type, payload = await self._request(self.READ_REQUEST, handle, b"")
+        return payload if frame_type == self.READ_RESPONSE else None
+
+    def _send(self, frame_type, handle, payload):
+        self._writer.write(struct.pack("<BBH", frame_type, handle, len(payload)) + payload)
+
+    async def _request(self, frame_type, handle, payload):
+        # Like an ATT bearer, one request is outstanding at a time
+        async with self._request_lock:
+            self._pending = asyncio.get_event_loop().create_future()
+            try:
+                self._send(frame_type, handle, payload)
+                await self._writer.drain()
+                return await asyncio.wait_for(self._pending, self.timeout)
+            finally:
+                self._pending = None
+
+    async def _receive(self):
+        try:
+            while True:
+                header = await self._reader.readexactly(4)
+                frame_type, handle, length = struct.unpack("<BBH", header)
+                payload = await self._reader.readexactly(length) if length else b""
+                if frame_type == self.HELLO:
+                    self._parse_hello(payload.decode())
+                    self._hello.set_result(True)
+                elif frame_type == self.NOTIFY:
+                    callback = self.callbacks.get(handle)
+                    if callback:
+                        callback(self._uuids.get(handle), bytearray(payload))
+                elif self._pending is not None and not self._pending.done():
+                    self._pending.set_result((frame_type, payload))
+        except (asyncio.IncompleteReadError, ConnectionError):
+            self.connected = False
+            if self._pending is not None and not self._pending.done():
+                self._pending.set_exception(ConnectionError("device disconnected"))
+
+    def _parse_hello(self, text):
+        lines = text.splitlines()
+        self.name, self.address = lines[0], lines[1]
+        for line in lines[2:]:
+            handle, uuid, _properties, _size = line.split()
+            self._handles[uuid.upper()] = int(handle)
+            self._uuids[int(handle)] = uuid
@@ -20,6 +20,12 @@ class BLEProtocol:
         START_CLASSIFICATION = 4
         START_INFERENCE_BENCHMARK = 5
         START_TRAINING_BENCHMARK = 6
+        GET_WEIGHTS_ENCODED = 7
+        SET_WEIGHTS_ENCODED = 8
+        GET_WEIGHT_DELTA = 9
+        SET_MODEL = 10
+        GET_WEIGHTS_PIPELINED = 11
+        SET_WEIGHTS_PIPELINED = 12
 
     # Transfer parameters
     CHUNK_SIZE_RECEIVE = 52  # Max floats per chunk when receiving
@@ -0,0 +1,268 @@
+"""
+Pipelined, resumable transfer matching federated-client/TransferProtocol.cpp.
+
+Frames (little-endian):
+    BEGIN  sender -> receiver: type, id, total bytes (u32), payload CRC32, frame size (u16), window
+    DATA   sender -> receiver: type, id, sequence number (u16), payload, CRC32 of the frame so far
+    ACK    receiver -> sender: type, id, next expected sequence number (u16), status
+    READY  receiver -> sender: type, reserved, largest frame size (u16), window
+
+The sender keeps up to a window of frames in flight and goes back to the first
+unacknowledged frame on a repeated ACK or a timeout. The receiver accepts frames in
+order and keeps a partial payload, which a BEGIN for the same size, CRC and frame size
+resumes.
+"""
+
+import struct
+import zlib
+
+TYPE_BEGIN = 1
+TYPE_DATA = 2
+TYPE_ACK = 3
+TYPE_READY = 4
+
+DATA_HEADER_BYTES = 4
+DATA_OVERHEAD = DATA_HEADER_BYTES + 4
+MIN_FRAME_BYTES = 20
+MAX_WINDOW = 32
+
+ACK_RECEIVING = 0
+ACK_COMPLETE = 1
+ACK_FAILED = 2
+
+# Defaults of the firmware (BLEConfig in federated-client/Config.h)
+FRAME_BYTES = 244
+WINDOW = 8
+TIMEOUT_S = 0.25
+MAX_RETRIES = 10
+
+
+def frame_count(total_bytes, frame_bytes):
+    return -(-total_bytes // (frame_bytes - DATA_OVERHEAD))
+
+
+def frame_bytes_for_mtu(mtu):
+    """Largest frame that fits one ATT payload, capped at the firmware's buffer."""
+    return max(MIN_FRAME_BYTES, min(FRAME_BYTES, mtu - 3))
+
+
+def encode_ready(frame_bytes, window):
+    return struct.pack('<BBHB', TYPE_READY, 0, frame_bytes, window)
+
+
+def _valid(total_bytes, frame_bytes, window):
+    return (total_bytes > 0 and frame_bytes >= MIN_FRAME_BYTES and 0 < window <= MAX_WINDOW
+            and frame_count(total_bytes, frame_bytes) <= 0xFFFE)
+
+
+class TransferSender:
+    def __init__(self, payload, transfer_id, frame_bytes=FRAME_BYTES, window=WINDOW, timeout=TIMEOUT_S):
+        if not _valid(len(payload), frame_bytes, window):
+            raise ValueError("invalid transfer parameters")
+        self.payload = bytes(payload)
+        self.transfer_id = transfer_id & 0xFF
+        self.frame_bytes = frame_bytes
+        self.window = window
+        self.timeout = timeout
+        self.frames = frame_count(len(payload), frame_bytes)
+        self.crc = zlib.crc32(self.payload)
+        self.state = 'starting'
+        self.base = 0
+        self.next_seq = 0
+        self.highest_sent = 0
+        self.rewound_at = None
+        self.resumed_at = 0
+        self.begin_sent = False
+        self.last_send = 0.0
+        self.progress = 0.0
+        self.retries = 0
+        self.sent = 0
+        self.resent = 0
+
+    @property
+    def finished(self):
+        return self.state in ('complete', 'failed')
+
+    def next_frame(self, now):
+        """The frame due at now (seconds), or None while the window is full."""
+        if self.state == 'starting':
+            if self.begin_sent and now - self.last_send < self.timeout:
+                return None
+            if self.begin_sent:
+                self.resent += 1
+                self.retries += 1
+                if self.retries > MAX_RETRIES:
+                    self.state = 'failed'
+                    return None
+            self.begin_sent = True
+            self.last_send = now
+            self.sent += 1
+            return struct.pack('<BBIIHB', TYPE_BEGIN, self.transfer_id, len(self.payload),
+                               self.crc, self.frame_bytes, self.window)
+        if self.state != 'sending':
+            return None
+
+        if self.next_seq > self.base and now - self.progress >= self.timeout:
+            self.retries += 1
+            if self.retries > MAX_RETRIES:
+                self.state = 'failed'
+                return None
+            self.next_seq = self.base
+            self.progress = now
+
+        if self.next_seq >= self.frames or self.next_seq - self.base >= self.window:
+            return None
+        seq = self.next_seq
+        if seq < self.highest_sent:
+            self.resent += 1
+        else:
+            self.highest_sent = seq + 1
+        if self.next_seq == self.base:
+            self.progress = now
+        self.next_seq = seq + 1
+        self.last_send = now
+        self.sent += 1
+
+        per_frame = self.frame_bytes - DATA_OVERHEAD
+        frame = struct.pack('<BBH', TYPE_DATA, self.transfer_id, seq) + \
+            self.payload[seq * per_frame:(seq + 1) * per_frame]
+        return frame + struct.pack('<I', zlib.crc32(frame))
+
+    def on_frame(self, frame, now):
+        """Handle an ACK from the receiver."""
+        if len(frame) < 5 or frame[0] != TYPE_ACK or frame[1] != self.transfer_id:
+            return
+        if self.state not in ('starting', 'sending'):
+            return
+        _, _, next_seq, status = struct.unpack_from('<BBHB', frame)
+        if status == ACK_FAILED:
+            self.state = 'failed'
+            return
+        if next_seq > self.frames:
+            return
+
+        if self.state == 'starting':
+            self.state = 'sending'
+            self.base = self.next_seq = self.highest_sent = self.resumed_at = next_seq
+            self.progress = now
+            self.retries = 0
+        elif next_seq > self.base:
+            self.base = next_seq
+            self.next_seq = max(self.next_seq, self.base)
+            self.progress = now
+            self.retries = 0
+        elif next_seq == self.base and self.next_seq > self.base and self.rewound_at != self.base:
+            self.next_seq = self.base
+            self.rewound_at = self.base
+
+        if self.base == self.frames and status == ACK_COMPLETE:
+            self.state = 'complete'
+
+
+class TransferReceiver:
+    def __init__(self, capacity, max_frame_bytes=FRAME_BYTES):
+        self.capacity = capacity
+        self.max_frame_bytes = max_frame_bytes
+        self.buffer = bytearray(capacity)
+        self.reset()
+        self.transfer_id = 0
+        self.corrupt = 0
+
+    def reset(self):
+        """Forget the current and any partial transfer."""
+        self.state = 'idle'
+        self.total_bytes = 0
+        self.crc = 0
+        self.frame_bytes = 0
+        self.frames = 0
+        self.ack_every = 1
+        self.expected = 0
+        self.last_acked = 0
+        self.gap_acked = False
+        self.last_unexpected = 0
+        self.resumed_at = 0
+
+    @property
+    def data(self):
+        return bytes(self.buffer[:self.total_bytes])
+
+    @property
+    def received(self):
+        if self.state == 'complete':
+            return self.total_bytes
+        if self.frame_bytes == 0:
+            return 0
+        return min(self.expected * (self.frame_bytes - DATA_OVERHEAD), self.total_bytes)
+
+    def on_frame(self, frame):
+        """Returns True when an ACK is due; build it with ack()."""
+        if not frame:
+            return False
+        if frame[0] == TYPE_BEGIN and len(frame) >= 13:
+            self._on_begin(frame)
+            return True
+        if frame[0] == TYPE_DATA:
+            return self._on_data(frame)
+        return False
+
+    def ack(self):
+        status = {'complete': ACK_COMPLETE, 'failed': ACK_FAILED}.get(self.state, ACK_RECEIVING)
+        self.last_acked = self.expected
+        return struct.pack('<BBHB', TYPE_ACK, self.transfer_id, self.expected, status)
+
+    def _on_begin(self, frame):
+        _, transfer_id, total, crc, frame_bytes, window = struct.unpack_from('<BBIIHB', frame)
+        self.transfer_id = transfer_id
+        if (not _valid(total, frame_bytes, window) or frame_bytes > self.max_frame_bytes
+                or total > self.capacity):
+            self.reset()
+            self.state = 'failed'
+            return
+
+        resume = (self.state in ('receiving', 'complete') and total == self.total_bytes
+                  and crc == self.crc and frame_bytes == self.frame_bytes)
+        if resume:
+            self.resumed_at = self.expected
+        else:
+            self.state = 'receiving'
+            self.total_bytes = total
+            self.crc = crc
+            self.frame_bytes = frame_bytes
+            self.frames = frame_count(total, frame_bytes)
+            self.expected = 0
+            self.resumed_at = 0
+        self.ack_every = max(1, window // 2)
+        self.last_acked = self.expected
+        self.gap_acked = False
+
+    def _on_data(self, frame):
+        if len(frame) <= DATA_OVERHEAD or frame[1] != self.transfer_id or self.state == 'idle':
+            return False
+        if zlib.crc32(frame[:-4]) != struct.unpack_from('<I', frame, len(frame) - 4)[0]:
+            self.corrupt += 1
+            return False
+        if self.state != 'receiving':
+            return True
+
+        seq = struct.unpack_from('<H', frame, 2)[0]
+        if seq != self.expected:
+            # Once per pass of the sender: a lower sequence number means it went back
+            repeat = self.gap_acked and seq > self.last_unexpected
+            self.gap_acked = True
+            self.last_unexpected = seq
+            return not repeat
+
+        per_frame = self.frame_bytes - DATA_OVERHEAD
+        offset = seq * per_frame
+        count = len(frame) - DATA_OVERHEAD
+        if count != min(per_frame, self.total_bytes - offset):
+            self.corrupt += 1
+            return False
+        self.buffer[offset:offset + count] = frame[DATA_HEADER_BYTES:-4]
+        self.expected += 1
+        self.gap_acked = False
+
+        if self.expected == self.frames:
+            self.state = 'complete' if zlib.crc32(self.data) == self.crc else 'failed'
+            return True
+        return self.expected - self.last_acked >= self.ack_every
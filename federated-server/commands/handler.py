@@ -6,8 +6,9 @@ import asyncio
 import struct
 import time
 import numpy as np
-from ble.client import BLEClient
 from ble.protocol import BLEProtocol
+from ble.codec import WeightCodec, SparseDelta
+from ble import transfer
 from models.nn_config import NNConfig
 
 class CommandHandler:
@@ -15,7 +16,17 @@ class CommandHandler:
         self.ble_client = ble_client
         self.predictions = []
         self.received_weights = []
+        self.received_bytes = bytearray()
+        self.encoded_transfer = False
         self.total_weights = NNConfig.calculate_total_weights()
+        # Weights last sent to the device; encoded and delta uploads are relative to them.
+        # None after a model file, whose weights the device expands itself.
+        self.reference_weights = np.zeros(self.total_weights, dtype=np.float32)
+        # Pipelined transfers: weight notifications go to this callable while one runs.
+        # The upload receiver outlives a transfer so a reconnect can resume it.
+        self.pipelined_frame_handler = None
+        self.upload_receiver = transfer.TransferReceiver(self.total_weights * 4)
+        self.transfer_id = 0
         
     async def setup(self):
         """Set up notifications after connection."""
@@ -37,6 +48,20 @@ class CommandHandler:
         
     def _weights_callback(self, sender, data):
         """Handle incoming weights data."""
+        # Frames repeated after a finished upload: the device missed the final ACK and
+        # waits for it. The transfer id and frame CRC tell them from any other data.
+        if (data and data[0] == transfer.TYPE_DATA and self.upload_receiver.state == 'complete'
+                and self.upload_receiver.on_frame(bytes(data))):
+            asyncio.ensure_future(self.ble_client.write_char(
+                BLEProtocol.WEIGHTS_WRITE_CHAR_UUID, self.upload_receiver.ack(), response=False))
+            return
+        if self.pipelined_frame_handler is not None:
+            self.pipelined_frame_handler(bytes(data))
+            return
+        if self.encoded_transfer:
+            self.received_bytes.extend(data)
+            return
+
         chunk_weights = []
         num_floats = len(data) // 4
         for i in range(num_floats):
@@ -116,6 +141,263 @@ class CommandHandler:
             return None
 
 
+    async def get_weights_pipelined(self, idle_timeout=5.0):
+        """Request the device's weights over the pipelined transfer (see ble/transfer.py)."""
+        receiver = self.upload_receiver
+        activity = asyncio.Event()
+        state = {'ack_due': False, 'begun': False}
+
+        def on_frame(frame):
+            if frame and frame[0] == transfer.TYPE_BEGIN:
+                state['begun'] = True
+            if receiver.on_frame(frame):
+                state['ack_due'] = True
+            activity.set()
+
+        self.pipelined_frame_handler = on_frame
+        try:
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytes([BLEProtocol.Command.GET_WEIGHTS_PIPELINED])
+            )
+            if not success:
+                print("Failed to send GET_WEIGHTS_PIPELINED command")
+                return None
+
+            # The device sends frames of the size chosen here, so they fit our MTU.
+            # READY is repeated until the device's BEGIN arrives.
+            start_time = time.time()
+            ready = transfer.encode_ready(transfer.frame_bytes_for_mtu(self.ble_client.mtu), transfer.WINDOW)
+            for _ in range(transfer.MAX_RETRIES + 1):
+                if not await self.ble_client.write_char(BLEProtocol.WEIGHTS_WRITE_CHAR_UUID, ready,
+                                                        response=False):
+                    print("Failed to send READY")
+                    return None
+                try:
+                    await asyncio.wait_for(activity.wait(), transfer.TIMEOUT_S)
+                except asyncio.TimeoutError:
+                    continue
+                if state['begun']:
+                    break
+                activity.clear()
+
+            while not (state['begun'] and not state['ack_due']
+                       and receiver.state in ('complete', 'failed')):
+                if not state['ack_due']:
+                    try:
+                        await asyncio.wait_for(activity.wait(), idle_timeout)
+                    except asyncio.TimeoutError:
+                        print(f"Timeout: no frame for {idle_timeout} seconds "
+                              f"({receiver.received} bytes kept for resume)")
+                        return None
+                    activity.clear()
+                if state['ack_due']:
+                    state['ack_due'] = False
+                    await self.ble_client.write_char(BLEProtocol.WEIGHTS_WRITE_CHAR_UUID,
+                                                     receiver.ack(), response=False)
+        finally:
+            self.pipelined_frame_handler = None
+
+        if receiver.state != 'complete':
+            print("Pipelined transfer failed: payload CRC mismatch")
+            return None
+        if receiver.total_bytes != self.total_weights * 4:
+            print(f"Weight count mismatch. Expected: {self.total_weights} Got: {receiver.total_bytes // 4}")
+            return None
+
+        duration = time.time() - start_time
+        resumed = f", resumed at frame {receiver.resumed_at}" if receiver.resumed_at else ""
+        print(f"Received {self.total_weights} weights in {receiver.frames} frames{resumed} "
+              f"({duration:.3f} seconds, {receiver.total_bytes * 8 / (duration * 1000):.2f} kbps)")
+        return np.frombuffer(receiver.data, dtype='<f4').astype(np.float32)
+
+    def _has_reference(self):
+        if self.reference_weights is None:
+            print("The device's reference weights are unknown; send weights with s, se or sp first")
+            return False
+        return True
+
+    async def get_weights_encoded(self):
+        """Request the device's change since the last weights sent as a quantized WeightCodec
+        payload and apply it to those weights."""
+        if not self._has_reference():
+            return None
+        try:
+            self.received_bytes = bytearray()
+            self.encoded_transfer = True
+            print("Requesting encoded weights...")
+
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytes([BLEProtocol.Command.GET_WEIGHTS_ENCODED])
+            )
+
+            if not success:
+                print("Failed to send GET_WEIGHTS_ENCODED command")
+                return None
+
+            timeout = 30.0  # seconds
+            start_time = asyncio.get_event_loop().time()
+
+            while True:
+                header = WeightCodec.peek_header(self.received_bytes)
+                if header is not None:
+                    fmt, count = header
+                    if count != self.total_weights:
+                        print(f"Weight count mismatch. Expected: {self.total_weights} Got: {count}")
+                        return None
+                    if len(self.received_bytes) >= WeightCodec.encoded_size(fmt, count):
+                        break
+
+                if asyncio.get_event_loop().time() - start_time > timeout:
+                    print(f"Overall timeout after {timeout} seconds")
+                    return None
+                await asyncio.sleep(0.1)
+
+            weights = WeightCodec.decode(self.received_bytes, self.reference_weights)
+            print(f"Received {len(weights)} weight changes as {WeightCodec.FORMAT_NAMES[fmt]} "
+                  f"in {len(self.received_bytes)} bytes "
+                  f"({len(self.received_bytes) / (4 * len(weights)) * 100:.1f}% of fp32)")
+            return weights
+
+        except Exception as e:
+            print(f"Error getting encoded weights: {str(e)}")
+            return None
+        finally:
+            self.encoded_transfer = False
+
+    async def get_weight_delta(self):
+        """Request the device's largest weight changes and apply them to the last weights sent."""
+        if not self._has_reference():
+            return None
+        try:
+            self.received_bytes = bytearray()
+            self.encoded_transfer = True
+            print("Requesting sparse weight delta...")
+
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytes([BLEProtocol.Command.GET_WEIGHT_DELTA])
+            )
+
+            if not success:
+                print("Failed to send GET_WEIGHT_DELTA command")
+                return None
+
+            timeout = 30.0  # seconds
+            start_time = asyncio.get_event_loop().time()
+
+            while True:
+                header = SparseDelta.peek_header(self.received_bytes)
+                if header is not None and header[0] != self.total_weights:
+                    print(f"Weight count mismatch. Expected: {self.total_weights} Got: {header[0]}")
+                    return None
+                delta = SparseDelta.decode(self.received_bytes)
+                if delta is not None:
+                    break
+
+                if asyncio.get_event_loop().time() - start_time > timeout:
+                    print(f"Overall timeout after {timeout} seconds")
+                    return None
+                await asyncio.sleep(0.1)
+
+            entries = header[1]
+            print(f"Received {entries} of {len(delta)} weight changes "
+                  f"in {len(self.received_bytes)} bytes "
+                  f"({len(self.received_bytes) / (4 * len(delta)) * 100:.1f}% of fp32)")
+            return self.reference_weights + delta
+
+        except Exception as e:
+            print(f"Error getting weight delta: {str(e)}")
+            return None
+        finally:
+            self.encoded_transfer = False
+
+    async def send_weights_encoded(self, weights, fmt=WeightCodec.INT8):
+        """Send weights to the device as a quantized WeightCodec payload."""
+        try:
+            if len(weights) != self.total_weights:
+                print(f"Error: Expected {self.total_weights} weights, got {len(weights)}")
+                return False
+
+            payload = WeightCodec.encode(weights, fmt)
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytearray([BLEProtocol.Command.SET_WEIGHTS_ENCODED]),
+                response=True
+            )
+
+            if not success:
+                print("Failed to send SET_WEIGHTS_ENCODED command")
+                return False
+
+            await asyncio.sleep(0.05)
+
+            chunk_bytes = BLEProtocol.CHUNK_SIZE_RECEIVE * 4
+            start_time = time.time()
+            for offset in range(0, len(payload), chunk_bytes):
+                success = await self.ble_client.write_char(
+                    BLEProtocol.WEIGHTS_WRITE_CHAR_UUID,
+                    payload[offset:offset + chunk_bytes],
+                    response=True
+                )
+                if not success:
+                    print(f"Failed to send encoded chunk at byte {offset}")
+                    return False
+
+            duration = time.time() - start_time
+            print(f"Sent {len(weights)} weights as {WeightCodec.FORMAT_NAMES[fmt]} "
+                  f"in {len(payload)} bytes ({duration:.3f} seconds)")
+            self.reference_weights = WeightCodec.decode(payload)
+            return True
+
+        except Exception as e:
+            print(f"Error sending encoded weights: {str(e)}")
+            return False
+
+    async def send_model_file(self, path):
+        """Send a model file exported by the simulator (--export-model) to the device."""
+        try:
+            with open(path, 'rb') as f:
+                model = f.read()
+            if model[:4] != b'SBLM':
+                print(f"Error: {path} is not a model file")
+                return False
+
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytearray([BLEProtocol.Command.SET_MODEL]),
+                response=True
+            )
+
+            if not success:
+                print("Failed to send SET_MODEL command")
+                return False
+
+            await asyncio.sleep(0.05)
+
+            # The device checks each block's CRC as it arrives and drops a bad transfer early
+            chunk_bytes = BLEProtocol.CHUNK_SIZE_RECEIVE * 4
+            start_time = time.time()
+            for offset in range(0, len(model), chunk_bytes):
+                success = await self.ble_client.write_char(
+                    BLEProtocol.WEIGHTS_WRITE_CHAR_UUID,
+                    model[offset:offset + chunk_bytes],
+                    response=True
+                )
+                if not success:
+                    print(f"Failed to send model chunk at byte {offset}")
+                    return False
+
+            duration = time.time() - start_time
+            print(f"Sent model file {path} ({len(model)} bytes, {duration:.3f} seconds)")
+            self.reference_weights = None
+            return True
+
+        except Exception as e:
+            print(f"Error sending model file: {str(e)}")
+            return False
+
     async def send_weights(self, weights):
         """Send weights to the device with optimized transfer."""
         try:
@@ -172,12 +454,69 @@ class CommandHandler:
             print(f"Weight update complete in {duration:.3f} seconds")
             print(f"Effective throughput: {(len(weights) * 4 * 8) / (duration * 1000):.2f} kbps")
 
+            self.reference_weights = np.asarray(weights, dtype=np.float32)
             return True
 
         except Exception as e:
             print(f"Error sending weights: {str(e)}")
             return False
 
+    async def send_weights_pipelined(self, weights):
+        """Send weights over the pipelined transfer; repeating it after a disconnect resumes."""
+        if len(weights) != self.total_weights:
+            print(f"Error: Expected {self.total_weights} weights, got {len(weights)}")
+            return False
+
+        payload = np.asarray(weights, dtype='<f4').tobytes()
+        self.transfer_id = (self.transfer_id + 1) & 0xFF
+        sender = transfer.TransferSender(payload, self.transfer_id,
+                                         transfer.frame_bytes_for_mtu(self.ble_client.mtu))
+        activity = asyncio.Event()
+
+        def on_frame(frame):
+            sender.on_frame(frame, time.monotonic())
+            activity.set()
+
+        self.pipelined_frame_handler = on_frame
+        try:
+            success = await self.ble_client.write_char(
+                BLEProtocol.CONTROL_CHAR_UUID,
+                bytearray([BLEProtocol.Command.SET_WEIGHTS_PIPELINED]),
+                response=True
+            )
+            if not success:
+                print("Failed to send SET_WEIGHTS_PIPELINED command")
+                return False
+
+            start_time = time.time()
+            while not sender.finished:
+                frame = sender.next_frame(time.monotonic())
+                if frame is not None:
+                    if not await self.ble_client.write_char(BLEProtocol.WEIGHTS_WRITE_CHAR_UUID,
+                                                            frame, response=False):
+                        print(f"Failed to send frame ({sender.base}/{sender.frames} acknowledged)")
+                        return False
+                    continue
+                # Window full: wait for an ACK or the retransmission timeout
+                try:
+                    await asyncio.wait_for(activity.wait(), sender.timeout)
+                except asyncio.TimeoutError:
+                    pass
+                activity.clear()
+        finally:
+            self.pipelined_frame_handler = None
+
+        if sender.state != 'complete':
+            print("Pipelined weight update failed")
+            return False
+
+        duration = time.time() - start_time
+        resumed = f", resumed at frame {sender.resumed_at}" if sender.resumed_at else ""
+        print(f"Weight update complete in {sender.frames} frames{resumed}, {sender.resent} resent "
+              f"({duration:.3f} seconds, {len(payload) * 8 / (duration * 1000):.2f} kbps)")
+        self.reference_weights = np.asarray(weights, dtype=np.float32)
+        return True
+
     async def start_classification(self):
         """Start classification mode on the device."""
         try:
@@ -0,0 +1,117 @@
+"""
+Federated rounds against many emulated devices (federated-client/host) at once.
+
+Each round sends the global weights to every device, has each device train on a few
+windows and averages the weights it gets back, with all devices served concurrently.
+Reports the server-side latency of each operation and of the rounds.
+"""
+
+import argparse
+import asyncio
+import contextlib
+import io
+import time
+from statistics import mean, median
+
+import numpy as np
+
+from ble.emulator import EmulatorClient
+from commands.handler import CommandHandler
+
+
+def parse_devices(spec):
+    """Comma-separated addresses; "9000-9019" is a range of ports on 127.0.0.1."""
+    devices = []
+    for item in spec.split(","):
+        if "-" in item and "/" not in item and ":" not in item:
+            first, last = (int(port) for port in item.split("-"))
+            devices.extend(f"127.0.0.1:{port}" for port in range(first, last + 1))
+        elif item.isdigit():
+            devices.append(f"127.0.0.1:{item}")
+        else:
+            devices.append(item)
+    return devices
+
+
+async def timed(times, operation, coroutine):
+    start = time.perf_counter()
+    result = await coroutine
+    times.setdefault(operation, []).append(time.perf_counter() - start)
+    return result
+
+
+async def run_device_round(handler, weights, windows, times, failures, pipelined):
+    send = handler.send_weights_pipelined if pipelined else handler.send_weights
+    get = handler.get_weights_pipelined if pipelined else handler.get_weights
+    if not await timed(times, "SET_WEIGHTS", send(weights)):
+        failures.append("SET_WEIGHTS")
+        return None
+    for window in range(windows):
+        label = window % 3
+        if not await timed(times, "START_TRAINING", handler.start_training(label)):
+            failures.append("START_TRAINING")
+            return None
+    result = await timed(times, "GET_WEIGHTS", get())
+    if result is None:
+        failures.append("GET_WEIGHTS")
+    return result
+
+
+async def run(args):
+    devices = parse_devices(args.devices)
+    clients = [EmulatorClient(address) for address in devices]
+    times = {}
+    failures = []
+    round_times = []
+
+    log = io.StringIO()
+    with contextlib.redirect_stdout(log):
+        connected = await asyncio.gather(*(client.connect() for client in clients))
+        handlers = [CommandHandler(client) for client, ok in zip(clients, connected) if ok]
+        await asyncio.gather(*(handler.setup() for handler in handlers))
+
+        global_weights = np.random.default_rng(args.seed).normal(
+            0, 0.5, handlers[0].total_weights if handlers else 0).astype(np.float32)
+        for _ in range(args.rounds):
+            start = time.perf_counter()
+            results = await asyncio.gather(*(
+                run_device_round(handler, global_weights, args.windows, times, failures, args.pipelined)
+                for handler in handlers))
+            updates = [np.asarray(result, dtype=np.float32) for result in results if result is not None]
+            if updates:
+                global_weights = np.mean(updates, axis=0).astype(np.float32)
+            round_times.append(time.perf_counter() - start)
+
+        await asyncio.gather(*(client.disconnect() for client in clients))
+
+    print(f"Devices: {len(handlers)}/{len(devices)} connected, "
+          f"{args.rounds} rounds of {args.windows} training windows"
+          f"{', pipelined transfers' if args.pipelined else ''}")
+    print(f"  {'Operation':<16} {'Count':>6} {'Mean s':>8} {'p50 s':>8} {'Max s':>8}")
+    for operation in ("SET_WEIGHTS", "START_TRAINING", "GET_WEIGHTS"):
+        values = times.get(operation, [])
+        if values:
+            print(f"  {operation:<16} {len(values):>6} {mean(values):>8.3f} "
+                  f"{median(values):>8.3f} {max(values):>8.3f}")
+    if round_times:
+        print(f"  {'Round':<16} {len(round_times):>6} {mean(round_times):>8.3f} "
+              f"{median(round_times):>8.3f} {max(round_times):>8.3f}")
+    if failures:
+        print(f"Failed operations: {len(failures)} ({', '.join(sorted(set(failures)))})")
+    return 0 if not failures and len(handlers) == len(devices) else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Federated rounds against emulated devices')
+    parser.add_argument('--devices', required=True,
+                        help='Emulator addresses: host:port, port, port ranges (9000-9019) or Unix socket paths')
+    parser.add_argument('--rounds', type=int, default=3, help='Federated rounds (default: 3)')
+    parser.add_argument('--windows', type=int, default=2, help='Training windows per device and round (default: 2)')
+    parser.add_argument('--seed', type=int, default=0, help='Seed of the initial global weights (default: 0)')
+    parser.add_argument('--pipelined', action='store_true',
+                        help='Exchange weights with GET/SET_WEIGHTS_PIPELINED instead of the chunked commands')
+    return asyncio.run(run(parser.parse_args()))
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -7,7 +7,6 @@ import argparse
 import numpy as np
 import sys
 import signal
-from ble.client import BLEClient
 from ble.protocol import BLEProtocol
 from commands.handler import CommandHandler
 from benchmark.timing import BLETimingHandler
@@ -31,6 +30,12 @@ async def display_help():
     print("  t  - Start training (with label)")
     print("  g  - Get weights from device")
     print("  s  - Set random weights on device")
+    print("  ge - Get int8/fp16-encoded weights from device")
+    print("  se - Set random weights on device as int8")
+    print("  gd - Get sparse weight changes since the last set weights")
+    print("  sm - Send a model file exported by the simulator")
+    print("  gp - Get weights from device (pipelined transfer)")
+    print("  sp - Set random weights on device (pipelined transfer)")
     print("  bi - Run inference benchmark")
     print("  bt - Run training benchmark")
     print("  mg - Measure GET_WEIGHTS performance")
@@ -70,6 +75,29 @@ async def main_menu(command_handler, timing_handler, exit_handler):
                 print("Generating random weights...")
                 new_weights = np.random.normal(0, 0.5, command_handler.total_weights).astype(np.float32)
                 await command_handler.send_weights(new_weights)
+            elif command == 'ge':
+                weights = await command_handler.get_weights_encoded()
+                if weights is not None:
+                    command_handler.print_weights_matrix(weights)
+            elif command == 'gd':
+                weights = await command_handler.get_weight_delta()
+                if weights is not None:
+                    command_handler.print_weights_matrix(weights)
+            elif command == 'gp':
+                weights = await command_handler.get_weights_pipelined()
+                if weights is not None:
+                    command_handler.print_weights_matrix(weights)
+            elif command == 'sp':
+                print("Generating random weights...")
+                new_weights = np.random.normal(0, 0.5, command_handler.total_weights).astype(np.float32)
+                await command_handler.send_weights_pipelined(new_weights)
+            elif command == 'sm':
+                path = input("Model file path: ").strip()
+                await command_handler.send_model_file(path)
+            elif command == 'se':
+                print("Generating random weights...")
+                new_weights = np.random.normal(0, 0.5, command_handler.total_weights).astype(np.float32)
+                await command_handler.send_weights_encoded(new_weights)
             elif command == 'bi':
                 await command_handler.run_inference_benchmark()
             elif command == 'bt':
@@ -99,17 +127,24 @@ async def main():
     parser = argparse.ArgumentParser(description='Federated Learning Server for Arduino-based Bike Lock')
     parser.add_argument('--device', '-d', type=str, 
                         help='BLE device address (e.g., "xx:xx:xx:xx:xx:xx")')
+    parser.add_argument('--emulator', '-e', type=str,
+                        help='Connect to an emulated device instead (host:port or Unix socket path)')
     args = parser.parse_args()
     
-    device_address = args.device
-    
-    # If no device address provided, prompt the user
-    if not device_address:
-        device_address = input("Enter BLE device address (e.g., xx:xx:xx:xx:xx:xx): ")
-    
+    if args.emulator:
+        from ble.emulator import EmulatorClient
+        device_address = args.emulator
+        ble_client = EmulatorClient(device_address)
+    else:
+        from ble.client import BLEClient
+        device_address = args.device
+
+        # If no device address provided, prompt the user
+        if not device_address:
+            device_address = input("Enter BLE device address (e.g., xx:xx:xx:xx:xx:xx): ")
+        ble_client = BLEClient(device_address)
+
     print(f"Connecting to device: {device_address}")
-    
-    ble_client = BLEClient(device_address)
     exit_handler = GracefulExit()
     
     try:
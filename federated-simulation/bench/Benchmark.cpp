@@ -0,0 +1,143 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Value of "field": in one line written by write_json
+bool json_field(const std::string& line, const std::string& field, std::string& value) {
+    const std::string key = "\"" + field + "\": ";
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) return false;
+    pos += key.size();
+
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == std::string::npos) return false;
+        value = line.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end - pos);
+    }
+    return true;
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(double min_sample_seconds, size_t samples, const std::string& filter)
+    : min_sample_seconds(min_sample_seconds),
+      samples(std::max<size_t>(1, samples)),
+      filter(filter) {
+}
+
+bool BenchmarkRunner::selected(const std::string& name, const std::string& params) const {
+    if (filter.empty()) return true;
+    return (name + "/" + params).find(filter) != std::string::npos;
+}
+
+void BenchmarkRunner::add_result(const std::string& name, const std::string& params, size_t iterations,
+                                 std::vector<double> per_op_ns) {
+    if (per_op_ns.empty()) {
+        throw std::runtime_error("Benchmark " + name + " recorded no samples");
+    }
+    std::sort(per_op_ns.begin(), per_op_ns.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.params = params;
+    result.iterations = iterations;
+    result.median_ns = per_op_ns[per_op_ns.size() / 2];
+    result.min_ns = per_op_ns.front();
+    result.max_ns = per_op_ns.back();
+    benchmark_results.push_back(result);
+
+    std::cerr << "  " << std::left << std::setw(40) << result.key() << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1) << result.median_ns << " ns/op"
+              << std::defaultfloat << std::endl;
+}
+
+void BenchmarkRunner::print_table(std::ostream& out) const {
+    out << std::left << std::setw(40) << "Benchmark" << std::right
+        << std::setw(14) << "median ns" << std::setw(14) << "min ns" << std::setw(14) << "ops/s" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto& result : benchmark_results) {
+        out << std::left << std::setw(40) << result.key() << std::right
+            << std::setw(14) << result.median_ns
+            << std::setw(14) << result.min_ns
+            << std::setw(14) << result.ops_per_second() << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+void BenchmarkRunner::write_json(std::ostream& out) const {
+    out << "{\n  \"schema\": 1,\n  \"benchmarks\": [\n";
+    out << std::setprecision(6);
+    for (size_t i = 0; i < benchmark_results.size(); i++) {
+        const auto& result = benchmark_results[i];
+        out << "    {\"name\": \"" << result.name << "\""
+            << ", \"params\": \"" << result.params << "\""
+            << ", \"iterations\": " << result.iterations
+            << ", \"median_ns\": " << result.median_ns
+            << ", \"min_ns\": " << result.min_ns
+            << ", \"max_ns\": " << result.max_ns
+            << ", \"ops_per_second\": " << result.ops_per_second() << "}"
+            << (i + 1 < benchmark_results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::read_json(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open benchmark results: " + path);
+    }
+
+    std::vector<BenchmarkResult> results;
+    std::string line;
+    while (std::getline(file, line)) {
+        BenchmarkResult result;
+        std::string value;
+        if (!json_field(line, "name", result.name) || !json_field(line, "median_ns", value)) {
+            continue;
+        }
+        result.median_ns = std::stod(value);
+        json_field(line, "params", result.params);
+        if (json_field(line, "iterations", value)) result.iterations = std::stoul(value);
+        if (json_field(line, "min_ns", value)) result.min_ns = std::stod(value);
+        if (json_field(line, "max_ns", value)) result.max_ns = std::stod(value);
+        results.push_back(result);
+    }
+    return results;
+}
+
+size_t BenchmarkRunner::compare(const std::vector<BenchmarkResult>& baseline,
+                                const std::vector<BenchmarkResult>& current,
+                                double threshold, std::ostream& out) {
+    std::unordered_map<std::string, const BenchmarkResult*> previous;
+    for (const auto& result : baseline) {
+        previous[result.key()] = &result;
+    }
+
+    size_t regressions = 0;
+    out << std::left << std::setw(40) << "Benchmark" << std::right
+        << std::setw(14) << "baseline ns" << std::setw(14) << "current ns" << std::setw(10) << "change" << "\n";
+    for (const auto& result : current) {
+        auto it = previous.find(result.key());
+        if (it == previous.end() || it->second->median_ns <= 0.0) continue;
+
+        double change = result.median_ns / it->second->median_ns - 1.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        out << std::left << std::setw(40) << result.key() << std::right << std::fixed
+            << std::setw(14) << std::setprecision(1) << it->second->median_ns
+            << std::setw(14) << result.median_ns
+            << std::setw(9) << std::showpos << std::setprecision(1) << (change * 100.0) << "%"
+            << std::noshowpos << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    out << std::defaultfloat;
+    return regressions;
+}
@@ -0,0 +1,97 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult {
+    std::string name;         // Benchmarked function, e.g. layer_forward
+    std::string params;       // Shape or configuration, e.g. 11x60
+    size_t iterations = 0;    // Operations per timed sample
+    double median_ns = 0.0;   // Per operation
+    double min_ns = 0.0;
+    double max_ns = 0.0;
+
+    std::string key() const { return params.empty() ? name : name + "/" + params; }
+    double ops_per_second() const { return median_ns > 0.0 ? 1e9 / median_ns : 0.0; }
+};
+
+// Keep the compiler from discarding a benchmarked result
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+#endif
+}
+
+// Times a callable in repeated samples. Each sample runs enough iterations to last at
+// least min_sample_seconds, and the median per-operation time is reported.
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(double min_sample_seconds = 0.05, size_t samples = 7, const std::string& filter = "");
+
+    bool selected(const std::string& name, const std::string& params) const;
+
+    template <typename Body>
+    void run(const std::string& name, const std::string& params, Body&& body) {
+        if (!selected(name, params)) return;
+
+        // Calibrate the iteration count with a growing trial run
+        size_t iterations = 1;
+        for (;;) {
+            double seconds = time_iterations(body, iterations);
+            if (seconds >= min_sample_seconds || iterations >= (size_t(1) << 30)) break;
+            double scale = seconds > 0.0 ? min_sample_seconds / seconds : 10.0;
+            iterations = static_cast<size_t>(iterations * std::min(10.0, std::max(1.5, scale * 1.2)));
+        }
+
+        std::vector<double> per_op_ns;
+        for (size_t s = 0; s < samples; s++) {
+            per_op_ns.push_back(time_iterations(body, iterations) * 1e9 / iterations);
+        }
+        add_result(name, params, iterations, per_op_ns);
+    }
+
+    // Record a benchmark timed by the caller (e.g. one that runs for seconds)
+    void add_result(const std::string& name, const std::string& params, size_t iterations,
+                    std::vector<double> per_op_ns);
+
+    const std::vector<BenchmarkResult>& results() const { return benchmark_results; }
+    size_t sample_count() const { return samples; }
+
+    void print_table(std::ostream& out) const;
+
+    // One benchmark object per line so results can be diffed and read back without a JSON library
+    void write_json(std::ostream& out) const;
+    static std::vector<BenchmarkResult> read_json(const std::string& path);
+
+    // Print the change of every benchmark present in both runs. Returns the number of
+    // benchmarks whose median got slower by more than threshold (0.1 = 10%).
+    static size_t compare(const std::vector<BenchmarkResult>& baseline,
+                          const std::vector<BenchmarkResult>& current,
+                          double threshold, std::ostream& out);
+
+private:
+    template <typename Body>
+    static double time_iterations(Body& body, size_t iterations) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double min_sample_seconds;
+    size_t samples;
+    std::string filter;
+    std::vector<BenchmarkResult> benchmark_results;
+};
+
+#endif
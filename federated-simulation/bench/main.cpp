@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "NeuralNetwork/NeuralNetwork.h"
+#include "FeatureExtractor/FeatureExtractor.h"
+#include "DataLoader/DataLoader.h"
+#include "FederatedServer/FederatedServer.h"
+#include "FederatedSimulation/FederatedSimulation.h"
+#include "SyntheticData/SyntheticDataGenerator.h"
+#include "Privacy/PrivateAggregator.h"
+#include "Pruning/Pruner.h"
+#include "Random/Philox.h"
+#include "FixedPointMLP.h"
+#include "SparseMLP.h"
+#include "IncrementalFeatures.h"
+#include "Optimizer/LocalOptimizer.h"
+#include "TransportModel/BleTransportModel.h"
+
+namespace {
+
+// Topologies searched by HyperParameterOptimizer (full grid)
+const std::vector<std::vector<size_t>> HPO_TOPOLOGIES = {
+    {11, 10, 3}, {11, 15, 3}, {11, 20, 3}, {11, 30, 3}, {11, 60, 3}, {11, 40, 20, 3}
+};
+
+constexpr size_t SAMPLES_PER_RECORDING = 256;    // 2.56 s at 100 Hz, as in the example dataset
+constexpr size_t CLIENTS_PER_ROUND = 30;         // Default clients * fraction
+
+std::string topology_name(const std::vector<size_t>& topology) {
+    std::string name;
+    for (size_t i = 0; i < topology.size(); i++) {
+        name += (i ? "-" : "") + std::to_string(topology[i]);
+    }
+    return name;
+}
+
+SyntheticDataConfig synthetic_config(size_t count) {
+    SyntheticDataConfig config;
+    config.samples = count;
+    config.window = SAMPLES_PER_RECORDING;
+    return config;
+}
+
+// A carrying-away window, the class with the most motion spread over the spectrum
+MotionSample synthetic_sample() {
+    SyntheticDataGenerator generator(synthetic_config(64), 1);
+    size_t index = 0;
+    while (index + 1 < generator.size() && generator.label_of(index) != 1) index++;
+    return generator.generate(index);
+}
+
+std::vector<MotionSample> synthetic_dataset(size_t count) {
+    SyntheticDataGenerator generator(synthetic_config(count), 1);
+    std::vector<MotionSample> dataset(count);
+    for (size_t i = 0; i < count; i++) {
+        generator.generate(i, dataset[i]);
+    }
+    return dataset;
+}
+
+void bench_layer_forward(BenchmarkRunner& runner) {
+    std::vector<std::pair<size_t, size_t>> shapes;
+    for (const auto& topology : HPO_TOPOLOGIES) {
+        for (size_t i = 0; i + 1 < topology.size(); i++) {
+            std::pair<size_t, size_t> shape(topology[i], topology[i + 1]);
+            if (std::find(shapes.begin(), shapes.end(), shape) == shapes.end()) {
+                shapes.push_back(shape);
+            }
+        }
+    }
+
+    for (const auto& shape : shapes) {
+        CounterRng rng(42, RngPurpose::WEIGHT_INIT);
+        std::vector<float> parameters;
+        Layer layer(shape.first, shape.second, rng, parameters);
+        std::vector<float> inputs(shape.first, 0.5f);
+        runner.run("layer_forward", std::to_string(shape.first) + "x" + std::to_string(shape.second),
+                   [&] { do_not_optimize(layer.forward(parameters.data(), inputs)); });
+    }
+}
+
+void bench_network(BenchmarkRunner& runner) {
+    for (const auto& topology : HPO_TOPOLOGIES) {
+        NeuralNetwork network(topology, 42);
+        std::vector<float> inputs(topology.front(), 0.5f);
+        std::vector<float> targets(topology.back(), 0.0f);
+        targets[0] = 1.0f;
+
+        runner.run("network_forward", topology_name(topology),
+                   [&] { do_not_optimize(network.forward(inputs)); });
+        runner.run("network_train", topology_name(topology),
+                   [&] { network.train(inputs, targets, 0.01f); });
+
+        // The same topology on the int8/Q15 engine shared with the firmware
+        std::vector<unsigned int> sizes(topology.begin(), topology.end());
+        FixedPointMLP fixed;
+        fixed.init(sizes.data(), static_cast<unsigned int>(sizes.size()), 42);
+        std::vector<float> weights = network.get_flat_weights();
+        fixed.setParameters(weights.data(), weights.size());
+        std::vector<float> outputs(topology.back());
+        runner.run("fixed_forward", topology_name(topology),
+                   [&] { fixed.predict(inputs.data(), outputs.data()); do_not_optimize(outputs); });
+        runner.run("fixed_train", topology_name(topology),
+                   [&] { fixed.train(inputs.data(), targets.data(), 0.01f); });
+
+        // Three quarters of each layer's weights pruned: compressed rows over the float
+        // arena, and the firmware's sparse-row engine
+        PruningConfig pruning;
+        pruning.mode = PruningMode::UNSTRUCTURED;
+        pruning.sparsity = 0.75f;
+        pruning.start_round = 1;
+        pruning.ramp_rounds = 1;
+        Pruner pruner(pruning, topology);
+        pruner.update(1, weights);
+        NeuralNetwork pruned(topology, 42);
+        pruned.set_mask(pruner.mask());
+        runner.run("network_forward", topology_name(topology) + "/pruned75",
+                   [&] { do_not_optimize(pruned.forward(inputs)); });
+        runner.run("network_train", topology_name(topology) + "/pruned75",
+                   [&] { pruned.train(inputs, targets, 0.01f); });
+
+        SparseMLP sparse;
+        std::vector<uint8_t> bitmap = pruner.weight_bitmap();
+        if (sparse.init(sizes.data(), static_cast<unsigned int>(sizes.size())) &&
+            sparse.setMask(bitmap.data(), sparse.weightCount()) &&
+            sparse.setParameters(weights.data(), weights.size())) {
+            runner.run("sparse_forward", topology_name(topology) + "/pruned75",
+                       [&] { sparse.predict(inputs.data(), outputs.data()); do_not_optimize(outputs); });
+            runner.run("sparse_train", topology_name(topology) + "/pruned75",
+                       [&] { sparse.train(inputs.data(), targets.data(), 0.01f); });
+        }
+    }
+
+    // Hidden activations with the softmax cross-entropy head on the default topology
+    const std::vector<size_t> topology = {11, 15, 3};
+    for (Activation hidden : {Activation::SIGMOID, Activation::RELU, Activation::TANH}) {
+        NeuralNetwork network(topology, 42, 0, {hidden, Activation::SOFTMAX});
+        std::vector<float> inputs(topology.front(), 0.5f);
+        std::vector<float> targets(topology.back(), 0.0f);
+        targets[0] = 1.0f;
+        runner.run("network_train", topology_name(topology) + "/" + NeuralNetwork::activation_name(hidden) + "-softmax",
+                   [&] { network.train(inputs, targets, 0.01f); });
+    }
+
+    // Local optimizers: backpropagation into a gradient buffer plus the update rule
+    for (OptimizerType type : {OptimizerType::SGD, OptimizerType::MOMENTUM, OptimizerType::ADAM}) {
+        NeuralNetwork network(topology, 42);
+        OptimizerConfig config;
+        config.type = type;
+        config.proximal_mu = 0.01f;
+        LocalOptimizer optimizer(config, network.parameter_count());
+        std::vector<float> global = network.get_flat_weights();
+        std::vector<float> gradients;
+        std::vector<float> inputs(topology.front(), 0.5f);
+        std::vector<float> targets(topology.back(), 0.0f);
+        targets[0] = 1.0f;
+        runner.run("local_step", topology_name(topology) + "/" + LocalOptimizer::type_name(type) + "-prox", [&] {
+            network.compute_gradients(inputs, targets, gradients);
+            optimizer.step(network.parameter_data(), gradients.data(), global.data(), 0.01f);
+        });
+    }
+}
+
+void bench_synthetic_generation(BenchmarkRunner& runner) {
+    SyntheticDataGenerator generator(synthetic_config(1 << 20), CLIENTS_PER_ROUND);
+    MotionSample sample;
+    size_t index = 0;
+    runner.run("synthetic_window", std::to_string(SAMPLES_PER_RECORDING), [&] {
+        generator.generate(index, sample);
+        index = (index + 1) % generator.size();
+        do_not_optimize(sample.acc_x.data());
+    });
+}
+
+void bench_feature_extraction(BenchmarkRunner& runner) {
+    MotionSample sample = synthetic_sample();
+    FeatureExtractor extractor;
+    runner.run("extract_features", std::to_string(SAMPLES_PER_RECORDING),
+               [&] { do_not_optimize(extractor.extract_features(sample)); });
+
+    // The firmware's sample-by-sample engine at 50% overlap; a window completes every 128
+    // pushes, so this includes its share of the per-window magnitudes
+    const float bands[] = {0, 6, 12, 19, 25, 31, 37, 44, 50};
+    IncrementalFeatures incremental;
+    incremental.init(SAMPLES_PER_RECORDING, SAMPLES_PER_RECORDING / 2, 100.0f, bands, 8);
+    size_t position = 0;
+    runner.run("incremental_features", std::to_string(SAMPLES_PER_RECORDING) + "/sample", [&] {
+        do_not_optimize(incremental.push(sample.acc_x[position]));
+        position = (position + 1) % sample.acc_x.size();
+    });
+}
+
+void bench_load_motion_file(BenchmarkRunner& runner) {
+    if (!runner.selected("load_motion_file", std::to_string(SAMPLES_PER_RECORDING))) return;
+
+    // A recording in the data collection server's CSV format
+    namespace fs = std::filesystem;
+    fs::path base = fs::temp_directory_path() / "smartbikelock_bench";
+    fs::create_directories(base / "motion_data");
+    {
+        MotionSample sample = synthetic_sample();
+        std::ofstream file(base / "motion_data" / "recording_bench.csv");
+        file << "timestamp_ms,acc_x,acc_y,acc_z\n";
+        for (size_t i = 0; i < sample.acc_x.size(); i++) {
+            file << i * 10 << "," << sample.acc_x[i] << "," << sample.acc_y[i] << "," << sample.acc_z[i] << "\n";
+        }
+    }
+
+    DataLoader loader(base.string());
+    runner.run("load_motion_file", std::to_string(SAMPLES_PER_RECORDING), [&] {
+        do_not_optimize(loader.load_motion_file("recording_bench.csv", 0, "bench", 1));
+    });
+    fs::remove_all(base);
+}
+
+void bench_average_weights(BenchmarkRunner& runner) {
+    for (const auto& topology : HPO_TOPOLOGIES) {
+        size_t weight_count = NeuralNetwork(topology, 42).get_flat_weights().size();
+        std::vector<std::vector<float>> client_weights(CLIENTS_PER_ROUND, std::vector<float>(weight_count));
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        for (auto& weights : client_weights) {
+            for (auto& w : weights) w = value(rng);
+        }
+
+        FederatedServer server(42);
+        runner.run("average_weights", topology_name(topology) + "/" + std::to_string(CLIENTS_PER_ROUND),
+                   [&] { do_not_optimize(server.average_weights(client_weights)); });
+    }
+}
+
+// One local epoch over a full replay buffer of the default client
+void bench_replay_epoch(BenchmarkRunner& runner) {
+    const std::vector<size_t> topology = {11, 15, 3};
+    const size_t capacity = 64;
+    FederatedClient client(topology, nullptr, 42, 0);
+    client.set_replay_capacity(capacity);
+    std::vector<float> features(topology.front());
+    std::vector<float> target(topology.back(), 0.0f);
+    for (size_t i = 0; i < capacity; i++) {
+        for (size_t f = 0; f < features.size(); f++) features[f] = static_cast<float>((i * 7 + f) % 13) / 13.0f;
+        std::fill(target.begin(), target.end(), 0.0f);
+        target[i % target.size()] = 1.0f;
+        client.train_on_sample(features, target, 0.01f);
+    }
+    runner.run("replay_epoch", topology_name(topology) + "/" + std::to_string(capacity),
+               [&] { client.train_on_replay(1, 0.01f); });
+}
+
+void bench_philox_normal(BenchmarkRunner& runner) {
+    std::vector<float> noise(1024);
+    Philox stream(42);
+    uint64_t block = 0;
+    runner.run("philox_normal", std::to_string(noise.size()), [&] {
+        stream.fill_normal(noise.data(), noise.size(), block);
+        block += noise.size() / 4;
+        do_not_optimize(noise.data());
+    });
+}
+
+// Cost of streaming one client update through clipping and masking in a very large round,
+// so per-round cost is this times the number of participants
+void bench_private_update(BenchmarkRunner& runner) {
+    constexpr size_t PARTICIPANTS = 100000;
+    const std::vector<size_t> topology = {11, 15, 3};
+    size_t weight_count = NeuralNetwork(topology, 42).get_flat_weights().size();
+    std::vector<size_t> participants(PARTICIPANTS);
+    for (size_t i = 0; i < PARTICIPANTS; i++) participants[i] = i;
+
+    std::vector<float> update(weight_count);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> value(0.0f, 0.05f);
+    for (auto& u : update) u = value(rng);
+
+    for (bool secure : {false, true}) {
+        PrivacyConfig config;
+        config.clip_norm = 1.0f;
+        config.noise_multiplier = 1.0f;
+        config.secure_aggregation = secure;
+        PrivateAggregator aggregator(config, 42);
+        uint64_t round = 0;
+        size_t position = PARTICIPANTS;
+        runner.run("private_update", topology_name(topology) + (secure ? "/secagg/" : "/clip/") +
+                   std::to_string(PARTICIPANTS), [&] {
+            if (position == PARTICIPANTS) {
+                if (round > 0) do_not_optimize(aggregator.finish_round().data());
+                aggregator.begin_round(++round, participants, weight_count);
+                position = 0;
+            }
+            aggregator.add_update(position++, update.data());
+        });
+    }
+}
+
+// Simulated weight uploads of the default topology. The pipelined model runs the firmware's
+// TransferSender and TransferReceiver frame by frame, so this tracks their cost per transfer.
+void bench_ble_transfer(BenchmarkRunner& runner) {
+    const size_t payload_bytes = NeuralNetwork({11, 15, 3}, 42).parameter_count() * sizeof(float);
+    for (float loss : {0.0f, 0.05f}) {
+        BleTransportConfig config;
+        config.protocol = BleProtocol::PIPELINED;
+        config.frame_loss = loss;
+        BleTransportModel model(config);
+        runner.run("ble_transfer", "pipelined/" + std::to_string(payload_bytes) +
+                   (loss > 0.0f ? "/loss5" : ""), [&] {
+            do_not_optimize(model.upload_cost(payload_bytes).seconds);
+        });
+    }
+}
+
+// Complete run_simulation calls on a synthetic dataset with the default configuration.
+// Reported per round, with dataset preparation and the final evaluation spread over the
+// rounds, so results are only comparable for the same round count.
+void bench_simulation(BenchmarkRunner& runner, int rounds, bool async_mode) {
+    const std::string params = std::string(async_mode ? "async" : "sync") + "/11-15-3/" +
+                               std::to_string(rounds);
+    if (!runner.selected("simulation_round", params)) return;
+
+    auto dataset = synthetic_dataset(340);
+    std::string metrics_path = (std::filesystem::temp_directory_path() / "smartbikelock_bench_metrics.csv").string();
+
+    auto run = [&](int fl_rounds) {
+        FederatedSimulation simulation("", 42);
+        simulation.set_dataset(dataset);
+        simulation.set_fl_rounds(fl_rounds);
+        simulation.set_metrics_file(metrics_path);
+        simulation.set_async_mode(async_mode);
+
+        // Keep console output out of the measurement
+        std::ostringstream discard;
+        std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+        auto start = std::chrono::steady_clock::now();
+        try {
+            simulation.run_simulation();
+        } catch (...) {
+            std::cout.rdbuf(console);
+            throw;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout.rdbuf(console);
+        return seconds;
+    };
+
+    std::vector<double> per_round_ns;
+    for (size_t s = 0; s < runner.sample_count(); s++) {
+        per_round_ns.push_back(run(rounds) * 1e9 / rounds);
+    }
+    std::filesystem::remove(metrics_path);
+    runner.add_result("simulation_round", params, static_cast<size_t>(rounds), per_round_ns);
+}
+
+void printUsage() {
+    std::cout << "Usage: SmartBikeLockBench [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --filter <text>       Run only benchmarks whose name/params contain text\n";
+    std::cout << "  --json <file>         Write results as JSON\n";
+    std::cout << "  --compare <file>      Compare with a previous JSON result and flag regressions\n";
+    std::cout << "  --threshold <f>       Relative slowdown reported as a regression (default: 0.10)\n";
+    std::cout << "  --samples <N>         Timed samples per benchmark (default: 7)\n";
+    std::cout << "  --min-time <s>        Minimum duration of one sample (default: 0.05)\n";
+    std::cout << "  --rounds <N>          Rounds per end-to-end simulation run (default: 40)\n";
+    std::cout << "  --help                Display this help message\n";
+}
+
+bool getCmdOption(const std::vector<std::string>& args, const std::string& option, std::string& value) {
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == option) {
+            value = args[i + 1];
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (std::find(args.begin(), args.end(), "--help") != args.end()) {
+        printUsage();
+        return 0;
+    }
+
+    std::string filter;
+    std::string json_path;
+    std::string baseline_path;
+    double threshold = 0.10;
+    size_t samples = 7;
+    double min_time = 0.05;
+    int rounds = 40;
+
+    try {
+        std::string value;
+        if (getCmdOption(args, "--filter", value)) filter = value;
+        if (getCmdOption(args, "--json", value)) json_path = value;
+        if (getCmdOption(args, "--compare", value)) baseline_path = value;
+        if (getCmdOption(args, "--threshold", value)) threshold = std::stod(value);
+        if (getCmdOption(args, "--samples", value)) samples = std::stoul(value);
+        if (getCmdOption(args, "--min-time", value)) min_time = std::stod(value);
+        if (getCmdOption(args, "--rounds", value)) rounds = std::stoi(value);
+        if (rounds < 1) {
+            throw std::runtime_error("--rounds must be positive");
+        }
+
+        BenchmarkRunner runner(min_time, samples, filter);
+        std::cerr << "Running benchmarks (" << samples << " samples each)\n";
+        bench_layer_forward(runner);
+        bench_network(runner);
+        bench_synthetic_generation(runner);
+        bench_feature_extraction(runner);
+        bench_load_motion_file(runner);
+        bench_average_weights(runner);
+        bench_replay_epoch(runner);
+        bench_philox_normal(runner);
+        bench_private_update(runner);
+        bench_ble_transfer(runner);
+        bench_simulation(runner, rounds, false);
+        bench_simulation(runner, rounds, true);
+
+        std::cout << "\n";
+        runner.print_table(std::cout);
+
+        if (!json_path.empty()) {
+            std::ofstream json(json_path);
+            runner.write_json(json);
+            std::cout << "\nResults written to " << json_path << "\n";
+        }
+
+        if (!baseline_path.empty()) {
+            std::cout << "\nComparison with " << baseline_path << " (threshold "
+                      << (threshold * 100.0) << "%):\n";
+            size_t regressions = BenchmarkRunner::compare(BenchmarkRunner::read_json(baseline_path),
+                                                          runner.results(), threshold, std::cout);
+            if (regressions > 0) {
+                std::cout << regressions << " benchmark(s) regressed\n";
+                return 2;
+            }
+            std::cout << "No regressions\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@ struct MotionSample {
     std::string timestamp;
     int label;
     std::string filename;
+    std::string group;          // Value of the group column of the metadata, if one is set
     std::vector<float> acc_x;
     std::vector<float> acc_y;
     std::vector<float> acc_z;
@@ -18,6 +19,12 @@ struct MotionSample {
 class DataLoader {
 public:
     DataLoader(const std::string& base_path);
+
+    // Copy the first prefix characters (0 = all) of this metadata column into MotionSample::group
+    void set_group_column(const std::string& column, size_t prefix = 0) {
+        group_column = column;
+        group_prefix = prefix;
+    }
     
     // Load all data
     std::vector<MotionSample> load_dataset(const std::string& metadata_file);
@@ -32,6 +39,8 @@ public:
 private:
     std::string base_path;
     std::string motion_data_path;
+    std::string group_column;
+    size_t group_prefix = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef DATA_PARTITIONER_H
+#define DATA_PARTITIONER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How training samples are divided among clients
+enum class PartitionScheme {
+    SHARED,      // Every client draws from the whole training set (IID, overlapping)
+    IID,         // Disjoint, equally sized random shards
+    DIRICHLET,   // Label skew: each class is split over clients by Dirichlet(alpha) proportions
+    QUANTITY,    // Quantity skew: client sizes follow Dirichlet(alpha), labels stay IID
+    SHARDS       // One device per metadata group (e.g. recording day); groups are split or combined
+};
+
+struct PartitionConfig {
+    PartitionScheme scheme = PartitionScheme::SHARED;
+    float alpha = 0.5f;                       // Smaller values give more skewed partitions
+    std::string shard_column = "timestamp";   // Metadata column that identifies the device
+    size_t shard_prefix = 10;                 // Leading characters of the value used as key (0 = all)
+};
+
+// Training sample indices held by every client, in compressed sparse row form: client c
+// holds indices[offsets[c]] .. indices[offsets[c + 1] - 1]. Partitions are disjoint and
+// every client holds at least one sample.
+class ClientPartition {
+public:
+    ClientPartition() = default;
+
+    // labels and groups are per training sample; groups are only used by SHARDS
+    static ClientPartition build(const PartitionConfig& config,
+                                 const std::vector<int>& labels,
+                                 const std::vector<int>& groups,
+                                 size_t num_clients,
+                                 uint32_t seed);
+
+    // Partition given by an owning client per sample (e.g. synthetic data)
+    static ClientPartition from_owners(const std::vector<uint32_t>& owners, size_t num_clients);
+
+    bool empty() const { return offsets.empty(); }
+    size_t num_clients() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t size(size_t client) const { return offsets[client + 1] - offsets[client]; }
+    const uint32_t* begin(size_t client) const { return indices.data() + offsets[client]; }
+    const uint32_t* end(size_t client) const { return indices.data() + offsets[client + 1]; }
+
+    // Samples per client (min/median/max) and the mean number of classes per client
+    std::string summary(const std::vector<int>& labels, size_t num_classes) const;
+
+    static PartitionScheme parse_scheme(const std::string& name);
+    static const char* scheme_name(PartitionScheme scheme);
+
+private:
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> indices;
+};
+
+#endif
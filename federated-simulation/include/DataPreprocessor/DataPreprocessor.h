@@ -1,14 +1,21 @@
 #ifndef DATA_PREPROCESSOR_H
 #define DATA_PREPROCESSOR_H
 
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
-#include <random>
 #include "DataLoader/DataLoader.h"
+#include "DataPartitioner/DataPartitioner.h"
 #include "FeatureExtractor/FeatureExtractor.h"
+#include "Random/CounterRng.h"
 
 struct TrainingSample {
     std::vector<float> features;
     std::vector<float> target;  // One-hot encoded target
+    int label = 0;              // Class index of the target
+    int client = -1;            // Client holding this sample, -1 when shared by all
+    int group = -1;             // Device or session of the recording (MotionSample::group), -1 if unknown
 };
 
 class DataPreprocessor {
@@ -17,6 +24,24 @@ public:
     explicit DataPreprocessor(uint32_t base_seed = 42);  // Base seed for reproducibility
     // Process all samples and prepare for training
     void prepare_dataset(const std::vector<MotionSample>& samples);
+
+    // Fills sample with sample index and returns the client holding it (-1 for shared)
+    using SampleSource = std::function<int(size_t index, MotionSample& sample)>;
+    // Like prepare_dataset for count samples produced one at a time, so only features are
+    // kept. Without a partition, clients then draw only from the training samples they hold.
+    void prepare_stream(size_t count, const SampleSource& source);
+
+    // Divide the training set among num_clients clients; set before preparing the dataset
+    void set_partition(const PartitionConfig& config, size_t num_clients) {
+        partition_config = config;
+        partition_clients = num_clients;
+    }
+    const ClientPartition& get_partition() const { return partition; }
+    std::string partition_summary() const;
+
+    // Number of classes in the one-hot targets; set before prepare_dataset
+    void set_num_classes(size_t classes) { num_classes = classes; }
+    size_t get_num_classes() const { return num_classes; }
     TrainingSample get_next_training_sample(size_t client_id);
     void reset_sampling();
     
@@ -34,18 +59,25 @@ private:
     
     float feature_min;
     float feature_max;
+    size_t num_classes = 3;
     
     FeatureExtractor feature_extractor;
-    std::mt19937 rng;
     
     // Helper methods
     std::vector<float> create_one_hot_encoding(int label);
+    TrainingSample make_training_sample(const MotionSample& sample, int client);
+    void finish_dataset(std::vector<TrainingSample>& all_samples);
+    void build_partition();
     void normalize_features(std::vector<float>& features);
     void split_train_test(std::vector<TrainingSample>& all_samples, float test_ratio = 0.2);
     uint32_t base_seed;  // Store base seed for reset functionality
-    std::unordered_map<size_t, std::mt19937> client_rngs;  // RNG per client
+    std::unordered_map<size_t, CounterRng> client_rngs;  // Sample order stream per client
     std::unordered_map<size_t, std::vector<size_t>> client_shuffled_indices;  // Indices per client
     std::unordered_map<size_t, size_t> client_current_indices;  // Current position per client
+    PartitionConfig partition_config;
+    size_t partition_clients = 0;
+    ClientPartition partition;  // Training samples held by each client; empty when all are shared
+    std::unordered_map<std::string, int> group_ids;
 };
 
 
@@ -0,0 +1,71 @@
+#ifndef DEVICE_MODEL_H
+#define DEVICE_MODEL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Per-window averages printed by federated-client/TimingBenchmark.h, in microseconds.
+// Defaults are for an Arduino Nano 33 BLE Sense (64 MHz Cortex-M4F) running NNConfig::LAYERS.
+struct DeviceTimings {
+    float data_collection_us = 2560000.0f;   // 256 samples at 100 Hz, paced by the sensor
+    float feature_extraction_us = 12000.0f;  // 256-point FFT, bands and statistics
+    float inference_us = 250.0f;
+    float training_us = 800.0f;              // One forward and backward pass
+    std::vector<size_t> topology = {11, 60, 3};   // Network the benchmark ran
+
+    // Read the serial output of measureInferenceLatency()/measureTrainingTime(); values
+    // missing from the log keep their defaults
+    static DeviceTimings from_benchmark_log(const std::string& path);
+};
+
+struct DeviceConfig {
+    DeviceTimings reference;
+    float speed_spread = 0.3f;          // Lognormal sigma of the per-device compute speed
+    float battery_joules = 100.0f;      // Mean energy a device may spend on training (0 = unlimited)
+    float active_power_mw = 20.0f;      // MCU and IMU while collecting and training
+    float radio_power_mw = 25.0f;       // While exchanging weights over BLE
+    float online_fraction = 0.75f;      // Share of the day a device is in reach of the server
+    float day_seconds = 86400.0f;       // Period of the availability window
+};
+
+struct DeviceProfile {
+    double flops_per_second;            // Training throughput; a multiply-add counts as two FLOPs
+    double feature_extraction_seconds;
+    double battery_joules;              // Remaining budget
+    double online_start_seconds;        // Offset of the daily online window
+};
+
+// Heterogeneous fleet calibrated from on-device measurements: compute speed, a battery
+// budget and a daily availability window per device
+class DeviceModel {
+public:
+    DeviceModel(const DeviceConfig& config, size_t num_clients, uint32_t seed = 42);
+
+    const DeviceProfile& profile(size_t client_id) const { return profiles[client_id]; }
+
+    // Time to collect, process and train on samples windows with this network, plus training
+    // on replayed windows from the replay buffer
+    double compute_seconds(size_t client_id, size_t samples, const std::vector<size_t>& topology,
+                           size_t replayed = 0) const;
+
+    // In its online window with battery left at time (seconds since the start)
+    bool available(size_t client_id, double time) const;
+    // Earliest time from time on at which some device with battery is online (infinity if none)
+    double next_available(double time) const;
+
+    // Spend the energy of one participation
+    void consume(size_t client_id, double compute_seconds, double transfer_seconds);
+    size_t depleted_count() const;
+
+    // FLOPs of one training step: forward pass plus a backward pass twice as expensive
+    static double training_flops(const std::vector<size_t>& topology);
+
+private:
+    bool has_battery(size_t client_id) const;
+
+    DeviceConfig config;
+    std::vector<DeviceProfile> profiles;
+};
+
+#endif
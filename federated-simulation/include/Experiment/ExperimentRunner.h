@@ -0,0 +1,103 @@
+#ifndef EXPERIMENT_RUNNER_H
+#define EXPERIMENT_RUNNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Experiment/JsonValue.h"
+#include "FederatedSimulation/FederatedSimulation.h"
+
+// One configuration of an experiment: the command line options every seed runs with
+struct ExperimentConfig {
+    std::string label;               // The values that vary, e.g. "lr=0.3, topology=11,30,3"
+    std::vector<std::string> args;   // Options as on the command line, without --seed
+
+    // args joined by spaces; identifies the configuration in the results file
+    std::string options() const;
+};
+
+// Sweep read from a JSON spec. Option names are those of the command line without the
+// leading "--"; true adds a flag, false or null leaves an option out, arrays are joined
+// with commas.
+//   {
+//     "base":    {"rounds": 200, "data-path": "data"},          options of every run
+//     "configs": [{"prune": "none"}, {"prune": "structured"}],   optional alternatives
+//     "sweep":   {"lr": [0.3, 0.75], "topology": ["11,15,3", [11,30,3]]},
+//     "seeds":   5,                  or a list; a count runs seeds 42, 43, ...
+//     "jobs":    4,                  runs at once (default: hardware threads)
+//     "results": "experiment_results.json",
+//     "metrics-dir": "runs"          per-run metrics files (default: none)
+//   }
+// The configurations are every entry of "configs" combined with every combination of the
+// "sweep" values; later sources override earlier ones.
+struct ExperimentSpec {
+    static constexpr uint32_t FIRST_SEED = 42;
+
+    std::vector<ExperimentConfig> configs;
+    std::vector<uint32_t> seeds;
+    size_t jobs = 0;                 // 0 = hardware threads
+    std::string results_path = "experiment_results.json";
+    std::string metrics_dir;
+
+    static ExperimentSpec from_json(const JsonValue& spec);
+    static ExperimentSpec load(const std::string& path);
+};
+
+// Mean and sample standard deviation of one result over the seeds of a configuration
+struct ResultStatistic {
+    size_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+
+    static ResultStatistic of(const std::vector<double>& values);
+};
+
+// Runs every configuration of a spec with every seed on a pool of worker threads. Datasets
+// are loaded once and shared by the runs that read them. The results file is rewritten
+// after each run, so an interrupted batch resumes where it stopped: runs already in the
+// file (same options and seed) are not repeated.
+class ExperimentRunner {
+public:
+    // Builds a configured simulation from command line options, as the executable parses them
+    using SimulationFactory =
+        std::function<std::unique_ptr<FederatedSimulation>(const std::vector<std::string>& args)>;
+
+    ExperimentRunner(ExperimentSpec spec, SimulationFactory factory);
+
+    void set_jobs(size_t jobs) { spec.jobs = jobs; }
+    void set_results_path(const std::string& path) { spec.results_path = path; }
+
+    // Run the missing runs and write the results; returns the number of runs that failed
+    size_t run();
+
+private:
+    struct RunRecord {
+        std::string options;
+        uint32_t seed = 0;
+        SimulationResult result;
+        double wall_seconds = 0.0;
+    };
+
+    struct PendingRun {
+        size_t config;
+        uint32_t seed;
+        std::unique_ptr<FederatedSimulation> simulation;
+    };
+
+    void load_results();
+    void write_results() const;
+    void print_summary() const;
+    bool completed(const std::string& options, uint32_t seed) const;
+    std::vector<const RunRecord*> records_of(const ExperimentConfig& config) const;
+
+    ExperimentSpec spec;
+    SimulationFactory factory;
+    std::vector<RunRecord> records;     // Completed runs, including ones resumed from the file
+    mutable std::mutex records_mutex;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef JSON_VALUE_H
+#define JSON_VALUE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Parsed JSON document, enough for experiment specs and their results files. Numbers keep
+// the text they were written with, so "0.75" turns back into the option value "0.75".
+// Object members keep their document order.
+class JsonValue {
+public:
+    enum class Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    // Throws std::runtime_error with the offset of the first error
+    static JsonValue parse(const std::string& text);
+    static JsonValue parse_file(const std::string& path);
+
+    Type type() const { return value_type; }
+    bool is_null() const { return value_type == Type::NUL; }
+    bool is_number() const { return value_type == Type::NUMBER; }
+    bool is_string() const { return value_type == Type::STRING; }
+    bool is_array() const { return value_type == Type::ARRAY; }
+    bool is_object() const { return value_type == Type::OBJECT; }
+
+    // Throw std::runtime_error if the value has another type
+    bool as_bool() const;
+    double as_number() const;
+    const std::string& as_string() const;
+    const std::vector<JsonValue>& items() const;
+    const std::vector<std::pair<std::string, JsonValue>>& members() const;
+
+    // Number or string as written, "true"/"false" for booleans
+    std::string text() const;
+    // Member of an object, nullptr if absent
+    const JsonValue* find(const std::string& key) const;
+
+    // Quoted and escaped JSON string
+    static std::string quote(const std::string& text);
+
+private:
+    class Parser;
+
+    Type value_type = Type::NUL;
+    bool boolean = false;
+    std::string scalar;       // Text of a number, contents of a string
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> fields;
+};
+
+#endif
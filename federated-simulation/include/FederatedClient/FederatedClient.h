@@ -3,32 +3,105 @@
 
 #include "NeuralNetwork/NeuralNetwork.h"
 #include "DataPreprocessor/DataPreprocessor.h"
+#include "WeightCodec.h"
+#include "SparseDelta.h"
+#include "FixedPointMLP.h"
+#include "SparseMLP.h"
+#include "ReplayBuffer.h"
+#include "Optimizer/LocalOptimizer.h"
 #include <memory>
-#include <random>
+#include <string>
+
+// Bytes a client needs for local training, as it would allocate them on the device
+struct ClientMemory {
+    size_t model = 0;            // Parameters and activation buffers
+    size_t gradients = 0;        // Per-sample parameter gradients (optimizers other than plain SGD)
+    size_t optimizer_state = 0;  // Momentum or Adam moments
+    size_t global_copy = 0;      // Received global model (FedProx anchor, delta uploads)
+    size_t replay = 0;           // Replay buffer of recent windows
+
+    size_t total() const { return model + gradients + optimizer_state + global_copy + replay; }
+};
+
+// Arithmetic used for local training and inference
+enum class ModelBackend {
+    FLOAT32,      // NeuralNetwork
+    FIXED_POINT,  // FixedPointMLP, the integer engine of the firmware
+    SPARSE        // SparseMLP, the compressed sparse row engine of the firmware
+};
 
 class FederatedClient {
 public:
-    // Initialize with network topology and preprocessor
-    FederatedClient(const std::vector<size_t>& topology, std::shared_ptr<DataPreprocessor> preprocessor, uint32_t seed);
+    // Initialize with network topology and preprocessor; random streams are keyed by (seed, client_id).
+    // activations as for NeuralNetwork; the fixed-point and sparse backends support sigmoid
+    // layers and plain SGD only.
+    FederatedClient(const std::vector<size_t>& topology, std::shared_ptr<DataPreprocessor> preprocessor,
+                    uint32_t seed, uint32_t client_id, ModelBackend backend = ModelBackend::FLOAT32,
+                    const std::vector<Activation>& activations = {},
+                    const OptimizerConfig& optimizer_config = OptimizerConfig());
     
-    // Core FL operations
+    // Core FL operations. With a replay buffer, trained samples are also kept in it.
     void train_on_sample(const std::vector<float>& features, 
                         const std::vector<float>& target,
                         float learning_rate);
+
+    // Keep the last capacity training samples for local epochs
+    void set_replay_capacity(size_t capacity);
+    // Further passes over the replay buffer, each in a new random order
+    void train_on_replay(size_t epochs, float learning_rate);
+    size_t replay_size() const { return replay.size(); }
     std::vector<float> get_weights() const;
     void set_weights(const std::vector<float>& weights);
+
+    // Pruning mask decided by the server (see NeuralNetwork::set_mask); pruned weights stay
+    // zero through set_weights() and training. Not supported by the fixed-point backend.
+    void set_mask(const std::vector<uint8_t>& mask);
+
+    // Compressed upload of the change since the last received global model.
+    // The quantization error is kept and added to the next upload (error feedback).
+    std::vector<uint8_t> get_encoded_update(WeightCodec::Format format, WeightCodec::Rounding rounding);
+
+    // Sparse upload of the k largest-magnitude changes since the last received global model.
+    // Changes that are not sent accumulate locally until they are large enough to be selected.
+    std::vector<uint8_t> get_sparse_update(size_t k);
     
     // Inference
     std::vector<float> predict(const std::vector<float>& features);
     
-    // Access to neural network for evaluation
+    // Access to neural network for evaluation (float backend only)
     const NeuralNetwork& get_network() const { return network; }
     NeuralNetwork& get_network() { return network; }
 
+    // with_global_copy: count the received model, which delta uploads keep on the device
+    ClientMemory memory_usage(bool with_global_copy) const;
+
+    ModelBackend get_backend() const { return backend; }
+    static ModelBackend parse_backend(const std::string& name);
+    static std::string backend_name(ModelBackend backend);
+
 private:
     NeuralNetwork network;
+    std::vector<size_t> topology;
+    ModelBackend backend;
+    FixedPointMLP fixed_network;  // Starts from the weights of network
+    SparseMLP sparse_network;     // Likewise
     std::shared_ptr<DataPreprocessor> preprocessor;
-    std::mt19937 rng;
+    LocalOptimizer optimizer;
+    std::vector<float> gradients;         // Parameter gradients of the current sample
+    bool has_global = false;              // A global model was received
+
+    std::vector<float> received_weights;  // Global model the local update is relative to
+    std::vector<float> upload_residual;   // Error-feedback residual of previous uploads (quantized or sparse)
+    uint32_t codec_rng_state;             // Stochastic rounding state
+
+    void train_step(const std::vector<float>& features, const std::vector<float>& target, float learning_rate);
+
+    uint32_t seed;
+    uint32_t client_id;
+    ReplayBuffer replay;
+    uint64_t replay_epochs = 0;           // Replay epochs so far, the round of the order stream
+    std::vector<float> replay_features;
+    std::vector<float> replay_target;
 };
 
 #endif
\ No newline at end of file
@@ -3,7 +3,15 @@
 
 #include <vector>
 #include <memory>
-#include <random>
+#include <cstdint>
+#include "WeightCodec.h"
+#include "SparseDelta.h"
+
+// Client update waiting in the server buffer for asynchronous aggregation
+struct BufferedUpdate {
+    std::vector<float> delta;   // Local weights minus the global weights the client started from
+    size_t staleness;           // Global model versions published since the client was dispatched
+};
 
 class FederatedServer {
 public:
@@ -11,11 +19,50 @@ public:
     // FedAvg implementation
     std::vector<float> average_weights(const std::vector<std::vector<float>>& client_weights);
     std::vector<size_t> select_clients(size_t total_clients, float client_fraction);
+
+    // FedBuff implementation: apply the staleness-weighted mean of buffered deltas
+    std::vector<float> aggregate_buffered(const std::vector<float>& global_weights,
+                                          const std::vector<BufferedUpdate>& updates,
+                                          float server_learning_rate = 1.0f);
+    static float staleness_weight(size_t staleness);
+
+    // Quantized weight exchange: the broadcast is encoded as the change since the previous
+    // broadcast, with the server's quantization error fed back into the next one
+    std::vector<uint8_t> encode_broadcast(const std::vector<float>& weights,
+                                          WeightCodec::Format format,
+                                          WeightCodec::Rounding rounding);
+    // Weights clients hold after decoding the last broadcast
+    const std::vector<float>& get_broadcast_weights() const { return broadcast_weights; }
+    static std::vector<float> decode_delta(const std::vector<uint8_t>& payload, size_t expected_size);
+    static std::vector<float> decode_update(const std::vector<uint8_t>& payload,
+                                            const std::vector<float>& reference);
+
+    // Sparse FedAvg: add the mean of the clients' top-k deltas to the global model.
+    // Coordinates a client did not send count as an unchanged weight for that client.
+    std::vector<float> apply_sparse_deltas(const std::vector<float>& global_weights,
+                                           const std::vector<std::vector<uint8_t>>& payloads);
+    static std::vector<float> decode_sparse_delta(const std::vector<uint8_t>& payload, size_t expected_size);
+
+    // Pick up to count clients uniformly at random from the given candidates
+    std::vector<size_t> select_from(const std::vector<size_t>& candidates, size_t count);
+
+    // Deadline-aware selection: pick up to count of the candidates expected to finish within
+    // deadline_seconds (estimated_seconds per candidate; 0 disables the deadline). If none
+    // can, the fastest candidate is picked alone.
+    std::vector<size_t> select_within_deadline(const std::vector<size_t>& candidates,
+                                               const std::vector<double>& estimated_seconds,
+                                               size_t count,
+                                               double deadline_seconds);
     
 private:
     // Helper method to verify weights are compatible
     bool verify_weights(const std::vector<std::vector<float>>& client_weights) const;
-    std::mt19937 rng; // RNG for client selection
+    uint32_t seed;
+    uint64_t selections = 0;  // Selection calls so far; each draws from its own stream
+
+    std::vector<float> broadcast_weights;   // Last broadcast model as decoded by clients
+    std::vector<float> broadcast_residual;  // Error-feedback residual of the broadcast
+    uint32_t codec_rng_state;
 };
 
 #endif
\ No newline at end of file
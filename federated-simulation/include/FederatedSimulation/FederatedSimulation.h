@@ -3,11 +3,34 @@
 
 #include <vector>
 #include <memory>
+#include <iostream>
 #include <string>
+#include <utility>
 #include "DataLoader/DataLoader.h"
 #include "DataPreprocessor/DataPreprocessor.h"
+#include "Metrics/Metrics.h"
 #include "FederatedClient/FederatedClient.h"
 #include "FederatedServer/FederatedServer.h"
+#include "LatencyModel/LatencyModel.h"
+#include "DeviceModel/DeviceModel.h"
+#include "TransportModel/BleTransportModel.h"
+#include "MetricsSink/MetricsSink.h"
+#include "Profiler/PhaseProfiler.h"
+#include "SyntheticData/SyntheticDataGenerator.h"
+#include "Privacy/PrivateAggregator.h"
+#include "Pruning/Pruner.h"
+
+// Outcome of run_simulation(), for callers that compare runs
+struct SimulationResult {
+    int rounds_to_success = -1;       // First round of the HPO success criterion; -1 if not reached
+                                      // (asynchronous runs do not track it)
+    double seconds_to_success = 0.0;  // Simulated time at that round
+    float final_accuracy = 0.0f;      // Final test set evaluation
+    float final_loss = 0.0f;
+    float macro_f1 = 0.0f;
+    double sim_time = 0.0;            // Simulated seconds of the whole run
+    size_t bytes = 0;                 // Payload bytes of the whole run
+};
 
 class FederatedSimulation {
 public:
@@ -21,10 +44,105 @@ public:
     void set_samples_per_round(size_t samples) { samples_per_round = samples; }
     void set_fl_rounds(int rounds) { fl_rounds = rounds; }
     void set_topology(const std::vector<size_t>& topo) { topology = topo; }
+    // Per-layer activations, or (hidden, output); empty keeps sigmoid everywhere
+    void set_activations(const std::vector<Activation>& spec) { activations = spec; }
+    // An empty path writes no per-round metrics
     void set_metrics_file(const std::string& file) { metrics_file = file; }
+    void set_metrics_format(MetricsFormat format) { metrics_format = format; }
+
+    // Per-phase timing: <metrics file>_timing.csv with p50/p99 per round, and/or a Chrome
+    // trace of the rounds first..last
+    void set_profiling(bool enabled) { profile_timing = enabled; }
+    void set_trace(const std::string& path, int first_round, int last_round) {
+        profiler.set_trace_file(path, first_round, last_round);
+    }
+
+    // Use these samples instead of loading the dataset from data_path. The shared form lets
+    // simulations running side by side read one loaded copy.
+    void set_dataset(std::vector<MotionSample> samples) {
+        preset_dataset = std::make_shared<const std::vector<MotionSample>>(std::move(samples));
+    }
+    void set_dataset(std::shared_ptr<const std::vector<MotionSample>> samples) {
+        preset_dataset = std::move(samples);
+    }
+
+    // Load the samples run_simulation() reads from data_path, so simulations of the same data
+    // can share one copy through set_dataset()
+    std::shared_ptr<const std::vector<MotionSample>> load_dataset() const;
+    // Identifies what load_dataset() reads; empty when the simulation loads nothing
+    // (synthetic or preset data)
+    std::string dataset_source() const;
+
+    // Print nothing to the console; errors still go to stderr
+    void set_quiet(bool enabled) { quiet = enabled; }
+
+    // Stream generated windows into the preprocessor instead of loading data_path. Each
+    // client trains only on the windows the generator assigns to it.
+    void set_synthetic_data(const SyntheticDataConfig& config) {
+        synthetic_config = config;
+        use_synthetic = true;
+    }
+
+    // Divide the training set among clients (default: every client samples all of it)
+    void set_partition(const PartitionConfig& config) { partition_config = config; }
+
+    // Asynchronous (FedBuff) mode configuration
+    void set_async_mode(bool enabled) { async_mode = enabled; }
+    void set_async_buffer_size(size_t size) { async_buffer_size = size; }
+    void set_async_concurrency(size_t concurrency) { async_concurrency = concurrency; }
+    void set_server_learning_rate(float lr) { server_learning_rate = lr; }
+    void set_latency_config(const LatencyConfig& config) { latency_config = config; }
+
+    // Heterogeneous devices: local training takes simulated time, devices are only selected
+    // inside their online window with battery left, and a synchronous round lasts until its
+    // slowest device has uploaded
+    void set_device_config(const DeviceConfig& config) {
+        device_config = config;
+        use_device_model = true;
+    }
+    // Select only devices expected to finish a round within this time (0 = no deadline)
+    void set_round_deadline(double seconds) { round_deadline = seconds; }
+
+    // BLE link used to estimate simulated time and bytes per round
+    void set_transport_config(const BleTransportConfig& config) { transport_config = config; }
+
+    // Encoding of weights on the BLE link (fp32 keeps the raw exchange)
+    void set_weight_format(WeightCodec::Format format) { weight_format = format; }
+    void set_stochastic_rounding(bool enabled) {
+        weight_rounding = enabled ? WeightCodec::Rounding::STOCHASTIC : WeightCodec::Rounding::NEAREST;
+    }
+
+    // Train and evaluate clients with the float network or the device's integer engine
+    void set_model_backend(ModelBackend backend) { model_backend = backend; }
+
+    // Passes over the local data per round: the fresh samples, then epochs - 1 passes over a
+    // replay buffer of the last replay_capacity samples (0 = samples per round)
+    void set_local_epochs(size_t epochs) { local_epochs = epochs; }
+    void set_replay_capacity(size_t capacity) { replay_capacity = capacity; }
+
+    // Local update rule of the clients (plain SGD by default)
+    void set_optimizer_config(const OptimizerConfig& config) { optimizer_config = config; }
+    // Fail if a client needs more training memory than this (0 = report only)
+    void set_memory_budget(size_t bytes) { memory_budget = bytes; }
+
+    // Upload only this fraction of weight changes as top-k sparse deltas (0 keeps dense uploads)
+    void set_upload_density(float density) { upload_density = density; }
+
+    // Clip, mask and/or add noise to client updates during synchronous aggregation
+    void set_privacy_config(const PrivacyConfig& config) { privacy_config = config; }
+
+    // Magnitude pruning of the global model by the server during synchronous rounds; the
+    // mask goes out with the broadcast and only kept weights are exchanged
+    void set_pruning_config(const PruningConfig& config) { pruning_config = config; }
+
+    // Start every client from a saved model and/or save the final global model
+    void set_initial_model_path(const std::string& path) { initial_model_path = path; }
+    void set_export_model_path(const std::string& path) { export_model_path = path; }
     
     // Run the simulation
     void run_simulation();
+    // Result of the last completed run_simulation()
+    const SimulationResult& get_result() const { return result; }
     
 private:
     // Helper struct for tracking metrics during training
@@ -40,25 +158,134 @@ private:
         std::shared_ptr<DataPreprocessor> preprocessor,
         float learning_rate,
         size_t samples_per_client);
+    // Windows a client trains on again from its replay buffer in a round. Before training,
+    // the buffer does not hold this round's samples yet.
+    size_t replayed_windows(const FederatedClient& client, bool before_training) const;
     
-    float evaluate_test_set(
+    // Run setup, before the first round
+    void check_configuration() const;
+    std::shared_ptr<DataPreprocessor> prepare_data();
+    std::vector<std::unique_ptr<FederatedClient>> create_clients(
+        std::shared_ptr<DataPreprocessor> preprocessor) const;
+    // Creates the pruner if the model is pruned and none is configured
+    void load_initial_model(
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::unique_ptr<Pruner>& pruner);
+    void print_configuration();
+    // Fails if the client needs more memory than the budget
+    void print_client_configuration(const FederatedClient& client);
+    void export_model(
+        const FederatedClient& client,
+        const DataPreprocessor& preprocessor,
+        const Pruner* pruner);
+
+    // Synchronous rounds. The steps of a round share the run's state in SyncRun.
+    struct SyncRun;
+    struct RoundUpdates;
+    void run_sync_rounds(
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::shared_ptr<DataPreprocessor> preprocessor,
+        const std::vector<TrainingSample>& test_samples,
+        Pruner* pruner);
+    void start_sync_run(
+        SyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        Pruner* pruner);
+    // Per-device exchange time, again whenever pruning changes the exchanged size
+    void update_exchange_cost(SyncRun& run) const;
+    // Returns false when every device has used up its battery budget
+    bool select_round_clients(
+        SyncRun& run,
+        FederatedServer& server,
+        const std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::vector<size_t>& selected_clients);
+    RoundUpdates collect_updates(
+        SyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        const std::vector<size_t>& selected_clients);
+    std::vector<float> aggregate_updates(
+        SyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        int round,
+        const std::vector<size_t>& selected_clients,
+        const RoundUpdates& updates);
+    // Prunes and encodes the aggregate as the clients receive it
+    void broadcast_model(
+        SyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::vector<float>& averaged_weights);
+    // Advances the simulated clock and byte count by the round's exchanges
+    void account_round(
+        SyncRun& run,
+        const std::vector<std::unique_ptr<FederatedClient>>& clients,
+        const std::vector<size_t>& selected_clients,
+        size_t round_upload_bytes);
+    void print_sync_report(const SyncRun& run, const FederatedClient& client, size_t num_clients);
+    void print_pruning_report(const SyncRun& run, const FederatedClient& client);
+
+    // Asynchronous (FedBuff) rounds
+    struct PendingUpdate;
+    struct AsyncRun;
+    void run_async_rounds(
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::shared_ptr<DataPreprocessor> preprocessor,
+        const std::vector<TrainingSample>& test_samples);
+    void refresh_dispatch_weights(AsyncRun& run) const;
+    // Hand the current global model to idle clients until the concurrency limit is reached
+    void dispatch_clients(
+        AsyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::shared_ptr<DataPreprocessor> preprocessor);
+    void dispatch_client(
+        AsyncRun& run,
+        size_t client_idx,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        std::shared_ptr<DataPreprocessor> preprocessor);
+    void aggregate_buffer(
+        AsyncRun& run,
+        FederatedServer& server,
+        std::vector<std::unique_ptr<FederatedClient>>& clients,
+        const std::vector<TrainingSample>& test_samples);
+
+    // Fused metrics pass over the test set. Without AUC the histogram estimate in
+    // streaming_auc is updated instead. The result is reused across rounds.
+    const Evaluation& evaluate_test_set(
         FederatedClient& client,
-        const std::vector<TrainingSample>& test_set);
+        const std::vector<TrainingSample>& test_set,
+        bool with_auc = false);
     
-    void write_metrics_to_csv(
-        const std::string& filename,
+    void record_metrics(
         int round,
         float accuracy,
         float test_loss,
-        float training_loss);
-    
+        float training_loss,
+        double sim_time,
+        size_t bytes_transferred);
+
+    // Bytes of one weight transfer with the configured codec
+    size_t exchange_bytes(size_t weight_count) const;
+
     void print_final_evaluation(
         FederatedClient& client,
         const std::vector<TrainingSample>& test_set);
+
+    // Console output, or a stream that discards everything when quiet
+    std::ostream& console() { return quiet ? null_output : std::cout; }
     
     // Member variables
     std::string data_path;
     uint32_t seed;
+    std::shared_ptr<const std::vector<MotionSample>> preset_dataset;
+    bool use_synthetic = false;
+    SyntheticDataConfig synthetic_config;
+    PartitionConfig partition_config;
     
     // Configuration parameters
     size_t num_clients = 100;
@@ -67,7 +294,45 @@ private:
     float learning_rate = 0.75f;
     int fl_rounds = 200;
     std::vector<size_t> topology = {11, 15, 3};
+    std::vector<Activation> activations;
     std::string metrics_file = "federated_metrics.csv";
+    MetricsFormat metrics_format = MetricsFormat::CSV;
+    std::unique_ptr<MetricsSink> metrics_sink;
+    bool profile_timing = false;
+    PhaseProfiler profiler;
+    bool quiet = false;
+    std::ostream null_output{nullptr};
+    SimulationResult result;
+
+    // Asynchronous mode parameters
+    bool async_mode = false;
+    size_t async_buffer_size = 10;     // K: updates buffered before each aggregation
+    size_t async_concurrency = 0;      // Clients training at once (0 = num_clients * client_fraction)
+    float server_learning_rate = 1.0f;
+    LatencyConfig latency_config;
+    bool use_device_model = false;
+    DeviceConfig device_config;
+    double round_deadline = 0.0;
+    BleTransportConfig transport_config;
+    WeightCodec::Format weight_format = WeightCodec::Format::FLOAT32;
+    WeightCodec::Rounding weight_rounding = WeightCodec::Rounding::NEAREST;
+    float upload_density = 0.0f;
+    ModelBackend model_backend = ModelBackend::FLOAT32;
+    OptimizerConfig optimizer_config;
+    size_t local_epochs = 1;
+    size_t replay_capacity = 0;
+    size_t memory_budget = 0;
+    PrivacyConfig privacy_config;
+    PruningConfig pruning_config;
+    std::string initial_model_path;
+    std::string export_model_path;
+
+    // Test set evaluation buffers
+    std::vector<float> test_predictions;
+    std::vector<int> test_labels;
+    Evaluation test_evaluation;
+    Metrics::AucScratch metrics_scratch;
+    StreamingAuc streaming_auc;
 };
 
 #endif
\ No newline at end of file
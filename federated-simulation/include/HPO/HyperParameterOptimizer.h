@@ -7,6 +7,8 @@
 #include <limits>
 #include "DataPreprocessor/DataPreprocessor.h"
 #include "FederatedClient/FederatedClient.h"
+#include "TransportModel/BleTransportModel.h"
+#include "MetricsSink/MetricsSink.h"
 
 struct HyperParams {
     std::vector<size_t> topology;
@@ -18,6 +20,8 @@ struct HyperParams {
     int rounds_to_success;
     float final_accuracy;
     float final_loss;
+    double seconds_to_success;   // Simulated BLE time until the success round
+    size_t bytes_to_success;     // Payload bytes exchanged until the success round
 
     std::string to_string() const;
 };
@@ -48,15 +52,26 @@ public:
     
     // Set parameters for optimization
     void set_max_rounds(int max_rounds) { max_fl_rounds = max_rounds; }
-    void set_num_clients(size_t num_clients) { num_clients = num_clients; }
+    void set_num_clients(size_t clients) { num_clients = clients; }
     void set_quick_search(bool quick) { quick_search = quick; }
+    void set_transport_config(const BleTransportConfig& config) { transport_config = config; }
+    void set_partition(const PartitionConfig& config) { partition_config = config; }
+    // Rank successful configurations by simulated time-to-accuracy instead of rounds
+    void set_rank_by_time(bool by_time) { rank_by_time = by_time; }
+    void set_model_backend(ModelBackend backend) { model_backend = backend; }
+    // Activations of every topology in the grid: per layer, or (hidden, output)
+    void set_activations(const std::vector<Activation>& spec) { activations = spec; }
+    void set_optimizer_config(const OptimizerConfig& config) { optimizer_config = config; }
+    // Local epochs over a replay buffer (0 capacity = samples per round of the configuration)
+    void set_local_epochs(size_t epochs) { local_epochs = epochs; }
+    void set_replay_capacity(size_t capacity) { replay_capacity = capacity; }
     
 private:
     // Generate grid of parameter combinations to test
     std::vector<HyperParams> generate_param_grid();
     
-    // Evaluate a single configuration
-    bool evaluate_configuration(HyperParams& params, const std::string& metrics_file = "hyperparam_metrics.csv");
+    // Evaluate a single configuration, recording its rounds under config_id
+    bool evaluate_configuration(HyperParams& params, MetricsSink& metrics, int32_t config_id);
     
     // Helper struct for tracking metrics during training
     struct TrainingMetrics {
@@ -78,6 +93,15 @@ private:
     int max_fl_rounds = 600;
     size_t num_clients = 100;
     bool quick_search = false;
+    bool rank_by_time = false;
+    BleTransportConfig transport_config;
+    PartitionConfig partition_config;
+    ModelBackend model_backend = ModelBackend::FLOAT32;
+    std::vector<Activation> activations;
+    OptimizerConfig optimizer_config;
+    size_t local_epochs = 1;
+    size_t replay_capacity = 0;
+    std::string metrics_file = "hyperparam_metrics.csv";
 };
 
 #endif
\ No newline at end of file
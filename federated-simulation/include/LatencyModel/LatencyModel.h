@@ -0,0 +1,44 @@
+#ifndef LATENCY_MODEL_H
+#define LATENCY_MODEL_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Distribution used to draw the time between dispatching the global model
+// to a client and its update arriving back at the server
+enum class LatencyDistribution {
+    CONSTANT,
+    UNIFORM,
+    EXPONENTIAL,
+    LOGNORMAL
+};
+
+struct LatencyConfig {
+    LatencyDistribution distribution = LatencyDistribution::LOGNORMAL;
+    float mean_seconds = 30.0f;        // Mean report-back time of a regular client
+    float spread = 0.5f;               // Relative spread (uniform half-width / lognormal sigma)
+    float straggler_fraction = 0.1f;   // Fraction of clients that are persistently slow
+    float straggler_slowdown = 5.0f;   // Latency multiplier applied to stragglers
+};
+
+class LatencyModel {
+public:
+    LatencyModel(const LatencyConfig& config, size_t num_clients, uint32_t seed = 42);
+
+    // Draw the report-back latency (seconds) for one dispatch of a client
+    float sample(size_t client_id);
+
+    bool is_straggler(size_t client_id) const { return client_slowdown[client_id] > 1.0f; }
+
+    static LatencyDistribution parse_distribution(const std::string& name);
+    static std::string distribution_name(LatencyDistribution distribution);
+
+private:
+    LatencyConfig config;
+    std::vector<float> client_slowdown;  // Persistent per-client latency multiplier
+    std::vector<uint32_t> dispatches;    // Draws so far per client; each uses its own stream
+    uint32_t seed;
+};
+
+#endif
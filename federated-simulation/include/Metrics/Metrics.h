@@ -2,42 +2,129 @@
 #define METRICS_H
 
 #include <vector>
-#include <array>
 #include <string>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+// Row-major confusion counts: rows are true classes, columns predicted classes
+struct ConfusionMatrix {
+    size_t num_classes = 0;
+    std::vector<int> counts;
+
+    explicit ConfusionMatrix(size_t classes = 0) : num_classes(classes), counts(classes * classes, 0) {}
+
+    void reset(size_t classes) { num_classes = classes; counts.assign(classes * classes, 0); }
+    int& at(size_t actual, size_t predicted) { return counts[actual * num_classes + predicted]; }
+    int at(size_t actual, size_t predicted) const { return counts[actual * num_classes + predicted]; }
+};
+
+// Results of one fused pass over a prediction matrix. Reusing a result keeps its buffers.
+struct Evaluation {
+    size_t samples = 0;
+    float accuracy = 0.0f;
+    float log_loss = 0.0f;
+    ConfusionMatrix confusion;
+    std::vector<float> precision;
+    std::vector<float> recall;
+    std::vector<float> f1;
+    std::vector<float> auc;   // Empty unless AUC was requested
+    float macro_f1 = 0.0f;
+    float macro_auc = 0.0f;
+};
 
 class Metrics {
 public:
-    // Calculate accuracy
-    static float accuracy(const std::vector<std::vector<float>>& predictions, 
+    // Reusable buffers for AUC and the nested-vector adapters. Calls that pass the same
+    // scratch do not allocate once it has grown to the test set size.
+    struct AucScratch {
+        std::vector<uint64_t> keys;
+        std::vector<uint64_t> sorted;
+        std::vector<float> predictions;
+        std::vector<int> labels;
+    };
+
+    static constexpr size_t MAX_CLASSES = 256;
+
+    // Fused evaluation of row-major predictions (rows x num_classes) against class labels:
+    // accuracy, log loss, confusion matrix, precision, recall and F1 in one pass, plus
+    // one-vs-rest AUC from a single radix sort when with_auc is set. Precision, recall and F1
+    // are 0 for a class that is never predicted or never present.
+    static void evaluate(const float* predictions, const int* labels, size_t rows, size_t num_classes,
+                         Evaluation& result, AucScratch& scratch, bool with_auc = true);
+
+    // One-vs-rest ROC AUC for each class from midranks, so tied scores count half.
+    // All classes are ranked with one radix sort. A class without positives or negatives scores 0
+    // and is left out of the macro average.
+    static void roc_auc(const float* predictions, const int* labels, size_t rows, size_t num_classes,
+                        AucScratch& scratch, std::vector<float>& auc_scores, float* macro_auc = nullptr);
+
+    // Precision, recall and F1 per class from a confusion matrix
+    static void class_scores(const ConfusionMatrix& matrix,
+                             std::vector<float>& precision,
+                             std::vector<float>& recall,
+                             std::vector<float>& f1);
+
+    // Adapters for nested prediction vectors and one-hot targets
+    static float accuracy(const std::vector<std::vector<float>>& predictions,
                          const std::vector<std::vector<float>>& targets);
-    
-    // Calculate confusion matrix
-    static std::array<std::array<int, 3>, 3> confusion_matrix(
+    static ConfusionMatrix confusion_matrix(
         const std::vector<std::vector<float>>& predictions,
         const std::vector<std::vector<float>>& targets);
-    
-    // Calculate ROC AUC score for each class
-    static std::array<float, 3> roc_auc(
+    static std::vector<float> roc_auc(
         const std::vector<std::vector<float>>& predictions,
-        const std::vector<std::vector<float>>& targets);
-    
-    // Calculate F1 score for each class
-    static std::array<float, 3> f1_scores(
-        const std::array<std::array<int, 3>, 3>& conf_matrix);
-    
-    // Pretty print confusion matrix
-    static void print_confusion_matrix(const std::array<std::array<int, 3>, 3>& matrix);
-
-    // Calculate cross-entropy loss
+        const std::vector<std::vector<float>>& targets,
+        float* macro_auc = nullptr);
+    static std::vector<float> f1_scores(const ConfusionMatrix& conf_matrix);
     static float cross_entropy_loss(
         const std::vector<std::vector<float>>& predictions,
         const std::vector<std::vector<float>>& targets);
-        
-    
+
+    // Pretty print confusion matrix
+    static void print_confusion_matrix(const ConfusionMatrix& matrix, std::ostream& out = std::cout);
+
+    // Index of the largest value (the first one on ties)
+    static int argmax(const float* values, size_t count);
+
+private:
+    // Order-preserving map of a float to unsigned bits
+    static uint32_t sortable_bits(float value);
+
+    static void flatten(const std::vector<std::vector<float>>& predictions,
+                        const std::vector<std::vector<float>>& targets,
+                        AucScratch& scratch);
+};
+
+// Approximate one-vs-rest AUC from bounded per-class score histograms, for monitoring large
+// test sets every round without storing or sorting predictions. Each histogram starts at a fine
+// bin width and doubles it, merging neighbouring bins, whenever a score falls outside its range,
+// so it adapts to scores that cluster tightly early in training. Scores in one bin count as
+// tied, which bounds the error by the share of pairs that fall into the same bin.
+class StreamingAuc {
+public:
+    explicit StreamingAuc(size_t num_classes = 3, size_t bins = 1024);
+
+    void reset();
+    void add(const float* prediction, int label);
+
+    std::vector<float> per_class() const;
+    float macro() const;
+
 private:
-    // Convert probabilities to class predictions
-    static std::vector<int> get_predicted_classes(const std::vector<std::vector<float>>& predictions);
-    static std::vector<int> get_true_classes(const std::vector<std::vector<float>>& targets);
+    struct Histogram {
+        double origin = 0.0;
+        double width = 0.0;                // 0 until the first score arrives
+        std::vector<uint32_t> positives;
+        std::vector<uint32_t> negatives;
+        uint64_t positive_count = 0;
+        uint64_t negative_count = 0;
+    };
+
+    void insert(Histogram& histogram, float score, bool positive) const;
+    static void coarsen(std::vector<uint32_t>& counts, bool keep_upper);
+
+    size_t bins;
+    std::vector<Histogram> histograms;
 };
 
-#endif
\ No newline at end of file
+#endif
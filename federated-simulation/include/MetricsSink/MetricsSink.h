@@ -0,0 +1,169 @@
+#ifndef METRICS_SINK_H
+#define METRICS_SINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class MetricsFormat {
+    CSV,
+    NDJSON,
+    BINARY
+};
+
+// One row of per-round metrics. Fixed size so it can be queued without allocating.
+struct MetricsRecord {
+    int32_t round = 0;
+    int32_t config = -1;          // HPO configuration id, -1 for a single simulation
+    float accuracy = 0.0f;        // Fraction; back-ends write it as a percentage
+    float test_loss = 0.0f;
+    float training_loss = 0.0f;
+    double sim_time = 0.0;        // Simulated seconds
+    uint64_t bytes = 0;           // Cumulative payload bytes
+};
+
+// Output format of a metrics file. Each back-end owns the open stream and is only
+// used from the writer thread.
+class MetricsBackend {
+public:
+    virtual ~MetricsBackend() = default;
+
+    virtual void write_label(int32_t config, const std::string& label) = 0;
+    virtual void write_rows(const MetricsRecord* rows, size_t count) = 0;
+    virtual void flush() = 0;
+
+    static std::unique_ptr<MetricsBackend> create(MetricsFormat format, const std::string& path,
+                                                  bool with_config);
+};
+
+// Bounded multi-producer single-consumer queue (Vyukov's sequence-numbered ring).
+// push() and pop() never block or allocate; push() fails when the ring is full.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells = std::unique_ptr<Cell[]>(new Cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer
+    bool pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) < 0) {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate while other threads push or pop
+    size_t size() const {
+        size_t tail = dequeue_pos.load(std::memory_order_relaxed);
+        size_t head = enqueue_pos.load(std::memory_order_relaxed);
+        return head > tail ? head - tail : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+// Metrics file written by a background thread. Training threads hand records to a
+// lock-free queue and never wait for I/O; the writer drains the queue in batches
+// through one open file handle and flushes once per batch. A producer that finds the
+// queue half full wakes the writer early. When the queue is full the record is
+// dropped and counted rather than stalling the caller.
+class MetricsSink {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+    static constexpr int FLUSH_INTERVAL_MS = 100;
+
+    // Truncates path. with_config adds the configuration column (HPO runs).
+    MetricsSink(const std::string& path, MetricsFormat format, bool with_config = false,
+                size_t capacity = DEFAULT_CAPACITY);
+    ~MetricsSink();
+
+    MetricsSink(const MetricsSink&) = delete;
+    MetricsSink& operator=(const MetricsSink&) = delete;
+
+    // Safe from any thread; returns false if the record was dropped
+    bool record(const MetricsRecord& record);
+
+    // Describe a configuration id before recording its rows. Takes a short lock,
+    // so call it once per configuration rather than per round.
+    void label_config(int32_t config, const std::string& label);
+
+    // Write everything queued and close the file. Called by the destructor.
+    void close();
+
+    size_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+    const std::string& path() const { return file_path; }
+
+    static MetricsFormat parse_format(const std::string& name);
+    static std::string format_name(MetricsFormat format);
+    // .ndjson/.jsonl select NDJSON, .smet selects the binary format, anything else CSV
+    static MetricsFormat format_for_path(const std::string& path);
+
+private:
+    void run_writer();
+    size_t drain();
+
+    std::string file_path;
+    std::unique_ptr<MetricsBackend> backend;
+    BoundedQueue<MetricsRecord> queue;
+    std::vector<MetricsRecord> batch;
+    std::atomic<size_t> dropped_records{0};
+    std::atomic<bool> wake_requested{false};
+
+    std::mutex mutex;                  // Guards pending_labels and stopping
+    std::condition_variable wake;
+    std::vector<std::pair<int32_t, std::string>> pending_labels;
+    bool stopping = false;
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ModelFormat.h"
+
+// Write the simulator's flat weights (per layer: weights, then biases) as a ModelFormat file
+// the device can load. The weights are stored in the firmware's layer order, followed by the biases.
+// A pruning mask (one value per flat parameter, 0 for a pruned weight) is stored with the
+// model, and only the kept weights are.
+void save_model_file(const std::string& path,
+                     const std::vector<size_t>& topology,
+                     const std::vector<float>& flat_weights,
+                     const std::vector<float>& scale_params,
+                     WeightCodec::Format format,
+                     const std::vector<uint8_t>& mask = {});
+
+// Read-only, memory-mapped ModelFormat file. The header and every payload block are verified
+// on open; payload views point straight into the mapping.
+class MappedModel {
+public:
+    explicit MappedModel(const std::string& path);
+    ~MappedModel();
+
+    MappedModel(const MappedModel&) = delete;
+    MappedModel& operator=(const MappedModel&) = delete;
+
+    const ModelFormat::Header& header() const { return model_header; }
+    std::vector<size_t> topology() const;
+    std::vector<float> scale_params() const { return {model_header.featureMin, model_header.featureMax}; }
+    size_t file_size() const { return mapped_size; }
+
+    // Zero-copy views into the mapping
+    const uint8_t* payload() const { return data + model_header.headerBytes; }
+    const float* fp32_weights() const;  // nullptr unless all weights are stored as fp32
+
+    // Decoded weights in the simulator's flat layout (biases are zero if the file has none)
+    std::vector<float> to_flat_weights() const;
+    // Pruning mask in the flat layout (see save_model_file), empty if the file has none
+    std::vector<uint8_t> parameter_mask() const;
+
+private:
+    const uint8_t* data = nullptr;
+    size_t mapped_size = 0;
+    ModelFormat::Header model_header;
+};
+
+#endif
@@ -3,51 +3,123 @@
 
 #include <vector>
 #include <memory>
-#include <random>
 #include <cmath>
+#include <string>
+#include "Random/CounterRng.h"
 
+enum class Activation : uint8_t {
+    SIGMOID,
+    RELU,
+    TANH,
+    LINEAR,
+    SOFTMAX   // Output layer only; trained with cross-entropy
+};
+
+// A fully connected layer. Its weights ([output][input]) and biases live in a parameter
+// arena owned by the caller, from the offset the layer was given at construction.
+// A pruned layer keeps compressed sparse rows of its remaining weights (per output, the
+// input indices) and its passes visit only those; the values stay in the arena.
 class Layer {
 public:
-    Layer(size_t inputs, size_t outputs, uint32_t seed);
+    // Appends the initial weights and biases, drawn from rng, to parameters
+    Layer(size_t inputs, size_t outputs, CounterRng& rng, std::vector<float>& parameters,
+          Activation activation = Activation::SIGMOID);
 
-    std::vector<float> forward(const std::vector<float>& inputs);
-    void backward(const std::vector<float>& inputs, std::vector<float>& gradients, float learning_rate);
+    const std::vector<float>& forward(const float* parameters, const std::vector<float>& inputs);
+    // Backpropagate and apply an SGD step to the parameters in one pass
+    void backward(float* parameters, const std::vector<float>& inputs, std::vector<float>& gradients,
+                  float learning_rate);
+    // Backpropagate and write the gradient of every parameter of this layer to
+    // parameter_gradients (same layout as the arena) without changing the parameters
+    void gradient(const float* parameters, const std::vector<float>& inputs, std::vector<float>& gradients,
+                  float* parameter_gradients);
 
-    size_t input_size() const { return weights.size() > 0 ? weights[0].size() : 0; }
-    size_t output_size() const { return weights.size(); }
+    // mask holds one value per weight of this layer, 0 for a pruned one; nullptr makes the
+    // layer dense again
+    void set_mask(const uint8_t* mask);
+    bool is_sparse() const { return sparse; }
+    size_t active_weights() const { return sparse ? columns.size() : inputs * outputs; }
 
-    // Direct weight access for distributed learning
-    const std::vector<std::vector<float>>& get_weights() const { return weights; }
-    void set_weights(const std::vector<std::vector<float>>& new_weights) { weights = new_weights; }
+    size_t input_size() const { return inputs; }
+    size_t output_size() const { return outputs; }
+    size_t parameter_offset() const { return offset; }
+    size_t parameter_count() const { return outputs * (inputs + 1); }
+    Activation get_activation() const { return activation; }
 
     // Getter for last outputs
     const std::vector<float>& get_last_outputs() const { return last_outputs; }
-    // In the Layer class:
-    const std::vector<float>& get_biases() const { return biases; }
-    void set_biases(const std::vector<float>& new_biases) { biases = new_biases; }
 
 private:
-    std::vector<std::vector<float>> weights;  // [output_neurons][input_neurons]
-    std::vector<float> biases;
+    size_t inputs;
+    size_t outputs;
+    size_t offset;                    // Weights at offset, biases after them
     std::vector<float> last_outputs;  // Cache for backprop
+    std::vector<float> next_gradients;
+    Activation activation;
+    bool sparse = false;
+    std::vector<uint32_t> row_start;  // outputs + 1 offsets into columns
+    std::vector<uint32_t> columns;    // Input index of each remaining weight
 
-    float activate(float x) const;
-    float activate_derivative(float x) const;
+    // Apply the activation to last_outputs in place
+    void activate();
+    // Derivative in terms of the activation output y
+    float activate_derivative(float y) const;
 };
 
 class NeuralNetwork {
 public:
-    NeuralNetwork(const std::vector<size_t>& topology, uint32_t seed);
+    // Initial weights come from the weight initialization stream of (seed, client).
+    // activations is expanded by layer_activations(); empty means sigmoid everywhere.
+    NeuralNetwork(const std::vector<size_t>& topology, uint32_t seed, uint32_t client = 0,
+                  const std::vector<Activation>& activations = {});
 
     std::vector<float> forward(const std::vector<float>& inputs);
+    // One SGD step. A softmax output is trained on the cross-entropy, whose gradient with
+    // respect to the pre-activations is outputs - targets; other outputs on the squared error.
     void train(const std::vector<float>& inputs, const std::vector<float>& targets, float learning_rate);
 
+    std::vector<Activation> get_activations() const;
+
+    // Backpropagate the loss of one sample into gradients (one value per parameter, in the
+    // flat weight layout) without updating the parameters; for optimizers other than SGD
+    void compute_gradients(const std::vector<float>& inputs, const std::vector<float>& targets,
+                           std::vector<float>& gradients);
+
     // Methods for distributed learning
-    std::vector<float> get_flat_weights() const;
+    std::vector<float> get_flat_weights() const { return parameters; }
+    // Pruned weights stay zero whatever the given values
     void set_flat_weights(const std::vector<float>& weights);
 
+    // Prune: mask holds one value per parameter of the flat layout, 0 for a pruned weight
+    // (biases are never pruned). Pruned weights are zeroed and skipped by every pass, so
+    // training leaves them at zero. An empty mask makes the network dense again.
+    void set_mask(const std::vector<uint8_t>& mask);
+    const std::vector<uint8_t>& get_mask() const { return mask; }
+    bool is_pruned() const { return !mask.empty(); }
+    // Zero the pruned weights again, e.g. after an optimizer step with momentum
+    void apply_mask();
+    // Parameters not pruned, including the biases
+    size_t active_parameter_count() const;
+
+    // Contiguous parameter arena: per layer the weights [output][input], then the biases
+    float* parameter_data() { return parameters.data(); }
+    size_t parameter_count() const { return parameters.size(); }
+    // Bytes of parameters and activation buffers
+    size_t memory_bytes() const;
+
+    // One activation per layer, or two: the activation of every hidden layer and of the output
+    static std::vector<Activation> layer_activations(const std::vector<Activation>& spec, size_t layer_count);
+    static Activation parse_activation(const std::string& name);
+    static std::string activation_name(Activation activation);
+
 private:
+    // Output layer gradient of the loss, see train()
+    void output_gradients(const std::vector<float>& inputs, const std::vector<float>& targets);
+
+    std::vector<float> parameters;
+    std::vector<uint8_t> mask;     // Empty unless pruned
     std::vector<Layer> layers;
+    std::vector<float> gradients;  // Backpropagated through the layers
 };
 
 #endif
\ No newline at end of file
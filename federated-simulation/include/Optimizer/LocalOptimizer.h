@@ -0,0 +1,57 @@
+#ifndef LOCAL_OPTIMIZER_H
+#define LOCAL_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class OptimizerType {
+    SGD,
+    MOMENTUM,   // Heavy ball: v = momentum * v + g, w -= lr * v
+    ADAM
+};
+
+struct OptimizerConfig {
+    OptimizerType type = OptimizerType::SGD;
+    float momentum = 0.9f;
+    float beta1 = 0.9f;
+    float beta2 = 0.999f;
+    float epsilon = 1e-8f;
+    float proximal_mu = 0.0f;   // FedProx: adds mu * (w - w_global) to every gradient (0 = off)
+    bool keep_state = false;    // Keep momentum and moments across rounds instead of resetting them
+
+    // Plain SGD is applied inside backpropagation without gradient or state buffers
+    bool fused_sgd() const { return type == OptimizerType::SGD && proximal_mu == 0.0f; }
+    // Floats of optimizer state per parameter
+    size_t state_per_parameter() const {
+        return type == OptimizerType::ADAM ? 2 : type == OptimizerType::MOMENTUM ? 1 : 0;
+    }
+};
+
+// Applies the local update rule of a client to a parameter arena, given the gradient of
+// one sample in the same layout. The state (momentum, or Adam's first and second
+// moments) is one contiguous buffer parallel to the arena.
+class LocalOptimizer {
+public:
+    LocalOptimizer(const OptimizerConfig& config, size_t parameter_count);
+
+    // A new global model was received; resets the state unless keep_state is set
+    void begin_round();
+    // global is the received model FedProx pulls towards; null skips the proximal term
+    void step(float* parameters, const float* gradients, const float* global, float learning_rate);
+
+    const OptimizerConfig& get_config() const { return config; }
+    size_t state_bytes() const { return state.size() * sizeof(float); }
+
+    static OptimizerType parse_type(const std::string& name);
+    static std::string type_name(OptimizerType type);
+
+private:
+    OptimizerConfig config;
+    size_t count;
+    std::vector<float> state;   // [momentum] or [first moments | second moments]
+    uint64_t steps = 0;         // Adam steps since the last reset, for bias correction
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef PRIVATE_AGGREGATOR_H
+#define PRIVATE_AGGREGATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PrivacyConfig {
+    float clip_norm = 0.0f;           // L2 bound on each client's update (0 = no clipping)
+    float noise_multiplier = 0.0f;    // Gaussian noise std as a multiple of clip_norm (0 = no noise)
+    double delta = 1e-5;              // Target delta of the reported (epsilon, delta)
+    bool secure_aggregation = false;  // Sum pairwise-masked fixed-point updates
+    size_t mask_neighbors = 0;        // Masks per client (0 = 2 * ceil(log2 n), at most n - 1)
+    float secagg_bound = 1.0f;        // Coordinate range of the fixed-point encoding without clipping
+
+    bool enabled() const { return clip_norm > 0.0f || noise_multiplier > 0.0f || secure_aggregation; }
+};
+
+// Renyi DP accountant for the subsampled Gaussian mechanism (Mironov, Talwar and Zhang,
+// "Renyi Differential Privacy of the Sampled Gaussian Mechanism", 2019), integer orders
+class RdpAccountant {
+public:
+    RdpAccountant(double noise_multiplier, double sampling_rate);
+
+    void step(size_t rounds = 1) { steps += rounds; }
+    size_t rounds() const { return steps; }
+    // Smallest epsilon over the orders for this delta after the rounds so far
+    double epsilon(double delta) const;
+
+private:
+    std::vector<double> orders;
+    std::vector<double> rdp_per_round;
+    size_t steps = 0;
+};
+
+// Aggregation stage that sees each update only once, as it streams in:
+//   1. the update (local minus global weights) is scaled to L2 norm <= clip_norm,
+//   2. with secure aggregation it is encoded in 32-bit fixed point and masked with
+//      pairwise masks that cancel in the modular sum, so the server never holds it in clear,
+//   3. Gaussian noise with std noise_multiplier * clip_norm is added to the sum.
+// Masks connect each client with mask_neighbors others on a ring (Bell et al., CCS 2020)
+// and are regenerated from a counter-based random stream per pair, so nothing is stored per client and
+// memory stays O(model size) for any number of clients.
+class PrivateAggregator {
+public:
+    PrivateAggregator(const PrivacyConfig& config, uint32_t seed);
+
+    // participants are client ids in upload order
+    void begin_round(uint64_t round, const std::vector<size_t>& participants, size_t dimension);
+    // Clip, encode and mask the update of participants[position] and add it to the sum
+    void add_update(size_t position, const float* update);
+    // Unmask, add noise and return the mean update of the round
+    std::vector<float> finish_round();
+
+    const PrivacyConfig& get_config() const { return config; }
+    size_t neighbors() const { return mask_neighbors; }
+    // Share of this round's updates that were scaled down
+    float clipped_fraction() const;
+
+private:
+    void add_pair_mask(size_t client_a, size_t client_b, bool add);
+
+    PrivacyConfig config;
+    uint32_t seed;
+    uint64_t round = 0;
+    std::vector<size_t> participants;
+    std::vector<bool> received;
+    size_t dimension = 0;
+    size_t updates = 0;
+    size_t clipped = 0;
+    size_t mask_neighbors = 0;
+    size_t ring_half = 0;
+    float scale = 1.0f;                // Fixed-point units per unit of weight
+
+    std::vector<double> plain_sum;     // Without secure aggregation
+    std::vector<uint32_t> masked_sum;  // Modular sum of the masked fixed-point updates
+    std::vector<uint32_t> masked;      // The upload of the current client
+    std::vector<uint32_t> mask;
+    std::vector<float> clipped_update;
+};
+
+#endif
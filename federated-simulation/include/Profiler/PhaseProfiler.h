@@ -0,0 +1,115 @@
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Stages of a federated round that are timed separately
+enum class Phase : uint8_t {
+    CLIENT_SELECTION,
+    SAMPLE_FETCH,
+    LOCAL_TRAINING,
+    WEIGHT_COLLECTION,
+    AGGREGATION,
+    BROADCAST,
+    EVALUATION,
+    METRICS_IO
+};
+
+// Wall-clock time spent in each phase of each round. Disabled by default; then a
+// ScopedPhase costs one branch. When enabled, every timed interval of a round is kept
+// until the round ends, and the round's call count, total, p50, p99 and max per phase
+// are appended to a CSV. Rounds in the trace range are also kept as Chrome trace
+// events (chrome://tracing or https://ui.perfetto.dev).
+class PhaseProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t PHASE_COUNT = 8;
+
+    bool enabled() const { return active; }
+
+    // Either output enables the profiler
+    void set_timing_file(const std::string& path) { timing_path = path; }
+    void set_trace_file(const std::string& path, int first_round = 1, int last_round = 3);
+
+    // Open the outputs; call once before the first round
+    void start();
+    void begin_round(int round);
+    void end_round();
+    // Drop an unfinished round, write the trace and print the per-phase breakdown to out
+    void finish(std::ostream& out = std::cout);
+
+    void record(Phase phase, Clock::time_point begin, Clock::time_point end);
+
+    static const char* phase_name(Phase phase);
+    // <metrics file without extension>_timing.csv
+    static std::string timing_path_for(const std::string& metrics_path);
+
+private:
+    struct TraceEvent {
+        Phase phase;
+        int round;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    struct RoundSpan {
+        int round;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    struct PhaseTotals {
+        double seconds = 0.0;
+        size_t calls = 0;
+        std::vector<double> round_ms;   // Time in this phase for every round, for the summary
+    };
+
+    int64_t micros_since_start(Clock::time_point time) const;
+
+    bool active = false;
+    std::string timing_path;
+    std::string trace_path;
+    int trace_first = 1;
+    int trace_last = 3;
+
+    std::ofstream timing_file;
+    Clock::time_point origin;
+    Clock::time_point round_start;
+    int current_round = 0;
+    bool in_round = false;
+    double total_round_seconds = 0.0;
+
+    std::array<std::vector<double>, PHASE_COUNT> round_durations;   // Microseconds
+    std::array<PhaseTotals, PHASE_COUNT> totals;
+    std::vector<TraceEvent> trace_events;
+    std::vector<RoundSpan> round_spans;     // Whole rounds for the trace
+};
+
+// Times the enclosing scope as one interval of a phase
+class ScopedPhase {
+public:
+    ScopedPhase(PhaseProfiler& profiler, Phase phase)
+        : profiler(profiler.enabled() ? &profiler : nullptr), phase(phase) {
+        if (this->profiler) start = PhaseProfiler::Clock::now();
+    }
+
+    ~ScopedPhase() {
+        if (profiler) profiler->record(phase, start, PhaseProfiler::Clock::now());
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    PhaseProfiler* profiler;
+    Phase phase;
+    PhaseProfiler::Clock::time_point start;
+};
+
+#endif
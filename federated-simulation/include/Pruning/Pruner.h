@@ -0,0 +1,77 @@
+#ifndef PRUNER_H
+#define PRUNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class PruningMode {
+    NONE,
+    UNSTRUCTURED,   // Individual weights
+    STRUCTURED      // Whole hidden neurons
+};
+
+struct PruningConfig {
+    PruningMode mode = PruningMode::NONE;
+    float sparsity = 0.5f;   // Final share of each layer's weights (or hidden neurons) removed
+    int start_round = 50;    // First round after whose aggregation the server prunes
+    int ramp_rounds = 50;    // Rounds over which the sparsity grows to its final value
+
+    bool enabled() const { return mode != PruningMode::NONE && sparsity > 0.0f; }
+};
+
+// Magnitude pruning of the global model, decided by the server after aggregation and sent
+// to the clients with the broadcast. The sparsity grows over ramp_rounds rounds following
+// the gradual schedule of Zhu and Gupta ("To prune, or not to prune", 2017),
+// s_t = s * (1 - (1 - t / ramp)^3), so the clients can recover between steps.
+//   unstructured: per layer, the weights with the smallest magnitude
+//   structured:   per hidden layer, the neurons with the smallest L2 norm of incoming
+//                 weights; their incoming and outgoing weights are pruned, so a device can
+//                 drop the neuron altogether
+// Masks only ever remove weights. Biases are never pruned: the bias of a removed neuron
+// no longer reaches the outputs and receives no gradient.
+class Pruner {
+public:
+    Pruner(const PruningConfig& config, const std::vector<size_t>& topology);
+
+    // Sparsity the schedule asks for after the aggregation of round (1-based)
+    float target_sparsity(int round) const;
+
+    // Prune the aggregated global model of round if the schedule says so; returns true when
+    // the mask changed. weights are not modified, see apply().
+    bool update(int round, const std::vector<float>& weights);
+    // Start from an existing mask (one value per parameter, e.g. from a model file)
+    void set_mask(const std::vector<uint8_t>& mask);
+    // Zero the pruned weights
+    void apply(std::vector<float>& weights) const;
+
+    // One value per parameter of the flat layout, 0 for a pruned weight
+    const std::vector<uint8_t>& mask() const { return parameter_mask; }
+    // ModelFormat mask section: one bit per weight in the firmware's order, biases skipped
+    std::vector<uint8_t> weight_bitmap() const;
+
+    const PruningConfig& get_config() const { return config; }
+    size_t weight_count() const;
+    size_t kept_weights() const;
+    // Parameters still exchanged: kept weights and every bias
+    size_t kept_parameters() const { return parameter_mask.size() - (weight_count() - kept_weights()); }
+    size_t removed_neurons() const;
+
+    static PruningMode parse_mode(const std::string& name);
+    static std::string mode_name(PruningMode mode);
+
+private:
+    // Prune until each layer reaches the sparsity; returns true when the mask changed
+    bool prune_weights(const std::vector<float>& weights, float sparsity);
+    bool prune_neurons(const std::vector<float>& weights, float sparsity);
+    void remove_neuron(size_t layer, size_t neuron);
+    bool neuron_removed(size_t layer, size_t neuron) const;
+
+    PruningConfig config;
+    std::vector<size_t> topology;
+    std::vector<size_t> offsets;           // First parameter of each layer
+    std::vector<uint8_t> parameter_mask;
+};
+
+#endif
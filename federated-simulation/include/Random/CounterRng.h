@@ -0,0 +1,126 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include "Random/Philox.h"
+
+// What a random stream is used for. Streams of different purposes never overlap, so
+// adding draws for one purpose does not shift the values of another.
+enum class RngPurpose : uint32_t {
+    CLIENT_SELECTION = 1,
+    DATA_SPLIT,          // Train/test shuffle
+    PARTITION,           // Assignment of training samples to clients
+    SAMPLE_ORDER,        // Order in which a client visits its training samples
+    WEIGHT_INIT,
+    CODEC_ROUNDING,      // Seed of the stochastic rounding state of the weight codec
+    LATENCY,
+    DEVICE_PROFILE,
+    SYNTHETIC_CLIENT,    // Class mix and sensor calibration of a synthetic device
+    SYNTHETIC_WINDOW,    // Class, phases and impacts of a synthetic window
+    SYNTHETIC_NOISE,     // Sensor noise of a synthetic window
+    SECURE_AGGREGATION_MASK,
+    DP_NOISE,
+    REPLAY_ORDER,        // Order of a client's replay buffer in one local epoch
+    LINK_LOSS            // Frames dropped by the simulated BLE link
+};
+
+// Client id of streams that belong to the server rather than a client
+constexpr uint64_t RNG_SERVER = ~0ULL;
+
+// Random stream keyed by (seed, purpose, round, client): Philox with key (seed, purpose),
+// stream id client and the round in the high half of the block counter, so each
+// (round, client) stream has 2^32 blocks. A stream depends only on its key, never on what
+// other streams drew before, so results do not change with the order in which clients
+// are processed or the number of threads processing them. The state is 48 bytes.
+//
+// Satisfies UniformRandomBitGenerator. The distribution methods below are used instead of
+// the <random> distributions, whose algorithms differ between standard libraries.
+class CounterRng {
+public:
+    using result_type = uint32_t;
+
+    CounterRng(uint64_t seed, RngPurpose purpose, uint64_t round = 0, uint64_t client = 0)
+        : philox((seed & 0xFFFFFFFFu) | (static_cast<uint64_t>(purpose) << 32), client),
+          next_block(static_cast<uint64_t>(round & 0xFFFFFFFFu) << 32) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+    result_type operator()() {
+        if (used == 4) {
+            buffer = philox.block(next_block++);
+            used = 0;
+        }
+        return buffer[used++];
+    }
+
+    // [0, 1) with 24 random bits
+    float uniform() { return ((*this)() >> 8) * (1.0f / 16777216.0f); }
+    float uniform(float low, float high) { return low + (high - low) * uniform(); }
+    // [0, 1) with 53 random bits
+    double uniform_double() {
+        uint64_t high = (*this)() >> 5;
+        uint64_t low = (*this)() >> 6;
+        return (high * 67108864.0 + low) * (1.0 / 9007199254740992.0);
+    }
+
+    // Unbiased integer in [0, bound) (Lemire's multiply-and-reject)
+    uint32_t below(uint32_t bound) {
+        uint64_t product = static_cast<uint64_t>((*this)()) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = static_cast<uint64_t>((*this)()) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    // Standard normal (Box-Muller; the second value of each pair is kept for the next call)
+    float normal() {
+        if (has_spare) {
+            has_spare = false;
+            return spare;
+        }
+        float u1 = (((*this)() >> 8) + 1) * (1.0f / 16777216.0f);
+        float angle = 6.2831853f * uniform();
+        float radius = std::sqrt(-2.0f * std::log(u1));
+        spare = radius * std::sin(angle);
+        has_spare = true;
+        return radius * std::cos(angle);
+    }
+
+    float exponential(float rate) { return -std::log((((*this)() >> 8) + 1) * (1.0f / 16777216.0f)) / rate; }
+    float lognormal(float mu, float sigma) { return std::exp(mu + sigma * normal()); }
+    // Gamma(shape, 1) (Marsaglia and Tsang)
+    double gamma(double shape);
+
+    // Fisher-Yates with below(), identical on every platform unlike std::shuffle
+    template <typename RandomIt>
+    void shuffle(RandomIt first, RandomIt last) {
+        auto count = std::distance(first, last);
+        for (auto i = count - 1; i > 0; i--) {
+            std::swap(first[i], first[below(static_cast<uint32_t>(i + 1))]);
+        }
+    }
+
+    // Bulk output from the following blocks, faster than repeated calls
+    void fill_u32(uint32_t* out, size_t count);
+    void fill_normal(float* out, size_t count);
+
+private:
+    Philox philox;
+    uint64_t next_block;
+    Philox::Block buffer{};
+    uint8_t used = 4;
+    bool has_spare = false;
+    float spare = 0.0f;
+};
+
+#endif
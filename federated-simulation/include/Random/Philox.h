@@ -0,0 +1,55 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as easy
+// as 1, 2, 3", SC'11). Block i of a stream is a pure function of (key, stream, i), so any
+// part of a stream can be produced in any order, on any thread, without stored state.
+class Philox {
+public:
+    using Block = std::array<uint32_t, 4>;
+
+    explicit Philox(uint64_t key, uint64_t stream = 0)
+        : key{static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)},
+          stream{static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)} {}
+
+    Block block(uint64_t index) const {
+        return generate({static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                         stream[0], stream[1]}, key);
+    }
+
+    // out[i] = word first_word + i of the stream (four words per block)
+    void fill_u32(uint32_t* out, size_t count, uint64_t first_word = 0) const;
+
+    // Standard normal values from the stream, four per block (Box-Muller with polynomial
+    // log and sincos so the transform loop vectorizes)
+    void fill_normal(float* out, size_t count, uint64_t first_block = 0) const;
+
+    static Block generate(Block counter, std::array<uint32_t, 2> key) {
+        for (int round = 0; round < 10; round++) {
+            uint64_t product0 = static_cast<uint64_t>(M0) * counter[0];
+            uint64_t product1 = static_cast<uint64_t>(M1) * counter[2];
+            counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                       static_cast<uint32_t>(product1),
+                       static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                       static_cast<uint32_t>(product0)};
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return counter;
+    }
+
+private:
+    static constexpr uint32_t M0 = 0xD2511F53u;
+    static constexpr uint32_t M1 = 0xCD9E8D57u;
+    static constexpr uint32_t W0 = 0x9E3779B9u;
+    static constexpr uint32_t W1 = 0xBB67AE85u;
+
+    std::array<uint32_t, 2> key;
+    std::array<uint32_t, 2> stream;
+};
+
+#endif
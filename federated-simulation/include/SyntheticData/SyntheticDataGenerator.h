@@ -0,0 +1,81 @@
+#ifndef SYNTHETIC_DATA_GENERATOR_H
+#define SYNTHETIC_DATA_GENERATOR_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DataLoader/DataLoader.h"
+
+// Narrow-band motion around one frequency, projected onto the sensor axes
+struct SpectralComponent {
+    float frequency_hz;
+    float frequency_jitter;              // Relative spread of the frequency between windows
+    std::array<float, 3> amplitude;      // Peak acceleration per axis (m/s^2)
+};
+
+// Class-conditional signal model: a sum of narrow-band components, decaying impacts
+// arriving as a Poisson process, white sensor noise and a tilted gravity vector
+struct ClassSpectrum {
+    std::string name;
+    std::vector<SpectralComponent> components;
+    float noise_std = 0.01f;             // Per axis (m/s^2)
+    float impact_rate_hz = 0.0f;
+    float impact_amplitude = 0.0f;       // Peak of an impact (m/s^2), mostly on the z axis
+    float impact_decay_s = 0.02f;
+    float impact_frequency_hz = 15.0f;   // Ringing of the frame after an impact
+    float tilt_std_rad = 0.02f;          // Random tilt of the gravity vector per window
+};
+
+struct SyntheticDataConfig {
+    size_t samples = 10000;
+    size_t window = 256;                 // Samples per window, as recorded by the device
+    float sample_rate_hz = 100.0f;
+    std::array<float, 3> gravity = {0.39f, -0.17f, 9.54f};     // Mean reading of the mounted device
+    std::vector<ClassSpectrum> classes = default_spectra();
+    std::vector<float> class_priors = {120.0f, 120.0f, 100.0f};   // Class balance of the collected data
+
+    // Per-client class mixture drawn from Dirichlet(alpha * K * p), p the normalized
+    // priors and K the class count; 0 gives every client p (IID). Smaller values give
+    // clients fewer classes.
+    float dirichlet_alpha = 0.0f;
+    // Relative per-client spread of sensor gain and offset (mounting and calibration)
+    float device_variation = 0.05f;
+    uint32_t seed = 42;
+
+    // No theft, carrying away and lock breaking, matched to the spread of the collected data
+    static std::vector<ClassSpectrum> default_spectra();
+};
+
+// Deterministic generator of labeled 3-axis windows. Window i belongs to client
+// i % num_clients and depends only on the seed and i, so any subset can be generated
+// in any order without storing the raw data.
+class SyntheticDataGenerator {
+public:
+    SyntheticDataGenerator(const SyntheticDataConfig& config, size_t num_clients);
+
+    size_t size() const { return config.samples; }
+    size_t num_classes() const { return config.classes.size(); }
+    size_t client_of(size_t index) const { return index % num_clients; }
+    const std::vector<float>& class_mix(size_t client) const { return client_mix[client]; }
+
+    // Fill sample with window index; its buffers are reused
+    void generate(size_t index, MotionSample& sample) const;
+    MotionSample generate(size_t index) const;
+
+    // Label of window index without generating the signal
+    int label_of(size_t index) const;
+
+private:
+    struct Device {
+        std::array<float, 3> gain;
+        std::array<float, 3> offset;
+    };
+
+    SyntheticDataConfig config;
+    size_t num_clients;
+    std::vector<std::vector<float>> client_mix;   // Cumulative class probabilities per client
+    std::vector<Device> devices;
+};
+
+#endif
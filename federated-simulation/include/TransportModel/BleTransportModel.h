@@ -0,0 +1,86 @@
+#ifndef BLE_TRANSPORT_MODEL_H
+#define BLE_TRANSPORT_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class BleProtocol {
+    LEGACY,     // GET_WEIGHTS / SET_WEIGHTS: fixed chunks paced by firmware delays
+    PIPELINED   // GET/SET_WEIGHTS_PIPELINED: windowed frames of federated-client/TransferProtocol.h
+};
+
+// Parameters of the BLE weight exchange, defaults mirror federated-client/Communication.cpp
+// and federated-server/commands/handler.py
+struct BleTransportConfig {
+    BleProtocol protocol = BleProtocol::LEGACY;
+    size_t chunk_bytes_send = 32 * sizeof(float);     // CHUNK_SIZE_SEND floats per notification
+    size_t chunk_bytes_receive = 52 * sizeof(float);  // CHUNK_SIZE_RECEIVE floats per write
+    float send_chunk_delay_ms = 15.0f;     // delay(15) after each notification in sendWeights
+    float loop_delay_ms = 50.0f;           // delay(50) in loop(): one received chunk per iteration
+    float transfer_setup_ms = 50.0f;       // Server-side pause after the SET_WEIGHTS command
+    float connection_interval_ms = 30.0f;  // BLE connection interval (7.5 ms - 4 s)
+    size_t att_mtu = 247;                  // Negotiated ATT MTU
+    size_t ll_payload_bytes = 251;         // Link-layer payload (27 without data length extension)
+    size_t packets_per_event = 4;          // Link-layer packets sent per connection event
+    size_t parallel_links = 1;             // Devices the server exchanges weights with concurrently
+
+    // Pipelined transfers (BLEConfig::TRANSFER_* in federated-client/Config.h)
+    size_t frame_bytes = 244;              // Largest frame; capped at the ATT payload of the MTU
+    size_t window_frames = 8;
+    float retransmit_timeout_ms = 250.0f;
+    float frame_loss = 0.0f;               // Share of frames lost to the application (e.g. queue overflow)
+    uint64_t loss_seed = 0;
+};
+
+// Cost of moving a payload over the link
+struct TransferCost {
+    double seconds = 0.0;
+    size_t payload_bytes = 0;   // Application bytes (weights)
+    size_t air_bytes = 0;       // Payload plus ATT and L2CAP headers
+    size_t chunks = 0;          // Chunks or frames, including retransmissions and acknowledgements
+
+    TransferCost& operator+=(const TransferCost& other);
+};
+
+class BleTransportModel {
+public:
+    explicit BleTransportModel(const BleTransportConfig& config = BleTransportConfig());
+
+    // Device -> server (GET_WEIGHTS): notifications paced by the inter-chunk delay
+    TransferCost upload_cost(size_t payload_bytes) const;
+
+    // Server -> device (SET_WEIGHTS): acknowledged writes, one consumed per loop() iteration
+    TransferCost download_cost(size_t payload_bytes) const;
+
+    // One synchronous round: every participant downloads the global model and uploads its
+    // weights; sessions are spread over the configured number of parallel links
+    TransferCost round_cost(size_t download_bytes, size_t upload_bytes, size_t participants) const;
+
+    const BleTransportConfig& get_config() const { return config; }
+
+    // Frame size of pipelined transfers at the configured MTU
+    size_t pipelined_frame_bytes() const;
+
+    static BleProtocol parse_protocol(const std::string& name);
+    static std::string protocol_name(BleProtocol protocol);
+
+private:
+    // Runs the firmware's TransferSender and TransferReceiver over a simulated link:
+    // each connection event carries up to packets_per_event link-layer packets in each
+    // direction, and a frame generated during an event is sent from the next one
+    TransferCost pipelined_cost(size_t payload_bytes, bool upload) const;
+    TransferCost simulate_pipelined(size_t payload_bytes, bool upload, uint64_t trial) const;
+
+    // Time to push one chunk through the link layer at the configured packets per event
+    double link_time_ms(size_t chunk_bytes) const;
+    size_t air_bytes(size_t chunk_bytes) const;
+    double command_time_ms() const;
+
+    static constexpr size_t ATT_HEADER_BYTES = 3;
+    static constexpr size_t L2CAP_HEADER_BYTES = 4;
+
+    BleTransportConfig config;
+};
+
+#endif
@@ -17,13 +17,40 @@ std::vector<MotionSample> DataLoader::load_dataset(const std::string& metadata_f
     }
     
     std::string line;
-    // Skip header
     std::getline(file, line);
+
+    // Locate the group column in the header
+    int group_index = -1;
+    if (!group_column.empty()) {
+        std::stringstream header(line);
+        std::string name;
+        for (int i = 0; std::getline(header, name, ','); i++) {
+            if (!name.empty() && name.back() == '\r') name.pop_back();
+            if (name == group_column) group_index = i;
+        }
+        if (group_index < 0) {
+            throw std::runtime_error("Metadata file has no column " + group_column);
+        }
+    }
     
     // Read each line
     while (std::getline(file, line)) {
         std::stringstream ss(line);
         std::string field;
+
+        std::string group;
+        if (group_index >= 0) {
+            std::stringstream columns(line);
+            std::string column;
+            for (int i = 0; std::getline(columns, column, ','); i++) {
+                if (i == group_index) {
+                    group = column;
+                    break;
+                }
+            }
+            if (!group.empty() && group.back() == '\r') group.pop_back();
+            if (group_prefix > 0) group = group.substr(0, group_prefix);
+        }
         
         // Parse CSV fields
         std::getline(ss, field, ',');
@@ -41,6 +68,7 @@ std::vector<MotionSample> DataLoader::load_dataset(const std::string& metadata_f
         try {
             // Load the corresponding motion data file
             dataset.push_back(load_motion_file(filename, sample_id, timestamp, label));
+            dataset.back().group = group;
         } catch (const std::exception& e) {
             std::cerr << "Error loading " << filename << ": " << e.what() << "\n";
         }
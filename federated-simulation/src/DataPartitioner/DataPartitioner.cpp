@@ -0,0 +1,216 @@
+#include "DataPartitioner/DataPartitioner.h"
+#include "Random/CounterRng.h"
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::vector<double> dirichlet(size_t count, float alpha, CounterRng& rng) {
+    std::vector<double> proportions(count);
+    double total = 0.0;
+    for (auto& p : proportions) {
+        p = rng.gamma(alpha);
+        total += p;
+    }
+    // Every draw can underflow for a tiny alpha; fall back to an even split
+    for (auto& p : proportions) {
+        p = total > 0.0 ? p / total : 1.0 / count;
+    }
+    return proportions;
+}
+
+// Give consecutive runs of samples to clients in proportion
+void assign(const std::vector<uint32_t>& samples, const std::vector<double>& proportions,
+            const std::vector<uint32_t>& clients, std::vector<uint32_t>& owners) {
+    double cumulative = 0.0;
+    size_t start = 0;
+    for (size_t c = 0; c < clients.size(); c++) {
+        cumulative += proportions[c];
+        size_t stop = c + 1 == clients.size()
+            ? samples.size()
+            : std::min(samples.size(), static_cast<size_t>(cumulative * samples.size() + 0.5));
+        for (size_t i = start; i < stop; i++) {
+            owners[samples[i]] = clients[c];
+        }
+        start = std::max(start, stop);
+    }
+}
+
+} // namespace
+
+ClientPartition ClientPartition::build(const PartitionConfig& config,
+                                       const std::vector<int>& labels,
+                                       const std::vector<int>& groups,
+                                       size_t num_clients,
+                                       uint32_t seed) {
+    if (config.scheme == PartitionScheme::SHARED) {
+        return ClientPartition();
+    }
+    if (num_clients == 0) {
+        throw std::invalid_argument("Cannot partition data among zero clients");
+    }
+    if (labels.size() < num_clients) {
+        throw std::runtime_error("Cannot partition " + std::to_string(labels.size()) +
+                                 " training samples among " + std::to_string(num_clients) + " clients");
+    }
+    if (config.alpha <= 0.0f &&
+        (config.scheme == PartitionScheme::DIRICHLET || config.scheme == PartitionScheme::QUANTITY)) {
+        throw std::invalid_argument("Partition alpha must be positive");
+    }
+
+    CounterRng rng(seed, RngPurpose::PARTITION);
+    std::vector<uint32_t> owners(labels.size());
+    std::vector<uint32_t> all_clients(num_clients);
+    std::iota(all_clients.begin(), all_clients.end(), 0);
+
+    switch (config.scheme) {
+        case PartitionScheme::IID:
+        case PartitionScheme::QUANTITY: {
+            std::vector<uint32_t> samples(labels.size());
+            std::iota(samples.begin(), samples.end(), 0);
+            rng.shuffle(samples.begin(), samples.end());
+            std::vector<double> proportions = config.scheme == PartitionScheme::IID
+                ? std::vector<double>(num_clients, 1.0 / num_clients)
+                : dirichlet(num_clients, config.alpha, rng);
+            assign(samples, proportions, all_clients, owners);
+            break;
+        }
+        case PartitionScheme::DIRICHLET: {
+            std::map<int, std::vector<uint32_t>> by_label;
+            for (size_t i = 0; i < labels.size(); i++) {
+                by_label[labels[i]].push_back(static_cast<uint32_t>(i));
+            }
+            for (auto& entry : by_label) {
+                rng.shuffle(entry.second.begin(), entry.second.end());
+                assign(entry.second, dirichlet(num_clients, config.alpha, rng), all_clients, owners);
+            }
+            break;
+        }
+        case PartitionScheme::SHARDS: {
+            if (groups.size() != labels.size()) {
+                throw std::invalid_argument("Shard partitioning needs a group for every sample");
+            }
+            std::map<int, std::vector<uint32_t>> by_group;
+            for (size_t i = 0; i < groups.size(); i++) {
+                if (groups[i] < 0) {
+                    throw std::runtime_error("Sample without a value in the shard column");
+                }
+                by_group[groups[i]].push_back(static_cast<uint32_t>(i));
+            }
+
+            // More devices than clients: a client holds several devices. Fewer: the
+            // clients of a device hold disjoint parts of its samples.
+            size_t group_count = by_group.size();
+            size_t g = 0;
+            for (auto& entry : by_group) {
+                std::vector<uint32_t> clients;
+                if (group_count >= num_clients) {
+                    clients.push_back(static_cast<uint32_t>(g % num_clients));
+                } else {
+                    for (size_t c = g; c < num_clients; c += group_count) {
+                        clients.push_back(static_cast<uint32_t>(c));
+                    }
+                }
+                rng.shuffle(entry.second.begin(), entry.second.end());
+                assign(entry.second, std::vector<double>(clients.size(), 1.0 / clients.size()), clients, owners);
+                g++;
+            }
+            break;
+        }
+        case PartitionScheme::SHARED:
+            break;
+    }
+
+    return from_owners(owners, num_clients);
+}
+
+ClientPartition ClientPartition::from_owners(const std::vector<uint32_t>& owners, size_t num_clients) {
+    if (owners.size() < num_clients) {
+        throw std::runtime_error("Cannot partition " + std::to_string(owners.size()) +
+                                 " training samples among " + std::to_string(num_clients) + " clients");
+    }
+
+    std::vector<uint32_t> assigned(owners);
+    std::vector<uint32_t> counts(num_clients, 0);
+    for (uint32_t owner : assigned) {
+        if (owner >= num_clients) {
+            throw std::out_of_range("Sample owner " + std::to_string(owner) + " outside " +
+                                    std::to_string(num_clients) + " clients");
+        }
+        counts[owner]++;
+    }
+
+    // A client without data cannot train; move one sample from the largest client
+    for (size_t c = 0; c < num_clients; c++) {
+        if (counts[c] > 0) continue;
+        uint32_t largest = static_cast<uint32_t>(std::max_element(counts.begin(), counts.end()) - counts.begin());
+        for (size_t i = assigned.size(); i-- > 0;) {
+            if (assigned[i] == largest) {
+                assigned[i] = static_cast<uint32_t>(c);
+                counts[largest]--;
+                counts[c]++;
+                break;
+            }
+        }
+    }
+
+    // Counting sort by client keeps each client's samples in index order
+    ClientPartition partition;
+    partition.offsets.assign(num_clients + 1, 0);
+    for (size_t c = 0; c < num_clients; c++) {
+        partition.offsets[c + 1] = partition.offsets[c] + counts[c];
+    }
+    partition.indices.resize(assigned.size());
+    std::vector<uint32_t> next(partition.offsets.begin(), partition.offsets.end() - 1);
+    for (size_t i = 0; i < assigned.size(); i++) {
+        partition.indices[next[assigned[i]]++] = static_cast<uint32_t>(i);
+    }
+    return partition;
+}
+
+std::string ClientPartition::summary(const std::vector<int>& labels, size_t num_classes) const {
+    if (empty()) return "shared by all clients";
+
+    std::vector<size_t> sizes(num_clients());
+    double classes_per_client = 0.0;
+    std::vector<char> seen(num_classes);
+    for (size_t c = 0; c < num_clients(); c++) {
+        sizes[c] = size(c);
+        std::fill(seen.begin(), seen.end(), 0);
+        for (const uint32_t* i = begin(c); i != end(c); ++i) {
+            int label = labels[*i];
+            if (label >= 0 && static_cast<size_t>(label) < num_classes) seen[label] = 1;
+        }
+        classes_per_client += std::count(seen.begin(), seen.end(), 1);
+    }
+    std::sort(sizes.begin(), sizes.end());
+
+    std::ostringstream out;
+    out << sizes.front() << "/" << sizes[sizes.size() / 2] << "/" << sizes.back()
+        << " samples per client (min/median/max), "
+        << classes_per_client / num_clients() << " classes per client";
+    return out.str();
+}
+
+PartitionScheme ClientPartition::parse_scheme(const std::string& name) {
+    if (name == "shared") return PartitionScheme::SHARED;
+    if (name == "iid") return PartitionScheme::IID;
+    if (name == "dirichlet") return PartitionScheme::DIRICHLET;
+    if (name == "quantity") return PartitionScheme::QUANTITY;
+    if (name == "shards") return PartitionScheme::SHARDS;
+    throw std::invalid_argument("Unknown partition scheme: " + name);
+}
+
+const char* ClientPartition::scheme_name(PartitionScheme scheme) {
+    switch (scheme) {
+        case PartitionScheme::SHARED: return "shared";
+        case PartitionScheme::IID: return "iid";
+        case PartitionScheme::DIRICHLET: return "dirichlet";
+        case PartitionScheme::QUANTITY: return "quantity";
+        case PartitionScheme::SHARDS: return "shards";
+    }
+    return "unknown";
+}
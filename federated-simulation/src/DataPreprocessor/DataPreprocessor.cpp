@@ -1,25 +1,54 @@
 #include "DataPreprocessor/DataPreprocessor.h"
 #include <algorithm>
+#include <iterator>
 #include <numeric>
-#include <random>
+#include <stdexcept>
+#include <string>
 
 DataPreprocessor::DataPreprocessor(uint32_t seed) : 
     feature_min(0), 
     feature_max(1),
-    rng(seed),
-    base_seed(base_seed) {
+    base_seed(seed) {
 }
 
 void DataPreprocessor::prepare_dataset(const std::vector<MotionSample>& samples) {
     std::vector<TrainingSample> all_samples;
+    all_samples.reserve(samples.size());
     
     for (const auto& sample : samples) {
-        TrainingSample training_sample;
-        training_sample.features = feature_extractor.extract_features(sample);
-        training_sample.target = create_one_hot_encoding(sample.label);
-        all_samples.push_back(training_sample);
+        all_samples.push_back(make_training_sample(sample, -1));
     }
     
+    finish_dataset(all_samples);
+}
+
+void DataPreprocessor::prepare_stream(size_t count, const SampleSource& source) {
+    std::vector<TrainingSample> all_samples;
+    all_samples.reserve(count);
+
+    MotionSample sample;
+    for (size_t i = 0; i < count; i++) {
+        int client = source(i, sample);
+        all_samples.push_back(make_training_sample(sample, client));
+    }
+
+    finish_dataset(all_samples);
+}
+
+TrainingSample DataPreprocessor::make_training_sample(const MotionSample& sample, int client) {
+    TrainingSample training_sample;
+    training_sample.features = feature_extractor.extract_features(sample);
+    training_sample.target = create_one_hot_encoding(sample.label);
+    training_sample.label = sample.label;
+    training_sample.client = client;
+    if (!sample.group.empty()) {
+        auto id = group_ids.emplace(sample.group, static_cast<int>(group_ids.size())).first;
+        training_sample.group = id->second;
+    }
+    return training_sample;
+}
+
+void DataPreprocessor::finish_dataset(std::vector<TrainingSample>& all_samples) {
     feature_min = std::numeric_limits<float>::max();
     feature_max = std::numeric_limits<float>::lowest();
     
@@ -38,7 +67,11 @@ void DataPreprocessor::prepare_dataset(const std::vector<MotionSample>& samples)
 }
 
 std::vector<float> DataPreprocessor::create_one_hot_encoding(int label) {
-    std::vector<float> encoding(3, 0.0f);  // 3 classes
+    if (label < 0 || static_cast<size_t>(label) >= num_classes) {
+        throw std::out_of_range("Label " + std::to_string(label) + " outside " +
+                                std::to_string(num_classes) + " classes");
+    }
+    std::vector<float> encoding(num_classes, 0.0f);
     encoding[label] = 1.0f;
     return encoding;
 }
@@ -53,11 +86,50 @@ void DataPreprocessor::normalize_features(std::vector<float>& features) {
 }
 
 void DataPreprocessor::split_train_test(std::vector<TrainingSample>& all_samples, float test_ratio) {
-    std::shuffle(all_samples.begin(), all_samples.end(), rng);
+    CounterRng(base_seed, RngPurpose::DATA_SPLIT).shuffle(all_samples.begin(), all_samples.end());
     
     size_t test_size = static_cast<size_t>(all_samples.size() * test_ratio);
-    test_set.assign(all_samples.begin(), all_samples.begin() + test_size);
-    training_set.assign(all_samples.begin() + test_size, all_samples.end());
+    test_set.assign(std::make_move_iterator(all_samples.begin()),
+                    std::make_move_iterator(all_samples.begin() + test_size));
+    training_set.assign(std::make_move_iterator(all_samples.begin() + test_size),
+                        std::make_move_iterator(all_samples.end()));
+    all_samples.clear();
+
+    build_partition();
+    reset_sampling();
+}
+
+void DataPreprocessor::build_partition() {
+    partition = ClientPartition();
+
+    std::vector<int> labels(training_set.size());
+    std::vector<int> groups(training_set.size());
+    std::vector<uint32_t> owners(training_set.size());
+    bool owned = !training_set.empty();
+    size_t owner_clients = partition_clients;
+    for (size_t i = 0; i < training_set.size(); i++) {
+        labels[i] = training_set[i].label;
+        groups[i] = training_set[i].group;
+        owned = owned && training_set[i].client >= 0;
+        if (owned) {
+            owners[i] = static_cast<uint32_t>(training_set[i].client);
+            if (partition_clients == 0) owner_clients = std::max<size_t>(owner_clients, owners[i] + 1);
+        }
+    }
+
+    if (partition_config.scheme != PartitionScheme::SHARED) {
+        partition = ClientPartition::build(partition_config, labels, groups, partition_clients, base_seed);
+    } else if (owned) {
+        partition = ClientPartition::from_owners(owners, owner_clients);
+    }
+}
+
+std::string DataPreprocessor::partition_summary() const {
+    std::vector<int> labels(training_set.size());
+    for (size_t i = 0; i < training_set.size(); i++) {
+        labels[i] = training_set[i].label;
+    }
+    return partition.summary(labels, num_classes);
 }
 
 TrainingSample DataPreprocessor::get_next_training_sample(size_t client_id) {
@@ -67,17 +139,22 @@ TrainingSample DataPreprocessor::get_next_training_sample(size_t client_id) {
     
     // Initialize client-specific RNG and indices if not exists
     if (client_rngs.find(client_id) == client_rngs.end()) {
-        // Create deterministic seed for this client using base_seed
-        uint32_t client_seed = base_seed + client_id;
-        client_rngs[client_id] = std::mt19937(client_seed);
+        CounterRng& rng = client_rngs.emplace(client_id, CounterRng(base_seed, RngPurpose::SAMPLE_ORDER, 0, client_id))
+                              .first->second;
         
-        // Initialize shuffled indices for this client
-        client_shuffled_indices[client_id].resize(training_set.size());
-        std::iota(client_shuffled_indices[client_id].begin(), 
-                 client_shuffled_indices[client_id].end(), 0);
-        std::shuffle(client_shuffled_indices[client_id].begin(), 
-                    client_shuffled_indices[client_id].end(), 
-                    client_rngs[client_id]);
+        // Initialize shuffled indices for this client: its partition, or all samples
+        if (!partition.empty()) {
+            if (client_id >= partition.num_clients()) {
+                throw std::out_of_range("Client " + std::to_string(client_id) + " outside the " +
+                                        std::to_string(partition.num_clients()) + " partitioned clients");
+            }
+            client_shuffled_indices[client_id].assign(partition.begin(client_id), partition.end(client_id));
+        } else {
+            client_shuffled_indices[client_id].resize(training_set.size());
+            std::iota(client_shuffled_indices[client_id].begin(), 
+                     client_shuffled_indices[client_id].end(), 0);
+        }
+        rng.shuffle(client_shuffled_indices[client_id].begin(), client_shuffled_indices[client_id].end());
         
         client_current_indices[client_id] = 0;
     }
@@ -88,13 +165,12 @@ TrainingSample DataPreprocessor::get_next_training_sample(size_t client_id) {
     
     // Update client's position
     client_current_indices[client_id] = 
-        (client_current_indices[client_id] + 1) % training_set.size();
+        (client_current_indices[client_id] + 1) % client_shuffled_indices[client_id].size();
     
     // Reshuffle this client's indices if we've gone through all samples
     if (client_current_indices[client_id] == 0) {
-        std::shuffle(client_shuffled_indices[client_id].begin(), 
-                    client_shuffled_indices[client_id].end(), 
-                    client_rngs[client_id]);
+        client_rngs.at(client_id).shuffle(client_shuffled_indices[client_id].begin(),
+                                          client_shuffled_indices[client_id].end());
     }
     
     return sample;
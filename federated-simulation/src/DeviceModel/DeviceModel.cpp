@@ -0,0 +1,123 @@
+#include "DeviceModel/DeviceModel.h"
+#include "Random/CounterRng.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Position of time within a device's day, starting at its online window
+double day_phase(double time, double start, double day) {
+    double phase = std::fmod(time - start, day);
+    return phase < 0.0 ? phase + day : phase;
+}
+
+} // namespace
+
+DeviceTimings DeviceTimings::from_benchmark_log(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open benchmark log: " + path);
+    }
+
+    // Lines look like "Feature Extraction: 11873 microseconds"
+    DeviceTimings timings;
+    std::string line;
+    auto read_value = [&](const std::string& key, float& value) {
+        if (line.compare(0, key.size(), key) != 0 || line.find("microseconds") == std::string::npos) {
+            return;
+        }
+        value = std::stof(line.substr(key.size()));
+    };
+    while (std::getline(file, line)) {
+        read_value("Data Collection:", timings.data_collection_us);
+        read_value("Feature Extraction:", timings.feature_extraction_us);
+        read_value("Inference:", timings.inference_us);
+        read_value("Training:", timings.training_us);
+    }
+    if (timings.training_us <= 0.0f) {
+        throw std::runtime_error("Benchmark log has no positive training time: " + path);
+    }
+    return timings;
+}
+
+DeviceModel::DeviceModel(const DeviceConfig& config, size_t num_clients, uint32_t seed)
+    : config(config), profiles(num_clients) {
+
+    if (config.reference.training_us <= 0.0f || config.reference.topology.size() < 2) {
+        throw std::runtime_error("Device reference timings need a training time and topology");
+    }
+    if (config.online_fraction <= 0.0f || config.day_seconds <= 0.0f) {
+        throw std::runtime_error("Devices must be online for part of the day");
+    }
+
+    const double reference_flops = training_flops(config.reference.topology) /
+                                   (config.reference.training_us * 1e-6);
+    for (size_t c = 0; c < profiles.size(); c++) {
+        CounterRng rng(seed, RngPurpose::DEVICE_PROFILE, 0, c);
+        DeviceProfile& profile = profiles[c];
+        double factor = rng.lognormal(0.0f, config.speed_spread);
+        profile.flops_per_second = reference_flops * factor;
+        profile.feature_extraction_seconds = config.reference.feature_extraction_us * 1e-6 / factor;
+        profile.battery_joules = config.battery_joules > 0.0f
+            ? config.battery_joules * rng.uniform(0.5f, 1.5f)
+            : std::numeric_limits<double>::infinity();
+        profile.online_start_seconds = rng.uniform_double() * config.day_seconds;
+    }
+}
+
+double DeviceModel::training_flops(const std::vector<size_t>& topology) {
+    double forward = 0.0;
+    for (size_t i = 0; i + 1 < topology.size(); i++) {
+        forward += 2.0 * topology[i] * topology[i + 1];
+    }
+    return 3.0 * forward;
+}
+
+double DeviceModel::compute_seconds(size_t client_id, size_t samples, const std::vector<size_t>& topology,
+                                    size_t replayed) const {
+    const DeviceProfile& device = profiles[client_id];
+    const double training_seconds = training_flops(topology) / device.flops_per_second;
+    double per_window = config.reference.data_collection_us * 1e-6 +
+                        device.feature_extraction_seconds +
+                        training_seconds;
+    // Replayed windows are already collected and featurized
+    return samples * per_window + replayed * training_seconds;
+}
+
+bool DeviceModel::has_battery(size_t client_id) const {
+    return profiles[client_id].battery_joules > 0.0;
+}
+
+bool DeviceModel::available(size_t client_id, double time) const {
+    if (!has_battery(client_id)) return false;
+    if (config.online_fraction >= 1.0f) return true;
+    return day_phase(time, profiles[client_id].online_start_seconds, config.day_seconds) <
+           config.online_fraction * config.day_seconds;
+}
+
+double DeviceModel::next_available(double time) const {
+    double earliest = std::numeric_limits<double>::infinity();
+    for (size_t c = 0; c < profiles.size(); c++) {
+        if (!has_battery(c)) continue;
+        if (available(c, time)) return time;
+        double phase = day_phase(time, profiles[c].online_start_seconds, config.day_seconds);
+        earliest = std::min(earliest, time + (config.day_seconds - phase) + 1e-6);
+    }
+    return earliest;
+}
+
+void DeviceModel::consume(size_t client_id, double compute_seconds, double transfer_seconds) {
+    profiles[client_id].battery_joules -= (config.active_power_mw * compute_seconds +
+                                           config.radio_power_mw * transfer_seconds) * 1e-3;
+}
+
+size_t DeviceModel::depleted_count() const {
+    size_t depleted = 0;
+    for (size_t c = 0; c < profiles.size(); c++) {
+        if (!has_battery(c)) depleted++;
+    }
+    return depleted;
+}
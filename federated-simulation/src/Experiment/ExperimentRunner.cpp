@@ -0,0 +1,477 @@
+#include "Experiment/ExperimentRunner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+    using OptionList = std::vector<std::pair<std::string, const JsonValue*>>;
+
+    // Command line options the runner sets itself or that make no sense for a batch
+    void check_option(const std::string& name) {
+        if (name == "seed") {
+            throw std::runtime_error("Experiment runs take their seeds from \"seeds\"");
+        }
+        if (name == "metrics") {
+            throw std::runtime_error("Experiment runs write metrics files to \"metrics-dir\"");
+        }
+        static const char* const unsupported[] = {
+            "hpo", "quick-search", "experiment", "jobs", "results", "help",
+            "profile", "trace", "trace-rounds", "export-model"
+        };
+        for (const char* option : unsupported) {
+            if (name == option) {
+                throw std::runtime_error("Option --" + name + " is not supported in experiments");
+            }
+        }
+    }
+
+    void set_option(OptionList& options, const std::string& name, const JsonValue& value) {
+        check_option(name);
+        for (auto& option : options) {
+            if (option.first == name) {
+                option.second = &value;
+                return;
+            }
+        }
+        options.emplace_back(name, &value);
+    }
+
+    // Command line value of an option: scalars as written, arrays joined with commas
+    std::string option_value(const std::string& name, const JsonValue& value) {
+        if (value.is_array()) {
+            std::string joined;
+            for (const auto& item : value.items()) {
+                if (item.is_array() || item.is_object() || item.is_null()) {
+                    throw std::runtime_error("Option " + name + " has a nested value");
+                }
+                joined += (joined.empty() ? "" : ",") + item.text();
+            }
+            return joined;
+        }
+        if (value.is_object()) {
+            throw std::runtime_error("Option " + name + " has an object value");
+        }
+        return value.is_null() ? "unset" : value.text();
+    }
+
+    uint32_t seed_value(const JsonValue& value) {
+        double seed = value.as_number();
+        if (seed < 0.0 || seed > 4294967295.0 || seed != std::floor(seed)) {
+            throw std::runtime_error("Seeds must be integers between 0 and 2^32 - 1, got " + value.text());
+        }
+        return static_cast<uint32_t>(seed);
+    }
+
+    // JSON has no NaN or infinity
+    std::string json_number(double value) {
+        if (!std::isfinite(value)) return "null";
+        std::ostringstream out;
+        out << std::setprecision(10) << value;
+        return out.str();
+    }
+
+    std::string json_statistic(const ResultStatistic& statistic) {
+        return "{\"count\": " + std::to_string(statistic.count) +
+               ", \"mean\": " + (statistic.count ? json_number(statistic.mean) : "null") +
+               ", \"std\": " + (statistic.count ? json_number(statistic.stddev) : "null") + "}";
+    }
+
+    double member_number(const JsonValue& object, const char* key, double fallback) {
+        const JsonValue* value = object.find(key);
+        return value && value->is_number() ? value->as_number() : fallback;
+    }
+}
+
+std::string ExperimentConfig::options() const {
+    std::string joined;
+    for (const auto& arg : args) {
+        joined += (joined.empty() ? "" : " ") + arg;
+    }
+    return joined;
+}
+
+ExperimentSpec ExperimentSpec::from_json(const JsonValue& json) {
+    if (!json.is_object()) {
+        throw std::runtime_error("An experiment spec must be a JSON object");
+    }
+    static const char* const keys[] = {"base", "configs", "sweep", "seeds", "jobs", "results", "metrics-dir"};
+    for (const auto& member : json.members()) {
+        if (std::find_if(std::begin(keys), std::end(keys),
+                         [&](const char* key) { return member.first == key; }) == std::end(keys)) {
+            throw std::runtime_error("Unknown experiment spec key: " + member.first);
+        }
+    }
+
+    ExperimentSpec spec;
+    OptionList base;
+    if (const JsonValue* value = json.find("base")) {
+        for (const auto& option : value->members()) {
+            set_option(base, option.first, option.second);
+        }
+    }
+
+    // Each variant overrides the base options and is labelled by the values it sets
+    struct Variant {
+        OptionList options;
+        std::vector<std::string> label;
+    };
+    std::vector<Variant> variants(1);
+    if (const JsonValue* value = json.find("configs")) {
+        if (value->items().empty()) {
+            throw std::runtime_error("Experiment \"configs\" is empty");
+        }
+        variants.clear();
+        for (const auto& config : value->items()) {
+            Variant variant;
+            for (const auto& option : config.members()) {
+                set_option(variant.options, option.first, option.second);
+                variant.label.push_back(option.first + "=" + option_value(option.first, option.second));
+            }
+            variants.push_back(std::move(variant));
+        }
+    }
+    if (const JsonValue* value = json.find("sweep")) {
+        for (const auto& parameter : value->members()) {
+            if (parameter.second.items().empty()) {
+                throw std::runtime_error("Sweep of " + parameter.first + " has no values");
+            }
+            std::vector<Variant> combined;
+            for (const auto& variant : variants) {
+                for (const auto& option : parameter.second.items()) {
+                    Variant next = variant;
+                    set_option(next.options, parameter.first, option);
+                    next.label.push_back(parameter.first + "=" + option_value(parameter.first, option));
+                    combined.push_back(std::move(next));
+                }
+            }
+            variants = std::move(combined);
+        }
+    }
+
+    for (const auto& variant : variants) {
+        OptionList options = base;
+        for (const auto& option : variant.options) {
+            set_option(options, option.first, *option.second);
+        }
+
+        ExperimentConfig config;
+        for (const auto& option : options) {
+            const JsonValue& value = *option.second;
+            if (value.is_null() || (value.type() == JsonValue::Type::BOOLEAN && !value.as_bool())) {
+                continue;
+            }
+            config.args.push_back("--" + option.first);
+            if (value.type() != JsonValue::Type::BOOLEAN) {
+                config.args.push_back(option_value(option.first, value));
+            }
+        }
+        for (const auto& part : variant.label) {
+            config.label += (config.label.empty() ? "" : ", ") + part;
+        }
+        if (config.label.empty()) config.label = "base";
+        spec.configs.push_back(std::move(config));
+    }
+
+    if (const JsonValue* value = json.find("seeds")) {
+        if (value->is_array()) {
+            for (const auto& seed : value->items()) {
+                spec.seeds.push_back(seed_value(seed));
+            }
+        } else {
+            uint32_t count = seed_value(*value);
+            for (uint32_t i = 0; i < count; i++) {
+                spec.seeds.push_back(FIRST_SEED + i);
+            }
+        }
+        std::vector<uint32_t> sorted = spec.seeds;
+        std::sort(sorted.begin(), sorted.end());
+        if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+            throw std::runtime_error("Experiment seeds must be distinct");
+        }
+    } else {
+        spec.seeds.push_back(FIRST_SEED);
+    }
+    if (spec.seeds.empty()) {
+        throw std::runtime_error("Experiment has no seeds");
+    }
+
+    if (const JsonValue* value = json.find("jobs")) spec.jobs = seed_value(*value);
+    if (const JsonValue* value = json.find("results")) spec.results_path = value->as_string();
+    if (const JsonValue* value = json.find("metrics-dir")) spec.metrics_dir = value->as_string();
+    return spec;
+}
+
+ExperimentSpec ExperimentSpec::load(const std::string& path) {
+    JsonValue json = JsonValue::parse_file(path);
+    try {
+        return from_json(json);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+ResultStatistic ResultStatistic::of(const std::vector<double>& values) {
+    ResultStatistic statistic;
+    statistic.count = values.size();
+    if (values.empty()) return statistic;
+    double sum = 0.0;
+    for (double value : values) sum += value;
+    statistic.mean = sum / values.size();
+    if (values.size() > 1) {
+        double squares = 0.0;
+        for (double value : values) squares += (value - statistic.mean) * (value - statistic.mean);
+        statistic.stddev = std::sqrt(squares / (values.size() - 1));
+    }
+    return statistic;
+}
+
+ExperimentRunner::ExperimentRunner(ExperimentSpec spec, SimulationFactory factory)
+    : spec(std::move(spec)), factory(std::move(factory)) {
+}
+
+bool ExperimentRunner::completed(const std::string& options, uint32_t seed) const {
+    return std::any_of(records.begin(), records.end(), [&](const RunRecord& record) {
+        return record.seed == seed && record.options == options;
+    });
+}
+
+std::vector<const ExperimentRunner::RunRecord*> ExperimentRunner::records_of(const ExperimentConfig& config) const {
+    const std::string options = config.options();
+    std::vector<const RunRecord*> matching;
+    for (const auto& record : records) {
+        if (record.options == options &&
+            std::find(spec.seeds.begin(), spec.seeds.end(), record.seed) != spec.seeds.end()) {
+            matching.push_back(&record);
+        }
+    }
+    return matching;
+}
+
+void ExperimentRunner::load_results() {
+    records.clear();
+    if (!std::filesystem::exists(spec.results_path)) {
+        return;
+    }
+
+    JsonValue json;
+    try {
+        json = JsonValue::parse_file(spec.results_path);
+        const JsonValue* runs = json.find("runs");
+        if (!runs) return;
+        for (const auto& run : runs->items()) {
+            RunRecord record;
+            record.options = run.find("options") ? run.find("options")->as_string() : "";
+            record.seed = run.find("seed") ? seed_value(*run.find("seed")) : 0;
+            record.result.rounds_to_success = static_cast<int>(member_number(run, "rounds_to_success", -1.0));
+            record.result.seconds_to_success = member_number(run, "seconds_to_success", 0.0);
+            record.result.final_accuracy = static_cast<float>(member_number(run, "final_accuracy", 0.0));
+            record.result.final_loss = static_cast<float>(member_number(run, "final_loss", NAN));
+            record.result.macro_f1 = static_cast<float>(member_number(run, "macro_f1", 0.0));
+            record.result.sim_time = member_number(run, "sim_time", 0.0);
+            record.result.bytes = static_cast<size_t>(member_number(run, "bytes", 0.0));
+            record.wall_seconds = member_number(run, "wall_seconds", 0.0);
+            records.push_back(record);
+        }
+    } catch (const std::runtime_error& e) {
+        // Never overwrite results that could not be read
+        throw std::runtime_error("Cannot resume from " + spec.results_path + ": " + e.what());
+    }
+}
+
+void ExperimentRunner::write_results() const {
+    std::ostringstream out;
+    out << "{\n  \"configs\": [";
+    for (size_t c = 0; c < spec.configs.size(); c++) {
+        const ExperimentConfig& config = spec.configs[c];
+        std::vector<double> rounds, seconds, accuracy, loss;
+        auto matching = records_of(config);
+        for (const RunRecord* record : matching) {
+            if (record->result.rounds_to_success > 0) {
+                rounds.push_back(record->result.rounds_to_success);
+                seconds.push_back(record->result.seconds_to_success);
+            }
+            accuracy.push_back(record->result.final_accuracy);
+            if (std::isfinite(record->result.final_loss)) loss.push_back(record->result.final_loss);
+        }
+        out << (c ? ",\n" : "\n")
+            << "    {\"label\": " << JsonValue::quote(config.label)
+            << ", \"options\": " << JsonValue::quote(config.options())
+            << ", \"runs\": " << matching.size()
+            << ", \"successes\": " << rounds.size() << ",\n"
+            << "     \"rounds_to_success\": " << json_statistic(ResultStatistic::of(rounds)) << ",\n"
+            << "     \"seconds_to_success\": " << json_statistic(ResultStatistic::of(seconds)) << ",\n"
+            << "     \"final_accuracy\": " << json_statistic(ResultStatistic::of(accuracy)) << ",\n"
+            << "     \"final_loss\": " << json_statistic(ResultStatistic::of(loss)) << "}";
+    }
+    out << "\n  ],\n  \"runs\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const RunRecord& record = records[i];
+        const SimulationResult& result = record.result;
+        out << (i ? ",\n" : "\n")
+            << "    {\"options\": " << JsonValue::quote(record.options)
+            << ", \"seed\": " << record.seed
+            << ", \"rounds_to_success\": "
+            << (result.rounds_to_success > 0 ? std::to_string(result.rounds_to_success) : "null")
+            << ", \"seconds_to_success\": "
+            << (result.rounds_to_success > 0 ? json_number(result.seconds_to_success) : "null")
+            << ", \"final_accuracy\": " << json_number(result.final_accuracy)
+            << ", \"final_loss\": " << json_number(result.final_loss)
+            << ", \"macro_f1\": " << json_number(result.macro_f1)
+            << ", \"sim_time\": " << json_number(result.sim_time)
+            << ", \"bytes\": " << result.bytes
+            << ", \"wall_seconds\": " << json_number(record.wall_seconds) << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    // Replace the file in one step, so an interrupted batch always leaves readable results
+    const std::string temporary = spec.results_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file || !(file << out.str()) || !file.flush()) {
+            throw std::runtime_error("Cannot write " + temporary);
+        }
+    }
+    if (std::rename(temporary.c_str(), spec.results_path.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace " + spec.results_path);
+    }
+}
+
+void ExperimentRunner::print_summary() const {
+    std::cout << "\n=== Experiment Results ===\n";
+    for (const auto& config : spec.configs) {
+        std::vector<double> rounds, accuracy;
+        auto matching = records_of(config);
+        for (const RunRecord* record : matching) {
+            if (record->result.rounds_to_success > 0) rounds.push_back(record->result.rounds_to_success);
+            accuracy.push_back(100.0 * record->result.final_accuracy);
+        }
+        ResultStatistic rounds_statistic = ResultStatistic::of(rounds);
+        ResultStatistic accuracy_statistic = ResultStatistic::of(accuracy);
+        std::cout << config.label << "\n"
+                  << "  Success: " << rounds.size() << " of " << matching.size() << " runs";
+        if (!rounds.empty()) {
+            std::cout << ", rounds to success " << rounds_statistic.mean << " +/- " << rounds_statistic.stddev;
+        }
+        std::cout << "\n  Final Accuracy: " << accuracy_statistic.mean << "% +/- " << accuracy_statistic.stddev
+                  << "%\n";
+    }
+    std::cout << "Results saved to " << spec.results_path << std::endl;
+}
+
+size_t ExperimentRunner::run() {
+    if (spec.configs.empty()) {
+        throw std::runtime_error("Experiment has no configurations");
+    }
+    load_results();
+
+    // Configure every missing run first, so a bad option fails before anything runs
+    std::vector<PendingRun> pending;
+    for (size_t c = 0; c < spec.configs.size(); c++) {
+        const ExperimentConfig& config = spec.configs[c];
+        for (uint32_t seed : spec.seeds) {
+            if (completed(config.options(), seed)) continue;
+            std::vector<std::string> args = config.args;
+            args.push_back("--seed");
+            args.push_back(std::to_string(seed));
+            PendingRun run{c, seed, factory(args)};
+            run.simulation->set_quiet(true);
+            std::string metrics_path;
+            if (!spec.metrics_dir.empty()) {
+                std::filesystem::create_directories(spec.metrics_dir);
+                metrics_path = (std::filesystem::path(spec.metrics_dir) /
+                                ("config" + std::to_string(c) + "_seed" + std::to_string(seed) + ".csv")).string();
+            }
+            run.simulation->set_metrics_file(metrics_path);
+            pending.push_back(std::move(run));
+        }
+    }
+
+    // Each dataset is loaded once; the runs that read it share the copy
+    std::map<std::string, std::shared_ptr<const std::vector<MotionSample>>> datasets;
+    for (auto& run : pending) {
+        std::string source = run.simulation->dataset_source();
+        if (source.empty()) continue;
+        auto& dataset = datasets[source];
+        if (!dataset) {
+            dataset = run.simulation->load_dataset();
+            std::cout << "Loaded " << dataset->size() << " samples from " << source << "\n";
+        }
+        run.simulation->set_dataset(dataset);
+    }
+
+    const size_t total = spec.configs.size() * spec.seeds.size();
+    size_t jobs = spec.jobs > 0 ? spec.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max(size_t(1), std::min(jobs, pending.size()));
+    std::cout << "Experiment: " << spec.configs.size() << " configuration(s) x " << spec.seeds.size()
+              << " seed(s), " << (total - pending.size()) << " run(s) already in " << spec.results_path
+              << ", " << pending.size() << " to run on " << jobs << " thread(s)\n";
+
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+    size_t failures = 0;
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < pending.size();) {
+            PendingRun& run = pending[i];
+            const ExperimentConfig& config = spec.configs[run.config];
+            auto start = std::chrono::steady_clock::now();
+            try {
+                run.simulation->run_simulation();
+            } catch (const std::exception& e) {
+                run.simulation.reset();
+                std::lock_guard<std::mutex> lock(records_mutex);
+                failures++;
+                std::cerr << "Run " << config.label << ", seed " << run.seed << " failed: " << e.what() << "\n";
+                continue;
+            }
+            RunRecord record;
+            record.options = config.options();
+            record.seed = run.seed;
+            record.result = run.simulation->get_result();
+            record.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            run.simulation.reset();
+
+            std::lock_guard<std::mutex> lock(records_mutex);
+            records.push_back(record);
+            try {
+                write_results();
+            } catch (const std::exception& e) {
+                // The run stays in memory and is written with the next result
+                std::cerr << "Warning: " << e.what() << "\n";
+            }
+            finished++;
+            std::cout << "[" << (finished + failures) << "/" << pending.size() << "] " << config.label
+                      << ", seed " << run.seed << ": ";
+            if (record.result.rounds_to_success > 0) {
+                std::cout << "success after " << record.result.rounds_to_success << " rounds";
+            } else {
+                std::cout << "no success";
+            }
+            std::cout << ", accuracy " << (record.result.final_accuracy * 100.0f) << "% ("
+                      << record.wall_seconds << "s)" << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < jobs; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    write_results();
+    print_summary();
+    return failures;
+}
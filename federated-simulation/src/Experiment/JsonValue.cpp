@@ -0,0 +1,295 @@
+#include "Experiment/JsonValue.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+class JsonValue::Parser {
+public:
+    explicit Parser(const std::string& text) : text(text) {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (pos != text.size()) fail("unexpected text after the document");
+        return value;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("JSON error at offset " + std::to_string(pos) + ": " + message);
+    }
+
+    void skip_whitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    void expect(char c) {
+        skip_whitespace();
+        if (pos >= text.size() || text[pos] != c) fail(std::string("expected '") + c + "'");
+        pos++;
+    }
+
+    bool consume(const char* word) {
+        size_t length = std::char_traits<char>::length(word);
+        if (text.compare(pos, length, word) != 0) return false;
+        pos += length;
+        return true;
+    }
+
+    JsonValue parse_value(int depth) {
+        if (depth > MAX_DEPTH) fail("nested too deeply");
+        skip_whitespace();
+        if (pos >= text.size()) fail("unexpected end of document");
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            value.value_type = Type::OBJECT;
+            pos++;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return value;
+            }
+            for (;;) {
+                skip_whitespace();
+                if (pos >= text.size() || text[pos] != '"') fail("expected a member name");
+                std::string key = parse_string();
+                expect(':');
+                value.fields.emplace_back(std::move(key), parse_value(depth + 1));
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                expect('}');
+                return value;
+            }
+        }
+        if (c == '[') {
+            value.value_type = Type::ARRAY;
+            pos++;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return value;
+            }
+            for (;;) {
+                value.elements.push_back(parse_value(depth + 1));
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                expect(']');
+                return value;
+            }
+        }
+        if (c == '"') {
+            value.value_type = Type::STRING;
+            value.scalar = parse_string();
+            return value;
+        }
+        if (consume("true")) {
+            value.value_type = Type::BOOLEAN;
+            value.boolean = true;
+            return value;
+        }
+        if (consume("false")) {
+            value.value_type = Type::BOOLEAN;
+            return value;
+        }
+        if (consume("null")) {
+            return value;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            value.value_type = Type::NUMBER;
+            value.scalar = parse_number();
+            return value;
+        }
+        fail(std::string("unexpected character '") + c + "'");
+    }
+
+    std::string parse_number() {
+        size_t start = pos;
+        auto digits = [&]() {
+            size_t first = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') pos++;
+            if (pos == first) fail("expected a digit");
+        };
+        if (text[pos] == '-') pos++;
+        digits();
+        if (pos < text.size() && text[pos] == '.') {
+            pos++;
+            digits();
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            pos++;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) pos++;
+            digits();
+        }
+        return text.substr(start, pos - start);
+    }
+
+    unsigned int parse_hex4() {
+        if (pos + 4 > text.size()) fail("truncated \\u escape");
+        unsigned int code = 0;
+        for (int i = 0; i < 4; i++) {
+            char h = text[pos++];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= h - '0';
+            else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+            else fail("invalid \\u escape");
+        }
+        return code;
+    }
+
+    static void append_utf8(std::string& out, unsigned int code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parse_string() {
+        pos++;  // Opening quote
+        std::string out;
+        for (;;) {
+            if (pos >= text.size()) fail("unterminated string");
+            char c = text[pos++];
+            if (c == '"') return out;
+            if (static_cast<unsigned char>(c) < 0x20) fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) fail("unterminated string");
+            char e = text[pos++];
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned int code = parse_hex4();
+                    // Surrogate pair
+                    if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                        pos += 2;
+                        unsigned int low = parse_hex4();
+                        if (low < 0xDC00 || low >= 0xE000) fail("invalid surrogate pair");
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default: fail(std::string("invalid escape '\\") + e + "'");
+            }
+        }
+    }
+
+    const std::string& text;
+    size_t pos = 0;
+};
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return Parser(text).parse_document();
+}
+
+JsonValue JsonValue::parse_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    try {
+        return parse(contents.str());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+bool JsonValue::as_bool() const {
+    if (value_type != Type::BOOLEAN) throw std::runtime_error("Expected a JSON boolean");
+    return boolean;
+}
+
+double JsonValue::as_number() const {
+    if (value_type != Type::NUMBER) throw std::runtime_error("Expected a JSON number");
+    return std::strtod(scalar.c_str(), nullptr);
+}
+
+const std::string& JsonValue::as_string() const {
+    if (value_type != Type::STRING) throw std::runtime_error("Expected a JSON string");
+    return scalar;
+}
+
+const std::vector<JsonValue>& JsonValue::items() const {
+    if (value_type != Type::ARRAY) throw std::runtime_error("Expected a JSON array");
+    return elements;
+}
+
+const std::vector<std::pair<std::string, JsonValue>>& JsonValue::members() const {
+    if (value_type != Type::OBJECT) throw std::runtime_error("Expected a JSON object");
+    return fields;
+}
+
+std::string JsonValue::text() const {
+    switch (value_type) {
+        case Type::BOOLEAN: return boolean ? "true" : "false";
+        case Type::NUMBER:
+        case Type::STRING: return scalar;
+        default: throw std::runtime_error("Expected a JSON number, string or boolean");
+    }
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    for (const auto& field : members()) {
+        if (field.first == key) return &field.second;
+    }
+    return nullptr;
+}
+
+std::string JsonValue::quote(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[7];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
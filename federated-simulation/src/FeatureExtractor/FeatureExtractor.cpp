@@ -1,19 +1,29 @@
 #include "FeatureExtractor/FeatureExtractor.h"
 #include <cmath>
 #include <algorithm>
+#include <mutex>
 #include <numeric>
 
+namespace {
+    // Only fftwf_execute is thread-safe; planning and destroying plans share FFTW's planner
+    std::mutex planner_mutex;
+}
+
 FeatureExtractor::FeatureExtractor() : buffer_size(256) {  // Using 256 samples like Arduino
     // Allocate FFTW buffers
     fft_in = fftwf_alloc_real(buffer_size);
     fft_out = fftwf_alloc_complex(buffer_size/2 + 1);
     
     // Create FFT plan
+    std::lock_guard<std::mutex> lock(planner_mutex);
     fft_plan = fftwf_plan_dft_r2c_1d(buffer_size, fft_in, fft_out, FFTW_MEASURE);
 }
 
 FeatureExtractor::~FeatureExtractor() {
-    fftwf_destroy_plan(fft_plan);
+    {
+        std::lock_guard<std::mutex> lock(planner_mutex);
+        fftwf_destroy_plan(fft_plan);
+    }
     fftwf_free(fft_in);
     fftwf_free(fft_out);
 }
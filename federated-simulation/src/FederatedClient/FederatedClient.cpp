@@ -1,29 +1,250 @@
 #include "FederatedClient/FederatedClient.h"
+#include <stdexcept>
+#include <algorithm>
 
 FederatedClient::FederatedClient(
     const std::vector<size_t>& topology,
     std::shared_ptr<DataPreprocessor> preprocessor,
-    uint32_t seed)
-    : network(topology, seed),
+    uint32_t seed,
+    uint32_t client_id,
+    ModelBackend backend,
+    const std::vector<Activation>& activations,
+    const OptimizerConfig& optimizer_config)
+    : network(topology, seed, client_id, activations),
+      topology(topology),
+      backend(backend),
       preprocessor(preprocessor),
-      rng(seed) {
+      optimizer(optimizer_config, network.parameter_count()),
+      codec_rng_state(CounterRng(seed, RngPurpose::CODEC_ROUNDING, 0, client_id)() | 1u),
+      seed(seed),
+      client_id(client_id),
+      replay_features(topology.front()),
+      replay_target(topology.back()) {
+    if (backend != ModelBackend::FLOAT32) {
+        const std::string name = backend == ModelBackend::FIXED_POINT ? "fixed-point" : "sparse";
+        for (Activation activation : network.get_activations()) {
+            if (activation != Activation::SIGMOID) {
+                throw std::runtime_error("The " + name + " backend supports sigmoid layers only");
+            }
+        }
+        if (!optimizer_config.fused_sgd()) {
+            throw std::runtime_error("The " + name + " backend supports plain SGD only");
+        }
+    }
+    if (backend == ModelBackend::SPARSE) {
+        std::vector<unsigned int> layers(topology.begin(), topology.end());
+        std::vector<float> weights = network.get_flat_weights();
+        if (!sparse_network.init(layers.data(), static_cast<unsigned int>(layers.size())) ||
+            !sparse_network.setParameters(weights.data(), weights.size())) {
+            throw std::runtime_error("Topology not supported by the sparse backend");
+        }
+    }
+    if (backend == ModelBackend::FIXED_POINT) {
+        std::vector<unsigned int> layers(topology.begin(), topology.end());
+        // Stochastic rounding of weight updates uses the codec stream one word further on
+        CounterRng rounding(seed, RngPurpose::CODEC_ROUNDING, 0, client_id);
+        rounding();
+        std::vector<float> weights = network.get_flat_weights();
+        if (!fixed_network.init(layers.data(), static_cast<unsigned int>(layers.size()), rounding() | 1u) ||
+            !fixed_network.setParameters(weights.data(), weights.size())) {
+            throw std::runtime_error("Topology not supported by the fixed-point backend");
+        }
+    }
+
+    // Until a global model is received, updates are relative to zero
+    received_weights.assign(network.get_flat_weights().size(), 0.0f);
+    upload_residual.assign(received_weights.size(), 0.0f);
 }
 
 void FederatedClient::train_on_sample(const std::vector<float>& features,
                                     const std::vector<float>& target,
                                     float learning_rate) {
-    network.train(features, target, learning_rate);
+    train_step(features, target, learning_rate);
+    if (replay.isInitialized()) {
+        size_t label = std::max_element(target.begin(), target.end()) - target.begin();
+        replay.add(features.data(), static_cast<uint8_t>(label));
+    }
+}
+
+void FederatedClient::set_replay_capacity(size_t capacity) {
+    if (!replay.init(capacity, replay_features.size())) {
+        throw std::runtime_error("Replay buffer capacity must be between 1 and 65535");
+    }
+}
+
+void FederatedClient::train_on_replay(size_t epochs, float learning_rate) {
+    std::vector<uint32_t> order(replay.size());
+    for (size_t epoch = 0; epoch < epochs; epoch++) {
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+        CounterRng(seed, RngPurpose::REPLAY_ORDER, replay_epochs++, client_id).shuffle(order.begin(), order.end());
+
+        for (uint32_t index : order) {
+            const float* features = replay.features(index);
+            std::copy(features, features + replay_features.size(), replay_features.begin());
+            std::fill(replay_target.begin(), replay_target.end(), 0.0f);
+            replay_target[replay.label(index)] = 1.0f;
+            train_step(replay_features, replay_target, learning_rate);
+        }
+    }
+}
+
+void FederatedClient::train_step(const std::vector<float>& features,
+                                 const std::vector<float>& target,
+                                 float learning_rate) {
+    if (backend == ModelBackend::FIXED_POINT) {
+        fixed_network.train(features.data(), target.data(), learning_rate);
+        return;
+    }
+    if (backend == ModelBackend::SPARSE) {
+        sparse_network.train(features.data(), target.data(), learning_rate);
+        return;
+    }
+    if (optimizer.get_config().fused_sgd()) {
+        network.train(features, target, learning_rate);
+        return;
+    }
+    network.compute_gradients(features, target, gradients);
+    optimizer.step(network.parameter_data(), gradients.data(),
+                   has_global ? received_weights.data() : nullptr, learning_rate);
+    // Momentum and the proximal term would move pruned weights away from zero
+    network.apply_mask();
 }
 
 
 std::vector<float> FederatedClient::get_weights() const {
+    if (backend == ModelBackend::FIXED_POINT) {
+        std::vector<float> weights(fixed_network.parameterCount());
+        fixed_network.getParameters(weights.data(), weights.size());
+        return weights;
+    }
+    if (backend == ModelBackend::SPARSE) {
+        std::vector<float> weights(sparse_network.parameterCount());
+        sparse_network.getParameters(weights.data(), weights.size());
+        return weights;
+    }
     return network.get_flat_weights();
 }
 
 void FederatedClient::set_weights(const std::vector<float>& weights) {
-    network.set_flat_weights(weights);
+    if (backend == ModelBackend::FIXED_POINT) {
+        if (!fixed_network.setParameters(weights.data(), weights.size())) {
+            throw std::runtime_error("Weight count does not match the fixed-point network");
+        }
+    } else if (backend == ModelBackend::SPARSE) {
+        if (!sparse_network.setParameters(weights.data(), weights.size())) {
+            throw std::runtime_error("Weight count does not match the sparse network");
+        }
+    } else {
+        network.set_flat_weights(weights);
+    }
+    received_weights = weights;
+    has_global = true;
+    optimizer.begin_round();
+}
+
+void FederatedClient::set_mask(const std::vector<uint8_t>& mask) {
+    if (backend == ModelBackend::FIXED_POINT) {
+        throw std::runtime_error("The fixed-point backend does not support pruning");
+    }
+    // The float network keeps the mask for the parameter layout; the sparse engine takes
+    // the weight bitmap of the model format
+    network.set_mask(mask);
+    if (backend == ModelBackend::SPARSE) {
+        std::vector<uint8_t> bitmap((sparse_network.weightCount() + 7) / 8, 0);
+        size_t bit = 0;
+        size_t offset = 0;
+        for (size_t l = 0; l + 1 < topology.size(); l++) {
+            const size_t count = topology[l] * topology[l + 1];
+            for (size_t i = 0; i < count; i++, bit++) {
+                if (mask.empty() || mask[offset + i]) bitmap[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+            }
+            offset += count + topology[l + 1];
+        }
+        sparse_network.setMask(bitmap.data(), sparse_network.weightCount());
+    }
+}
+
+std::vector<uint8_t> FederatedClient::get_encoded_update(
+    WeightCodec::Format format,
+    WeightCodec::Rounding rounding) {
+
+    std::vector<float> delta = get_weights();
+    for (size_t i = 0; i < delta.size(); i++) {
+        delta[i] -= received_weights[i];
+    }
+
+    std::vector<uint8_t> payload(WeightCodec::encodedSize(format, delta.size()));
+    size_t written = WeightCodec::encode(delta.data(), delta.size(), format, rounding,
+                                         payload.data(), payload.size(),
+                                         upload_residual.data(), &codec_rng_state);
+    if (written == 0) {
+        throw std::runtime_error("Failed to encode client update");
+    }
+    return payload;
+}
+
+std::vector<uint8_t> FederatedClient::get_sparse_update(size_t k) {
+    std::vector<float> delta = get_weights();
+    for (size_t i = 0; i < delta.size(); i++) {
+        delta[i] -= received_weights[i];
+    }
+
+    k = std::min(k, delta.size());
+    std::vector<uint8_t> payload(SparseDelta::maxEncodedSize(k));
+    size_t written = SparseDelta::encodeTopK(delta.data(), delta.size(), k,
+                                             payload.data(), payload.size(), upload_residual.data());
+    if (written == 0) {
+        throw std::runtime_error("Failed to encode sparse client update");
+    }
+    payload.resize(written);
+    return payload;
 }
 
 std::vector<float> FederatedClient::predict(const std::vector<float>& features) {
+    if (backend == ModelBackend::FIXED_POINT) {
+        std::vector<float> outputs(fixed_network.outputSize());
+        fixed_network.predict(features.data(), outputs.data());
+        return outputs;
+    }
+    if (backend == ModelBackend::SPARSE) {
+        std::vector<float> outputs(sparse_network.outputSize());
+        sparse_network.predict(features.data(), outputs.data());
+        return outputs;
+    }
     return network.forward(features);
+}
+
+ClientMemory FederatedClient::memory_usage(bool with_global_copy) const {
+    ClientMemory memory;
+    const size_t weight_bytes = received_weights.size() * sizeof(float);
+    if (backend == ModelBackend::FIXED_POINT) {
+        memory.model = fixed_network.memoryBytes();
+    } else if (backend == ModelBackend::SPARSE) {
+        memory.model = sparse_network.memoryBytes();
+    } else {
+        memory.model = network.memory_bytes();
+        memory.gradients = optimizer.get_config().fused_sgd() ? 0 : weight_bytes;
+        memory.optimizer_state = optimizer.state_bytes();
+    }
+    if (with_global_copy || optimizer.get_config().proximal_mu > 0.0f) {
+        memory.global_copy = weight_bytes;
+    }
+    memory.replay = replay.memoryBytes();
+    return memory;
+}
+
+ModelBackend FederatedClient::parse_backend(const std::string& name) {
+    if (name == "float" || name == "fp32") return ModelBackend::FLOAT32;
+    if (name == "fixed" || name == "int8") return ModelBackend::FIXED_POINT;
+    if (name == "sparse" || name == "csr") return ModelBackend::SPARSE;
+    throw std::runtime_error("Unknown model backend: " + name);
+}
+
+std::string FederatedClient::backend_name(ModelBackend backend) {
+    switch (backend) {
+        case ModelBackend::FLOAT32: return "float32";
+        case ModelBackend::FIXED_POINT: return "int8 fixed point";
+        case ModelBackend::SPARSE: return "float32 sparse rows";
+    }
+    return "unknown";
 }
\ No newline at end of file
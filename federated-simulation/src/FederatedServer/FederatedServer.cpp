@@ -1,10 +1,13 @@
 #include "FederatedServer/FederatedServer.h"
+#include "Random/CounterRng.h"
 #include <stdexcept>
 #include <algorithm>
-#include <random>
+#include <numeric>
+#include <cmath>
 
 
-FederatedServer::FederatedServer(uint32_t seed) : rng(seed) {}
+FederatedServer::FederatedServer(uint32_t seed)
+    : seed(seed), codec_rng_state(CounterRng(seed, RngPurpose::CODEC_ROUNDING, 0, RNG_SERVER)() | 1u) {}
 
 
 std::vector<size_t> FederatedServer::select_clients(size_t total_clients, float client_fraction) {
@@ -23,7 +26,7 @@ std::vector<size_t> FederatedServer::select_clients(size_t total_clients, float
     std::iota(all_clients.begin(), all_clients.end(), 0);
     
     // Shuffle and select first num_selected clients
-    std::shuffle(all_clients.begin(), all_clients.end(), rng);
+    CounterRng(seed, RngPurpose::CLIENT_SELECTION, selections++).shuffle(all_clients.begin(), all_clients.end());
     
     return std::vector<size_t>(
         all_clients.begin(), 
@@ -31,6 +34,38 @@ std::vector<size_t> FederatedServer::select_clients(size_t total_clients, float
     );
 }
 
+std::vector<size_t> FederatedServer::select_from(const std::vector<size_t>& candidates, size_t count) {
+    std::vector<size_t> pool = candidates;
+    CounterRng(seed, RngPurpose::CLIENT_SELECTION, selections++).shuffle(pool.begin(), pool.end());
+    pool.resize(std::min(count, pool.size()));
+    return pool;
+}
+
+std::vector<size_t> FederatedServer::select_within_deadline(const std::vector<size_t>& candidates,
+                                                            const std::vector<double>& estimated_seconds,
+                                                            size_t count,
+                                                            double deadline_seconds) {
+    if (candidates.size() != estimated_seconds.size()) {
+        throw std::runtime_error("Need one time estimate per candidate");
+    }
+    if (candidates.empty()) {
+        return {};
+    }
+
+    std::vector<size_t> eligible;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (deadline_seconds <= 0.0 || estimated_seconds[i] <= deadline_seconds) {
+            eligible.push_back(candidates[i]);
+        }
+    }
+    if (eligible.empty()) {
+        size_t fastest = std::min_element(estimated_seconds.begin(), estimated_seconds.end()) -
+                         estimated_seconds.begin();
+        return {candidates[fastest]};
+    }
+    return select_from(eligible, count);
+}
+
 std::vector<float> FederatedServer::average_weights(
     const std::vector<std::vector<float>>& client_weights) {
     
@@ -57,6 +92,111 @@ std::vector<float> FederatedServer::average_weights(
     return averaged_weights;
 }
 
+float FederatedServer::staleness_weight(size_t staleness) {
+    // Polynomial staleness discount s(tau) = 1 / sqrt(1 + tau) as used by FedBuff
+    return 1.0f / std::sqrt(1.0f + static_cast<float>(staleness));
+}
+
+std::vector<float> FederatedServer::aggregate_buffered(
+    const std::vector<float>& global_weights,
+    const std::vector<BufferedUpdate>& updates,
+    float server_learning_rate) {
+
+    if (updates.empty()) {
+        throw std::runtime_error("No buffered updates to aggregate");
+    }
+
+    std::vector<float> new_weights = global_weights;
+    const float scale = server_learning_rate / updates.size();
+
+    for (const auto& update : updates) {
+        if (update.delta.size() != global_weights.size()) {
+            throw std::runtime_error("Invalid client update for buffered aggregation");
+        }
+
+        float weight = scale * staleness_weight(update.staleness);
+        for (size_t i = 0; i < new_weights.size(); i++) {
+            new_weights[i] += weight * update.delta[i];
+        }
+    }
+
+    return new_weights;
+}
+
+std::vector<uint8_t> FederatedServer::encode_broadcast(
+    const std::vector<float>& weights,
+    WeightCodec::Format format,
+    WeightCodec::Rounding rounding) {
+
+    if (broadcast_weights.size() != weights.size()) {
+        // First broadcast: clients decode relative to zero
+        broadcast_weights.assign(weights.size(), 0.0f);
+        broadcast_residual.assign(weights.size(), 0.0f);
+    }
+
+    std::vector<float> delta(weights.size());
+    for (size_t i = 0; i < weights.size(); i++) {
+        delta[i] = weights[i] - broadcast_weights[i];
+    }
+
+    std::vector<uint8_t> payload(WeightCodec::encodedSize(format, delta.size()));
+    size_t written = WeightCodec::encode(delta.data(), delta.size(), format, rounding,
+                                         payload.data(), payload.size(),
+                                         broadcast_residual.data(), &codec_rng_state);
+    if (written == 0) {
+        throw std::runtime_error("Failed to encode broadcast");
+    }
+
+    broadcast_weights = decode_update(payload, broadcast_weights);
+    return payload;
+}
+
+std::vector<float> FederatedServer::decode_delta(const std::vector<uint8_t>& payload, size_t expected_size) {
+    std::vector<float> delta(expected_size);
+    if (WeightCodec::decode(payload.data(), payload.size(), delta.data(), delta.size()) != expected_size) {
+        throw std::runtime_error("Invalid encoded weight payload");
+    }
+    return delta;
+}
+
+std::vector<float> FederatedServer::decode_update(
+    const std::vector<uint8_t>& payload,
+    const std::vector<float>& reference) {
+
+    std::vector<float> weights = decode_delta(payload, reference.size());
+    for (size_t i = 0; i < weights.size(); i++) {
+        weights[i] += reference[i];
+    }
+    return weights;
+}
+
+std::vector<float> FederatedServer::apply_sparse_deltas(
+    const std::vector<float>& global_weights,
+    const std::vector<std::vector<uint8_t>>& payloads) {
+
+    std::vector<float> weights = global_weights;
+    if (payloads.empty()) {
+        return weights;
+    }
+
+    const float scale = 1.0f / payloads.size();
+    for (const auto& payload : payloads) {
+        if (!SparseDelta::apply(payload.data(), payload.size(), weights.data(), weights.size(), scale)) {
+            throw std::runtime_error("Invalid sparse delta payload");
+        }
+    }
+    return weights;
+}
+
+std::vector<float> FederatedServer::decode_sparse_delta(const std::vector<uint8_t>& payload,
+                                                        size_t expected_size) {
+    std::vector<float> delta(expected_size, 0.0f);
+    if (!SparseDelta::apply(payload.data(), payload.size(), delta.data(), delta.size())) {
+        throw std::runtime_error("Invalid sparse delta payload");
+    }
+    return delta;
+}
+
 bool FederatedServer::verify_weights(
     const std::vector<std::vector<float>>& client_weights) const {
     
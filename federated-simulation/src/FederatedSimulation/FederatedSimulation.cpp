@@ -1,9 +1,13 @@
 #include "FederatedSimulation/FederatedSimulation.h"
 #include "Metrics/Metrics.h"
+#include "HPO/HyperParameterOptimizer.h"
+#include "ModelFile/ModelFile.h"
 #include <iostream>
-#include <iomanip>
-#include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <queue>
 
 FederatedSimulation::FederatedSimulation(const std::string& data_path, uint32_t seed)
     : data_path(data_path), seed(seed) {
@@ -22,7 +26,12 @@ FederatedSimulation::TrainingMetrics FederatedSimulation::train_clients_online(
     for (size_t i = 0; i < samples_per_client; i++) {
         // Each selected client gets a different sample
         for (size_t client_idx : selected_clients) {
-            TrainingSample sample = preprocessor->get_next_training_sample(client_idx);
+            TrainingSample sample;
+            {
+                ScopedPhase timer(profiler, Phase::SAMPLE_FETCH);
+                sample = preprocessor->get_next_training_sample(client_idx);
+            }
+            ScopedPhase timer(profiler, Phase::LOCAL_TRAINING);
 
             // Get prediction before training (for loss calculation)
             auto prediction = clients[client_idx]->predict(sample.features);
@@ -36,198 +45,1134 @@ FederatedSimulation::TrainingMetrics FederatedSimulation::train_clients_online(
         }
     }
 
+    if (local_epochs > 1) {
+        ScopedPhase timer(profiler, Phase::LOCAL_TRAINING);
+        for (size_t client_idx : selected_clients) {
+            clients[client_idx]->train_on_replay(local_epochs - 1, learning_rate);
+        }
+    }
+
     return metrics;
 }
 
-float FederatedSimulation::evaluate_test_set(
+size_t FederatedSimulation::replayed_windows(const FederatedClient& client, bool before_training) const {
+    if (local_epochs <= 1) return 0;
+    size_t buffered = client.replay_size();
+    if (before_training) {
+        buffered = std::min(buffered + samples_per_round, replay_capacity > 0 ? replay_capacity : samples_per_round);
+    }
+    return (local_epochs - 1) * buffered;
+}
+
+const Evaluation& FederatedSimulation::evaluate_test_set(
     FederatedClient& client,
-    const std::vector<TrainingSample>& test_set) {
-    
-    std::vector<std::vector<float>> predictions;
-    std::vector<std::vector<float>> targets;
+    const std::vector<TrainingSample>& test_set,
+    bool with_auc) {
+
+    ScopedPhase timer(profiler, Phase::EVALUATION);
+    const size_t num_classes = topology.back();
+    test_predictions.resize(test_set.size() * num_classes);
+    test_labels.resize(test_set.size());
+    streaming_auc.reset();
 
-    // Get predictions for all test samples
-    for (const auto& test_sample : test_set) {
-        predictions.push_back(client.predict(test_sample.features));
-        targets.push_back(test_sample.target);
+    // Gather predictions into one contiguous matrix for the fused metrics pass
+    for (size_t i = 0; i < test_set.size(); i++) {
+        auto prediction = client.predict(test_set[i].features);
+        std::copy(prediction.begin(), prediction.end(), test_predictions.begin() + i * num_classes);
+        test_labels[i] = test_set[i].label;
+        if (!with_auc) {
+            streaming_auc.add(prediction.data(), test_labels[i]);
+        }
     }
 
-    return Metrics::accuracy(predictions, targets);
+    Metrics::evaluate(test_predictions.data(), test_labels.data(), test_set.size(), num_classes,
+                      test_evaluation, metrics_scratch, with_auc);
+    return test_evaluation;
 }
 
-void FederatedSimulation::write_metrics_to_csv(
-    const std::string& filename,
+void FederatedSimulation::record_metrics(
     int round,
     float accuracy,
     float test_loss,
-    float training_loss) {
-    
-    bool file_exists = std::ifstream(filename).good();
+    float training_loss,
+    double sim_time,
+    size_t bytes_transferred) {
+
+    if (!metrics_sink) return;
+    ScopedPhase timer(profiler, Phase::METRICS_IO);
+    MetricsRecord record;
+    record.round = round;
+    record.accuracy = accuracy;
+    record.test_loss = test_loss;
+    record.training_loss = training_loss;
+    record.sim_time = sim_time;
+    record.bytes = bytes_transferred;
+    metrics_sink->record(record);
+}
+
+size_t FederatedSimulation::exchange_bytes(size_t weight_count) const {
+    if (weight_format == WeightCodec::Format::FLOAT32) {
+        return weight_count * sizeof(float);
+    }
+    return WeightCodec::encodedSize(weight_format, weight_count);
+}
+
+// A dispatched client whose update is in flight towards the server
+struct FederatedSimulation::PendingUpdate {
+    double arrival_time;
+    size_t client_idx;
+    size_t model_version;
+    std::vector<float> delta;
+    float training_loss;
+    size_t bytes_transferred;
+
+    bool operator>(const PendingUpdate& other) const {
+        return arrival_time > other.arrival_time;
+    }
+};
+
+// State of an asynchronous run, shared by its dispatch and aggregation steps
+struct FederatedSimulation::AsyncRun {
+    AsyncRun(const LatencyConfig& latency_config, const BleTransportConfig& transport_config,
+             size_t num_clients, uint32_t seed)
+        : latency(latency_config, num_clients, seed), transport(transport_config) {}
+
+    LatencyModel latency;
+    BleTransportModel transport;
+    std::unique_ptr<DeviceModel> devices;
+    size_t concurrency = 1;
+    size_t buffer_size = 1;
+
+    std::vector<float> global_weights;
+    // Model handed to dispatched clients. Clients hold different global versions, so it is
+    // encoded in full with nearest rounding rather than as a delta.
+    std::vector<float> dispatch_weights;
+    size_t model_version = 0;
+    double sim_time = 0.0;
+    size_t total_bytes = 0;
+
+    // Every dispatch downloads the global model and uploads the local update
+    size_t weight_bytes = 0;
+    bool sparse = false;
+    size_t sparse_entries = 0;
+
+    std::priority_queue<PendingUpdate, std::vector<PendingUpdate>, std::greater<PendingUpdate>> in_flight;
+    std::vector<size_t> idle_clients;
+    std::vector<BufferedUpdate> buffer;
+    float buffered_training_loss = 0.0f;
+};
+
+void FederatedSimulation::run_async_rounds(
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::shared_ptr<DataPreprocessor> preprocessor,
+    const std::vector<TrainingSample>& test_samples) {
+
+    AsyncRun run(latency_config, transport_config, clients.size(), seed);
+    if (use_device_model) {
+        run.devices = std::make_unique<DeviceModel>(device_config, clients.size(), seed);
+    }
+
+    size_t concurrency = async_concurrency > 0
+        ? async_concurrency
+        : static_cast<size_t>(clients.size() * client_fraction);
+    run.concurrency = std::max(size_t(1), std::min(concurrency, clients.size()));
+    run.buffer_size = std::max(size_t(1), async_buffer_size);
+
+    console() << "  Mode: asynchronous (FedBuff)" << std::endl;
+    console() << "  Buffer Size: " << run.buffer_size << std::endl;
+    console() << "  Concurrency: " << run.concurrency << std::endl;
+    console() << "  Latency: " << LatencyModel::distribution_name(latency_config.distribution)
+              << ", mean " << latency_config.mean_seconds << "s, "
+              << (latency_config.straggler_fraction * 100.0f) << "% stragglers x"
+              << latency_config.straggler_slowdown << std::endl;
+
+    // The server starts from the first client's initialization
+    run.global_weights = clients[0]->get_weights();
+    run.weight_bytes = exchange_bytes(run.global_weights.size());
+    run.sparse = upload_density > 0.0f;
+    run.sparse_entries = SparseDelta::entriesForDensity(run.global_weights.size(), upload_density);
+    refresh_dispatch_weights(run);
+
+    run.idle_clients.resize(clients.size());
+    std::iota(run.idle_clients.begin(), run.idle_clients.end(), 0);
 
-    std::ofstream file;
-    if (!file_exists) {
-        file.open(filename);
-        file << "Round,Accuracy,TestLoss,TrainingLoss\n";
+    profiler.begin_round(1);
+    dispatch_clients(run, server, clients, preprocessor);
+
+    while (static_cast<int>(run.model_version) < fl_rounds && !run.in_flight.empty()) {
+        PendingUpdate update = run.in_flight.top();
+        run.in_flight.pop();
+
+        run.sim_time = update.arrival_time;
+        run.total_bytes += update.bytes_transferred;
+        run.idle_clients.push_back(update.client_idx);
+        run.buffered_training_loss += update.training_loss;
+        run.buffer.push_back({std::move(update.delta), run.model_version - update.model_version});
+
+        if (run.buffer.size() >= run.buffer_size) {
+            aggregate_buffer(run, server, clients, test_samples);
+        }
+
+        dispatch_clients(run, server, clients, preprocessor);
+    }
+
+    // Leave every client holding the final global model
+    for (auto& client : clients) {
+        client->set_weights(run.dispatch_weights);
+    }
+
+    result.sim_time = run.sim_time;
+    result.bytes = run.total_bytes;
+    console() << "\nSimulated wall-clock time: " << run.sim_time << "s for "
+              << run.model_version << " aggregations (" << run.total_bytes << " bytes transferred)" << std::endl;
+    if (run.devices && run.devices->depleted_count() > 0) {
+        console() << run.devices->depleted_count() << " of " << clients.size()
+                  << " devices used up their battery budget" << std::endl;
+    }
+}
+
+void FederatedSimulation::refresh_dispatch_weights(AsyncRun& run) const {
+    run.dispatch_weights = run.global_weights;
+    if (weight_format == WeightCodec::Format::FLOAT32) {
+        return;
+    }
+    std::vector<uint8_t> payload(run.weight_bytes);
+    WeightCodec::encode(run.global_weights.data(), run.global_weights.size(), weight_format,
+                        WeightCodec::Rounding::NEAREST, payload.data(), payload.size());
+    run.dispatch_weights = FederatedServer::decode_delta(payload, run.global_weights.size());
+}
+
+void FederatedSimulation::dispatch_clients(
+    AsyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::shared_ptr<DataPreprocessor> preprocessor) {
+
+    size_t free_slots = run.concurrency - run.in_flight.size();
+    std::vector<size_t> dispatched;
+    {
+        ScopedPhase timer(profiler, Phase::CLIENT_SELECTION);
+        std::vector<size_t> candidates = run.idle_clients;
+        if (run.devices) {
+            // With nothing in flight, wait until some device comes online
+            if (run.in_flight.empty()) {
+                double online = run.devices->next_available(run.sim_time);
+                if (std::isinf(online)) return;
+                run.sim_time = online;
+            }
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](size_t c) {
+                return !run.devices->available(c, run.sim_time);
+            }), candidates.end());
+        }
+        dispatched = server.select_from(candidates, free_slots);
+        for (size_t client_idx : dispatched) {
+            run.idle_clients.erase(std::find(run.idle_clients.begin(), run.idle_clients.end(), client_idx));
+        }
+    }
+
+    for (size_t client_idx : dispatched) {
+        dispatch_client(run, client_idx, clients, preprocessor);
+    }
+}
+
+void FederatedSimulation::dispatch_client(
+    AsyncRun& run,
+    size_t client_idx,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::shared_ptr<DataPreprocessor> preprocessor) {
+
+    {
+        ScopedPhase timer(profiler, Phase::BROADCAST);
+        clients[client_idx]->set_weights(run.dispatch_weights);
+    }
+    auto training_metrics = train_clients_online(
+        {client_idx}, clients, preprocessor,
+        learning_rate, samples_per_round);
+
+    ScopedPhase timer(profiler, Phase::WEIGHT_COLLECTION);
+    std::vector<float> delta;
+    size_t upload_bytes = run.weight_bytes;
+    if (run.sparse) {
+        auto payload = clients[client_idx]->get_sparse_update(run.sparse_entries);
+        upload_bytes = payload.size();
+        delta = FederatedServer::decode_sparse_delta(payload, run.dispatch_weights.size());
+    } else if (weight_format == WeightCodec::Format::FLOAT32) {
+        delta = clients[client_idx]->get_weights();
+        for (size_t i = 0; i < delta.size(); i++) {
+            delta[i] -= run.dispatch_weights[i];
+        }
     } else {
-        file.open(filename, std::ios_base::app);
+        auto payload = clients[client_idx]->get_encoded_update(weight_format, weight_rounding);
+        delta = FederatedServer::decode_delta(payload, run.dispatch_weights.size());
     }
 
-    file << round << ","
-         << std::fixed << std::setprecision(4)
-         << (accuracy * 100.0f) << ","
-         << test_loss << ","
-         << training_loss << "\n";
+    TransferCost exchange_cost = run.transport.download_cost(run.weight_bytes);
+    exchange_cost += run.transport.upload_cost(upload_bytes);
+    double compute_seconds = 0.0;
+    if (run.devices) {
+        compute_seconds = run.devices->compute_seconds(client_idx, samples_per_round, topology,
+                                                       replayed_windows(*clients[client_idx], false));
+        run.devices->consume(client_idx, compute_seconds, exchange_cost.seconds);
+    }
 
-    file.close();
+    // Local training happens at dispatch time; only its arrival is delayed on the simulated clock
+    run.in_flight.push({
+        run.sim_time + run.latency.sample(client_idx) + compute_seconds + exchange_cost.seconds,
+        client_idx,
+        run.model_version,
+        std::move(delta),
+        Metrics::cross_entropy_loss(training_metrics.predictions, training_metrics.targets),
+        exchange_cost.payload_bytes
+    });
+}
+
+void FederatedSimulation::aggregate_buffer(
+    AsyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    const std::vector<TrainingSample>& test_samples) {
+
+    float mean_staleness = 0.0f;
+    for (const auto& buffered : run.buffer) {
+        mean_staleness += buffered.staleness;
+    }
+    mean_staleness /= run.buffer.size();
+    float training_loss = run.buffered_training_loss / run.buffer.size();
+
+    {
+        ScopedPhase timer(profiler, Phase::AGGREGATION);
+        run.global_weights = server.aggregate_buffered(run.global_weights, run.buffer, server_learning_rate);
+    }
+    {
+        ScopedPhase timer(profiler, Phase::BROADCAST);
+        refresh_dispatch_weights(run);
+        // Evaluate the new global model as clients receive it
+        clients[0]->set_weights(run.dispatch_weights);
+    }
+    run.model_version++;
+    run.buffer.clear();
+    run.buffered_training_loss = 0.0f;
+
+    const Evaluation& evaluation = evaluate_test_set(*clients[0], test_samples);
+    float test_loss = evaluation.log_loss;
+    float test_accuracy = evaluation.accuracy;
+
+    record_metrics(run.model_version, test_accuracy, test_loss, training_loss, run.sim_time, run.total_bytes);
+
+    console() << "\n=== Aggregation " << run.model_version
+              << " at t=" << run.sim_time << "s ===\n"
+              << "  Mean Staleness: " << mean_staleness << "\n"
+              << "  Training Loss: " << training_loss << "\n"
+              << "  Test Loss: " << test_loss << "\n"
+              << "  Test Accuracy: " << (test_accuracy * 100.0f) << "%\n"
+              << "  Test Macro AUC (approx.): " << streaming_auc.macro() << "\n";
+
+    // Dispatches after an aggregation belong to the next round
+    profiler.end_round();
+    profiler.begin_round(static_cast<int>(run.model_version) + 1);
+}
+
+// State of a synchronous run, shared by the steps of its rounds
+struct FederatedSimulation::SyncRun {
+    explicit SyncRun(const BleTransportConfig& config) : transport(config) {}
+
+    BleTransportModel transport;
+    Pruner* pruner = nullptr;
+    bool encoded = false;
+    bool sparse = false;
+    size_t weight_count = 0;
+    // A pruned model exchanges only its kept weights and the biases; downloads also
+    // carry the mask
+    size_t weight_bytes = 0;
+    size_t mask_bytes = 0;
+    size_t sparse_entries = 0;
+    size_t target_clients = 0;
+
+    // Each device downloads the model, trains and uploads; the round ends with the slowest
+    std::unique_ptr<DeviceModel> devices;
+    double device_exchange_seconds = 0.0;
+    std::vector<double> device_round_seconds;
+    size_t short_rounds = 0;
+
+    // Updates are clipped and masked as deltas from the global model
+    std::unique_ptr<PrivateAggregator> private_aggregator;
+    std::unique_ptr<RdpAccountant> accountant;
+    // The model sparse and private deltas are relative to
+    std::vector<float> global_weights;
+
+    double sim_time = 0.0;
+    size_t total_bytes = 0;
+    size_t upload_bytes_total = 0;
+    size_t uploads = 0;
+    double squared_error = 0.0;
+    size_t uploaded_values = 0;
+    SuccessTracker convergence;
+    std::vector<double> elapsed_seconds;
+};
+
+// Updates collected from the clients of one synchronous round
+struct FederatedSimulation::RoundUpdates {
+    std::vector<std::vector<float>> client_weights;
+    std::vector<std::vector<uint8_t>> sparse_payloads;
+    size_t upload_bytes = 0;
+};
+
+void FederatedSimulation::run_sync_rounds(
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::shared_ptr<DataPreprocessor> preprocessor,
+    const std::vector<TrainingSample>& test_samples,
+    Pruner* pruner) {
+
+    SyncRun run(transport_config);
+    start_sync_run(run, server, clients, pruner);
+
+    // Federated Learning Rounds
+    for (int round = 0; round < fl_rounds; round++) {
+        console() << "\n=== Federated Learning Round " << (round + 1) << " ===\n";
+        profiler.begin_round(round + 1);
+
+        // Select subset of clients for this round
+        std::vector<size_t> selected_clients;
+        if (!select_round_clients(run, server, clients, selected_clients)) {
+            console() << "Every device has used up its battery budget\n";
+            break;
+        }
+        console() << "Selected " << selected_clients.size() << " clients for this round\n";
+
+        // Local training on selected clients
+        console() << "\nLocal training with " << samples_per_round
+                  << " samples per client...\n";
+
+        // Train selected clients
+        auto training_metrics = train_clients_online(
+            selected_clients, clients, preprocessor,
+            learning_rate, samples_per_round);
+
+        // Calculate training loss
+        float training_loss;
+        {
+            ScopedPhase timer(profiler, Phase::EVALUATION);
+            training_loss = Metrics::cross_entropy_loss(
+                training_metrics.predictions,
+                training_metrics.targets);
+        }
+
+        // Aggregate the selected clients' updates and update ALL clients with the result
+        RoundUpdates updates = collect_updates(run, server, clients, selected_clients);
+        std::vector<float> averaged_weights = aggregate_updates(run, server, clients, round + 1,
+                                                                selected_clients, updates);
+        broadcast_model(run, server, clients, averaged_weights);
+
+        // Calculate test metrics; the histogram AUC avoids sorting the test set every round
+        const Evaluation& evaluation = evaluate_test_set(*clients[0], test_samples);
+        float test_loss = evaluation.log_loss;
+        float test_accuracy = evaluation.accuracy;
+
+        account_round(run, clients, selected_clients, updates.upload_bytes);
+
+        record_metrics(round + 1, test_accuracy, test_loss, training_loss, run.sim_time, run.total_bytes);
+        run.convergence.update(round + 1, test_accuracy, test_loss);
+        run.elapsed_seconds.push_back(run.sim_time);
+        profiler.end_round();
+
+        // Display metrics
+        console() << "Round " << (round + 1) << " metrics:\n"
+                  << "  Training Loss: " << training_loss << "\n"
+                  << "  Test Loss: " << test_loss << "\n"
+                  << "  Test Accuracy: " << (test_accuracy * 100.0f) << "%\n"
+                  << "  Test Macro AUC (approx.): " << streaming_auc.macro() << "\n"
+                  << "  Simulated Time: " << run.sim_time << "s (" << run.total_bytes << " bytes)\n";
+        if (pruner && pruner->kept_weights() < pruner->weight_count()) {
+            console() << "  Sparsity: "
+                      << (100.0f - 100.0f * pruner->kept_weights() / pruner->weight_count()) << "% ("
+                      << pruner->kept_weights() << " of " << pruner->weight_count() << " weights kept)\n";
+        }
+        if (privacy_config.clip_norm > 0.0f) {
+            console() << "  Clipped Updates: " << (run.private_aggregator->clipped_fraction() * 100.0f) << "%\n";
+        }
+        if (run.accountant) {
+            console() << "  Privacy Spent: epsilon = " << run.accountant->epsilon(privacy_config.delta)
+                      << " (delta = " << privacy_config.delta << ")\n";
+        }
+    }
+
+    print_sync_report(run, *clients[0], clients.size());
+
+    // Rounds until the HPO success criterion holds, to compare convergence across encodings
+    result.sim_time = run.sim_time;
+    result.bytes = run.total_bytes;
+    int rounds_to_success = run.convergence.get_rounds_to_success();
+    if (rounds_to_success <= fl_rounds) {
+        result.rounds_to_success = rounds_to_success;
+        result.seconds_to_success = run.elapsed_seconds[rounds_to_success - 1];
+        console() << "Rounds to success (" << (SuccessTracker::ACCURACY_THRESHOLD * 100.0f)
+                  << "% accuracy, loss <= " << SuccessTracker::LOSS_THRESHOLD << " for "
+                  << SuccessTracker::REQUIRED_CONSECUTIVE_ROUNDS << " rounds): "
+                  << rounds_to_success << std::endl;
+    } else {
+        console() << "Success criterion not reached within " << fl_rounds << " rounds" << std::endl;
+    }
+}
+
+void FederatedSimulation::start_sync_run(
+    SyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    Pruner* pruner) {
+
+    run.pruner = pruner;
+    run.encoded = weight_format != WeightCodec::Format::FLOAT32;
+    run.sparse = upload_density > 0.0f;
+    run.weight_count = clients[0]->get_weights().size();
+    run.weight_bytes = exchange_bytes(run.weight_count);
+    run.sparse_entries = SparseDelta::entriesForDensity(run.weight_count, upload_density);
+    run.target_clients = std::max(size_t(1), static_cast<size_t>(clients.size() * client_fraction));
+    update_exchange_cost(run);
+    if (use_device_model) {
+        run.devices = std::make_unique<DeviceModel>(device_config, clients.size(), seed);
+    }
+
+    const bool private_aggregation = privacy_config.enabled();
+    if (private_aggregation) {
+        run.private_aggregator = std::make_unique<PrivateAggregator>(privacy_config, seed);
+        if (privacy_config.noise_multiplier > 0.0f) {
+            run.accountant = std::make_unique<RdpAccountant>(
+                privacy_config.noise_multiplier, static_cast<double>(run.target_clients) / clients.size());
+        }
+    }
+
+    // Sparse and private deltas are relative to a model every client shares, so the
+    // clients first receive the server's initial model (taken from the first client)
+    if (run.sparse || private_aggregation) {
+        run.global_weights = clients[0]->get_weights();
+        if (run.encoded) {
+            server.encode_broadcast(run.global_weights, weight_format, weight_rounding);
+            run.global_weights = server.get_broadcast_weights();
+        }
+        for (auto& client : clients) {
+            client->set_weights(run.global_weights);
+        }
+    }
+}
+
+void FederatedSimulation::update_exchange_cost(SyncRun& run) const {
+    if (run.pruner) {
+        run.weight_bytes = exchange_bytes(run.pruner->kept_parameters());
+        run.mask_bytes = run.pruner->weight_bitmap().size();
+    }
+    run.device_exchange_seconds =
+        run.transport.download_cost(run.weight_bytes + run.mask_bytes).seconds +
+        run.transport.upload_cost(run.sparse ? SparseDelta::maxEncodedSize(run.sparse_entries)
+                                             : run.weight_bytes).seconds;
+}
+
+bool FederatedSimulation::select_round_clients(
+    SyncRun& run,
+    FederatedServer& server,
+    const std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::vector<size_t>& selected_clients) {
+
+    ScopedPhase timer(profiler, Phase::CLIENT_SELECTION);
+    if (!run.devices) {
+        selected_clients = server.select_clients(clients.size(), client_fraction);
+        return true;
+    }
+
+    double online = run.devices->next_available(run.sim_time);
+    if (std::isinf(online)) {
+        return false;
+    }
+    run.sim_time = online;
+
+    std::vector<size_t> candidates;
+    std::vector<double> estimated_seconds;
+    for (size_t c = 0; c < clients.size(); c++) {
+        if (run.devices->available(c, run.sim_time)) {
+            candidates.push_back(c);
+            estimated_seconds.push_back(
+                run.devices->compute_seconds(c, samples_per_round, topology,
+                                             replayed_windows(*clients[c], true)) +
+                run.device_exchange_seconds);
+        }
+    }
+    selected_clients = server.select_within_deadline(candidates, estimated_seconds,
+                                                     run.target_clients, round_deadline);
+    return true;
+}
+
+FederatedSimulation::RoundUpdates FederatedSimulation::collect_updates(
+    SyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    const std::vector<size_t>& selected_clients) {
+
+    // Collect weights only from selected clients
+    RoundUpdates updates;
+    for (size_t client_idx : selected_clients) {
+        ScopedPhase timer(profiler, Phase::WEIGHT_COLLECTION);
+        if (run.sparse) {
+            updates.sparse_payloads.push_back(clients[client_idx]->get_sparse_update(run.sparse_entries));
+            updates.upload_bytes += updates.sparse_payloads.back().size();
+            continue;
+        }
+        updates.upload_bytes += run.weight_bytes;
+        if (!run.encoded) {
+            updates.client_weights.push_back(clients[client_idx]->get_weights());
+            continue;
+        }
+
+        // The server rebuilds each model from the last broadcast and the decoded delta
+        std::vector<float> reference = server.get_broadcast_weights();
+        reference.resize(run.weight_count, 0.0f);
+        auto payload = clients[client_idx]->get_encoded_update(weight_format, weight_rounding);
+        updates.client_weights.push_back(FederatedServer::decode_update(payload, reference));
+
+        auto local_weights = clients[client_idx]->get_weights();
+        for (size_t i = 0; i < run.weight_count; i++) {
+            float error = updates.client_weights.back()[i] - local_weights[i];
+            run.squared_error += error * error;
+        }
+        run.uploaded_values += run.weight_count;
+    }
+    return updates;
+}
+
+std::vector<float> FederatedSimulation::aggregate_updates(
+    SyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    int round,
+    const std::vector<size_t>& selected_clients,
+    const RoundUpdates& updates) {
+
+    ScopedPhase timer(profiler, Phase::AGGREGATION);
+    std::vector<float> averaged_weights;
+    if (run.private_aggregator) {
+        // Each update passes through clipping and masking as it arrives
+        run.private_aggregator->begin_round(round, selected_clients, run.weight_count);
+        std::vector<float> delta(run.weight_count);
+        for (size_t k = 0; k < selected_clients.size(); k++) {
+            if (run.sparse) {
+                delta = FederatedServer::decode_sparse_delta(updates.sparse_payloads[k], run.weight_count);
+            } else {
+                for (size_t i = 0; i < run.weight_count; i++) {
+                    delta[i] = updates.client_weights[k][i] - run.global_weights[i];
+                }
+            }
+            run.private_aggregator->add_update(k, delta.data());
+        }
+        std::vector<float> mean_update = run.private_aggregator->finish_round();
+        averaged_weights = run.global_weights;
+        for (size_t i = 0; i < run.weight_count; i++) averaged_weights[i] += mean_update[i];
+        if (run.accountant) run.accountant->step();
+    } else {
+        averaged_weights = run.sparse
+            ? server.apply_sparse_deltas(run.global_weights, updates.sparse_payloads)
+            : server.average_weights(updates.client_weights);
+    }
+
+    // The server prunes the aggregate; clients receive the new mask with it
+    if (run.pruner && run.pruner->update(round, averaged_weights)) {
+        for (auto& client : clients) {
+            client->set_mask(run.pruner->mask());
+        }
+        update_exchange_cost(run);
+    }
+    return averaged_weights;
+}
+
+void FederatedSimulation::broadcast_model(
+    SyncRun& run,
+    FederatedServer& server,
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::vector<float>& averaged_weights) {
+
+    ScopedPhase timer(profiler, Phase::BROADCAST);
+    if (run.pruner) {
+        run.pruner->apply(averaged_weights);
+    }
+    if (run.encoded) {
+        server.encode_broadcast(averaged_weights, weight_format, weight_rounding);
+        averaged_weights = server.get_broadcast_weights();
+        if (run.pruner) {
+            // Quantization error must not revive pruned weights
+            run.pruner->apply(averaged_weights);
+        }
+    }
+    if (run.sparse || run.private_aggregator) {
+        run.global_weights = averaged_weights;
+    }
+
+    for (auto& client : clients) {
+        client->set_weights(averaged_weights);
+    }
+}
+
+void FederatedSimulation::account_round(
+    SyncRun& run,
+    const std::vector<std::unique_ptr<FederatedClient>>& clients,
+    const std::vector<size_t>& selected_clients,
+    size_t round_upload_bytes) {
+
+    // Account for the BLE exchange with every selected client
+    run.upload_bytes_total += round_upload_bytes;
+    run.uploads += selected_clients.size();
+    size_t mean_upload_bytes = round_upload_bytes / std::max(size_t(1), selected_clients.size());
+    TransferCost round_cost = run.transport.round_cost(run.weight_bytes + run.mask_bytes, mean_upload_bytes,
+                                                       selected_clients.size());
+    double round_seconds = round_cost.seconds;
+    if (run.devices) {
+        double slowest = 0.0;
+        for (size_t client_idx : selected_clients) {
+            double compute_seconds = run.devices->compute_seconds(
+                client_idx, samples_per_round, topology, replayed_windows(*clients[client_idx], false));
+            slowest = std::max(slowest, compute_seconds + run.device_exchange_seconds);
+            run.devices->consume(client_idx, compute_seconds, run.device_exchange_seconds);
+        }
+        // Transfers share the server's links, so the link schedule can also bound the round
+        round_seconds = std::max(round_seconds, slowest);
+        run.device_round_seconds.push_back(round_seconds);
+        if (selected_clients.size() < run.target_clients) run.short_rounds++;
+    }
+    run.sim_time += round_seconds;
+    run.total_bytes += round_cost.payload_bytes;
+}
+
+void FederatedSimulation::print_sync_report(const SyncRun& run, const FederatedClient& client, size_t num_clients) {
+    if (run.encoded) {
+        size_t raw_bytes = 2 * run.uploads * run.weight_count * sizeof(float);
+        console() << "\nWeight exchange with " << WeightCodec::formatName(weight_format) << ": "
+                  << run.total_bytes << " bytes instead of " << raw_bytes << " with fp32 ("
+                  << (100.0f - 100.0f * run.total_bytes / raw_bytes) << "% saved)" << std::endl;
+        if (!run.sparse) {
+            console() << "Upload quantization RMSE: "
+                      << std::sqrt(run.squared_error / std::max(size_t(1), run.uploaded_values)) << std::endl;
+        }
+    }
+    if (run.sparse) {
+        size_t dense_bytes = run.uploads * run.weight_count * sizeof(float);
+        console() << "\nTop-k uploads: " << run.upload_bytes_total << " bytes instead of "
+                  << dense_bytes << " dense fp32 (compression ratio "
+                  << (static_cast<float>(dense_bytes) / std::max(size_t(1), run.upload_bytes_total))
+                  << "x)" << std::endl;
+    }
+
+    if (run.pruner) {
+        print_pruning_report(run, client);
+    }
+
+    if (run.accountant) {
+        console() << "\nDifferential privacy: (" << run.accountant->epsilon(privacy_config.delta) << ", "
+                  << privacy_config.delta << ")-DP at the client level after " << run.accountant->rounds()
+                  << " rounds (noise multiplier " << privacy_config.noise_multiplier
+                  << ", sampling rate " << (static_cast<double>(run.target_clients) / num_clients)
+                  << ")" << std::endl;
+    }
+
+    if (run.devices && !run.device_round_seconds.empty()) {
+        std::vector<double> sorted = run.device_round_seconds;
+        std::sort(sorted.begin(), sorted.end());
+        double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+        double mean = total / sorted.size();
+        console() << "\nRound time with device model: mean " << mean << "s, p50 "
+                  << sorted[sorted.size() / 2] << "s, max " << sorted.back() << "s ("
+                  << (3600.0 / mean) << " rounds per hour of training)" << std::endl;
+        console() << run.short_rounds << " round(s) had fewer than " << run.target_clients
+                  << " available devices within the deadline; " << run.devices->depleted_count()
+                  << " of " << num_clients << " devices used up their battery budget" << std::endl;
+    }
+}
+
+void FederatedSimulation::print_pruning_report(const SyncRun& run, const FederatedClient& client) {
+    const Pruner& pruner = *run.pruner;
+    const size_t kept = pruner.kept_weights();
+    console() << "\nPruned model: " << kept << " of " << pruner.weight_count() << " weights kept ("
+              << (100.0f - 100.0f * kept / pruner.weight_count()) << "% sparse";
+    if (pruning_config.mode == PruningMode::STRUCTURED) {
+        console() << ", " << pruner.removed_neurons() << " hidden neurons removed";
+    }
+    console() << "), " << (run.weight_bytes + run.mask_bytes) << " bytes per download and " << run.weight_bytes
+              << " per upload instead of " << exchange_bytes(run.weight_count) << std::endl;
+
+    // Inference and training memory of the device's sparse-row engine with this mask
+    SparseMLP engine;
+    std::vector<unsigned int> layers(topology.begin(), topology.end());
+    std::vector<uint8_t> bitmap = pruner.weight_bitmap();
+    if (engine.init(layers.data(), static_cast<unsigned int>(layers.size())) &&
+        engine.setMask(bitmap.data(), engine.weightCount())) {
+        console() << "Sparse-row device engine: " << engine.memoryBytes() << " bytes instead of "
+                  << client.get_network().memory_bytes() << " for the dense network" << std::endl;
+    }
 }
 
 void FederatedSimulation::print_final_evaluation(
     FederatedClient& client,
     const std::vector<TrainingSample>& test_set) {
     
-    float test_accuracy = evaluate_test_set(client, test_set);
-    std::cout << "\nFinal Test Set Evaluation:" << std::endl;
-    std::cout << "Accuracy: " << (test_accuracy * 100.0f) << "%" << std::endl;
+    const Evaluation& evaluation = evaluate_test_set(client, test_set, true);
+    result.final_accuracy = evaluation.accuracy;
+    result.final_loss = evaluation.log_loss;
+    result.macro_f1 = evaluation.macro_f1;
+    console() << "\nFinal Test Set Evaluation:" << std::endl;
+    console() << "Accuracy: " << (evaluation.accuracy * 100.0f) << "%" << std::endl;
 
-    // Get predictions for confusion matrix
-    std::vector<std::vector<float>> predictions;
-    std::vector<std::vector<float>> targets;
-    for (const auto& test_sample : test_set) {
-        predictions.push_back(client.predict(test_sample.features));
-        targets.push_back(test_sample.target);
+    Metrics::print_confusion_matrix(evaluation.confusion, console());
+
+    console() << "\nF1 Scores per class:" << std::endl;
+    for (size_t i = 0; i < evaluation.f1.size(); i++) {
+        console() << "Class " << i << ": " << evaluation.f1[i] << std::endl;
     }
+    console() << "Macro average: " << evaluation.macro_f1 << std::endl;
 
-    // Calculate and print confusion matrix
-    auto conf_matrix = Metrics::confusion_matrix(predictions, targets);
-    Metrics::print_confusion_matrix(conf_matrix);
+    console() << "\nROC AUC Scores per class:" << std::endl;
+    for (size_t i = 0; i < evaluation.auc.size(); i++) {
+        console() << "Class " << i << ": " << evaluation.auc[i] << std::endl;
+    }
+    console() << "Macro average: " << evaluation.macro_auc << std::endl;
+}
 
-    // Calculate and print F1 scores
-    auto f1_scores = Metrics::f1_scores(conf_matrix);
-    std::cout << "\nF1 Scores per class:" << std::endl;
-    for (size_t i = 0; i < f1_scores.size(); i++) {
-        std::cout << "Class " << i << ": " << f1_scores[i] << std::endl;
+std::shared_ptr<const std::vector<MotionSample>> FederatedSimulation::load_dataset() const {
+    DataLoader loader(data_path);
+    if (partition_config.scheme == PartitionScheme::SHARDS) {
+        loader.set_group_column(partition_config.shard_column, partition_config.shard_prefix);
     }
-    
-    // Calculate and print ROC AUC scores
-    auto auc_scores = Metrics::roc_auc(predictions, targets);
-    std::cout << "\nROC AUC Scores per class:" << std::endl;
-    for (size_t i = 0; i < auc_scores.size(); i++) {
-        std::cout << "Class " << i << ": " << auc_scores[i] << std::endl;
+    return std::make_shared<const std::vector<MotionSample>>(loader.load_dataset("motion_metadata.csv"));
+}
+
+std::string FederatedSimulation::dataset_source() const {
+    if (use_synthetic || preset_dataset) {
+        return "";
+    }
+    // Shard partitions also read the device column
+    std::string source = data_path;
+    if (partition_config.scheme == PartitionScheme::SHARDS) {
+        source += "#" + partition_config.shard_column + ":" + std::to_string(partition_config.shard_prefix);
     }
+    return source;
 }
 
-void FederatedSimulation::run_simulation() {
-    try {
-        // Load dataset
-        DataLoader loader(data_path);
-        auto dataset = loader.load_dataset("motion_metadata.csv");
-        std::cout << "Loaded " << dataset.size() << " samples\n\n";
+void FederatedSimulation::check_configuration() const {
+    if (async_mode && privacy_config.enabled()) {
+        // Masks only cancel over a fixed cohort, which buffered asynchronous updates lack
+        throw std::runtime_error("Private aggregation is only supported in synchronous mode");
+    }
+    const std::vector<Activation> layer_activations =
+        NeuralNetwork::layer_activations(activations, topology.size() - 1);
+    if (!export_model_path.empty() &&
+        std::any_of(layer_activations.begin(), layer_activations.end(),
+                    [](Activation a) { return a != Activation::SIGMOID; })) {
+        // The device runs every layer through a sigmoid and the model file has no field for others
+        throw std::runtime_error("Only sigmoid networks can be exported as device models");
+    }
+}
 
-        // Prepare data for training
-        auto preprocessor = std::make_shared<DataPreprocessor>(seed);
-        preprocessor->prepare_dataset(dataset);
+std::shared_ptr<DataPreprocessor> FederatedSimulation::prepare_data() {
+    auto preprocessor = std::make_shared<DataPreprocessor>(seed);
+    preprocessor->set_num_classes(topology.back());
+    preprocessor->set_partition(partition_config, num_clients);
 
-        // Create federated components
-        FederatedServer server(seed);
-        std::vector<std::unique_ptr<FederatedClient>> clients;
+    if (use_synthetic) {
+        SyntheticDataGenerator generator(synthetic_config, num_clients);
+        if (generator.num_classes() != topology.back()) {
+            throw std::runtime_error("Synthetic data has " + std::to_string(generator.num_classes()) +
+                                     " classes but the topology has " + std::to_string(topology.back()) +
+                                     " outputs");
+        }
+        auto start = std::chrono::steady_clock::now();
+        preprocessor->prepare_stream(generator.size(), [&](size_t index, MotionSample& sample) {
+            generator.generate(index, sample);
+            return static_cast<int>(generator.client_of(index));
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        console() << "Generated " << generator.size() << " synthetic samples in " << seconds << "s (";
+        if (synthetic_config.dirichlet_alpha > 0.0f) {
+            console() << "Dirichlet alpha " << synthetic_config.dirichlet_alpha << ")\n\n";
+        } else {
+            console() << "IID)\n\n";
+        }
+    } else {
+        auto dataset = preset_dataset && !preset_dataset->empty() ? preset_dataset : load_dataset();
+        console() << "Loaded " << dataset->size() << " samples\n\n";
+        preprocessor->prepare_dataset(*dataset);
+    }
+    if (!preprocessor->get_partition().empty()) {
+        console() << "Partition ("
+                  << (partition_config.scheme == PartitionScheme::SHARED
+                          ? "synthetic devices"
+                          : ClientPartition::scheme_name(partition_config.scheme))
+                  << "): "
+                  << preprocessor->partition_summary() << "\n\n";
+    }
+    return preprocessor;
+}
+
+std::vector<std::unique_ptr<FederatedClient>> FederatedSimulation::create_clients(
+    std::shared_ptr<DataPreprocessor> preprocessor) const {
 
-        // Initialize clients
-        for (size_t i = 0; i < num_clients; i++) {
-            clients.push_back(std::make_unique<FederatedClient>(topology, preprocessor, seed + i));
+    std::vector<std::unique_ptr<FederatedClient>> clients;
+    for (size_t i = 0; i < num_clients; i++) {
+        clients.push_back(std::make_unique<FederatedClient>(topology, preprocessor, seed, i, model_backend,
+                                                            activations, optimizer_config));
+        if (local_epochs > 1) {
+            clients.back()->set_replay_capacity(replay_capacity > 0 ? replay_capacity : samples_per_round);
         }
+    }
+    return clients;
+}
 
-        // Remove existing metrics file if it exists
-        std::remove(metrics_file.c_str());
+void FederatedSimulation::load_initial_model(
+    std::vector<std::unique_ptr<FederatedClient>>& clients,
+    std::unique_ptr<Pruner>& pruner) {
 
-        // Get test samples for evaluation
-        auto test_samples = preprocessor->get_test_set();
-        if (test_samples.empty()) {
-            throw std::runtime_error("No test samples available");
+    MappedModel model(initial_model_path);
+    if (model.topology() != topology) {
+        throw std::runtime_error("Model topology in " + initial_model_path +
+                                 " does not match the simulation topology");
+    }
+    auto initial_weights = model.to_flat_weights();
+    auto initial_mask = model.parameter_mask();
+    if (!initial_mask.empty() && !pruner) {
+        if (async_mode) {
+            throw std::runtime_error("Pruned models are supported in synchronous rounds only");
         }
+        pruner = std::make_unique<Pruner>(pruning_config, topology);
+    }
+    if (!initial_mask.empty()) {
+        pruner->set_mask(initial_mask);
+    }
+    for (auto& client : clients) {
+        if (!initial_mask.empty()) client->set_mask(initial_mask);
+        client->set_weights(initial_weights);
+    }
+    console() << "Loaded initial model from " << initial_model_path << " ("
+              << WeightCodec::formatName(model.header().format) << ", "
+              << model.file_size() << " bytes";
+    if (!initial_mask.empty()) {
+        console() << ", " << model.header().keptWeights << " of " << model.header().weightCount()
+                  << " weights kept";
+    }
+    console() << ")\n";
+}
 
-        std::cout << "\nStarting federated learning with:" << std::endl;
-        std::cout << "  Clients: " << num_clients << std::endl;
-        std::cout << "  Client Fraction: " << client_fraction << std::endl;
-        std::cout << "  Samples Per Round: " << samples_per_round << std::endl;
-        std::cout << "  Learning Rate: " << learning_rate << std::endl;
-        std::cout << "  Rounds: " << fl_rounds << std::endl;
-        
-        std::cout << "  Topology: [";
-        for (size_t i = 0; i < topology.size(); i++) {
-            std::cout << topology[i];
-            if (i < topology.size() - 1) {
-                std::cout << ", ";
-            }
+void FederatedSimulation::print_configuration() {
+    console() << "\nStarting federated learning with:" << std::endl;
+    console() << "  Clients: " << num_clients << std::endl;
+    console() << "  Client Fraction: " << client_fraction << std::endl;
+    console() << "  Samples Per Round: " << samples_per_round << std::endl;
+    console() << "  Learning Rate: " << learning_rate << std::endl;
+    console() << "  Rounds: " << fl_rounds << std::endl;
+    
+    console() << "  Topology: [";
+    for (size_t i = 0; i < topology.size(); i++) {
+        console() << topology[i];
+        if (i < topology.size() - 1) {
+            console() << ", ";
         }
-        std::cout << "]" << std::endl;
+    }
+    console() << "]" << std::endl;
+    const std::vector<Activation> layer_activations =
+        NeuralNetwork::layer_activations(activations, topology.size() - 1);
+    console() << "  Activations: ";
+    for (size_t i = 0; i < layer_activations.size(); i++) {
+        console() << (i ? ", " : "") << NeuralNetwork::activation_name(layer_activations[i]);
+    }
+    console() << std::endl;
 
-        // Federated Learning Rounds
-        for (int round = 0; round < fl_rounds; round++) {
-            std::cout << "\n=== Federated Learning Round " << (round + 1) << " ===\n";
+    const BleTransportConfig& link = transport_config;
+    console() << "  BLE Link: " << link.connection_interval_ms << "ms interval, MTU "
+              << link.att_mtu << ", " << link.parallel_links << " parallel link(s), "
+              << BleTransportModel::protocol_name(link.protocol) << " transfers";
+    if (link.protocol == BleProtocol::PIPELINED) {
+        console() << " (window " << link.window_frames << ", "
+                  << BleTransportModel(link).pipelined_frame_bytes() << "-byte frames";
+        if (link.frame_loss > 0.0f) {
+            console() << ", " << link.frame_loss * 100.0f << "% frame loss";
+        }
+        console() << ")";
+    }
+    console() << std::endl;
+    if (use_device_model) {
+        const DeviceTimings& reference = device_config.reference;
+        console() << "  Devices: " << (reference.training_us * DeviceModel::training_flops(topology) /
+                                        DeviceModel::training_flops(reference.topology))
+                  << "us training and " << reference.feature_extraction_us
+                  << "us feature extraction per window on a median device, ";
+        if (device_config.battery_joules > 0.0f) {
+            console() << device_config.battery_joules << " J battery budget, ";
+        }
+        console() << (device_config.online_fraction * 100.0f) << "% of the day online";
+        if (round_deadline > 0.0) {
+            console() << ", " << round_deadline << "s round deadline";
+        }
+        console() << std::endl;
+    }
+}
 
-            // Select subset of clients for this round
-            auto selected_clients = server.select_clients(clients.size(), client_fraction);
-            std::cout << "Selected " << selected_clients.size() << " clients for this round\n";
+void FederatedSimulation::print_client_configuration(const FederatedClient& client) {
+    const size_t weight_count = client.get_weights().size();
+    console() << "  Model Backend: " << FederatedClient::backend_name(model_backend) << std::endl;
+    if (local_epochs > 1) {
+        console() << "  Local Epochs: " << local_epochs << " (replay buffer of "
+                  << (replay_capacity > 0 ? replay_capacity : samples_per_round) << " windows)" << std::endl;
+    }
+    console() << "  Local Optimizer: " << LocalOptimizer::type_name(optimizer_config.type);
+    if (optimizer_config.type == OptimizerType::MOMENTUM) {
+        console() << " (momentum " << optimizer_config.momentum << ")";
+    }
+    if (optimizer_config.proximal_mu > 0.0f) {
+        console() << ", FedProx mu " << optimizer_config.proximal_mu;
+    }
+    if (optimizer_config.state_per_parameter() > 0) {
+        console() << (optimizer_config.keep_state ? ", state kept" : ", state reset") << " across rounds";
+    }
+    console() << std::endl;
 
-            // Local training on selected clients
-            std::cout << "\nLocal training with " << samples_per_round
-                      << " samples per client...\n";
+    // Delta uploads keep the received model next to the trained one
+    const bool delta_uploads = weight_format != WeightCodec::Format::FLOAT32 || upload_density > 0.0f ||
+                               privacy_config.enabled();
+    const ClientMemory memory = client.memory_usage(delta_uploads);
+    console() << "  Client Memory: " << memory.total() << " bytes (model " << memory.model
+              << ", gradients " << memory.gradients << ", optimizer state " << memory.optimizer_state
+              << ", global copy " << memory.global_copy << ", replay buffer " << memory.replay << ")";
+    if (memory_budget > 0) {
+        console() << ", " << (100.0 * memory.total() / memory_budget) << "% of the " << memory_budget
+                  << " byte budget";
+    }
+    console() << std::endl;
+    if (memory_budget > 0 && memory.total() > memory_budget) {
+        throw std::runtime_error("Clients need " + std::to_string(memory.total()) +
+                                 " bytes for training, more than the budget of " +
+                                 std::to_string(memory_budget));
+    }
+    console() << "  Weight Exchange: " << WeightCodec::formatName(weight_format)
+              << (weight_rounding == WeightCodec::Rounding::STOCHASTIC ? " (stochastic rounding)" : "")
+              << ", " << exchange_bytes(weight_count) << " bytes per transfer ("
+              << (100.0f * exchange_bytes(weight_count) / (weight_count * sizeof(float)))
+              << "% of fp32)" << std::endl;
+    if (upload_density > 0.0f) {
+        size_t entries = SparseDelta::entriesForDensity(weight_count, upload_density);
+        console() << "  Upload: top-k sparse deltas, " << entries << " of " << weight_count
+                  << " weights (" << (upload_density * 100.0f) << "%), at most "
+                  << SparseDelta::maxEncodedSize(entries) << " bytes per upload" << std::endl;
+    }
 
-            // Train selected clients
-            auto training_metrics = train_clients_online(
-                selected_clients, clients, preprocessor,
-                learning_rate, samples_per_round);
+    if (pruning_config.enabled()) {
+        console() << "  Pruning: " << Pruner::mode_name(pruning_config.mode) << " magnitude, "
+                  << (pruning_config.sparsity * 100.0f)
+                  << (pruning_config.mode == PruningMode::STRUCTURED ? "% of hidden neurons"
+                                                                     : "% of each layer's weights")
+                  << " over rounds " << pruning_config.start_round << "-"
+                  << (pruning_config.start_round + pruning_config.ramp_rounds - 1) << std::endl;
+    }
 
-            // Calculate training loss
-            float training_loss = Metrics::cross_entropy_loss(
-                training_metrics.predictions,
-                training_metrics.targets);
+    if (privacy_config.enabled()) {
+        console() << "  Private Aggregation: ";
+        if (privacy_config.clip_norm > 0.0f) console() << "L2 clip " << privacy_config.clip_norm << ", ";
+        if (privacy_config.noise_multiplier > 0.0f) {
+            console() << "noise multiplier " << privacy_config.noise_multiplier << ", ";
+        }
+        console() << (privacy_config.secure_aggregation ? "pairwise-masked secure aggregation" : "no masking")
+                  << std::endl;
+    }
+}
 
-            // Collect weights only from selected clients
-            std::vector<std::vector<float>> client_weights;
-            for (size_t client_idx : selected_clients) {
-                client_weights.push_back(clients[client_idx]->get_weights());
-            }
+void FederatedSimulation::export_model(
+    const FederatedClient& client,
+    const DataPreprocessor& preprocessor,
+    const Pruner* pruner) {
 
-            // Average weights from selected clients
-            auto averaged_weights = server.average_weights(client_weights);
+    save_model_file(export_model_path, topology, client.get_weights(),
+                    preprocessor.get_scale_params(), weight_format,
+                    pruner ? pruner->mask() : std::vector<uint8_t>());
+    MappedModel exported(export_model_path);
+    console() << "\nExported model to " << export_model_path << " ("
+              << WeightCodec::formatName(weight_format) << ", " << exported.file_size()
+              << " bytes, " << exported.header().blockCount << " CRC blocks";
+    if (exported.header().hasMask()) {
+        console() << ", mask keeps " << exported.header().keptWeights << " of "
+                  << exported.header().weightCount() << " weights";
+    }
+    console() << ")" << std::endl;
+}
 
-            // Update ALL clients with averaged weights
-            for (auto& client : clients) {
-                client->set_weights(averaged_weights);
-            }
+void FederatedSimulation::run_simulation() {
+    result = SimulationResult();
+    try {
+        check_configuration();
 
-            // Calculate test metrics
-            std::vector<std::vector<float>> test_predictions;
-            std::vector<std::vector<float>> test_targets;
+        // Prepare data for training
+        auto preprocessor = prepare_data();
+        streaming_auc = StreamingAuc(topology.back());
+
+        // Create federated components
+        FederatedServer server(seed);
+        auto clients = create_clients(preprocessor);
 
-            for (const auto& test_sample : test_samples) {
-                test_predictions.push_back(clients[0]->predict(test_sample.features));
-                test_targets.push_back(test_sample.target);
+        // The server prunes the global model; a pruned initial model keeps its mask
+        std::unique_ptr<Pruner> pruner;
+        if (pruning_config.enabled()) {
+            if (async_mode) {
+                throw std::runtime_error("Pruning is supported in synchronous rounds only");
             }
+            pruner = std::make_unique<Pruner>(pruning_config, topology);
+        }
+        if (!initial_model_path.empty()) {
+            load_initial_model(clients, pruner);
+        }
+        if (pruner && model_backend == ModelBackend::FIXED_POINT) {
+            throw std::runtime_error("Pruning needs the float or sparse backend");
+        }
 
-            float test_loss = Metrics::cross_entropy_loss(test_predictions, test_targets);
-            float test_accuracy = Metrics::accuracy(test_predictions, test_targets);
+        // Metrics are written by a background thread through one open file
+        metrics_sink.reset();
+        if (!metrics_file.empty()) {
+            metrics_sink = std::make_unique<MetricsSink>(metrics_file, metrics_format);
+        }
+        if (profile_timing) {
+            profiler.set_timing_file(PhaseProfiler::timing_path_for(metrics_file));
+        }
+        profiler.start();
 
-            // Write to CSV
-            write_metrics_to_csv(metrics_file, round + 1, test_accuracy, test_loss, training_loss);
+        // Get test samples for evaluation
+        auto test_samples = preprocessor->get_test_set();
+        if (test_samples.empty()) {
+            throw std::runtime_error("No test samples available");
+        }
+
+        print_configuration();
+        print_client_configuration(*clients[0]);
 
-            // Display metrics
-            std::cout << "Round " << (round + 1) << " metrics:\n"
-                      << "  Training Loss: " << training_loss << "\n"
-                      << "  Test Loss: " << test_loss << "\n"
-                      << "  Test Accuracy: " << (test_accuracy * 100.0f) << "%\n";
+        if (async_mode) {
+            run_async_rounds(server, clients, preprocessor, test_samples);
+        } else {
+            run_sync_rounds(server, clients, preprocessor, test_samples, pruner.get());
         }
 
+        profiler.finish(console());
+
         // After FL rounds complete
-        std::cout << "\nPerforming final evaluation..." << std::endl;
+        console() << "\nPerforming final evaluation..." << std::endl;
         print_final_evaluation(*clients[0], test_samples);
+
+        if (!export_model_path.empty()) {
+            export_model(*clients[0], *preprocessor, pruner.get());
+        }
         
-        std::cout << "\nFederated learning simulation complete." << std::endl;
-        std::cout << "Results saved to " << metrics_file << std::endl;
+        console() << "\nFederated learning simulation complete." << std::endl;
+        if (metrics_sink) {
+            metrics_sink->close();
+            console() << "Results saved to " << metrics_file << " ("
+                      << MetricsSink::format_name(metrics_format) << ")" << std::endl;
+            if (metrics_sink->dropped() > 0) {
+                std::cerr << "Warning: " << metrics_sink->dropped()
+                          << " metrics records dropped because the writer queue was full" << std::endl;
+            }
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         throw;
     }
-}
\ No newline at end of file
+}
@@ -99,7 +99,9 @@ std::vector<HyperParams> HyperParameterOptimizer::generate_param_grid() {
                         topology, lr, samples, fraction,
                         std::numeric_limits<int>::max(), // rounds_to_success
                         0.0f,                            // final_accuracy
-                        0.0f                             // final_loss
+                        0.0f,                            // final_loss
+                        std::numeric_limits<double>::infinity(), // seconds_to_success
+                        0                                // bytes_to_success
                     });
                 }
             }
@@ -136,20 +138,31 @@ HyperParameterOptimizer::TrainingMetrics HyperParameterOptimizer::train_clients_
         }
     }
 
+    if (local_epochs > 1) {
+        for (size_t client_idx : selected_clients) {
+            clients[client_idx]->train_on_replay(local_epochs - 1, learning_rate);
+        }
+    }
+
     return metrics;
 }
 
 bool HyperParameterOptimizer::evaluate_configuration(
     HyperParams& params,
-    const std::string& metrics_file) {
+    MetricsSink& metrics,
+    int32_t config_id) {
 
     try {
         // Load dataset
         DataLoader loader(data_path);
+        if (partition_config.scheme == PartitionScheme::SHARDS) {
+            loader.set_group_column(partition_config.shard_column, partition_config.shard_prefix);
+        }
         auto dataset = loader.load_dataset("motion_metadata.csv");
 
         // Prepare data
         auto preprocessor = std::make_shared<DataPreprocessor>(seed);
+        preprocessor->set_partition(partition_config, num_clients);
         preprocessor->prepare_dataset(dataset);
 
         // Initialize components
@@ -159,7 +172,11 @@ bool HyperParameterOptimizer::evaluate_configuration(
         // Initialize clients with current topology
         for (size_t i = 0; i < num_clients; i++) {
             clients.push_back(std::make_unique<FederatedClient>(
-                params.topology, preprocessor, seed + i));
+                params.topology, preprocessor, seed, i, model_backend, activations,
+                optimizer_config));
+            if (local_epochs > 1) {
+                clients.back()->set_replay_capacity(replay_capacity > 0 ? replay_capacity : params.samples_per_round);
+            }
         }
 
         // Get test set
@@ -171,9 +188,15 @@ bool HyperParameterOptimizer::evaluate_configuration(
         // Success tracking
         SuccessTracker tracker;
 
-        // Open metrics file
-        std::ofstream metrics_file_stream(metrics_file, std::ios::app);
-        metrics_file_stream << "Round,Config,Accuracy,TestLoss,TrainingLoss\n";
+        // Simulated BLE cost, cumulative per round so time-to-success can be looked up
+        BleTransportModel transport(transport_config);
+        const size_t weight_bytes = clients[0]->get_weights().size() * sizeof(float);
+        std::vector<double> elapsed_seconds;
+        std::vector<size_t> elapsed_bytes;
+        double sim_time = 0.0;
+        size_t total_bytes = 0;
+
+        metrics.label_config(config_id, params.to_string());
 
         // Training loop
         for (int round = 0; round < max_fl_rounds; round++) {
@@ -215,12 +238,23 @@ bool HyperParameterOptimizer::evaluate_configuration(
             float test_accuracy = Metrics::accuracy(
                 test_predictions, test_targets);
 
+            TransferCost round_cost = transport.round_cost(
+                weight_bytes, weight_bytes, selected_clients.size());
+            sim_time += round_cost.seconds;
+            total_bytes += round_cost.payload_bytes;
+            elapsed_seconds.push_back(sim_time);
+            elapsed_bytes.push_back(total_bytes);
+
             // Log metrics
-            metrics_file_stream << round << ","
-                                << params.to_string() << ","
-                                << test_accuracy << ","
-                                << test_loss << ","
-                                << training_loss << "\n";
+            MetricsRecord record;
+            record.round = round + 1;
+            record.config = config_id;
+            record.accuracy = test_accuracy;
+            record.test_loss = test_loss;
+            record.training_loss = training_loss;
+            record.sim_time = sim_time;
+            record.bytes = total_bytes;
+            metrics.record(record);
 
             // Update success tracker
             bool success = tracker.update(round, test_accuracy, test_loss);
@@ -231,6 +265,8 @@ bool HyperParameterOptimizer::evaluate_configuration(
 
             if (success) {
                 params.rounds_to_success = tracker.get_rounds_to_success();
+                params.seconds_to_success = elapsed_seconds[params.rounds_to_success];
+                params.bytes_to_success = elapsed_bytes[params.rounds_to_success];
                 return true;
             }
         }
@@ -249,23 +285,31 @@ std::vector<HyperParams> HyperParameterOptimizer::run_optimization() {
 
     std::vector<HyperParams> successful_configs;
 
-    for (auto& params : param_grid) {
+    // One metrics file for the whole search, one label per configuration
+    MetricsSink metrics(metrics_file, MetricsSink::format_for_path(metrics_file), true);
+
+    for (size_t config_id = 0; config_id < param_grid.size(); config_id++) {
+        auto& params = param_grid[config_id];
         std::cout << "\nTesting configuration:\n"
                   << params.to_string() << "\n";
 
-        if (evaluate_configuration(params)) {
+        if (evaluate_configuration(params, metrics, static_cast<int32_t>(config_id))) {
             successful_configs.push_back(params);
             std::cout << "Success! Rounds needed: "
-                      << params.rounds_to_success << "\n";
+                      << params.rounds_to_success
+                      << " (" << params.seconds_to_success << "s simulated)\n";
         }
         else {
             std::cout << "Did not meet success criteria\n";
         }
     }
 
-    // Sort successful configurations by rounds to success
+    // Sort successful configurations by rounds (or simulated time) to success
     std::sort(successful_configs.begin(), successful_configs.end(),
-              [](const HyperParams& a, const HyperParams& b) {
+              [this](const HyperParams& a, const HyperParams& b) {
+                  if (rank_by_time) {
+                      return a.seconds_to_success < b.seconds_to_success;
+                  }
                   return a.rounds_to_success < b.rounds_to_success;
               });
 
@@ -280,6 +324,9 @@ std::vector<HyperParams> HyperParameterOptimizer::run_optimization() {
                   << successful_configs[0].to_string() << "\n"
                   << "Rounds to success: "
                   << successful_configs[0].rounds_to_success << "\n"
+                  << "Simulated time to success: "
+                  << successful_configs[0].seconds_to_success << "s ("
+                  << successful_configs[0].bytes_to_success << " bytes)\n"
                   << "Final accuracy: "
                   << (successful_configs[0].final_accuracy * 100.0f) << "%\n"
                   << "Final loss: "
@@ -302,6 +349,8 @@ std::vector<HyperParams> HyperParameterOptimizer::run_optimization() {
         best_config_file << "  \"samples_per_round\": " << successful_configs[0].samples_per_round << ",\n";
         best_config_file << "  \"client_fraction\": " << successful_configs[0].client_fraction << ",\n";
         best_config_file << "  \"rounds_to_success\": " << successful_configs[0].rounds_to_success << ",\n";
+        best_config_file << "  \"seconds_to_success\": " << successful_configs[0].seconds_to_success << ",\n";
+        best_config_file << "  \"bytes_to_success\": " << successful_configs[0].bytes_to_success << ",\n";
         best_config_file << "  \"final_accuracy\": " << successful_configs[0].final_accuracy << ",\n";
         best_config_file << "  \"final_loss\": " << successful_configs[0].final_loss << "\n";
         best_config_file << "}\n";
@@ -0,0 +1,73 @@
+#include "LatencyModel/LatencyModel.h"
+#include "Random/CounterRng.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+LatencyModel::LatencyModel(const LatencyConfig& config, size_t num_clients, uint32_t seed)
+    : config(config),
+      client_slowdown(num_clients, 1.0f),
+      dispatches(num_clients, 0),
+      seed(seed) {
+
+    if (config.mean_seconds <= 0.0f) {
+        throw std::runtime_error("Latency mean must be positive");
+    }
+
+    // Pick a fixed set of stragglers so slow devices stay slow across rounds
+    std::vector<size_t> order(num_clients);
+    std::iota(order.begin(), order.end(), 0);
+    CounterRng(seed, RngPurpose::LATENCY, 0, RNG_SERVER).shuffle(order.begin(), order.end());
+
+    size_t num_stragglers = static_cast<size_t>(num_clients * config.straggler_fraction);
+    for (size_t i = 0; i < num_stragglers; i++) {
+        client_slowdown[order[i]] = config.straggler_slowdown;
+    }
+}
+
+float LatencyModel::sample(size_t client_id) {
+    float latency = config.mean_seconds;
+    CounterRng rng(seed, RngPurpose::LATENCY, dispatches[client_id]++, client_id);
+
+    switch (config.distribution) {
+        case LatencyDistribution::CONSTANT:
+            break;
+        case LatencyDistribution::UNIFORM: {
+            float half_width = config.mean_seconds * std::min(config.spread, 1.0f);
+            latency = rng.uniform(config.mean_seconds - half_width, config.mean_seconds + half_width);
+            break;
+        }
+        case LatencyDistribution::EXPONENTIAL: {
+            latency = rng.exponential(1.0f / config.mean_seconds);
+            break;
+        }
+        case LatencyDistribution::LOGNORMAL: {
+            // Choose mu so that the distribution mean equals mean_seconds
+            float sigma = config.spread;
+            float mu = std::log(config.mean_seconds) - 0.5f * sigma * sigma;
+            latency = rng.lognormal(mu, sigma);
+            break;
+        }
+    }
+
+    return latency * client_slowdown[client_id];
+}
+
+LatencyDistribution LatencyModel::parse_distribution(const std::string& name) {
+    if (name == "constant") return LatencyDistribution::CONSTANT;
+    if (name == "uniform") return LatencyDistribution::UNIFORM;
+    if (name == "exponential") return LatencyDistribution::EXPONENTIAL;
+    if (name == "lognormal") return LatencyDistribution::LOGNORMAL;
+    throw std::runtime_error("Unknown latency distribution: " + name);
+}
+
+std::string LatencyModel::distribution_name(LatencyDistribution distribution) {
+    switch (distribution) {
+        case LatencyDistribution::CONSTANT: return "constant";
+        case LatencyDistribution::UNIFORM: return "uniform";
+        case LatencyDistribution::EXPONENTIAL: return "exponential";
+        case LatencyDistribution::LOGNORMAL: return "lognormal";
+    }
+    return "unknown";
+}
@@ -3,182 +3,376 @@
 #include <numeric>
 #include <iostream>
 #include <iomanip>
-#include <complex>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 
-float Metrics::accuracy(const std::vector<std::vector<float>>& predictions, 
+namespace {
+    // Clip probabilities to prevent log(0)
+    constexpr float LOG_EPSILON = 1e-15f;
+}
+
+int Metrics::argmax(const float* values, size_t count) {
+    return static_cast<int>(std::max_element(values, values + count) - values);
+}
+
+void Metrics::evaluate(const float* predictions, const int* labels, size_t rows, size_t num_classes,
+                       Evaluation& result, AucScratch& scratch, bool with_auc) {
+    if (num_classes == 0 || num_classes > MAX_CLASSES) {
+        throw std::invalid_argument("Number of classes must be between 1 and " + std::to_string(MAX_CLASSES));
+    }
+
+    result.samples = rows;
+    result.confusion.reset(num_classes);
+
+    // One pass for the predicted class, the confusion counts and the log loss
+    int correct = 0;
+    float total_loss = 0.0f;
+    for (size_t i = 0; i < rows; i++) {
+        const float* row = predictions + i * num_classes;
+        const int label = labels[i];
+        if (label < 0 || static_cast<size_t>(label) >= num_classes) {
+            throw std::out_of_range("Label " + std::to_string(label) + " outside the class range");
+        }
+
+        const int predicted = argmax(row, num_classes);
+        result.confusion.at(label, predicted)++;
+        correct += predicted == label;
+
+        float pred = std::max(std::min(row[label], 1.0f - LOG_EPSILON), LOG_EPSILON);
+        total_loss -= std::log(pred);
+    }
+
+    result.accuracy = rows > 0 ? static_cast<float>(correct) / rows : 0.0f;
+    result.log_loss = rows > 0 ? total_loss / rows : 0.0f;
+
+    class_scores(result.confusion, result.precision, result.recall, result.f1);
+    result.macro_f1 = std::accumulate(result.f1.begin(), result.f1.end(), 0.0f) / num_classes;
+
+    if (with_auc) {
+        roc_auc(predictions, labels, rows, num_classes, scratch, result.auc, &result.macro_auc);
+    } else {
+        result.auc.clear();
+        result.macro_auc = 0.0f;
+    }
+}
+
+void Metrics::class_scores(const ConfusionMatrix& matrix,
+                           std::vector<float>& precision,
+                           std::vector<float>& recall,
+                           std::vector<float>& f1) {
+    const size_t n = matrix.num_classes;
+    precision.assign(n, 0.0f);
+    recall.assign(n, 0.0f);
+    f1.assign(n, 0.0f);
+
+    for (size_t i = 0; i < n; i++) {
+        int true_pos = matrix.at(i, i);
+        int predicted = 0;
+        int actual = 0;
+        for (size_t j = 0; j < n; j++) {
+            predicted += matrix.at(j, i);
+            actual += matrix.at(i, j);
+        }
+
+        precision[i] = predicted > 0 ? true_pos / static_cast<float>(predicted) : 0.0f;
+        recall[i] = actual > 0 ? true_pos / static_cast<float>(actual) : 0.0f;
+        float sum = precision[i] + recall[i];
+        f1[i] = sum > 0.0f ? 2 * (precision[i] * recall[i]) / sum : 0.0f;
+    }
+}
+
+void Metrics::flatten(const std::vector<std::vector<float>>& predictions,
+                      const std::vector<std::vector<float>>& targets,
+                      AucScratch& scratch) {
+    const size_t num_classes = predictions.empty() ? 0 : predictions[0].size();
+    scratch.predictions.resize(predictions.size() * num_classes);
+    scratch.labels.resize(predictions.size());
+    for (size_t i = 0; i < predictions.size(); i++) {
+        std::copy(predictions[i].begin(), predictions[i].end(), scratch.predictions.begin() + i * num_classes);
+        scratch.labels[i] = argmax(targets[i].data(), targets[i].size());
+    }
+}
+
+float Metrics::accuracy(const std::vector<std::vector<float>>& predictions,
                        const std::vector<std::vector<float>>& targets) {
-    auto pred_classes = get_predicted_classes(predictions);
-    auto true_classes = get_true_classes(targets);
-    
     int correct = 0;
-    for (size_t i = 0; i < pred_classes.size(); i++) {
-        if (pred_classes[i] == true_classes[i]) {
+    for (size_t i = 0; i < predictions.size(); i++) {
+        if (argmax(predictions[i].data(), predictions[i].size()) ==
+            argmax(targets[i].data(), targets[i].size())) {
             correct++;
         }
     }
-    
-    return static_cast<float>(correct) / pred_classes.size();
+
+    return static_cast<float>(correct) / predictions.size();
 }
 
 float Metrics::cross_entropy_loss(
     const std::vector<std::vector<float>>& predictions,
     const std::vector<std::vector<float>>& targets) {
-    
+
     float total_loss = 0.0f;
-    const float epsilon = 1e-15f; // To prevent log(0)
-    
+
     for (size_t i = 0; i < predictions.size(); i++) {
         float sample_loss = 0.0f;
         for (size_t j = 0; j < predictions[i].size(); j++) {
-            // Clip predictions to prevent numerical instability
-            float pred = std::max(std::min(predictions[i][j], 1.0f - epsilon), epsilon);
+            float pred = std::max(std::min(predictions[i][j], 1.0f - LOG_EPSILON), LOG_EPSILON);
             sample_loss -= targets[i][j] * std::log(pred);
         }
         total_loss += sample_loss;
     }
-    
+
     return total_loss / predictions.size(); // Return average loss
 }
 
-std::array<std::array<int, 3>, 3> Metrics::confusion_matrix(
+ConfusionMatrix Metrics::confusion_matrix(
     const std::vector<std::vector<float>>& predictions,
     const std::vector<std::vector<float>>& targets) {
-    
-    std::array<std::array<int, 3>, 3> matrix = {{{0, 0, 0}, {0, 0, 0}, {0, 0, 0}}};
-    
-    auto pred_classes = get_predicted_classes(predictions);
-    auto true_classes = get_true_classes(targets);
-    
-    for (size_t i = 0; i < pred_classes.size(); i++) {
-        matrix[true_classes[i]][pred_classes[i]]++;
-    }
-    
+
+    ConfusionMatrix matrix(predictions.empty() ? 0 : predictions[0].size());
+    for (size_t i = 0; i < predictions.size(); i++) {
+        matrix.at(argmax(targets[i].data(), targets[i].size()),
+                  argmax(predictions[i].data(), predictions[i].size()))++;
+    }
     return matrix;
 }
 
-std::array<float, 3> Metrics::roc_auc(
+std::vector<float> Metrics::f1_scores(const ConfusionMatrix& conf_matrix) {
+    std::vector<float> precision, recall, f1;
+    class_scores(conf_matrix, precision, recall, f1);
+    return f1;
+}
+
+std::vector<float> Metrics::roc_auc(
     const std::vector<std::vector<float>>& predictions,
-    const std::vector<std::vector<float>>& targets) {
-    
-    std::array<float, 3> auc_scores = {0, 0, 0};
-    
-    // Calculate AUC for each class
-    for (int class_idx = 0; class_idx < 3; class_idx++) {
-        std::vector<std::pair<float, bool>> scores;
-        
-        // Collect predictions and true labels for this class
-        for (size_t i = 0; i < predictions.size(); i++) {
-            scores.push_back({
-                predictions[i][class_idx],
-                targets[i][class_idx] > 0.5f
-            });
-        }
-        
-        // Sort by predicted probability
-        std::sort(scores.begin(), scores.end());
-        
-        // Calculate AUC
-        float auc = 0;
-        int pos_count = 0;
-        int neg_count = 0;
-        
-        for (const auto& score : scores) {
-            if (score.second) pos_count++;
-            else neg_count++;
-        }
-        
-        if (pos_count > 0 && neg_count > 0) {
-            int tp = 0;
-            int fp = 0;
-            float prev_tpr = 0;
-            float prev_fpr = 0;
-            
-            for (auto it = scores.rbegin(); it != scores.rend(); ++it) {
-                if (it->second) tp++;
-                else fp++;
-                
-                float tpr = static_cast<float>(tp) / pos_count;
-                float fpr = static_cast<float>(fp) / neg_count;
-                
-                // Add trapezoid area
-                auc += (fpr - prev_fpr) * (tpr + prev_tpr) / 2;
-                
-                prev_tpr = tpr;
-                prev_fpr = fpr;
-            }
-        }
-        
-        auc_scores[class_idx] = auc;
-    }
-    
+    const std::vector<std::vector<float>>& targets,
+    float* macro_auc) {
+
+    AucScratch scratch;
+    flatten(predictions, targets, scratch);
+    std::vector<float> auc_scores;
+    roc_auc(scratch.predictions.data(), scratch.labels.data(), predictions.size(),
+            predictions.empty() ? 0 : predictions[0].size(), scratch, auc_scores, macro_auc);
     return auc_scores;
 }
 
-std::array<float, 3> Metrics::f1_scores(const std::array<std::array<int, 3>, 3>& conf_matrix) {
-    std::array<float, 3> f1_scores = {0, 0, 0};
-    
-    for (int i = 0; i < 3; i++) {
-        int true_pos = conf_matrix[i][i];
-        int false_pos = 0;
-        int false_neg = 0;
-        
-        for (int j = 0; j < 3; j++) {
-            if (i != j) {
-                false_pos += conf_matrix[j][i];
-                false_neg += conf_matrix[i][j];
+uint32_t Metrics::sortable_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // Negative floats order in reverse, so flip all their bits; positives only flip the sign
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void Metrics::roc_auc(const float* predictions, const int* labels, size_t rows, size_t num_classes,
+                      AucScratch& scratch, std::vector<float>& auc_scores, float* macro_auc) {
+    constexpr size_t INDEX_BITS = 24;
+    if (rows >= (size_t(1) << INDEX_BITS)) {
+        throw std::runtime_error("Too many samples for roc_auc");
+    }
+    if (num_classes > MAX_CLASSES) {
+        throw std::invalid_argument("Too many classes for roc_auc");
+    }
+
+    // Key layout: class (8 bits) | sortable score (32 bits) | sample index (24 bits)
+    const size_t total = rows * num_classes;
+    if (total == 0) {
+        // No samples: every class is undefined
+        auc_scores.assign(num_classes, 0.0f);
+        if (macro_auc) {
+            *macro_auc = 0.0f;
+        }
+        return;
+    }
+    scratch.keys.resize(total);
+    scratch.sorted.resize(total);
+    for (size_t i = 0; i < rows; i++) {
+        const float* row = predictions + i * num_classes;
+        for (size_t c = 0; c < num_classes; c++) {
+            scratch.keys[c * rows + i] = (static_cast<uint64_t>(c) << 56) |
+                                         (static_cast<uint64_t>(sortable_bits(row[c])) << INDEX_BITS) |
+                                         i;
+        }
+    }
+
+    // LSD radix sort on the class and score bytes; the index bits keep the input order
+    uint64_t* from = scratch.keys.data();
+    uint64_t* to = scratch.sorted.data();
+    for (size_t shift = INDEX_BITS; shift < 64; shift += 8) {
+        size_t counts[257] = {0};
+        for (size_t k = 0; k < total; k++) {
+            counts[((from[k] >> shift) & 0xFF) + 1]++;
+        }
+        // A byte that is the same for every key needs no pass
+        if (counts[((from[0] >> shift) & 0xFF) + 1] == total) {
+            continue;
+        }
+        for (size_t b = 0; b < 256; b++) {
+            counts[b + 1] += counts[b];
+        }
+        for (size_t k = 0; k < total; k++) {
+            to[counts[(from[k] >> shift) & 0xFF]++] = from[k];
+        }
+        std::swap(from, to);
+    }
+
+    // Each class is a contiguous run sorted by score. AUC = (R+ - P(P+1)/2) / (P N) with R+ the
+    // midrank sum of the positives.
+    auc_scores.assign(num_classes, 0.0f);
+    const uint64_t index_mask = (uint64_t(1) << INDEX_BITS) - 1;
+    float macro_sum = 0.0f;
+    size_t defined_classes = 0;
+
+    for (size_t c = 0; c < num_classes; c++) {
+        const uint64_t* run = from + c * rows;
+        double positive_rank_sum = 0.0;
+        size_t positives = 0;
+
+        size_t start = 0;
+        while (start < rows) {
+            size_t end = start + 1;
+            while (end < rows && (run[end] >> INDEX_BITS) == (run[start] >> INDEX_BITS)) {
+                end++;
+            }
+            double midrank = (start + 1 + end) / 2.0;
+            for (size_t k = start; k < end; k++) {
+                if (labels[run[k] & index_mask] == static_cast<int>(c)) {
+                    positive_rank_sum += midrank;
+                    positives++;
+                }
             }
+            start = end;
+        }
+
+        size_t negatives = rows - positives;
+        if (positives > 0 && negatives > 0) {
+            double u = positive_rank_sum - positives * (positives + 1) / 2.0;
+            auc_scores[c] = static_cast<float>(u / (static_cast<double>(positives) * negatives));
+            macro_sum += auc_scores[c];
+            defined_classes++;
         }
-        
-        float precision = true_pos / static_cast<float>(true_pos + false_pos);
-        float recall = true_pos / static_cast<float>(true_pos + false_neg);
-        
-        f1_scores[i] = 2 * (precision * recall) / (precision + recall);
     }
-    
-    return f1_scores;
+
+    if (macro_auc) {
+        *macro_auc = defined_classes > 0 ? macro_sum / defined_classes : 0.0f;
+    }
 }
 
-void Metrics::print_confusion_matrix(const std::array<std::array<int, 3>, 3>& matrix) {
-    std::cout << "\nConfusion Matrix:\n";
-    std::cout << "Predicted →\n";
-    std::cout << "Actual ↓  ";
-    
+void Metrics::print_confusion_matrix(const ConfusionMatrix& matrix, std::ostream& out) {
+    out << "\nConfusion Matrix:\n";
+    out << "Predicted →\n";
+    out << "Actual ↓  ";
+
     // Column headers
-    for (int i = 0; i < 3; i++) {
-        std::cout << std::setw(8) << i;
+    for (size_t i = 0; i < matrix.num_classes; i++) {
+        out << std::setw(8) << i;
     }
-    std::cout << "\n";
-    
+    out << "\n";
+
     // Matrix values
-    for (int i = 0; i < 3; i++) {
-        std::cout << std::setw(8) << i;
-        for (int j = 0; j < 3; j++) {
-            std::cout << std::setw(8) << matrix[i][j];
+    for (size_t i = 0; i < matrix.num_classes; i++) {
+        out << std::setw(8) << i;
+        for (size_t j = 0; j < matrix.num_classes; j++) {
+            out << std::setw(8) << matrix.at(i, j);
+        }
+        out << "\n";
+    }
+}
+
+StreamingAuc::StreamingAuc(size_t num_classes, size_t bins)
+    : bins(std::max(size_t(2), bins + bins % 2)),
+      histograms(num_classes) {
+    reset();
+}
+
+void StreamingAuc::reset() {
+    for (auto& histogram : histograms) {
+        histogram = Histogram();
+        histogram.positives.assign(bins, 0);
+        histogram.negatives.assign(bins, 0);
+    }
+}
+
+void StreamingAuc::coarsen(std::vector<uint32_t>& counts, bool keep_upper) {
+    // Merge bin pairs into one half of the histogram in place and clear the other half
+    const size_t half = counts.size() / 2;
+    if (keep_upper) {
+        for (size_t b = half; b-- > 0;) {
+            counts[half + b] = counts[2 * b] + counts[2 * b + 1];
+        }
+        std::fill(counts.begin(), counts.begin() + half, 0);
+    } else {
+        for (size_t b = 0; b < half; b++) {
+            counts[b] = counts[2 * b] + counts[2 * b + 1];
+        }
+        std::fill(counts.begin() + half, counts.end(), 0);
+    }
+}
+
+void StreamingAuc::insert(Histogram& histogram, float score, bool positive) const {
+    if (histogram.width == 0.0) {
+        // Start with the fine resolution centred on the first score
+        histogram.width = 1e-7;
+        histogram.origin = score - histogram.width * (bins / 2);
+    }
+
+    while (score < histogram.origin || score >= histogram.origin + histogram.width * bins) {
+        bool extend_down = score < histogram.origin;
+        coarsen(histogram.positives, extend_down);
+        coarsen(histogram.negatives, extend_down);
+        histogram.width *= 2.0;
+        if (extend_down) {
+            histogram.origin -= histogram.width * (bins / 2);
+        }
+    }
+
+    size_t bin = std::min(static_cast<size_t>((score - histogram.origin) / histogram.width), bins - 1);
+    if (positive) {
+        histogram.positives[bin]++;
+        histogram.positive_count++;
+    } else {
+        histogram.negatives[bin]++;
+        histogram.negative_count++;
+    }
+}
+
+void StreamingAuc::add(const float* prediction, int label) {
+    for (size_t c = 0; c < histograms.size(); c++) {
+        if (std::isfinite(prediction[c])) {
+            insert(histograms[c], prediction[c], static_cast<int>(c) == label);
         }
-        std::cout << "\n";
     }
 }
 
-std::vector<int> Metrics::get_predicted_classes(const std::vector<std::vector<float>>& predictions) {
-    std::vector<int> pred_classes;
-    pred_classes.reserve(predictions.size());
-    
-    for (const auto& pred : predictions) {
-        auto max_it = std::max_element(pred.begin(), pred.end());
-        pred_classes.push_back(std::distance(pred.begin(), max_it));
+std::vector<float> StreamingAuc::per_class() const {
+    std::vector<float> auc_scores(histograms.size(), 0.0f);
+    for (size_t c = 0; c < histograms.size(); c++) {
+        const Histogram& histogram = histograms[c];
+        if (histogram.positive_count == 0 || histogram.negative_count == 0) {
+            continue;
+        }
+
+        double pairs_won = 0.0;
+        double negatives_below = 0.0;
+        for (size_t b = 0; b < bins; b++) {
+            // Pairs in the same bin are treated as ties
+            pairs_won += histogram.positives[b] * (negatives_below + 0.5 * histogram.negatives[b]);
+            negatives_below += histogram.negatives[b];
+        }
+        auc_scores[c] = static_cast<float>(
+            pairs_won / (static_cast<double>(histogram.positive_count) * histogram.negative_count));
     }
-    
-    return pred_classes;
+    return auc_scores;
 }
 
-std::vector<int> Metrics::get_true_classes(const std::vector<std::vector<float>>& targets) {
-    std::vector<int> true_classes;
-    true_classes.reserve(targets.size());
-    
-    for (const auto& target : targets) {
-        auto max_it = std::max_element(target.begin(), target.end());
-        true_classes.push_back(std::distance(target.begin(), max_it));
+float StreamingAuc::macro() const {
+    auto auc_scores = per_class();
+    float sum = 0.0f;
+    size_t defined_classes = 0;
+    for (size_t c = 0; c < histograms.size(); c++) {
+        if (histograms[c].positive_count > 0 && histograms[c].negative_count > 0) {
+            sum += auc_scores[c];
+            defined_classes++;
+        }
     }
-    
-    return true_classes;
-}
\ No newline at end of file
+    return defined_classes > 0 ? sum / defined_classes : 0.0f;
+}
@@ -0,0 +1,348 @@
+#include "MetricsSink/MetricsSink.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+std::ofstream open_output(const std::string& path, std::ios::openmode mode = std::ios::out) {
+    std::ofstream stream(path, mode | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Cannot open metrics file: " + path);
+    }
+    return stream;
+}
+
+std::string csv_quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+std::string json_quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': quoted += "\\\""; break;
+            case '\\': quoted += "\\\\"; break;
+            case '\n': quoted += "\\n"; break;
+            case '\r': quoted += "\\r"; break;
+            case '\t': quoted += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    quoted += escaped;
+                } else {
+                    quoted += c;
+                }
+        }
+    }
+    return quoted + "\"";
+}
+
+// Text back-ends keep the labels, already quoted for their format, so rows can name their
+// configuration. Configurations without a label get the format's empty value.
+class LabelTable {
+public:
+    explicit LabelTable(std::string missing) : missing(std::move(missing)) {}
+
+    void set(int32_t config, const std::string& label) { labels[config] = label; }
+
+    const std::string& get(int32_t config) const {
+        auto it = labels.find(config);
+        return it != labels.end() ? it->second : missing;
+    }
+
+private:
+    std::unordered_map<int32_t, std::string> labels;
+    std::string missing;
+};
+
+// Same columns and precision as the original per-round CSV
+class CsvBackend : public MetricsBackend {
+public:
+    CsvBackend(const std::string& path, bool with_config)
+        : out(open_output(path)), with_config(with_config), labels("") {
+        out << (with_config ? "Round,Config,Accuracy,TestLoss,TrainingLoss,SimTime,Bytes\n"
+                            : "Round,Accuracy,TestLoss,TrainingLoss,SimTime,Bytes\n");
+        out << std::fixed << std::setprecision(4);
+    }
+
+    void write_label(int32_t config, const std::string& label) override {
+        labels.set(config, csv_quote(label));
+    }
+
+    void write_rows(const MetricsRecord* rows, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            const MetricsRecord& row = rows[i];
+            out << row.round << ",";
+            if (with_config) {
+                out << labels.get(row.config) << ",";
+            }
+            out << (row.accuracy * 100.0f) << ","
+                << row.test_loss << ","
+                << row.training_loss << ","
+                << row.sim_time << ","
+                << row.bytes << "\n";
+        }
+    }
+
+    void flush() override { out.flush(); }
+
+private:
+    std::ofstream out;
+    bool with_config;
+    LabelTable labels;
+};
+
+// One JSON object per line
+class NdjsonBackend : public MetricsBackend {
+public:
+    NdjsonBackend(const std::string& path, bool with_config)
+        : out(open_output(path)), with_config(with_config), labels("null") {
+        out << std::fixed << std::setprecision(4);
+    }
+
+    void write_label(int32_t config, const std::string& label) override {
+        labels.set(config, json_quote(label));
+    }
+
+    void write_rows(const MetricsRecord* rows, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            const MetricsRecord& row = rows[i];
+            out << "{\"round\":" << row.round;
+            if (with_config) {
+                out << ",\"config_id\":" << row.config
+                    << ",\"config\":" << labels.get(row.config);
+            }
+            out << ",\"accuracy\":" << (row.accuracy * 100.0f)
+                << ",\"test_loss\":" << row.test_loss
+                << ",\"training_loss\":" << row.training_loss
+                << ",\"sim_time\":" << row.sim_time
+                << ",\"bytes\":" << row.bytes << "}\n";
+        }
+    }
+
+    void flush() override { out.flush(); }
+
+private:
+    std::ofstream out;
+    bool with_config;
+    LabelTable labels;
+};
+
+// Columnar binary format, little-endian (see README "Metrics Output"):
+//   file header: magic "SBMT", version u16, column count u16
+//   chunks, each padded to 8 bytes: tag u8, 3 reserved bytes, body size u32, body
+//     'L' body: config id i32, UTF-8 label
+//     'R' body: row count u32, 4 reserved bytes, then one contiguous array per column:
+//               sim_time f64, bytes u64, round i32, config i32, accuracy % f32,
+//               test_loss f32, training_loss f32
+class BinaryBackend : public MetricsBackend {
+public:
+    static constexpr char MAGIC[4] = {'S', 'B', 'M', 'T'};
+    static constexpr uint16_t VERSION = 1;
+    static constexpr uint16_t COLUMNS = 7;
+
+    explicit BinaryBackend(const std::string& path)
+        : out(open_output(path, std::ios::out | std::ios::binary)) {
+        out.write(MAGIC, sizeof(MAGIC));
+        put(VERSION);
+        put(COLUMNS);
+    }
+
+    void write_label(int32_t config, const std::string& label) override {
+        begin_chunk('L', sizeof(int32_t) + label.size());
+        put(config);
+        out.write(label.data(), label.size());
+        end_chunk(sizeof(int32_t) + label.size());
+    }
+
+    void write_rows(const MetricsRecord* rows, size_t count) override {
+        const size_t body = 8 + count * (2 * sizeof(double) + 5 * sizeof(float));
+        begin_chunk('R', body);
+        put(static_cast<uint32_t>(count));
+        put(static_cast<uint32_t>(0));
+        for (size_t i = 0; i < count; i++) put(rows[i].sim_time);
+        for (size_t i = 0; i < count; i++) put(rows[i].bytes);
+        for (size_t i = 0; i < count; i++) put(rows[i].round);
+        for (size_t i = 0; i < count; i++) put(rows[i].config);
+        for (size_t i = 0; i < count; i++) put(rows[i].accuracy * 100.0f);
+        for (size_t i = 0; i < count; i++) put(rows[i].test_loss);
+        for (size_t i = 0; i < count; i++) put(rows[i].training_loss);
+        end_chunk(body);
+    }
+
+    void flush() override { out.flush(); }
+
+private:
+    // Little-endian bytes of an integer or IEEE float, whatever the host byte order
+    template <typename T>
+    void put(T value) {
+        static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "Unsupported column type");
+        static_assert(std::numeric_limits<float>::is_iec559 && std::numeric_limits<double>::is_iec559,
+                      "Columns are IEEE 754");
+        using Bits = std::conditional_t<sizeof(T) == 8, uint64_t,
+                                        std::conditional_t<sizeof(T) == 4, uint32_t, uint16_t>>;
+        Bits bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes[i] = static_cast<char>(bits >> (8 * i));
+        }
+        out.write(bytes, sizeof(T));
+    }
+
+    void begin_chunk(char tag, size_t body) {
+        const char header[4] = {tag, 0, 0, 0};
+        out.write(header, sizeof(header));
+        put(static_cast<uint32_t>(body));
+    }
+
+    void end_chunk(size_t body) {
+        static const char padding[8] = {};
+        out.write(padding, (8 - body % 8) % 8);
+    }
+
+    std::ofstream out;
+};
+
+constexpr char BinaryBackend::MAGIC[4];
+
+} // namespace
+
+std::unique_ptr<MetricsBackend> MetricsBackend::create(MetricsFormat format, const std::string& path,
+                                                       bool with_config) {
+    switch (format) {
+        case MetricsFormat::NDJSON:
+            return std::make_unique<NdjsonBackend>(path, with_config);
+        case MetricsFormat::BINARY:
+            return std::make_unique<BinaryBackend>(path);
+        case MetricsFormat::CSV:
+        default:
+            return std::make_unique<CsvBackend>(path, with_config);
+    }
+}
+
+MetricsSink::MetricsSink(const std::string& path, MetricsFormat format, bool with_config, size_t capacity)
+    : file_path(path),
+      backend(MetricsBackend::create(format, path, with_config)),
+      queue(capacity) {
+    batch.reserve(queue.capacity());
+    writer = std::thread(&MetricsSink::run_writer, this);
+}
+
+MetricsSink::~MetricsSink() {
+    close();
+}
+
+bool MetricsSink::record(const MetricsRecord& record) {
+    bool queued = queue.push(record);
+    if (!queued) {
+        dropped_records.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Only the first producer past the mark pays for the notification
+    if (queue.size() >= queue.capacity() / 2 && !wake_requested.exchange(true, std::memory_order_relaxed)) {
+        wake.notify_one();
+    }
+    return queued;
+}
+
+void MetricsSink::label_config(int32_t config, const std::string& label) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_labels.emplace_back(config, label);
+}
+
+void MetricsSink::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    backend.reset();
+}
+
+size_t MetricsSink::drain() {
+    // Pop rows before taking labels: a label is queued before its rows, so every
+    // label a popped row refers to is already pending
+    batch.clear();
+    MetricsRecord row;
+    while (batch.size() < queue.capacity() && queue.pop(row)) {
+        batch.push_back(row);
+    }
+
+    std::vector<std::pair<int32_t, std::string>> labels;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        labels.swap(pending_labels);
+    }
+
+    for (const auto& label : labels) {
+        backend->write_label(label.first, label.second);
+    }
+    if (!batch.empty()) {
+        backend->write_rows(batch.data(), batch.size());
+    }
+    if (!batch.empty() || !labels.empty()) {
+        backend->flush();
+    }
+    return batch.size();
+}
+
+void MetricsSink::run_writer() {
+    for (;;) {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] {
+                return stopping || wake_requested.load(std::memory_order_relaxed);
+            });
+            stop = stopping;
+        }
+        wake_requested.store(false, std::memory_order_relaxed);
+        while (drain() == queue.capacity()) {
+        }
+        if (stop) {
+            return;
+        }
+    }
+}
+
+MetricsFormat MetricsSink::parse_format(const std::string& name) {
+    if (name == "csv") return MetricsFormat::CSV;
+    if (name == "ndjson" || name == "jsonl") return MetricsFormat::NDJSON;
+    if (name == "bin" || name == "binary") return MetricsFormat::BINARY;
+    throw std::runtime_error("Unknown metrics format: " + name);
+}
+
+std::string MetricsSink::format_name(MetricsFormat format) {
+    switch (format) {
+        case MetricsFormat::NDJSON: return "ndjson";
+        case MetricsFormat::BINARY: return "bin";
+        case MetricsFormat::CSV:
+        default: return "csv";
+    }
+}
+
+MetricsFormat MetricsSink::format_for_path(const std::string& path) {
+    auto ends_with = [&path](const char* suffix) {
+        size_t length = std::strlen(suffix);
+        return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+    };
+    if (ends_with(".ndjson") || ends_with(".jsonl")) return MetricsFormat::NDJSON;
+    if (ends_with(".smet")) return MetricsFormat::BINARY;
+    return MetricsFormat::CSV;
+}
@@ -0,0 +1,174 @@
+#include "ModelFile/ModelFile.h"
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    ModelFormat::Header header_for(const std::vector<size_t>& topology) {
+        if (topology.size() < 2 || topology.size() > ModelFormat::MAX_LAYERS) {
+            throw std::runtime_error("Model topology must have between 2 and " +
+                                     std::to_string(ModelFormat::MAX_LAYERS) + " layers");
+        }
+
+        ModelFormat::Header header;
+        header.layerCount = static_cast<uint8_t>(topology.size());
+        for (size_t i = 0; i < topology.size(); i++) {
+            if (topology[i] == 0 || topology[i] > 0xFFFF) {
+                throw std::runtime_error("Layer size out of range for the model format");
+            }
+            header.layers[i] = static_cast<uint16_t>(topology[i]);
+        }
+        return header;
+    }
+}
+
+void save_model_file(const std::string& path,
+                     const std::vector<size_t>& topology,
+                     const std::vector<float>& flat_weights,
+                     const std::vector<float>& scale_params,
+                     WeightCodec::Format format,
+                     const std::vector<uint8_t>& mask) {
+    ModelFormat::Header header = header_for(topology);
+    header.format = format;
+    header.flags = ModelFormat::FLAG_HAS_BIASES;
+    if (!mask.empty()) {
+        header.flags |= ModelFormat::FLAG_HAS_MASK;
+    }
+    if (scale_params.size() >= 2) {
+        header.featureMin = scale_params[0];
+        header.featureMax = scale_params[1];
+    }
+
+    if (flat_weights.size() != header.weightCount() + header.biasCount() ||
+        (!mask.empty() && mask.size() != flat_weights.size())) {
+        throw std::runtime_error("Weight count does not match the model topology");
+    }
+
+    // Split the simulator's interleaved layout into the firmware's weights and the biases;
+    // with a mask, only the kept weights are stored and the mask has a bit per weight
+    std::vector<float> weights;
+    std::vector<float> biases;
+    std::vector<uint8_t> bitmap(mask.empty() ? 0 : (header.weightCount() + 7) / 8, 0);
+    size_t offset = 0;
+    size_t bit = 0;
+    for (size_t i = 0; i + 1 < topology.size(); i++) {
+        size_t weight_count = topology[i] * topology[i + 1];
+        for (size_t w = offset; w < offset + weight_count; w++, bit++) {
+            if (mask.empty()) {
+                weights.push_back(flat_weights[w]);
+            } else if (mask[w]) {
+                weights.push_back(flat_weights[w]);
+                bitmap[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+            }
+        }
+        offset += weight_count;
+        biases.insert(biases.end(), flat_weights.begin() + offset, flat_weights.begin() + offset + topology[i + 1]);
+        offset += topology[i + 1];
+    }
+    header.keptWeights = static_cast<uint32_t>(weights.size());
+
+    std::vector<uint8_t> file(ModelFormat::encodedSize(header));
+    if (file.empty() ||
+        ModelFormat::encode(header, weights.data(), biases.data(), file.data(), file.size(),
+                            bitmap.empty() ? nullptr : bitmap.data()) != file.size()) {
+        throw std::runtime_error("Failed to encode model");
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(file.data()), file.size())) {
+        throw std::runtime_error("Could not write model file: " + path);
+    }
+}
+
+MappedModel::MappedModel(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open model file: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("Could not read model file: " + path);
+    }
+    mapped_size = static_cast<size_t>(info.st_size);
+
+    void* mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map model file: " + path);
+    }
+    data = static_cast<const uint8_t*>(mapping);
+
+    if (!ModelFormat::parseHeader(data, mapped_size, model_header) ||
+        mapped_size != model_header.fileBytes() ||
+        !ModelFormat::verifyPayload(model_header, payload())) {
+        munmap(const_cast<uint8_t*>(data), mapped_size);
+        data = nullptr;
+        throw std::runtime_error("Corrupted or unsupported model file: " + path);
+    }
+}
+
+MappedModel::~MappedModel() {
+    if (data) {
+        munmap(const_cast<uint8_t*>(data), mapped_size);
+    }
+}
+
+std::vector<size_t> MappedModel::topology() const {
+    return std::vector<size_t>(model_header.layers, model_header.layers + model_header.layerCount);
+}
+
+const float* MappedModel::fp32_weights() const {
+    if (model_header.format != WeightCodec::Format::FLOAT32 || model_header.hasMask()) {
+        return nullptr;
+    }
+    // The padded header keeps the values aligned for direct float access
+    return reinterpret_cast<const float*>(payload() + WeightCodec::HEADER_BYTES);
+}
+
+std::vector<float> MappedModel::to_flat_weights() const {
+    std::vector<float> weights(model_header.weightCount());
+    std::vector<float> biases(model_header.biasCount(), 0.0f);
+    if (ModelFormat::decodeWeights(model_header, payload(), weights.data(), weights.size()) == 0 ||
+        (model_header.hasBiases() &&
+         ModelFormat::decodeBiases(model_header, payload(), biases.data(), biases.size()) == 0)) {
+        throw std::runtime_error("Failed to decode model weights");
+    }
+
+    std::vector<float> flat_weights;
+    size_t weight_offset = 0;
+    size_t bias_offset = 0;
+    for (size_t i = 0; i + 1 < model_header.layerCount; i++) {
+        size_t weight_count = static_cast<size_t>(model_header.layers[i]) * model_header.layers[i + 1];
+        flat_weights.insert(flat_weights.end(), weights.begin() + weight_offset,
+                            weights.begin() + weight_offset + weight_count);
+        weight_offset += weight_count;
+        flat_weights.insert(flat_weights.end(), biases.begin() + bias_offset,
+                            biases.begin() + bias_offset + model_header.layers[i + 1]);
+        bias_offset += model_header.layers[i + 1];
+    }
+    return flat_weights;
+}
+
+std::vector<uint8_t> MappedModel::parameter_mask() const {
+    const uint8_t* bitmap = ModelFormat::mask(model_header, payload());
+    if (!bitmap) {
+        return {};
+    }
+
+    // Biases are never pruned
+    std::vector<uint8_t> mask;
+    size_t bit = 0;
+    for (size_t i = 0; i + 1 < model_header.layerCount; i++) {
+        size_t weight_count = static_cast<size_t>(model_header.layers[i]) * model_header.layers[i + 1];
+        for (size_t w = 0; w < weight_count; w++, bit++) {
+            mask.push_back((bitmap[bit / 8] >> (bit % 8)) & 1);
+        }
+        mask.insert(mask.end(), model_header.layers[i + 1], 1);
+    }
+    return mask;
+}
@@ -1,158 +1,342 @@
 #include "NeuralNetwork/NeuralNetwork.h"
+#include <algorithm>
+#include <stdexcept>
 
-Layer::Layer(size_t inputs, size_t outputs, uint32_t seed) : 
-    weights(outputs, std::vector<float>(inputs)),
-    biases(outputs),
-    last_outputs(outputs) {
+Layer::Layer(size_t inputs, size_t outputs, CounterRng& rng, std::vector<float>& parameters,
+             Activation activation) : 
+    inputs(inputs),
+    outputs(outputs),
+    offset(parameters.size()),
+    last_outputs(outputs),
+    activation(activation) {
     
-    // Initialize with Xavier/Glorot initialization
-    std::mt19937 gen(seed);
-    float weight_range = std::sqrt(6.0f / (inputs + outputs));
-    std::uniform_real_distribution<float> d(-weight_range, weight_range);
+    // Initialize with Xavier/Glorot initialization, or He initialization for ReLU
+    float weight_range = activation == Activation::RELU
+        ? std::sqrt(6.0f / inputs)
+        : std::sqrt(6.0f / (inputs + outputs));
     
     // Initialize weights
-    for(auto& neuron_weights : weights) {
-        for(float& weight : neuron_weights) {
-            weight = d(gen);
-        }
+    for(size_t i = 0; i < inputs * outputs; i++) {
+        parameters.push_back(rng.uniform(-weight_range, weight_range));
     }
     
     // Initialize biases to small random values using the same RNG
     // This ensures the biases are also deterministic based on the seed
-    std::uniform_real_distribution<float> bias_dist(-0.1f, 0.1f);
-    for(float& bias : biases) {
-        bias = bias_dist(gen);
+    for(size_t i = 0; i < outputs; i++) {
+        parameters.push_back(rng.uniform(-0.1f, 0.1f));
+    }
+}
+
+void Layer::activate() {
+    switch (activation) {
+        case Activation::SIGMOID:
+            for (float& y : last_outputs) y = 1.0f / (1.0f + std::exp(-y));
+            break;
+        case Activation::RELU:
+            for (float& y : last_outputs) y = std::max(y, 0.0f);
+            break;
+        case Activation::TANH:
+            for (float& y : last_outputs) y = std::tanh(y);
+            break;
+        case Activation::LINEAR:
+            break;
+        case Activation::SOFTMAX: {
+            // Shift by the largest sum so exp() cannot overflow
+            float largest = *std::max_element(last_outputs.begin(), last_outputs.end());
+            float total = 0.0f;
+            for (float& y : last_outputs) {
+                y = std::exp(y - largest);
+                total += y;
+            }
+            for (float& y : last_outputs) y /= total;
+            break;
+        }
     }
 }
 
-float Layer::activate(float x) const {
-    // Sigmoid activation
-    return 1.0f / (1.0f + std::exp(-x));
+float Layer::activate_derivative(float y) const {
+    switch (activation) {
+        case Activation::SIGMOID: return y * (1.0f - y);
+        case Activation::RELU: return y > 0.0f ? 1.0f : 0.0f;
+        case Activation::TANH: return 1.0f - y * y;
+        // Softmax is fused with the cross-entropy: the incoming gradient is already
+        // taken with respect to the sums
+        case Activation::LINEAR:
+        case Activation::SOFTMAX: return 1.0f;
+    }
+    return 1.0f;
 }
 
-float Layer::activate_derivative(float x) const {
-    // Sigmoid derivative: f'(x) = f(x) * (1 - f(x))
-    return x * (1.0f - x);
+void Layer::set_mask(const uint8_t* mask) {
+    sparse = mask != nullptr;
+    row_start.clear();
+    columns.clear();
+    if (!sparse) {
+        return;
+    }
+    row_start.reserve(outputs + 1);
+    for (size_t i = 0; i < outputs; i++) {
+        row_start.push_back(static_cast<uint32_t>(columns.size()));
+        for (size_t j = 0; j < inputs; j++) {
+            if (mask[i * inputs + j]) columns.push_back(static_cast<uint32_t>(j));
+        }
+    }
+    row_start.push_back(static_cast<uint32_t>(columns.size()));
 }
 
-std::vector<float> Layer::forward(const std::vector<float>& inputs) {
-    last_outputs.resize(weights.size());
+const std::vector<float>& Layer::forward(const float* parameters, const std::vector<float>& inputs) {
+    const float* weights = parameters + offset;
+    const float* biases = weights + this->inputs * outputs;
+
+    if (sparse) {
+        for (size_t i = 0; i < outputs; i++) {
+            const float* neuron_weights = weights + i * this->inputs;
+            float sum = biases[i];
+            for (uint32_t k = row_start[i]; k < row_start[i + 1]; k++) {
+                sum += neuron_weights[columns[k]] * inputs[columns[k]];
+            }
+            last_outputs[i] = sum;
+        }
+        activate();
+        return last_outputs;
+    }
     
-    for(size_t i = 0; i < weights.size(); i++) {
+    for(size_t i = 0; i < outputs; i++) {
         // Start with the bias term instead of 0
         float sum = biases[i];
         
         // Add weighted inputs
-        for(size_t j = 0; j < weights[i].size(); j++) {
-            sum += weights[i][j] * inputs[j];
+        const float* neuron_weights = weights + i * this->inputs;
+        for(size_t j = 0; j < this->inputs; j++) {
+            sum += neuron_weights[j] * inputs[j];
         }
         
-        // Apply activation function
-        last_outputs[i] = activate(sum);
+        last_outputs[i] = sum;
     }
     
+    // Apply activation function
+    activate();
     return last_outputs;
 }
 
-void Layer::backward(const std::vector<float>& inputs, 
+void Layer::backward(float* parameters,
+                    const std::vector<float>& inputs, 
                     std::vector<float>& gradients, 
                     float learning_rate) {
-    std::vector<float> next_gradients(inputs.size(), 0.0f);
+    float* weights = parameters + offset;
+    float* biases = weights + this->inputs * outputs;
+    next_gradients.assign(this->inputs, 0.0f);
     
-    for(size_t i = 0; i < weights.size(); i++) {
+    for(size_t i = 0; i < outputs; i++) {
         float delta = gradients[i] * activate_derivative(last_outputs[i]);
         
         // Update biases
         biases[i] -= learning_rate * delta;
         
         // Update weights
-        for(size_t j = 0; j < weights[i].size(); j++) {
-            next_gradients[j] += weights[i][j] * delta;
-            weights[i][j] -= learning_rate * delta * inputs[j];
+        float* neuron_weights = weights + i * this->inputs;
+        if (sparse) {
+            for (uint32_t k = row_start[i]; k < row_start[i + 1]; k++) {
+                const uint32_t j = columns[k];
+                next_gradients[j] += neuron_weights[j] * delta;
+                neuron_weights[j] -= learning_rate * delta * inputs[j];
+            }
+            continue;
+        }
+        for(size_t j = 0; j < this->inputs; j++) {
+            next_gradients[j] += neuron_weights[j] * delta;
+            neuron_weights[j] -= learning_rate * delta * inputs[j];
         }
     }
     
-    gradients = next_gradients;
+    gradients.swap(next_gradients);
 }
 
-NeuralNetwork::NeuralNetwork(const std::vector<size_t>& topology, uint32_t seed = 42) {
+void Layer::gradient(const float* parameters,
+                     const std::vector<float>& inputs,
+                     std::vector<float>& gradients,
+                     float* parameter_gradients) {
+    const float* weights = parameters + offset;
+    float* weight_gradients = parameter_gradients + offset;
+    float* bias_gradients = weight_gradients + this->inputs * outputs;
+    next_gradients.assign(this->inputs, 0.0f);
+    if (sparse) {
+        // Pruned weights have no gradient
+        std::fill(weight_gradients, bias_gradients, 0.0f);
+    }
+
+    for(size_t i = 0; i < outputs; i++) {
+        float delta = gradients[i] * activate_derivative(last_outputs[i]);
+        bias_gradients[i] = delta;
+
+        const float* neuron_weights = weights + i * this->inputs;
+        float* neuron_gradients = weight_gradients + i * this->inputs;
+        if (sparse) {
+            for (uint32_t k = row_start[i]; k < row_start[i + 1]; k++) {
+                const uint32_t j = columns[k];
+                next_gradients[j] += neuron_weights[j] * delta;
+                neuron_gradients[j] = delta * inputs[j];
+            }
+            continue;
+        }
+        for(size_t j = 0; j < this->inputs; j++) {
+            next_gradients[j] += neuron_weights[j] * delta;
+            neuron_gradients[j] = delta * inputs[j];
+        }
+    }
+
+    gradients.swap(next_gradients);
+}
+
+NeuralNetwork::NeuralNetwork(const std::vector<size_t>& topology, uint32_t seed, uint32_t client,
+                             const std::vector<Activation>& activations) {
+    std::vector<Activation> per_layer = layer_activations(activations, topology.size() - 1);
+    // Layers draw one after another from the stream of this client
+    CounterRng rng(seed, RngPurpose::WEIGHT_INIT, 0, client);
     for(size_t i = 0; i < topology.size() - 1; i++) {
-        // Use seed + i to get different but deterministic initialization per layer
-        layers.emplace_back(topology[i], topology[i + 1], seed + i);
+        layers.emplace_back(topology[i], topology[i + 1], rng, parameters, per_layer[i]);
     }
 }
 
 std::vector<float> NeuralNetwork::forward(const std::vector<float>& inputs) {
-    std::vector<float> current = inputs;
+    const std::vector<float>* current = &inputs;
     for(auto& layer : layers) {
-        current = layer.forward(current);
+        current = &layer.forward(parameters.data(), *current);
     }
-    return current;
+    return *current;
 }
 
-void NeuralNetwork::train(const std::vector<float>& inputs, 
-                         const std::vector<float>& targets, 
-                         float learning_rate) {
+void NeuralNetwork::output_gradients(const std::vector<float>& inputs, const std::vector<float>& targets) {
     // Forward pass
-    auto outputs = forward(inputs);
+    const std::vector<float>* outputs = &inputs;
+    for(auto& layer : layers) {
+        outputs = &layer.forward(parameters.data(), *outputs);
+    }
     
-    // Calculate output layer gradients
-    std::vector<float> gradients = outputs;
+    // Calculate output layer gradients. For sigmoid outputs this is the squared-error
+    // gradient; the layer multiplies it by the derivative. For softmax it is already the
+    // cross-entropy gradient of the sums, so the layer uses it as is.
+    gradients.resize(outputs->size());
     for(size_t i = 0; i < gradients.size(); i++) {
-        gradients[i] = outputs[i] - targets[i];
+        gradients[i] = (*outputs)[i] - targets[i];
     }
+}
+
+void NeuralNetwork::train(const std::vector<float>& inputs, 
+                         const std::vector<float>& targets, 
+                         float learning_rate) {
+    output_gradients(inputs, targets);
     
     // Backward pass
-    std::vector<float> current_inputs = inputs;
     for(int i = layers.size() - 1; i >= 0; i--) {
-        layers[i].backward(i == 0 ? inputs : layers[i-1].get_last_outputs(), 
+        layers[i].backward(parameters.data(), i == 0 ? inputs : layers[i-1].get_last_outputs(), 
                          gradients, learning_rate);
     }
 }
 
-std::vector<float> NeuralNetwork::get_flat_weights() const {
-    std::vector<float> flat_weights;
-    for(const auto& layer : layers) {
-        const auto& weights = layer.get_weights();
-        // Add weights
-        for(const auto& neuron : weights) {
-            flat_weights.insert(flat_weights.end(), neuron.begin(), neuron.end());
+void NeuralNetwork::compute_gradients(const std::vector<float>& inputs,
+                                      const std::vector<float>& targets,
+                                      std::vector<float>& parameter_gradients) {
+    output_gradients(inputs, targets);
+    parameter_gradients.resize(parameters.size());
+
+    for(int i = layers.size() - 1; i >= 0; i--) {
+        layers[i].gradient(parameters.data(), i == 0 ? inputs : layers[i-1].get_last_outputs(),
+                           gradients, parameter_gradients.data());
+    }
+}
+
+size_t NeuralNetwork::memory_bytes() const {
+    size_t floats = parameters.size();
+    size_t widest = 0;
+    for (const auto& layer : layers) {
+        // Cached outputs, and the gradient buffers sized by the widest layer
+        floats += layer.output_size();
+        widest = std::max({widest, layer.input_size(), layer.output_size()});
+    }
+    return (floats + 2 * widest) * sizeof(float);
+}
+
+std::vector<Activation> NeuralNetwork::get_activations() const {
+    std::vector<Activation> activations;
+    for (const auto& layer : layers) {
+        activations.push_back(layer.get_activation());
+    }
+    return activations;
+}
+
+std::vector<Activation> NeuralNetwork::layer_activations(const std::vector<Activation>& spec, size_t layer_count) {
+    std::vector<Activation> per_layer;
+    if (spec.empty()) {
+        per_layer.assign(layer_count, Activation::SIGMOID);
+    } else if (spec.size() == layer_count) {
+        per_layer = spec;
+    } else if (spec.size() == 2) {
+        per_layer.assign(layer_count, spec[0]);
+        per_layer.back() = spec[1];
+    } else {
+        throw std::invalid_argument("Expected one activation per layer (" + std::to_string(layer_count) +
+                                    ") or two (hidden, output), got " + std::to_string(spec.size()));
+    }
+    for (size_t i = 0; i + 1 < per_layer.size(); i++) {
+        if (per_layer[i] == Activation::SOFTMAX) {
+            throw std::invalid_argument("Softmax is only supported on the output layer");
         }
-        
-        // Add biases from the layer
-        const auto& biases = layer.get_biases();
-        flat_weights.insert(flat_weights.end(), biases.begin(), biases.end());
     }
-    return flat_weights;
+    return per_layer;
+}
+
+Activation NeuralNetwork::parse_activation(const std::string& name) {
+    if (name == "sigmoid") return Activation::SIGMOID;
+    if (name == "relu") return Activation::RELU;
+    if (name == "tanh") return Activation::TANH;
+    if (name == "linear") return Activation::LINEAR;
+    if (name == "softmax") return Activation::SOFTMAX;
+    throw std::invalid_argument("Unknown activation: " + name);
+}
+
+std::string NeuralNetwork::activation_name(Activation activation) {
+    switch (activation) {
+        case Activation::SIGMOID: return "sigmoid";
+        case Activation::RELU: return "relu";
+        case Activation::TANH: return "tanh";
+        case Activation::LINEAR: return "linear";
+        case Activation::SOFTMAX: return "softmax";
+    }
+    return "unknown";
 }
 
 void NeuralNetwork::set_flat_weights(const std::vector<float>& weights) {
-    size_t offset = 0;
-    for(auto& layer : layers) {
-        size_t inputs = layer.input_size();
-        size_t outputs = layer.output_size();
-        
-        // Calculate sizes
-        size_t weight_count = inputs * outputs;
-        size_t bias_count = outputs;
-        
-        // Extract and set weights
-        std::vector<std::vector<float>> layer_weight_matrix(outputs, 
-                                                         std::vector<float>(inputs));
-        for(size_t i = 0; i < outputs; i++) {
-            for(size_t j = 0; j < inputs; j++) {
-                layer_weight_matrix[i][j] = weights[offset + i * inputs + j];
-            }
-        }
-        layer.set_weights(layer_weight_matrix);
-        offset += weight_count;
-        
-        // Extract and set biases
-        std::vector<float> layer_biases(outputs);
-        for(size_t i = 0; i < outputs; i++) {
-            layer_biases[i] = weights[offset + i];
-        }
-        layer.set_biases(layer_biases);
-        offset += bias_count;
+    if (weights.size() != parameters.size()) {
+        throw std::invalid_argument("Expected " + std::to_string(parameters.size()) +
+                                    " weights, got " + std::to_string(weights.size()));
+    }
+    parameters = weights;
+    apply_mask();
+}
+
+void NeuralNetwork::set_mask(const std::vector<uint8_t>& new_mask) {
+    if (!new_mask.empty() && new_mask.size() != parameters.size()) {
+        throw std::invalid_argument("Expected a mask of " + std::to_string(parameters.size()) +
+                                    " values, got " + std::to_string(new_mask.size()));
+    }
+    mask = new_mask;
+    for (auto& layer : layers) {
+        layer.set_mask(mask.empty() ? nullptr : mask.data() + layer.parameter_offset());
+    }
+    apply_mask();
+}
+
+void NeuralNetwork::apply_mask() {
+    for (size_t i = 0; i < mask.size(); i++) {
+        if (!mask[i]) parameters[i] = 0.0f;
     }
-}
\ No newline at end of file
+}
+
+size_t NeuralNetwork::active_parameter_count() const {
+    size_t count = 0;
+    for (const auto& layer : layers) {
+        count += layer.active_weights() + layer.output_size();
+    }
+    return count;
+}
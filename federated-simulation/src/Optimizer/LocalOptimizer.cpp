@@ -0,0 +1,78 @@
+#include "Optimizer/LocalOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+LocalOptimizer::LocalOptimizer(const OptimizerConfig& config, size_t parameter_count)
+    : config(config), count(parameter_count), state(parameter_count * config.state_per_parameter(), 0.0f) {
+    if (config.proximal_mu < 0.0f) {
+        throw std::invalid_argument("FedProx mu must not be negative");
+    }
+}
+
+void LocalOptimizer::begin_round() {
+    if (config.keep_state) return;
+    std::fill(state.begin(), state.end(), 0.0f);
+    steps = 0;
+}
+
+void LocalOptimizer::step(float* parameters, const float* gradients, const float* global, float learning_rate) {
+    // Without a received model there is nothing to stay close to
+    const float mu = global != nullptr ? config.proximal_mu : 0.0f;
+
+    switch (config.type) {
+        case OptimizerType::SGD:
+            for (size_t i = 0; i < count; i++) {
+                float g = gradients[i];
+                if (mu > 0.0f) g += mu * (parameters[i] - global[i]);
+                parameters[i] -= learning_rate * g;
+            }
+            break;
+
+        case OptimizerType::MOMENTUM: {
+            float* velocity = state.data();
+            for (size_t i = 0; i < count; i++) {
+                float g = gradients[i];
+                if (mu > 0.0f) g += mu * (parameters[i] - global[i]);
+                velocity[i] = config.momentum * velocity[i] + g;
+                parameters[i] -= learning_rate * velocity[i];
+            }
+            break;
+        }
+
+        case OptimizerType::ADAM: {
+            float* first = state.data();
+            float* second = first + count;
+            steps++;
+            // Bias correction folded into the step size
+            const double correction1 = 1.0 - std::pow(static_cast<double>(config.beta1), static_cast<double>(steps));
+            const double correction2 = 1.0 - std::pow(static_cast<double>(config.beta2), static_cast<double>(steps));
+            const float step_size = static_cast<float>(learning_rate * std::sqrt(correction2) / correction1);
+            const float epsilon = static_cast<float>(config.epsilon * std::sqrt(correction2));
+            for (size_t i = 0; i < count; i++) {
+                float g = gradients[i];
+                if (mu > 0.0f) g += mu * (parameters[i] - global[i]);
+                first[i] = config.beta1 * first[i] + (1.0f - config.beta1) * g;
+                second[i] = config.beta2 * second[i] + (1.0f - config.beta2) * g * g;
+                parameters[i] -= step_size * first[i] / (std::sqrt(second[i]) + epsilon);
+            }
+            break;
+        }
+    }
+}
+
+OptimizerType LocalOptimizer::parse_type(const std::string& name) {
+    if (name == "sgd") return OptimizerType::SGD;
+    if (name == "momentum") return OptimizerType::MOMENTUM;
+    if (name == "adam") return OptimizerType::ADAM;
+    throw std::invalid_argument("Unknown optimizer: " + name);
+}
+
+std::string LocalOptimizer::type_name(OptimizerType type) {
+    switch (type) {
+        case OptimizerType::SGD: return "sgd";
+        case OptimizerType::MOMENTUM: return "momentum";
+        case OptimizerType::ADAM: return "adam";
+    }
+    return "unknown";
+}
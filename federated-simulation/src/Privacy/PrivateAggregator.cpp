@@ -0,0 +1,190 @@
+#include "Privacy/PrivateAggregator.h"
+#include "Random/CounterRng.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+double log_add(double a, double b) {
+    if (a == -std::numeric_limits<double>::infinity()) return b;
+    if (b == -std::numeric_limits<double>::infinity()) return a;
+    double high = std::max(a, b);
+    return high + std::log1p(std::exp(std::min(a, b) - high));
+}
+
+} // namespace
+
+RdpAccountant::RdpAccountant(double noise_multiplier, double sampling_rate) {
+    for (int order = 2; order <= 64; order++) orders.push_back(order);
+    for (int order : {80, 96, 128, 192, 256}) orders.push_back(order);
+
+    const double q = std::min(1.0, std::max(0.0, sampling_rate));
+    for (double alpha : orders) {
+        double rdp;
+        if (noise_multiplier <= 0.0) {
+            rdp = std::numeric_limits<double>::infinity();
+        } else if (q == 0.0) {
+            rdp = 0.0;
+        } else if (q == 1.0) {
+            rdp = alpha / (2.0 * noise_multiplier * noise_multiplier);
+        } else {
+            // log A_alpha = log sum_k C(alpha, k) (1-q)^(alpha-k) q^k exp((k^2 - k) / (2 sigma^2))
+            double log_a = -std::numeric_limits<double>::infinity();
+            int n = static_cast<int>(alpha);
+            for (int k = 0; k <= n; k++) {
+                double log_binomial = std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0);
+                double term = log_binomial + (n - k) * std::log1p(-q) + k * std::log(q) +
+                              (static_cast<double>(k) * k - k) / (2.0 * noise_multiplier * noise_multiplier);
+                log_a = log_add(log_a, term);
+            }
+            rdp = log_a / (alpha - 1.0);
+        }
+        rdp_per_round.push_back(rdp);
+    }
+}
+
+double RdpAccountant::epsilon(double delta) const {
+    if (steps == 0) return 0.0;
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < orders.size(); i++) {
+        double eps = steps * rdp_per_round[i] + std::log(1.0 / delta) / (orders[i] - 1.0);
+        best = std::min(best, eps);
+    }
+    return best;
+}
+
+PrivateAggregator::PrivateAggregator(const PrivacyConfig& config, uint32_t seed)
+    : config(config), seed(seed) {
+    if (config.noise_multiplier > 0.0f && config.clip_norm <= 0.0f) {
+        throw std::invalid_argument("DP noise needs a clipping norm");
+    }
+    if (config.secure_aggregation && config.clip_norm <= 0.0f && config.secagg_bound <= 0.0f) {
+        throw std::invalid_argument("Secure aggregation needs a positive coordinate bound");
+    }
+}
+
+void PrivateAggregator::begin_round(uint64_t round, const std::vector<size_t>& participants, size_t dimension) {
+    if (participants.empty()) {
+        throw std::invalid_argument("A private aggregation round needs participants");
+    }
+    this->round = round;
+    this->participants = participants;
+    this->dimension = dimension;
+    received.assign(participants.size(), false);
+    updates = 0;
+    clipped = 0;
+    clipped_update.resize(dimension);
+
+    const size_t n = participants.size();
+    if (config.secure_aggregation) {
+        size_t wanted = config.mask_neighbors > 0
+            ? config.mask_neighbors
+            : 2 * static_cast<size_t>(std::ceil(std::log2(std::max<size_t>(n, 2))));
+        // Neighbors are the clients within ring_half positions on either side
+        ring_half = std::max<size_t>(1, std::min((wanted + 1) / 2, n / 2));
+        mask_neighbors = n > 1 ? std::min(2 * ring_half, n - 1) : 0;
+
+        // The sum of n coordinates in [-bound, bound] must fit a signed 32-bit value
+        double bound = config.clip_norm > 0.0f ? config.clip_norm : config.secagg_bound;
+        scale = static_cast<float>(2147483647.0 / (n * bound));
+        masked_sum.assign(dimension, 0u);
+        masked.resize(dimension);
+        mask.resize(dimension);
+    } else {
+        mask_neighbors = 0;
+        plain_sum.assign(dimension, 0.0);
+    }
+}
+
+void PrivateAggregator::add_pair_mask(size_t client_a, size_t client_b, bool add) {
+    // Both clients of a pair derive the same stream; the smaller id adds it, the other subtracts
+    uint64_t low = std::min(client_a, client_b);
+    uint64_t high = std::max(client_a, client_b);
+    CounterRng stream(seed, RngPurpose::SECURE_AGGREGATION_MASK, round, (low << 32) | (high & 0xFFFFFFFFu));
+    stream.fill_u32(mask.data(), dimension);
+    if (add) {
+        for (size_t i = 0; i < dimension; i++) masked[i] += mask[i];
+    } else {
+        for (size_t i = 0; i < dimension; i++) masked[i] -= mask[i];
+    }
+}
+
+void PrivateAggregator::add_update(size_t position, const float* update) {
+    if (position >= participants.size() || received[position]) {
+        throw std::out_of_range("Unexpected update from participant " + std::to_string(position));
+    }
+    received[position] = true;
+    updates++;
+
+    // Clip to the L2 bound
+    float factor = 1.0f;
+    if (config.clip_norm > 0.0f) {
+        double squared = 0.0;
+        for (size_t i = 0; i < dimension; i++) squared += static_cast<double>(update[i]) * update[i];
+        double norm = std::sqrt(squared);
+        if (norm > config.clip_norm) {
+            factor = static_cast<float>(config.clip_norm / norm);
+            clipped++;
+        }
+    }
+    for (size_t i = 0; i < dimension; i++) clipped_update[i] = update[i] * factor;
+
+    if (!config.secure_aggregation) {
+        for (size_t i = 0; i < dimension; i++) plain_sum[i] += clipped_update[i];
+        return;
+    }
+
+    // What the client uploads: fixed point plus its pairwise masks, modulo 2^32
+    const float bound = config.clip_norm > 0.0f ? config.clip_norm : config.secagg_bound;
+    for (size_t i = 0; i < dimension; i++) {
+        float value = std::min(bound, std::max(-bound, clipped_update[i]));
+        masked[i] = static_cast<uint32_t>(static_cast<int32_t>(std::lround(value * scale)));
+    }
+    const size_t n = participants.size();
+    const size_t client = participants[position];
+    for (size_t offset = 1; offset <= ring_half && n > 1; offset++) {
+        size_t forward = (position + offset) % n;
+        size_t backward = (position + n - offset) % n;
+        add_pair_mask(client, participants[forward], client < participants[forward]);
+        if (backward != forward) {
+            add_pair_mask(client, participants[backward], client < participants[backward]);
+        }
+    }
+
+    for (size_t i = 0; i < dimension; i++) masked_sum[i] += masked[i];
+}
+
+std::vector<float> PrivateAggregator::finish_round() {
+    const size_t n = participants.size();
+    if (config.secure_aggregation && updates != n) {
+        // Without every masked update the pairwise masks do not cancel
+        throw std::runtime_error("Secure aggregation round missing " + std::to_string(n - updates) + " updates");
+    }
+
+    std::vector<float> sum(dimension);
+    if (config.secure_aggregation) {
+        for (size_t i = 0; i < dimension; i++) {
+            sum[i] = static_cast<float>(static_cast<int32_t>(masked_sum[i])) / scale;
+        }
+    } else {
+        for (size_t i = 0; i < dimension; i++) sum[i] = static_cast<float>(plain_sum[i]);
+    }
+
+    if (config.noise_multiplier > 0.0f) {
+        std::vector<float> noise(dimension);
+        CounterRng(seed, RngPurpose::DP_NOISE, round).fill_normal(noise.data(), dimension);
+        const float std_dev = config.noise_multiplier * config.clip_norm;
+        for (size_t i = 0; i < dimension; i++) sum[i] += std_dev * noise[i];
+    }
+
+    // Mean over the selected clients (fixed denominator, as in DP-FedAvg)
+    for (auto& value : sum) value /= static_cast<float>(n);
+    return sum;
+}
+
+float PrivateAggregator::clipped_fraction() const {
+    return updates > 0 ? static_cast<float>(clipped) / updates : 0.0f;
+}
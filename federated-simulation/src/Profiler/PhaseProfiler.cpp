@@ -0,0 +1,178 @@
+#include "Profiler/PhaseProfiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Nearest-rank percentile; reorders values
+double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+} // namespace
+
+void PhaseProfiler::set_trace_file(const std::string& path, int first_round, int last_round) {
+    trace_path = path;
+    trace_first = first_round;
+    trace_last = std::max(first_round, last_round);
+}
+
+void PhaseProfiler::start() {
+    active = !timing_path.empty() || !trace_path.empty();
+    if (!active) return;
+
+    if (!timing_path.empty()) {
+        timing_file.open(timing_path, std::ios::trunc);
+        if (!timing_file) {
+            throw std::runtime_error("Cannot open timing file: " + timing_path);
+        }
+        timing_file << "Round,Phase,Calls,TotalMs,P50Us,P99Us,MaxUs\n"
+                    << std::fixed << std::setprecision(3);
+    }
+    origin = Clock::now();
+}
+
+void PhaseProfiler::begin_round(int round) {
+    if (!active) return;
+    current_round = round;
+    in_round = true;
+    round_start = Clock::now();
+    for (auto& durations : round_durations) {
+        durations.clear();
+    }
+}
+
+void PhaseProfiler::record(Phase phase, Clock::time_point begin, Clock::time_point end) {
+    if (!in_round) return;
+    double micros = std::chrono::duration<double, std::micro>(end - begin).count();
+    round_durations[static_cast<size_t>(phase)].push_back(micros);
+
+    if (!trace_path.empty() && current_round >= trace_first && current_round <= trace_last) {
+        trace_events.push_back({phase, current_round, micros_since_start(begin),
+                                static_cast<int64_t>(micros)});
+    }
+}
+
+void PhaseProfiler::end_round() {
+    if (!active || !in_round) return;
+    in_round = false;
+
+    Clock::time_point round_end = Clock::now();
+    total_round_seconds += std::chrono::duration<double>(round_end - round_start).count();
+    if (!trace_path.empty() && current_round >= trace_first && current_round <= trace_last) {
+        round_spans.push_back({current_round, micros_since_start(round_start),
+                               micros_since_start(round_end) - micros_since_start(round_start)});
+    }
+
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        auto& durations = round_durations[p];
+        double total_us = 0.0;
+        for (double d : durations) total_us += d;
+
+        totals[p].seconds += total_us * 1e-6;
+        totals[p].calls += durations.size();
+        totals[p].round_ms.push_back(total_us * 1e-3);
+
+        if (timing_file.is_open() && !durations.empty()) {
+            double max_us = *std::max_element(durations.begin(), durations.end());
+            timing_file << current_round << ","
+                        << phase_name(static_cast<Phase>(p)) << ","
+                        << durations.size() << ","
+                        << (total_us * 1e-3) << ","
+                        << percentile(durations, 0.50) << ","
+                        << percentile(durations, 0.99) << ","
+                        << max_us << "\n";
+        }
+    }
+}
+
+void PhaseProfiler::finish(std::ostream& out) {
+    if (!active) return;
+    in_round = false;
+    timing_file.close();
+
+    if (!trace_path.empty()) {
+        std::ofstream trace(trace_path, std::ios::trunc);
+        if (!trace) {
+            throw std::runtime_error("Cannot open trace file: " + trace_path);
+        }
+        // Rounds on one row, their phases nested below on the same thread
+        trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& event : round_spans) {
+            trace << (first ? "" : ",\n")
+                  << "{\"name\":\"round " << event.round << "\",\"cat\":\"round\",\"ph\":\"X\","
+                  << "\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+                  << ",\"pid\":1,\"tid\":1}";
+            first = false;
+        }
+        for (const auto& event : trace_events) {
+            trace << (first ? "" : ",\n")
+                  << "{\"name\":\"" << phase_name(event.phase) << "\",\"cat\":\"phase\",\"ph\":\"X\","
+                  << "\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+                  << ",\"pid\":1,\"tid\":1,\"args\":{\"round\":" << event.round << "}}";
+            first = false;
+        }
+        trace << "\n]}\n";
+    }
+
+    size_t rounds = totals[0].round_ms.size();
+    if (rounds == 0) return;
+
+    // Formatted apart from out, so its flags and precision are left alone
+    std::ostringstream report;
+    report << "\nTime per phase over " << rounds << " rounds ("
+           << std::fixed << std::setprecision(3) << total_round_seconds << "s):\n"
+           << "  " << std::left << std::setw(20) << "Phase" << std::right
+           << std::setw(10) << "Total ms" << std::setw(9) << "Share"
+           << std::setw(14) << "p50 ms/round" << std::setw(14) << "p99 ms/round" << "\n";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        auto& per_round = totals[p].round_ms;
+        report << "  " << std::left << std::setw(20) << phase_name(static_cast<Phase>(p)) << std::right
+               << std::setw(10) << (totals[p].seconds * 1e3)
+               << std::setw(8) << std::setprecision(1)
+               << (total_round_seconds > 0.0 ? 100.0 * totals[p].seconds / total_round_seconds : 0.0) << "%"
+               << std::setw(14) << std::setprecision(3) << percentile(per_round, 0.50)
+               << std::setw(14) << percentile(per_round, 0.99) << "\n";
+    }
+    out << report.str();
+    if (!timing_path.empty()) {
+        out << "Per-round timing saved to " << timing_path << "\n";
+    }
+    if (!trace_path.empty()) {
+        out << "Trace of rounds " << trace_first << "-" << trace_last << " saved to " << trace_path << "\n";
+    }
+}
+
+int64_t PhaseProfiler::micros_since_start(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+}
+
+const char* PhaseProfiler::phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::CLIENT_SELECTION: return "client_selection";
+        case Phase::SAMPLE_FETCH: return "sample_fetch";
+        case Phase::LOCAL_TRAINING: return "local_training";
+        case Phase::WEIGHT_COLLECTION: return "weight_collection";
+        case Phase::AGGREGATION: return "aggregation";
+        case Phase::BROADCAST: return "broadcast";
+        case Phase::EVALUATION: return "evaluation";
+        case Phase::METRICS_IO: return "metrics_io";
+    }
+    return "unknown";
+}
+
+std::string PhaseProfiler::timing_path_for(const std::string& metrics_path) {
+    size_t slash = metrics_path.find_last_of("/\\");
+    size_t dot = metrics_path.find_last_of('.');
+    std::string stem = (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        ? metrics_path.substr(0, dot)
+        : metrics_path;
+    return stem + "_timing.csv";
+}
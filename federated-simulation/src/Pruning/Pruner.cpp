@@ -0,0 +1,189 @@
+#include "Pruning/Pruner.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+Pruner::Pruner(const PruningConfig& config, const std::vector<size_t>& topology)
+    : config(config), topology(topology) {
+    if (config.mode != PruningMode::NONE && (config.sparsity < 0.0f || config.sparsity >= 1.0f)) {
+        throw std::invalid_argument("Pruning sparsity must be at least 0 and below 1");
+    }
+    if (config.mode != PruningMode::NONE && (config.start_round < 1 || config.ramp_rounds < 1)) {
+        throw std::invalid_argument("Pruning needs a start round and ramp of at least 1");
+    }
+    if (config.mode == PruningMode::STRUCTURED && topology.size() < 3) {
+        throw std::invalid_argument("Structured pruning needs a hidden layer");
+    }
+
+    size_t parameters = 0;
+    for (size_t l = 0; l + 1 < topology.size(); l++) {
+        offsets.push_back(parameters);
+        parameters += topology[l + 1] * (topology[l] + 1);
+    }
+    parameter_mask.assign(parameters, 1);
+}
+
+float Pruner::target_sparsity(int round) const {
+    if (!config.enabled() || round < config.start_round) {
+        return 0.0f;
+    }
+    float progress = std::min(1.0f, static_cast<float>(round - config.start_round + 1) / config.ramp_rounds);
+    return config.sparsity * (1.0f - std::pow(1.0f - progress, 3.0f));
+}
+
+bool Pruner::update(int round, const std::vector<float>& weights) {
+    if (!config.enabled() || round < config.start_round || round >= config.start_round + config.ramp_rounds) {
+        return false;
+    }
+    if (weights.size() != parameter_mask.size()) {
+        throw std::invalid_argument("Expected " + std::to_string(parameter_mask.size()) +
+                                    " weights to prune, got " + std::to_string(weights.size()));
+    }
+    float sparsity = target_sparsity(round);
+    return config.mode == PruningMode::STRUCTURED ? prune_neurons(weights, sparsity)
+                                                  : prune_weights(weights, sparsity);
+}
+
+bool Pruner::prune_weights(const std::vector<float>& weights, float sparsity) {
+    bool changed = false;
+    std::vector<std::pair<float, size_t>> kept;
+    for (size_t l = 0; l + 1 < topology.size(); l++) {
+        const size_t count = topology[l] * topology[l + 1];
+        const size_t target = static_cast<size_t>(sparsity * count);
+        kept.clear();
+        for (size_t i = offsets[l]; i < offsets[l] + count; i++) {
+            if (parameter_mask[i]) kept.emplace_back(std::fabs(weights[i]), i);
+        }
+        const size_t pruned = count - kept.size();
+        if (target <= pruned) {
+            continue;
+        }
+
+        // The smallest magnitudes go; ties are broken by position so the mask is deterministic
+        const size_t remove = target - pruned;
+        std::nth_element(kept.begin(), kept.begin() + (remove - 1), kept.end());
+        for (size_t k = 0; k < remove; k++) {
+            parameter_mask[kept[k].second] = 0;
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+bool Pruner::neuron_removed(size_t layer, size_t neuron) const {
+    const size_t inputs = topology[layer];
+    const uint8_t* row = parameter_mask.data() + offsets[layer] + neuron * inputs;
+    return std::none_of(row, row + inputs, [](uint8_t kept) { return kept != 0; });
+}
+
+void Pruner::remove_neuron(size_t layer, size_t neuron) {
+    const size_t inputs = topology[layer];
+    std::fill_n(parameter_mask.begin() + offsets[layer] + neuron * inputs, inputs, 0);
+
+    // Its output feeds column neuron of the next layer
+    const size_t next_inputs = topology[layer + 1];
+    for (size_t o = 0; o < topology[layer + 2]; o++) {
+        parameter_mask[offsets[layer + 1] + o * next_inputs + neuron] = 0;
+    }
+}
+
+bool Pruner::prune_neurons(const std::vector<float>& weights, float sparsity) {
+    bool changed = false;
+    std::vector<std::pair<float, size_t>> kept;
+    // Hidden layers are the outputs of every layer but the last
+    for (size_t l = 0; l + 2 < topology.size(); l++) {
+        const size_t neurons = topology[l + 1];
+        const size_t inputs = topology[l];
+        // At least one neuron stays
+        const size_t target = std::min(neurons - 1, static_cast<size_t>(sparsity * neurons));
+        kept.clear();
+        for (size_t n = 0; n < neurons; n++) {
+            if (neuron_removed(l, n)) continue;
+            const float* row = weights.data() + offsets[l] + n * inputs;
+            float norm = 0.0f;
+            for (size_t i = 0; i < inputs; i++) norm += row[i] * row[i];
+            kept.emplace_back(norm, n);
+        }
+        const size_t removed = neurons - kept.size();
+        if (target <= removed) {
+            continue;
+        }
+
+        const size_t remove = target - removed;
+        std::nth_element(kept.begin(), kept.begin() + (remove - 1), kept.end());
+        for (size_t k = 0; k < remove; k++) {
+            remove_neuron(l, kept[k].second);
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+void Pruner::set_mask(const std::vector<uint8_t>& mask) {
+    if (mask.size() != parameter_mask.size()) {
+        throw std::invalid_argument("Expected a mask of " + std::to_string(parameter_mask.size()) +
+                                    " values, got " + std::to_string(mask.size()));
+    }
+    parameter_mask = mask;
+}
+
+void Pruner::apply(std::vector<float>& weights) const {
+    for (size_t i = 0; i < parameter_mask.size(); i++) {
+        if (!parameter_mask[i]) weights[i] = 0.0f;
+    }
+}
+
+std::vector<uint8_t> Pruner::weight_bitmap() const {
+    std::vector<uint8_t> bitmap((weight_count() + 7) / 8, 0);
+    size_t bit = 0;
+    for (size_t l = 0; l + 1 < topology.size(); l++) {
+        for (size_t i = 0; i < topology[l] * topology[l + 1]; i++, bit++) {
+            if (parameter_mask[offsets[l] + i]) bitmap[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+    }
+    return bitmap;
+}
+
+size_t Pruner::weight_count() const {
+    size_t count = 0;
+    for (size_t l = 0; l + 1 < topology.size(); l++) {
+        count += topology[l] * topology[l + 1];
+    }
+    return count;
+}
+
+size_t Pruner::kept_weights() const {
+    size_t count = 0;
+    for (size_t l = 0; l + 1 < topology.size(); l++) {
+        const auto first = parameter_mask.begin() + offsets[l];
+        count += std::count(first, first + topology[l] * topology[l + 1], 1);
+    }
+    return count;
+}
+
+size_t Pruner::removed_neurons() const {
+    size_t count = 0;
+    for (size_t l = 0; l + 2 < topology.size(); l++) {
+        for (size_t n = 0; n < topology[l + 1]; n++) {
+            count += neuron_removed(l, n);
+        }
+    }
+    return count;
+}
+
+PruningMode Pruner::parse_mode(const std::string& name) {
+    if (name == "none") return PruningMode::NONE;
+    if (name == "unstructured" || name == "weights") return PruningMode::UNSTRUCTURED;
+    if (name == "structured" || name == "neurons") return PruningMode::STRUCTURED;
+    throw std::invalid_argument("Unknown pruning mode: " + name);
+}
+
+std::string Pruner::mode_name(PruningMode mode) {
+    switch (mode) {
+        case PruningMode::NONE: return "none";
+        case PruningMode::UNSTRUCTURED: return "unstructured";
+        case PruningMode::STRUCTURED: return "structured";
+    }
+    return "unknown";
+}
@@ -0,0 +1,34 @@
+#include "Random/CounterRng.h"
+
+double CounterRng::gamma(double shape) {
+    if (shape <= 0.0) return 0.0;
+    if (shape < 1.0) {
+        // Gamma(a) = Gamma(a + 1) * U^(1/a)
+        double boost = std::pow(1.0 - uniform_double(), 1.0 / shape);
+        return gamma(shape + 1.0) * boost;
+    }
+
+    const double d = shape - 1.0 / 3.0;
+    const double c = 1.0 / std::sqrt(9.0 * d);
+    while (true) {
+        double x = normal();
+        double v = 1.0 + c * x;
+        if (v <= 0.0) continue;
+        v = v * v * v;
+        double u = 1.0 - uniform_double();
+        if (u < 1.0 - 0.0331 * x * x * x * x) return d * v;
+        if (std::log(u) < 0.5 * x * x + d * (1.0 - v + std::log(v))) return d * v;
+    }
+}
+
+void CounterRng::fill_u32(uint32_t* out, size_t count) {
+    philox.fill_u32(out, count, next_block * 4);
+    next_block += (count + 3) / 4;
+    used = 4;
+}
+
+void CounterRng::fill_normal(float* out, size_t count) {
+    philox.fill_normal(out, count, next_block);
+    next_block += (count + 3) / 4;
+    used = 4;
+}
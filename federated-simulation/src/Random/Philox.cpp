@@ -0,0 +1,96 @@
+#include "Random/Philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t BATCH_BLOCKS = 64;
+constexpr float LN2 = 0.69314718f;
+constexpr float HALF_PI = 1.5707963f;
+
+// Natural log for x in (0, 1]: exponent from the bits, mantissa by atanh series.
+// Absolute error below 1e-6.
+inline float fast_log(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+    float mantissa;
+    std::memcpy(&mantissa, &bits, sizeof(mantissa));
+    float t = (mantissa - 1.0f) / (mantissa + 1.0f);
+    float t2 = t * t;
+    float series = t * (2.0f + t2 * (2.0f / 3.0f + t2 * (2.0f / 5.0f + t2 * (2.0f / 7.0f + t2 * (2.0f / 9.0f)))));
+    return exponent * LN2 + series;
+}
+
+// sin and cos of 2*pi*u for u in [0, 1): quadrant from 4u, Taylor polynomials on [0, pi/2]
+inline void fast_sincos_turn(float u, float& s, float& c) {
+    float v = 4.0f * u;
+    int quadrant = static_cast<int>(v);
+    float x = (v - static_cast<float>(quadrant)) * HALF_PI;
+    float x2 = x * x;
+    float sin_x = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+    float cos_x = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600))))));
+    // Rotate by the quadrant: (s, c) -> (c, -s) per quarter turn
+    bool odd = quadrant & 1;
+    bool negate_sin = quadrant & 2;
+    bool negate_cos = (quadrant == 1) || (quadrant == 2);
+    float sin_value = odd ? cos_x : sin_x;
+    float cos_value = odd ? sin_x : cos_x;
+    s = negate_sin ? -sin_value : sin_value;
+    c = negate_cos ? -cos_value : cos_value;
+}
+
+} // namespace
+
+void Philox::fill_u32(uint32_t* out, size_t count, uint64_t first_word) const {
+    uint64_t index = first_word / 4;
+    size_t skip = static_cast<size_t>(first_word % 4);
+    size_t written = 0;
+    while (written < count) {
+        Block words = block(index++);
+        for (size_t w = skip; w < 4 && written < count; w++) {
+            out[written++] = words[w];
+        }
+        skip = 0;
+    }
+}
+
+void Philox::fill_normal(float* out, size_t count, uint64_t first_block) const {
+    uint32_t words[BATCH_BLOCKS * 4];
+    float radius[BATCH_BLOCKS * 2];
+    float turn[BATCH_BLOCKS * 2];
+    float normals[BATCH_BLOCKS * 4];
+
+    size_t written = 0;
+    uint64_t index = first_block;
+    while (written < count) {
+        size_t blocks = std::min(BATCH_BLOCKS, (count - written + 3) / 4);
+        for (size_t b = 0; b < blocks; b++) {
+            Block block_words = block(index + b);
+            for (size_t w = 0; w < 4; w++) words[4 * b + w] = block_words[w];
+        }
+        index += blocks;
+
+        // Each pair of words gives two normals: u1 in (0, 1] for the radius, u2 for the angle
+        const size_t pairs = blocks * 2;
+        for (size_t p = 0; p < pairs; p++) {
+            float u1 = static_cast<float>((words[2 * p] >> 8) + 1) * (1.0f / 16777216.0f);
+            float u2 = static_cast<float>(words[2 * p + 1] >> 8) * (1.0f / 16777216.0f);
+            radius[p] = std::sqrt(-2.0f * fast_log(u1));
+            turn[p] = u2;
+        }
+
+        for (size_t p = 0; p < pairs; p++) {
+            float s, c;
+            fast_sincos_turn(turn[p], s, c);
+            normals[2 * p] = radius[p] * c;
+            normals[2 * p + 1] = radius[p] * s;
+        }
+
+        size_t take = std::min(count - written, pairs * 2);
+        std::memcpy(out + written, normals, take * sizeof(float));
+        written += take;
+    }
+}
@@ -0,0 +1,218 @@
+#include "SyntheticData/SyntheticDataGenerator.h"
+#include "Random/CounterRng.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr double TWO_PI = 6.283185307179586;
+
+} // namespace
+
+std::vector<ClassSpectrum> SyntheticDataConfig::default_spectra() {
+    ClassSpectrum no_theft;
+    no_theft.name = "No theft";
+    no_theft.components = {{0.3f, 0.5f, {0.01f, 0.01f, 0.01f}}};   // Wind and traffic on a parked bike
+    no_theft.noise_std = 0.012f;
+    no_theft.tilt_std_rad = 0.005f;
+
+    ClassSpectrum carrying;
+    carrying.name = "Carrying away";
+    carrying.components = {
+        {1.8f, 0.15f, {1.0f, 0.8f, 2.9f}},   // Gait
+        {3.6f, 0.15f, {0.6f, 0.5f, 1.4f}},   // Its first harmonic
+        {0.9f, 0.2f, {0.8f, 0.9f, 0.3f}}     // Sway of the bike against the body
+    };
+    carrying.noise_std = 0.3f;
+    carrying.tilt_std_rad = 0.15f;
+
+    ClassSpectrum breaking;
+    breaking.name = "Lock breaking";
+    breaking.components = {
+        {2.5f, 0.3f, {2.0f, 2.5f, 2.0f}},    // Sawing or prying
+        {22.0f, 0.2f, {1.0f, 2.0f, 3.0f}}    // Tool vibration
+    };
+    breaking.noise_std = 0.6f;
+    breaking.impact_rate_hz = 2.0f;          // Hammer or bolt cutter blows
+    breaking.impact_amplitude = 50.0f;
+    breaking.impact_decay_s = 0.05f;
+    breaking.impact_frequency_hz = 15.0f;
+    breaking.tilt_std_rad = 0.05f;
+
+    return {no_theft, carrying, breaking};
+}
+
+SyntheticDataGenerator::SyntheticDataGenerator(const SyntheticDataConfig& config, size_t num_clients)
+    : config(config), num_clients(std::max<size_t>(num_clients, 1)) {
+    size_t classes = config.classes.size();
+    if (classes == 0) {
+        throw std::invalid_argument("Synthetic data needs at least one class");
+    }
+    if (config.class_priors.size() != classes) {
+        throw std::invalid_argument("Synthetic data needs one prior per class");
+    }
+    if (config.window == 0 || config.sample_rate_hz <= 0.0f) {
+        throw std::invalid_argument("Synthetic window and sample rate must be positive");
+    }
+
+    double prior_sum = 0.0;
+    for (float prior : config.class_priors) {
+        if (prior < 0.0f) throw std::invalid_argument("Class priors must not be negative");
+        prior_sum += prior;
+    }
+    if (prior_sum <= 0.0) {
+        throw std::invalid_argument("Class priors must not all be zero");
+    }
+
+    client_mix.resize(this->num_clients);
+    devices.resize(this->num_clients);
+    for (size_t client = 0; client < this->num_clients; client++) {
+        CounterRng rng(config.seed, RngPurpose::SYNTHETIC_CLIENT, 0, client);
+        std::vector<double> mix(classes);
+        double total = 0.0;
+        for (size_t c = 0; c < classes; c++) {
+            double prior = config.class_priors[c] / prior_sum;
+            if (config.dirichlet_alpha > 0.0f && prior > 0.0) {
+                mix[c] = rng.gamma(config.dirichlet_alpha * classes * prior);
+            } else {
+                mix[c] = prior;
+            }
+            total += mix[c];
+        }
+        // A very small alpha can underflow every draw; such a client keeps the priors
+        if (total <= 0.0) {
+            for (size_t c = 0; c < classes; c++) mix[c] = config.class_priors[c] / prior_sum;
+            total = 1.0;
+        }
+
+        double cumulative = 0.0;
+        client_mix[client].resize(classes);
+        for (size_t c = 0; c < classes; c++) {
+            cumulative += mix[c] / total;
+            client_mix[client][c] = static_cast<float>(cumulative);
+        }
+        client_mix[client].back() = 1.0f;
+
+        for (size_t axis = 0; axis < 3; axis++) {
+            devices[client].gain[axis] = 1.0f + config.device_variation * rng.normal();
+            devices[client].offset[axis] = config.device_variation * rng.normal();
+        }
+    }
+}
+
+int SyntheticDataGenerator::label_of(size_t index) const {
+    // The class is the first draw of the window's generator
+    CounterRng rng(config.seed, RngPurpose::SYNTHETIC_WINDOW, 0, index);
+    const auto& mix = client_mix[client_of(index)];
+    float u = rng.uniform();
+    return static_cast<int>(std::upper_bound(mix.begin(), mix.end() - 1, u) - mix.begin());
+}
+
+MotionSample SyntheticDataGenerator::generate(size_t index) const {
+    MotionSample sample;
+    generate(index, sample);
+    return sample;
+}
+
+void SyntheticDataGenerator::generate(size_t index, MotionSample& sample) const {
+    if (index >= config.samples) {
+        throw std::out_of_range("Synthetic sample " + std::to_string(index) + " outside " +
+                                std::to_string(config.samples) + " samples");
+    }
+
+    CounterRng rng(config.seed, RngPurpose::SYNTHETIC_WINDOW, 0, index);
+    const size_t client = client_of(index);
+    const auto& mix = client_mix[client];
+    const int label = static_cast<int>(std::upper_bound(mix.begin(), mix.end() - 1, rng.uniform()) - mix.begin());
+    const ClassSpectrum& spectrum = config.classes[label];
+    const Device& device = devices[client];
+    const double dt = 1.0 / config.sample_rate_hz;
+
+    sample.sample_id = static_cast<int>(index);
+    sample.timestamp = "synthetic";
+    sample.label = label;
+    sample.filename.clear();
+    sample.acc_x.resize(config.window);
+    sample.acc_y.resize(config.window);
+    sample.acc_z.resize(config.window);
+
+    // Gravity tilted by small rotations about x and then y
+    float tilt_x = spectrum.tilt_std_rad * rng.normal();
+    float tilt_y = spectrum.tilt_std_rad * rng.normal();
+    const auto& g = config.gravity;
+    float gy = g[1] * std::cos(tilt_x) - g[2] * std::sin(tilt_x);
+    float gz = g[1] * std::sin(tilt_x) + g[2] * std::cos(tilt_x);
+    float gx = g[0] * std::cos(tilt_y) + gz * std::sin(tilt_y);
+    gz = -g[0] * std::sin(tilt_y) + gz * std::cos(tilt_y);
+    const float gravity[3] = {gx, gy, gz};
+
+    // One rotating phasor per component instead of a sine per sample
+    struct Oscillator {
+        double re, im, step_re, step_im;
+        const std::array<float, 3>* amplitude;
+    };
+    std::vector<Oscillator> oscillators;
+    oscillators.reserve(spectrum.components.size());
+    for (const auto& component : spectrum.components) {
+        double frequency = component.frequency_hz * (1.0 + component.frequency_jitter * rng.normal());
+        double phase = TWO_PI * rng.uniform();
+        double step = TWO_PI * std::max(frequency, 0.0) * dt;
+        oscillators.push_back({std::cos(phase), std::sin(phase), std::cos(step), std::sin(step),
+                               &component.amplitude});
+    }
+
+    // Impacts excite a damped resonator; the kick is scaled so the first peak is about
+    // the impact amplitude
+    const bool impacts = spectrum.impact_rate_hz > 0.0f && spectrum.impact_amplitude > 0.0f;
+    const double decay = impacts ? std::exp(-dt / std::max(spectrum.impact_decay_s, 1e-4f)) : 0.0;
+    const double omega = TWO_PI * spectrum.impact_frequency_hz * dt;
+    const double a1 = 2.0 * decay * std::cos(omega);
+    const double a2 = -decay * decay;
+    const double kick_scale = std::max(std::sin(omega), 0.05);
+    double ring1 = 0.0, ring2 = 0.0;
+    const float impact_rate = static_cast<float>(spectrum.impact_rate_hz * dt);   // Per sample
+    double next_impact = impacts ? rng.exponential(impact_rate) : 0.0;
+    static const float IMPACT_DIRECTION[3] = {0.15f, 0.25f, 1.0f};
+
+    // Sensor noise comes from its own stream, generated in bulk
+    std::vector<float> noise(3 * config.window);
+    CounterRng(config.seed, RngPurpose::SYNTHETIC_NOISE, 0, index).fill_normal(noise.data(), noise.size());
+
+    for (size_t i = 0; i < config.window; i++) {
+        float motion[3] = {0.0f, 0.0f, 0.0f};
+        for (auto& osc : oscillators) {
+            float wave = static_cast<float>(osc.im);
+            for (size_t axis = 0; axis < 3; axis++) {
+                motion[axis] += (*osc.amplitude)[axis] * wave;
+            }
+            double re = osc.re * osc.step_re - osc.im * osc.step_im;
+            osc.im = osc.re * osc.step_im + osc.im * osc.step_re;
+            osc.re = re;
+        }
+
+        if (impacts) {
+            double kick = 0.0;
+            while (next_impact <= static_cast<double>(i)) {
+                float sign = rng.uniform() < 0.5f ? -1.0f : 1.0f;
+                kick += sign * spectrum.impact_amplitude * (0.5f + rng.uniform()) * kick_scale;
+                next_impact += rng.exponential(impact_rate);
+            }
+            double ring = a1 * ring1 + a2 * ring2 + kick;
+            ring2 = ring1;
+            ring1 = ring;
+            for (size_t axis = 0; axis < 3; axis++) {
+                motion[axis] += IMPACT_DIRECTION[axis] * static_cast<float>(ring);
+            }
+        }
+
+        float values[3];
+        for (size_t axis = 0; axis < 3; axis++) {
+            float raw = gravity[axis] + motion[axis] + spectrum.noise_std * noise[3 * i + axis];
+            values[axis] = device.gain[axis] * raw + device.offset[axis];
+        }
+        sample.acc_x[i] = values[0];
+        sample.acc_y[i] = values[1];
+        sample.acc_z[i] = values[2];
+    }
+}
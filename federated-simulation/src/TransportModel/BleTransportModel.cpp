@@ -0,0 +1,256 @@
+#include "TransportModel/BleTransportModel.h"
+#include "Random/CounterRng.h"
+#include "TransferProtocol.h"
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    // Transfers averaged when frames can be lost
+    constexpr uint64_t LOSS_TRIALS = 16;
+    // Bound on a simulated transfer, far beyond the sender's retry limit
+    constexpr size_t MAX_EVENTS = 1000000;
+
+    struct LinkFrame {
+        std::vector<uint8_t> bytes;
+        size_t packets_left;
+    };
+
+    // One connection event in one direction: frames whose last packet is sent are delivered
+    std::vector<std::vector<uint8_t>> transmit(std::deque<LinkFrame>& queue, size_t packets) {
+        std::vector<std::vector<uint8_t>> delivered;
+        while (packets > 0 && !queue.empty()) {
+            LinkFrame& frame = queue.front();
+            size_t sent = std::min(packets, frame.packets_left);
+            frame.packets_left -= sent;
+            packets -= sent;
+            if (frame.packets_left == 0) {
+                delivered.push_back(std::move(frame.bytes));
+                queue.pop_front();
+            }
+        }
+        return delivered;
+    }
+}
+
+TransferCost& TransferCost::operator+=(const TransferCost& other) {
+    seconds += other.seconds;
+    payload_bytes += other.payload_bytes;
+    air_bytes += other.air_bytes;
+    chunks += other.chunks;
+    return *this;
+}
+
+BleTransportModel::BleTransportModel(const BleTransportConfig& config) : config(config) {
+    size_t max_chunk = std::max(config.chunk_bytes_send, config.chunk_bytes_receive);
+    if (config.protocol == BleProtocol::LEGACY && config.att_mtu < max_chunk + ATT_HEADER_BYTES) {
+        throw std::runtime_error("ATT MTU too small for the configured chunk size");
+    }
+    if (config.protocol == BleProtocol::PIPELINED) {
+        if (config.att_mtu < TransferProtocol::MIN_FRAME_BYTES + ATT_HEADER_BYTES ||
+            config.frame_bytes < TransferProtocol::MIN_FRAME_BYTES || config.frame_bytes > 0xFFFF) {
+            throw std::runtime_error("Pipelined frames need an ATT MTU of at least 23 and 20 to 65535 byte frames");
+        }
+        if (config.window_frames == 0 || config.window_frames > TransferProtocol::MAX_WINDOW) {
+            throw std::runtime_error("Transfer window must be between 1 and 32 frames");
+        }
+        if (config.frame_loss < 0.0f || config.frame_loss >= 1.0f || config.retransmit_timeout_ms < 1.0f) {
+            throw std::runtime_error("Frame loss must be in [0, 1) and the retransmit timeout at least 1 ms");
+        }
+    }
+    if (config.connection_interval_ms < 7.5f || config.connection_interval_ms > 4000.0f) {
+        throw std::runtime_error("Connection interval must be between 7.5 and 4000 ms");
+    }
+    if (config.ll_payload_bytes == 0 || config.packets_per_event == 0 || config.parallel_links == 0) {
+        throw std::runtime_error("Invalid BLE link configuration");
+    }
+}
+
+size_t BleTransportModel::air_bytes(size_t chunk_bytes) const {
+    return chunk_bytes + ATT_HEADER_BYTES + L2CAP_HEADER_BYTES;
+}
+
+double BleTransportModel::link_time_ms(size_t chunk_bytes) const {
+    // L2CAP fragments the ATT PDU into link-layer packets, which share connection events
+    size_t packets = (air_bytes(chunk_bytes) + config.ll_payload_bytes - 1) / config.ll_payload_bytes;
+    return static_cast<double>(packets) * config.connection_interval_ms / config.packets_per_event;
+}
+
+double BleTransportModel::command_time_ms() const {
+    // Control characteristic write with response: request and response in separate events
+    return 2.0 * config.connection_interval_ms;
+}
+
+size_t BleTransportModel::pipelined_frame_bytes() const {
+    return std::min(config.frame_bytes, config.att_mtu - ATT_HEADER_BYTES);
+}
+
+BleProtocol BleTransportModel::parse_protocol(const std::string& name) {
+    if (name == "legacy") return BleProtocol::LEGACY;
+    if (name == "pipelined") return BleProtocol::PIPELINED;
+    throw std::runtime_error("Unknown transfer protocol: " + name);
+}
+
+std::string BleTransportModel::protocol_name(BleProtocol protocol) {
+    switch (protocol) {
+        case BleProtocol::LEGACY: return "legacy";
+        case BleProtocol::PIPELINED: return "pipelined";
+    }
+    return "unknown";
+}
+
+TransferCost BleTransportModel::simulate_pipelined(size_t payload_bytes, bool upload, uint64_t trial) const {
+    TransferCost cost;
+    cost.payload_bytes = payload_bytes;
+    // The command write, and for uploads the central's READY in the following event
+    double start_ms = command_time_ms() + (upload ? config.connection_interval_ms : 0.0);
+    if (payload_bytes == 0) {
+        cost.seconds = start_ms / 1000.0;
+        return cost;
+    }
+
+    // Timing does not depend on the payload's content
+    std::vector<uint8_t> payload(payload_bytes, 0);
+    std::vector<uint8_t> received(payload_bytes);
+    const uint16_t frame_bytes = static_cast<uint16_t>(pipelined_frame_bytes());
+    const uint8_t window = static_cast<uint8_t>(config.window_frames);
+    const uint32_t timeout_ms = static_cast<uint32_t>(config.retransmit_timeout_ms);
+    TransferSender sender;
+    TransferReceiver receiver(received.data(), received.size(), frame_bytes);
+    uint8_t transfer_id = 1;
+    if (!sender.begin(payload.data(), static_cast<uint32_t>(payload_bytes), transfer_id, frame_bytes,
+                      window, timeout_ms)) {
+        throw std::runtime_error("Payload too large for a pipelined transfer");
+    }
+
+    CounterRng loss(config.loss_seed, RngPurpose::LINK_LOSS, trial, upload ? 1 : 0);
+    auto lost = [&]() { return config.frame_loss > 0.0f && loss.uniform() < config.frame_loss; };
+    auto queue_frame = [&](std::deque<LinkFrame>& queue, const uint8_t* bytes, size_t length) {
+        size_t packets = (air_bytes(length) + config.ll_payload_bytes - 1) / config.ll_payload_bytes;
+        queue.push_back({std::vector<uint8_t>(bytes, bytes + length), packets});
+        cost.air_bytes += air_bytes(length);
+        cost.chunks++;
+    };
+
+    std::deque<LinkFrame> forward;   // Sender -> receiver
+    std::deque<LinkFrame> backward;  // ACKs
+    std::vector<uint8_t> frame(frame_bytes);
+    uint8_t ack[TransferProtocol::ACK_BYTES];
+    size_t event = 0;
+    while (true) {
+        const uint32_t now_ms = static_cast<uint32_t>(event * config.connection_interval_ms);
+
+        // Between events the sender fills its window
+        size_t length;
+        while ((length = sender.nextFrame(frame.data(), frame.size(), now_ms)) > 0) {
+            queue_frame(forward, frame.data(), length);
+            sender.frameSent(now_ms);
+        }
+        if (sender.state() == TransferSender::State::COMPLETE) {
+            break;
+        }
+        if (sender.state() == TransferSender::State::FAILED) {
+            // The server repeats the command; the receiver resumes from its first missing frame
+            start_ms += command_time_ms();
+            forward.clear();
+            backward.clear();
+            sender.begin(payload.data(), static_cast<uint32_t>(payload_bytes), ++transfer_id, frame_bytes,
+                         window, timeout_ms);
+            continue;
+        }
+        if (++event > MAX_EVENTS) {
+            throw std::runtime_error("Simulated pipelined transfer did not finish");
+        }
+
+        // ACKs produced during this event go out in the next one
+        std::vector<std::vector<uint8_t>> acks = transmit(backward, config.packets_per_event);
+        for (const std::vector<uint8_t>& bytes : transmit(forward, config.packets_per_event)) {
+            if (!lost() && receiver.onFrame(bytes.data(), bytes.size())) {
+                size_t ack_length = receiver.ack(ack, sizeof(ack));
+                queue_frame(backward, ack, ack_length);
+            }
+        }
+        for (const std::vector<uint8_t>& bytes : acks) {
+            if (!lost()) {
+                sender.onFrame(bytes.data(), bytes.size(), now_ms);
+            }
+        }
+    }
+
+    cost.seconds = (start_ms + event * static_cast<double>(config.connection_interval_ms)) / 1000.0;
+    return cost;
+}
+
+TransferCost BleTransportModel::pipelined_cost(size_t payload_bytes, bool upload) const {
+    const uint64_t trials = config.frame_loss > 0.0f ? LOSS_TRIALS : 1;
+    TransferCost total;
+    for (uint64_t trial = 0; trial < trials; trial++) {
+        total += simulate_pipelined(payload_bytes, upload, trial);
+    }
+
+    TransferCost cost;
+    cost.seconds = total.seconds / trials;
+    cost.payload_bytes = payload_bytes;
+    cost.air_bytes = total.air_bytes / trials;
+    cost.chunks = total.chunks / trials;
+    return cost;
+}
+
+TransferCost BleTransportModel::upload_cost(size_t payload_bytes) const {
+    if (config.protocol == BleProtocol::PIPELINED) {
+        return pipelined_cost(payload_bytes, true);
+    }
+
+    TransferCost cost;
+    cost.payload_bytes = payload_bytes;
+
+    double elapsed_ms = command_time_ms();
+    for (size_t sent = 0; sent < payload_bytes; sent += config.chunk_bytes_send) {
+        size_t chunk = std::min(config.chunk_bytes_send, payload_bytes - sent);
+        elapsed_ms += std::max(static_cast<double>(config.send_chunk_delay_ms), link_time_ms(chunk));
+        cost.air_bytes += air_bytes(chunk);
+        cost.chunks++;
+    }
+
+    cost.seconds = elapsed_ms / 1000.0;
+    return cost;
+}
+
+TransferCost BleTransportModel::download_cost(size_t payload_bytes) const {
+    if (config.protocol == BleProtocol::PIPELINED) {
+        return pipelined_cost(payload_bytes, false);
+    }
+
+    TransferCost cost;
+    cost.payload_bytes = payload_bytes;
+
+    double elapsed_ms = command_time_ms() + config.transfer_setup_ms;
+    for (size_t sent = 0; sent < payload_bytes; sent += config.chunk_bytes_receive) {
+        size_t chunk = std::min(config.chunk_bytes_receive, payload_bytes - sent);
+        // A write with response needs a full round trip, and the device drains only one
+        // chunk per loop() iteration
+        double write_ms = std::max(link_time_ms(chunk), command_time_ms());
+        elapsed_ms += std::max(write_ms, static_cast<double>(config.loop_delay_ms));
+        cost.air_bytes += air_bytes(chunk);
+        cost.chunks++;
+    }
+
+    cost.seconds = elapsed_ms / 1000.0;
+    return cost;
+}
+
+TransferCost BleTransportModel::round_cost(size_t download_bytes, size_t upload_bytes,
+                                           size_t participants) const {
+    TransferCost per_client = download_cost(download_bytes);
+    per_client += upload_cost(upload_bytes);
+
+    TransferCost cost;
+    cost.payload_bytes = per_client.payload_bytes * participants;
+    cost.air_bytes = per_client.air_bytes * participants;
+    cost.chunks = per_client.chunks * participants;
+
+    size_t sequential_sessions = (participants + config.parallel_links - 1) / config.parallel_links;
+    cost.seconds = per_client.seconds * sequential_sessions;
+    return cost;
+}
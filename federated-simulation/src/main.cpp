@@ -4,6 +4,7 @@
 #include <sstream>
 #include "FederatedSimulation/FederatedSimulation.h"
 #include "HPO/HyperParameterOptimizer.h"
+#include "Experiment/ExperimentRunner.h"
 #include <algorithm>
 
 // Helper function to parse command line arguments
@@ -33,6 +34,18 @@ std::vector<size_t> parseTopology(const std::string& topologyStr) {
     return topology;
 }
 
+std::vector<Activation> parseActivations(const std::string& activationsStr) {
+    std::vector<Activation> activations;
+    std::stringstream ss(activationsStr);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        activations.push_back(NeuralNetwork::parse_activation(item));
+    }
+
+    return activations;
+}
+
 void printUsage() {
     std::cout << "Usage: SmartBikeLockSimulation [options]\n";
     std::cout << "Options:\n";
@@ -45,22 +58,73 @@ void printUsage() {
     std::cout << "  --fraction <f>        Set client fraction (default: 0.3)\n";
     std::cout << "  --topology <layers>   Set neural network topology (default: 11,15,3)\n";
     std::cout << "                        Format: comma-separated layer sizes, e.g., 11,20,3\n";
+    std::cout << "  --activations <list>  Set layer activations: sigmoid, relu, tanh, linear, softmax (output only)\n";
+    std::cout << "                        One per layer, or hidden,output, e.g., relu,softmax (default: sigmoid)\n";
     std::cout << "  --data-path <path>    Set path to data directory (default: ../data)\n";
+    std::cout << "  --synthetic <N>       Train on N generated windows instead of the data directory\n";
+    std::cout << "  --synthetic-alpha <a> Dirichlet concentration of per-client class mixes (default: 0 = IID)\n";
+    std::cout << "  --partition <scheme>  Split training data among clients: shared, iid, dirichlet, quantity, shards (default: shared)\n";
+    std::cout << "  --partition-alpha <a> Dirichlet concentration for dirichlet and quantity partitions (default: 0.5)\n";
+    std::cout << "  --shard-column <name> Metadata column identifying the device for shards (default: timestamp)\n";
+    std::cout << "  --shard-prefix <N>    Leading characters of the shard column used as key, 0 = all (default: 10)\n";
     std::cout << "  --metrics <file>      Set metrics output file (default: federated_metrics.csv)\n";
+    std::cout << "  --metrics-format <f>  Metrics file format: csv, ndjson, bin (default: from the file extension)\n";
     std::cout << "  --seed <N>            Set random seed (default: 42)\n";
+    std::cout << "  --async               Use buffered asynchronous aggregation (FedBuff)\n";
+    std::cout << "  --buffer-size <K>     Updates buffered before each async aggregation (default: 10)\n";
+    std::cout << "  --concurrency <N>     Clients training concurrently in async mode (default: clients * fraction)\n";
+    std::cout << "  --server-lr <rate>    Server learning rate for async aggregation (default: 1.0)\n";
+    std::cout << "  --latency <dist>      Client latency distribution: constant, uniform, exponential, lognormal\n";
+    std::cout << "                        (default: lognormal)\n";
+    std::cout << "  --latency-mean <s>    Mean client report-back time in seconds (default: 30)\n";
+    std::cout << "  --stragglers <f>      Fraction of persistently slow clients (default: 0.1)\n";
+    std::cout << "  --conn-interval <ms>  BLE connection interval used for transfer cost (default: 30)\n";
+    std::cout << "  --mtu <bytes>         Negotiated ATT MTU used for transfer cost (default: 247)\n";
+    std::cout << "  --parallel-links <N>  Devices the server exchanges weights with concurrently (default: 1)\n";
+    std::cout << "  --transfer <p>        BLE weight transfer: legacy, pipelined (default: legacy)\n";
+    std::cout << "  --transfer-window <N> Frames in flight of pipelined transfers (default: 8)\n";
+    std::cout << "  --frame-loss <p>      Share of pipelined frames lost and retransmitted (default: 0)\n";
+    std::cout << "  --devices             Simulate heterogeneous devices (compute time, battery, availability)\n";
+    std::cout << "  --device-timings <f>  Calibrate devices from a saved TimingBenchmark serial log (implies --devices)\n";
+    std::cout << "  --deadline <s>        Select only devices expected to finish a round within this time (default: none)\n";
+    std::cout << "  --battery <J>         Mean energy budget per device, 0 = unlimited (default: 100)\n";
+    std::cout << "  --online-fraction <f> Share of the day a device is reachable (default: 0.75)\n";
+    std::cout << "  --backend <b>         Client arithmetic: float, fixed (the device's int8/Q15 engine),\n";
+    std::cout << "                        sparse (the device's sparse-row engine) (default: float)\n";
+    std::cout << "  --weight-format <f>   Encoding of exchanged weights: fp32, fp16, int8 (default: fp32)\n";
+    std::cout << "  --stochastic-rounding Use stochastic rounding when quantizing exchanged weights\n";
+    std::cout << "  --export-model <file> Save the final global model in the device model format\n";
+    std::cout << "  --init-model <file>   Start every client from a saved model file\n";
+    std::cout << "  --topk <fraction>     Upload only this fraction of weight changes as sparse deltas (default: dense)\n";
+    std::cout << "  --optimizer <o>       Local optimizer: sgd, momentum, adam (default: sgd)\n";
+    std::cout << "  --momentum <b>        Momentum coefficient of the momentum optimizer (default: 0.9)\n";
+    std::cout << "  --prox-mu <mu>        FedProx proximal term pulling local weights to the global model (default: 0)\n";
+    std::cout << "  --keep-opt-state      Keep momentum/Adam state across rounds instead of resetting it\n";
+    std::cout << "  --local-epochs <E>    Passes over local data per round; passes after the first replay a buffer (default: 1)\n";
+    std::cout << "  --replay-capacity <N> Recent windows kept per client for local epochs (default: samples per round)\n";
+    std::cout << "  --memory-budget <B>   Fail if a client needs more training memory than B bytes (default: report only)\n";
+    std::cout << "  --dp-clip <C>         Clip each client update to L2 norm C before aggregation\n";
+    std::cout << "  --dp-noise <z>        Add Gaussian noise with std z * C to the aggregate and report epsilon\n";
+    std::cout << "  --dp-delta <d>        Delta of the reported (epsilon, delta) guarantee (default: 1e-5)\n";
+    std::cout << "  --secure-agg          Aggregate pairwise-masked fixed-point updates\n";
+    std::cout << "  --mask-neighbors <k>  Masking partners per client in secure aggregation (default: 2 * ceil(log2 n))\n";
+    std::cout << "  --prune <mode>        Server-side magnitude pruning: none, unstructured, structured (default: none)\n";
+    std::cout << "  --sparsity <s>        Final share of each layer's weights (structured: hidden neurons) pruned (default: 0.5)\n";
+    std::cout << "  --prune-start <R>     First round after which the server prunes (default: 50)\n";
+    std::cout << "  --prune-rounds <N>    Rounds over which the sparsity ramps up to its final value (default: 50)\n";
+    std::cout << "  --profile             Time each round phase; p50/p99 per round go to <metrics>_timing.csv\n";
+    std::cout << "  --trace <file>        Write a Chrome trace (chrome://tracing, Perfetto) of the traced rounds\n";
+    std::cout << "  --trace-rounds <a-b>  Rounds included in the trace (default: 1-3)\n";
+    std::cout << "  --rank-by-time        Rank HPO configurations by simulated time to success\n";
+    std::cout << "  --experiment <spec>   Run the configurations x seeds of a JSON experiment spec in parallel\n";
+    std::cout << "  --jobs <N>            Experiment runs at once (default: from the spec, else hardware threads)\n";
+    std::cout << "  --results <file>      Experiment results file; runs already in it are skipped\n";
+    std::cout << "                        (default: from the spec, else experiment_results.json)\n";
     std::cout << "  --help                Display this help message\n";
 }
 
-int main(int argc, char* argv[]) {
-    std::vector<std::string> args(argv + 1, argv + argc);
-    
-    // Check for help option first
-    if (cmdOptionExists(args, "--help") || cmdOptionExists(args, "-h")) {
-        printUsage();
-        return 0;
-    }
-    
-    // Default values
+// Settings of the command line shared by the simulation and the hyperparameter search
+struct Options {
     std::string dataPath = "../data";
     uint32_t seed = 42;
     int rounds = 200;
@@ -70,53 +134,224 @@ int main(int argc, char* argv[]) {
     float clientFraction = 0.3f;
     std::vector<size_t> topology = {11, 15, 3};
     std::string metricsFile = "federated_metrics.csv";
-    
-    // Parse command line arguments
+    MetricsFormat metricsFormat = MetricsFormat::CSV;
+    size_t bufferSize = 10;
+    size_t concurrency = 0;
+    float serverLearningRate = 1.0f;
+    float uploadDensity = 0.0f;
+    LatencyConfig latencyConfig;
+    BleTransportConfig transportConfig;
+    PartitionConfig partitionConfig;
+    WeightCodec::Format weightFormat = WeightCodec::Format::FLOAT32;
+    ModelBackend modelBackend = ModelBackend::FLOAT32;
+    std::vector<Activation> activations;
+    OptimizerConfig optimizerConfig;
+    size_t localEpochs = 1;
+    size_t replayCapacity = 0;
+};
+
+Options parseOptions(const std::vector<std::string>& args) {
+    Options options;
     std::string value;
-    if (getCmdOption(args, "--data-path", value)) dataPath = value;
-    if (getCmdOption(args, "--seed", value)) seed = std::stoul(value);
-    if (getCmdOption(args, "--rounds", value)) rounds = std::stoi(value);
-    if (getCmdOption(args, "--clients", value)) numClients = std::stoul(value);
-    if (getCmdOption(args, "--samples", value)) samplesPerRound = std::stoul(value);
-    if (getCmdOption(args, "--lr", value)) learningRate = std::stof(value);
-    if (getCmdOption(args, "--fraction", value)) clientFraction = std::stof(value);
-    if (getCmdOption(args, "--metrics", value)) metricsFile = value;
-    
+    if (getCmdOption(args, "--data-path", value)) options.dataPath = value;
+    if (getCmdOption(args, "--seed", value)) options.seed = std::stoul(value);
+    if (getCmdOption(args, "--rounds", value)) options.rounds = std::stoi(value);
+    if (getCmdOption(args, "--clients", value)) options.numClients = std::stoul(value);
+    if (getCmdOption(args, "--samples", value)) options.samplesPerRound = std::stoul(value);
+    if (getCmdOption(args, "--lr", value)) options.learningRate = std::stof(value);
+    if (getCmdOption(args, "--fraction", value)) options.clientFraction = std::stof(value);
+    if (getCmdOption(args, "--metrics", value)) options.metricsFile = value;
+    if (getCmdOption(args, "--buffer-size", value)) options.bufferSize = std::stoul(value);
+    if (getCmdOption(args, "--concurrency", value)) options.concurrency = std::stoul(value);
+    if (getCmdOption(args, "--server-lr", value)) options.serverLearningRate = std::stof(value);
+    if (getCmdOption(args, "--latency-mean", value)) options.latencyConfig.mean_seconds = std::stof(value);
+    if (getCmdOption(args, "--stragglers", value)) options.latencyConfig.straggler_fraction = std::stof(value);
+    if (getCmdOption(args, "--conn-interval", value)) options.transportConfig.connection_interval_ms = std::stof(value);
+    if (getCmdOption(args, "--mtu", value)) options.transportConfig.att_mtu = std::stoul(value);
+    if (getCmdOption(args, "--parallel-links", value)) options.transportConfig.parallel_links = std::stoul(value);
+    if (getCmdOption(args, "--topk", value)) options.uploadDensity = std::stof(value);
+
     if (getCmdOption(args, "--topology", value)) {
-        topology = parseTopology(value);
-        if (topology.size() < 2) {
-            std::cerr << "Error: Topology must have at least input and output layers.\n";
-            return 1;
+        options.topology = parseTopology(value);
+        if (options.topology.size() < 2) {
+            throw std::runtime_error("Topology must have at least input and output layers");
         }
     }
+
+    if (getCmdOption(args, "--weight-format", value) &&
+        !WeightCodec::parseFormat(value.c_str(), options.weightFormat)) {
+        throw std::runtime_error("Unknown weight format: " + value);
+    }
+    if (getCmdOption(args, "--backend", value)) options.modelBackend = FederatedClient::parse_backend(value);
+    if (getCmdOption(args, "--activations", value)) options.activations = parseActivations(value);
+    if (getCmdOption(args, "--optimizer", value)) options.optimizerConfig.type = LocalOptimizer::parse_type(value);
+    if (getCmdOption(args, "--momentum", value)) options.optimizerConfig.momentum = std::stof(value);
+    if (getCmdOption(args, "--prox-mu", value)) options.optimizerConfig.proximal_mu = std::stof(value);
+    options.optimizerConfig.keep_state = cmdOptionExists(args, "--keep-opt-state");
+    if (getCmdOption(args, "--local-epochs", value)) options.localEpochs = std::stoul(value);
+    if (getCmdOption(args, "--replay-capacity", value)) options.replayCapacity = std::stoul(value);
+    if (options.localEpochs == 0) {
+        throw std::runtime_error("Local epochs must be at least 1");
+    }
+    if (options.uploadDensity < 0.0f || options.uploadDensity > 1.0f) {
+        throw std::runtime_error("Top-k fraction must be between 0 and 1");
+    }
+
+    options.metricsFormat = MetricsSink::format_for_path(options.metricsFile);
+    if (getCmdOption(args, "--metrics-format", value)) {
+        options.metricsFormat = MetricsSink::parse_format(value);
+    }
+
+    if (getCmdOption(args, "--latency", value)) {
+        options.latencyConfig.distribution = LatencyModel::parse_distribution(value);
+    }
+
+    if (getCmdOption(args, "--transfer", value)) {
+        options.transportConfig.protocol = BleTransportModel::parse_protocol(value);
+    }
+    if (getCmdOption(args, "--transfer-window", value)) options.transportConfig.window_frames = std::stoul(value);
+    if (getCmdOption(args, "--frame-loss", value)) options.transportConfig.frame_loss = std::stof(value);
+    options.transportConfig.loss_seed = options.seed;
+
+    if (getCmdOption(args, "--partition", value)) {
+        options.partitionConfig.scheme = ClientPartition::parse_scheme(value);
+    }
+    if (getCmdOption(args, "--partition-alpha", value)) options.partitionConfig.alpha = std::stof(value);
+    if (getCmdOption(args, "--shard-column", value)) options.partitionConfig.shard_column = value;
+    if (getCmdOption(args, "--shard-prefix", value)) options.partitionConfig.shard_prefix = std::stoul(value);
+
+    return options;
+}
+
+// Simulation configured by the command line; experiments build one per run
+std::unique_ptr<FederatedSimulation> buildSimulation(const std::vector<std::string>& args) {
+    Options options = parseOptions(args);
+    std::string value;
+
+    auto simulation = std::make_unique<FederatedSimulation>(options.dataPath, options.seed);
+    simulation->set_fl_rounds(options.rounds);
+    simulation->set_num_clients(options.numClients);
+    simulation->set_samples_per_round(options.samplesPerRound);
+    simulation->set_learning_rate(options.learningRate);
+    simulation->set_client_fraction(options.clientFraction);
+    simulation->set_topology(options.topology);
+    simulation->set_activations(options.activations);
+    simulation->set_optimizer_config(options.optimizerConfig);
+    simulation->set_local_epochs(options.localEpochs);
+    simulation->set_replay_capacity(options.replayCapacity);
+    if (getCmdOption(args, "--memory-budget", value)) simulation->set_memory_budget(std::stoul(value));
+    simulation->set_metrics_file(options.metricsFile);
+    simulation->set_metrics_format(options.metricsFormat);
+    simulation->set_async_mode(cmdOptionExists(args, "--async"));
+    simulation->set_async_buffer_size(options.bufferSize);
+    simulation->set_async_concurrency(options.concurrency);
+    simulation->set_server_learning_rate(options.serverLearningRate);
+    simulation->set_latency_config(options.latencyConfig);
+    simulation->set_transport_config(options.transportConfig);
+    simulation->set_weight_format(options.weightFormat);
+    simulation->set_stochastic_rounding(cmdOptionExists(args, "--stochastic-rounding"));
+    simulation->set_upload_density(options.uploadDensity);
+    simulation->set_model_backend(options.modelBackend);
+    simulation->set_partition(options.partitionConfig);
+    if (cmdOptionExists(args, "--devices") || getCmdOption(args, "--device-timings", value)) {
+        DeviceConfig deviceConfig;
+        if (getCmdOption(args, "--device-timings", value)) {
+            deviceConfig.reference = DeviceTimings::from_benchmark_log(value);
+        }
+        if (getCmdOption(args, "--battery", value)) deviceConfig.battery_joules = std::stof(value);
+        if (getCmdOption(args, "--online-fraction", value)) deviceConfig.online_fraction = std::stof(value);
+        simulation->set_device_config(deviceConfig);
+    }
+    if (getCmdOption(args, "--deadline", value)) simulation->set_round_deadline(std::stod(value));
+    PrivacyConfig privacyConfig;
+    if (getCmdOption(args, "--dp-clip", value)) privacyConfig.clip_norm = std::stof(value);
+    if (getCmdOption(args, "--dp-noise", value)) privacyConfig.noise_multiplier = std::stof(value);
+    if (getCmdOption(args, "--dp-delta", value)) privacyConfig.delta = std::stod(value);
+    if (getCmdOption(args, "--mask-neighbors", value)) privacyConfig.mask_neighbors = std::stoul(value);
+    privacyConfig.secure_aggregation = cmdOptionExists(args, "--secure-agg");
+    simulation->set_privacy_config(privacyConfig);
+    PruningConfig pruningConfig;
+    if (getCmdOption(args, "--prune", value)) pruningConfig.mode = Pruner::parse_mode(value);
+    if (getCmdOption(args, "--sparsity", value)) pruningConfig.sparsity = std::stof(value);
+    if (getCmdOption(args, "--prune-start", value)) pruningConfig.start_round = std::stoi(value);
+    if (getCmdOption(args, "--prune-rounds", value)) pruningConfig.ramp_rounds = std::stoi(value);
+    simulation->set_pruning_config(pruningConfig);
+    if (getCmdOption(args, "--export-model", value)) simulation->set_export_model_path(value);
+    if (getCmdOption(args, "--init-model", value)) simulation->set_initial_model_path(value);
+    if (getCmdOption(args, "--synthetic", value)) {
+        SyntheticDataConfig syntheticConfig;
+        syntheticConfig.samples = std::stoul(value);
+        syntheticConfig.seed = options.seed;
+        if (getCmdOption(args, "--synthetic-alpha", value)) {
+            syntheticConfig.dirichlet_alpha = std::stof(value);
+        }
+        simulation->set_synthetic_data(syntheticConfig);
+    }
+    simulation->set_profiling(cmdOptionExists(args, "--profile"));
+    if (getCmdOption(args, "--trace", value)) {
+        std::string tracePath = value;
+        int firstRound = 1;
+        int lastRound = 3;
+        if (getCmdOption(args, "--trace-rounds", value)) {
+            size_t dash = value.find('-');
+            firstRound = std::stoi(value.substr(0, dash));
+            lastRound = dash == std::string::npos ? firstRound : std::stoi(value.substr(dash + 1));
+        }
+        simulation->set_trace(tracePath, firstRound, lastRound);
+    }
+    return simulation;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    
+    // Check for help option first
+    if (cmdOptionExists(args, "--help") || cmdOptionExists(args, "-h")) {
+        printUsage();
+        return 0;
+    }
     
     // Check which mode to run
     bool runHPO = cmdOptionExists(args, "--hpo");
     bool quickSearch = cmdOptionExists(args, "--quick-search");
     
     try {
-        if (runHPO) {
+        std::string value;
+        if (getCmdOption(args, "--experiment", value)) {
+            std::cout << "Running Experiment " << value << "\n";
+
+            ExperimentRunner runner(ExperimentSpec::load(value), buildSimulation);
+            if (getCmdOption(args, "--jobs", value)) runner.set_jobs(std::stoul(value));
+            if (getCmdOption(args, "--results", value)) runner.set_results_path(value);
+
+            size_t failures = runner.run();
+            if (failures > 0) {
+                std::cerr << "Error: " << failures << " run(s) failed\n";
+                return 1;
+            }
+        } else if (runHPO) {
+            Options options = parseOptions(args);
             std::cout << "Running Hyperparameter Optimization\n";
             
-            HyperParameterOptimizer optimizer(dataPath, seed);
-            optimizer.set_max_rounds(rounds);
-            optimizer.set_num_clients(numClients);
+            HyperParameterOptimizer optimizer(options.dataPath, options.seed);
+            optimizer.set_max_rounds(options.rounds);
+            optimizer.set_num_clients(options.numClients);
             optimizer.set_quick_search(quickSearch);
+            optimizer.set_transport_config(options.transportConfig);
+            optimizer.set_partition(options.partitionConfig);
+            optimizer.set_rank_by_time(cmdOptionExists(args, "--rank-by-time"));
+            optimizer.set_model_backend(options.modelBackend);
+            optimizer.set_activations(options.activations);
+            optimizer.set_optimizer_config(options.optimizerConfig);
+            optimizer.set_local_epochs(options.localEpochs);
+            optimizer.set_replay_capacity(options.replayCapacity);
             
             optimizer.run_optimization();
         } else {
+            auto simulation = buildSimulation(args);
             std::cout << "Running Standard Federated Learning Simulation\n";
             
-            FederatedSimulation simulation(dataPath, seed);
-            simulation.set_fl_rounds(rounds);
-            simulation.set_num_clients(numClients);
-            simulation.set_samples_per_round(samplesPerRound);
-            simulation.set_learning_rate(learningRate);
-            simulation.set_client_fraction(clientFraction);
-            simulation.set_topology(topology);
-            simulation.set_metrics_file(metricsFile);
-            
-            simulation.run_simulation();
+            simulation->run_simulation();
         }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
@@ -124,4 +359,4 @@ int main(int argc, char* argv[]) {
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,211 @@
+// Checks of Metrics and StreamingAuc against reference implementations and the original 3-class code
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Metrics/Metrics.h"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAIL: %s\n", what);
+            failures++;
+        }
+    }
+
+    bool near(float a, float b, float tolerance) {
+        return std::fabs(a - b) <= tolerance;
+    }
+
+    // Share of (positive, negative) pairs ranked correctly, ties counting half
+    float pairwise_auc(const std::vector<float>& predictions, const std::vector<int>& labels,
+                       size_t num_classes, size_t c) {
+        double won = 0.0;
+        size_t pairs = 0;
+        for (size_t p = 0; p < labels.size(); p++) {
+            if (labels[p] != static_cast<int>(c)) continue;
+            for (size_t n = 0; n < labels.size(); n++) {
+                if (labels[n] == static_cast<int>(c)) continue;
+                float positive = predictions[p * num_classes + c];
+                float negative = predictions[n * num_classes + c];
+                won += positive > negative ? 1.0 : positive == negative ? 0.5 : 0.0;
+                pairs++;
+            }
+        }
+        return pairs > 0 ? static_cast<float>(won / pairs) : 0.0f;
+    }
+
+    // Scores on a coarse grid, so most of them tie, including negative ones
+    void tie_heavy_data(size_t rows, size_t num_classes, std::vector<float>& predictions,
+                        std::vector<int>& labels) {
+        std::mt19937 rng(7);
+        predictions.resize(rows * num_classes);
+        labels.resize(rows);
+        for (size_t i = 0; i < rows; i++) {
+            labels[i] = static_cast<int>(rng() % num_classes);
+            for (size_t c = 0; c < num_classes; c++) {
+                float level = static_cast<float>(rng() % 6) - 1.0f;
+                if (static_cast<int>(c) == labels[i]) level += 1.0f;   // Informative but overlapping
+                predictions[i * num_classes + c] = level * 0.25f;
+            }
+        }
+    }
+
+    void testTieHeavyAuc() {
+        const size_t rows = 500, num_classes = 4;
+        std::vector<float> predictions;
+        std::vector<int> labels;
+        tie_heavy_data(rows, num_classes, predictions, labels);
+
+        Metrics::AucScratch scratch;
+        std::vector<float> auc;
+        float macro = 0.0f;
+        Metrics::roc_auc(predictions.data(), labels.data(), rows, num_classes, scratch, auc, &macro);
+        check(auc.size() == num_classes, "one AUC per class");
+
+        StreamingAuc streaming(num_classes);
+        for (size_t i = 0; i < rows; i++) {
+            streaming.add(&predictions[i * num_classes], labels[i]);
+        }
+        auto approximate = streaming.per_class();
+
+        float expected_macro = 0.0f;
+        for (size_t c = 0; c < num_classes; c++) {
+            float expected = pairwise_auc(predictions, labels, num_classes, c);
+            expected_macro += expected / num_classes;
+            check(near(auc[c], expected, 1e-5f), "radix AUC matches pairwise AUC on ties");
+            check(near(approximate[c], expected, 1e-3f), "streaming AUC matches pairwise AUC on ties");
+        }
+        check(near(macro, expected_macro, 1e-5f), "macro AUC is the mean of the classes");
+        check(near(streaming.macro(), expected_macro, 1e-3f), "streaming macro AUC");
+    }
+
+    void testEmptyAuc() {
+        Metrics::AucScratch scratch;
+        std::vector<float> auc;
+        float macro = 1.0f;
+        Metrics::roc_auc(nullptr, nullptr, 0, 3, scratch, auc, &macro);
+        check(auc == std::vector<float>(3, 0.0f), "no samples gives zero AUCs");
+        check(macro == 0.0f, "no samples gives zero macro AUC");
+
+        std::vector<std::vector<float>> none;
+        macro = 1.0f;
+        auto nested = Metrics::roc_auc(none, none, &macro);
+        check(macro == 0.0f, "nested adapter accepts an empty set");
+        for (float value : nested) check(value == 0.0f, "nested adapter gives zero AUCs");
+
+        Evaluation evaluation;
+        Metrics::evaluate(nullptr, nullptr, 0, 3, evaluation, scratch);
+        check(evaluation.auc == std::vector<float>(3, 0.0f) && evaluation.macro_auc == 0.0f,
+              "evaluating an empty set gives zero AUCs");
+
+        StreamingAuc streaming(3);
+        check(streaming.per_class() == std::vector<float>(3, 0.0f) && streaming.macro() == 0.0f,
+              "streaming AUC without samples is zero");
+    }
+
+    void testSingleClassAuc() {
+        // Every sample is class 1: no class has both positives and negatives
+        const size_t rows = 20, num_classes = 3;
+        std::vector<float> predictions(rows * num_classes);
+        std::vector<int> labels(rows, 1);
+        for (size_t i = 0; i < predictions.size(); i++) predictions[i] = static_cast<float>(i % 7) / 7.0f;
+
+        Metrics::AucScratch scratch;
+        std::vector<float> auc;
+        float macro = 1.0f;
+        Metrics::roc_auc(predictions.data(), labels.data(), rows, num_classes, scratch, auc, &macro);
+        check(auc == std::vector<float>(3, 0.0f), "single-class set gives zero AUCs");
+        check(macro == 0.0f, "single-class set gives zero macro AUC");
+
+        StreamingAuc streaming(num_classes);
+        for (size_t i = 0; i < rows; i++) streaming.add(&predictions[i * num_classes], labels[i]);
+        check(streaming.macro() == 0.0f, "streaming AUC of a single-class set is zero");
+
+        // One sample: a single key, so every radix byte is constant
+        Metrics::roc_auc(predictions.data(), labels.data(), 1, num_classes, scratch, auc, &macro);
+        check(auc == std::vector<float>(3, 0.0f) && macro == 0.0f, "one sample gives zero AUCs");
+    }
+
+    // 3-class fixture without tied scores. The expected values below were produced by the
+    // fixed 3-class Metrics this implementation replaced (trapezoidal AUC, std::array matrix).
+    void three_class_fixture(std::vector<std::vector<float>>& predictions,
+                             std::vector<std::vector<float>>& targets) {
+        std::mt19937 rng(2024);
+        const size_t rows = 60;
+        predictions.assign(rows, std::vector<float>(3));
+        targets.assign(rows, std::vector<float>(3, 0.0f));
+        for (size_t i = 0; i < rows; i++) {
+            int label = static_cast<int>(i % 5 == 0 ? 2 : rng() % 2);   // Class 2 is the minority
+            float raw[3], sum = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                raw[c] = static_cast<float>(rng() % 10000 + 1) + (c == label ? 6000.0f : 0.0f);
+                sum += raw[c];
+            }
+            for (int c = 0; c < 3; c++) predictions[i][c] = raw[c] / sum;
+            targets[i][label] = 1.0f;
+        }
+    }
+
+    const int BASELINE_CONFUSION[9] = {20, 1, 0, 1, 24, 2, 0, 1, 11};
+    const float BASELINE_F1[3] = {0.952380955f, 0.905660391f, 0.879999995f};
+    const float BASELINE_AUC[3] = {0.992673993f, 0.966329992f, 0.996527731f};
+    const float BASELINE_ACCURACY = 0.916666687f;
+    const float BASELINE_LOG_LOSS = 0.622644424f;
+
+    void testThreeClassBaseline() {
+        std::vector<std::vector<float>> predictions, targets;
+        three_class_fixture(predictions, targets);
+
+        std::vector<float> flat;
+        std::vector<int> labels;
+        for (size_t i = 0; i < predictions.size(); i++) {
+            flat.insert(flat.end(), predictions[i].begin(), predictions[i].end());
+            labels.push_back(Metrics::argmax(targets[i].data(), targets[i].size()));
+        }
+
+        Evaluation evaluation;
+        Metrics::AucScratch scratch;
+        Metrics::evaluate(flat.data(), labels.data(), labels.size(), 3, evaluation, scratch);
+        check(evaluation.confusion.counts == std::vector<int>(BASELINE_CONFUSION, BASELINE_CONFUSION + 9),
+              "confusion matrix matches the 3-class baseline");
+        check(near(evaluation.accuracy, BASELINE_ACCURACY, 1e-6f), "accuracy matches the 3-class baseline");
+        check(near(evaluation.log_loss, BASELINE_LOG_LOSS, 1e-6f), "log loss matches the 3-class baseline");
+        float macro_auc = 0.0f;
+        for (size_t c = 0; c < 3; c++) {
+            check(near(evaluation.f1[c], BASELINE_F1[c], 1e-6f), "F1 matches the 3-class baseline");
+            check(near(evaluation.auc[c], BASELINE_AUC[c], 1e-5f), "AUC matches the 3-class baseline");
+            macro_auc += BASELINE_AUC[c] / 3.0f;
+        }
+        check(near(evaluation.macro_auc, macro_auc, 1e-5f), "macro AUC matches the 3-class baseline");
+
+        // The nested-vector adapters the simulation reports with
+        ConfusionMatrix matrix = Metrics::confusion_matrix(predictions, targets);
+        check(matrix.counts == evaluation.confusion.counts, "confusion adapter matches evaluate");
+        auto f1 = Metrics::f1_scores(matrix);
+        auto auc = Metrics::roc_auc(predictions, targets);
+        for (size_t c = 0; c < 3; c++) {
+            check(near(f1[c], BASELINE_F1[c], 1e-6f), "F1 adapter matches the 3-class baseline");
+            check(near(auc[c], BASELINE_AUC[c], 1e-5f), "AUC adapter matches the 3-class baseline");
+        }
+        check(near(Metrics::accuracy(predictions, targets), BASELINE_ACCURACY, 1e-6f),
+              "accuracy adapter matches the 3-class baseline");
+        check(near(Metrics::cross_entropy_loss(predictions, targets), BASELINE_LOG_LOSS, 1e-6f),
+              "log loss adapter matches the 3-class baseline");
+    }
+}
+
+int main() {
+    testTieHeavyAuc();
+    testEmptyAuc();
+    testSingleClassAuc();
+    testThreeClassBaseline();
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All metrics checks passed\n");
+    return 0;
+}
@@ -1,9 +1,10 @@
-import pandas as pd
+import sys
 import matplotlib.pyplot as plt
 import numpy as np
+from metrics_reader import read_metrics
 
-# Read the CSV file
-df = pd.read_csv('federated_metrics.csv')
+# Read the metrics file (CSV, NDJSON or binary)
+df = read_metrics(sys.argv[1] if len(sys.argv) > 1 else 'federated_metrics.csv')
 
 # Create figure and axis objects with a certain size
 fig, ax1 = plt.subplots(figsize=(12, 6))
@@ -0,0 +1,92 @@
+"""
+Readers for the metrics files written by federated-simulation/src/MetricsSink.
+
+Every format is returned as a pandas DataFrame with the CSV column names:
+Round, [Config,] Accuracy (%), TestLoss, TrainingLoss, SimTime, Bytes.
+"""
+
+import struct
+import numpy as np
+import pandas as pd
+
+BINARY_MAGIC = b'SBMT'
+BINARY_VERSION = 1
+
+# Column order inside a binary row chunk
+BINARY_COLUMNS = [
+    ('SimTime', '<f8'),
+    ('Bytes', '<u8'),
+    ('Round', '<i4'),
+    ('ConfigId', '<i4'),
+    ('Accuracy', '<f4'),
+    ('TestLoss', '<f4'),
+    ('TrainingLoss', '<f4'),
+]
+
+COLUMN_ORDER = ['Round', 'Config', 'Accuracy', 'TestLoss', 'TrainingLoss', 'SimTime', 'Bytes']
+
+NDJSON_COLUMNS = {
+    'round': 'Round',
+    'config': 'Config',
+    'accuracy': 'Accuracy',
+    'test_loss': 'TestLoss',
+    'training_loss': 'TrainingLoss',
+    'sim_time': 'SimTime',
+    'bytes': 'Bytes',
+}
+
+
+def read_binary_metrics(path):
+    """Read a columnar .smet file."""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != BINARY_MAGIC:
+        raise ValueError(f"{path} is not a binary metrics file")
+    version, columns = struct.unpack_from('<HH', data, 4)
+    if version != BINARY_VERSION or columns != len(BINARY_COLUMNS):
+        raise ValueError(f"Unsupported metrics file version {version}")
+
+    labels = {}
+    chunks = []
+    offset = 8
+    while offset + 8 <= len(data):
+        tag, size = data[offset:offset + 1], struct.unpack_from('<I', data, offset + 4)[0]
+        body = offset + 8
+        if body + size > len(data):
+            break  # Incomplete chunk of a run that is still writing
+        if tag == b'L':
+            config_id = struct.unpack_from('<i', data, body)[0]
+            labels[config_id] = data[body + 4:body + size].decode('utf-8')
+        elif tag == b'R':
+            rows = struct.unpack_from('<I', data, body)[0]
+            column_offset = body + 8
+            chunk = {}
+            for name, dtype in BINARY_COLUMNS:
+                chunk[name] = np.frombuffer(data, dtype=dtype, count=rows, offset=column_offset)
+                column_offset += rows * np.dtype(dtype).itemsize
+            chunks.append(pd.DataFrame(chunk))
+        offset = body + size + (-size % 8)
+
+    if chunks:
+        df = pd.concat(chunks, ignore_index=True)
+    else:
+        df = pd.DataFrame({name: np.array([], dtype=dtype) for name, dtype in BINARY_COLUMNS})
+
+    if (df['ConfigId'] >= 0).any():
+        df['Config'] = df['ConfigId'].map(labels)
+    df = df.drop(columns='ConfigId')
+    return df[[c for c in COLUMN_ORDER if c in df.columns]]
+
+
+def read_metrics(path):
+    """Read a metrics file in any MetricsSink format, chosen by its content."""
+    with open(path, 'rb') as f:
+        head = f.read(4)
+
+    if head == BINARY_MAGIC:
+        return read_binary_metrics(path)
+    if head[:1] == b'{':
+        df = pd.read_json(path, lines=True).rename(columns=NDJSON_COLUMNS)
+        return df[[c for c in COLUMN_ORDER if c in df.columns]]
+    return pd.read_csv(path)